@@ -81,8 +81,7 @@ int main(int argc, const char* argv[]) {
     while (responses.empty());
 
     auto response = responses.front();
-    in_addr addr = {response.fromIp()};
-    std::cout << "IP: " << inet_ntoa(addr) << " Port: " << response.fromPort() << '\n';
+    std::cout << "Server: " << response.from() << '\n';
     std::cout << response.code();
     if (response.hasContentFormat()) {
       std::cout << " - ContentFormat: " << response.contentFormat();
@@ -0,0 +1,40 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Allocations_h
+#define __Allocations_h
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+
+/**
+ * Returns the number of heap allocations of the benchmark process so far,
+ * counted by the replaced global operator new of coap/allocations.
+ */
+size_t allocations();
+
+/**
+ * Reports the heap allocations per iteration of a benchmark as counter "allocs/op".
+ *
+ *   AllocationCounter counter(state);
+ *   for (auto _ : state) { ... }
+ */
+class AllocationCounter {
+ public:
+  explicit AllocationCounter(benchmark::State& state) : state_(state), start_(allocations()) { }
+
+  ~AllocationCounter() {
+    state_.counters["allocs/op"] =
+        benchmark::Counter(static_cast<double>(allocations() - start_), benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State& state_;
+  size_t start_;
+};
+
+#endif  // __Allocations_h
@@ -0,0 +1,147 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "cbor.h"
+#include "json.h"
+
+#include <list>
+#include <map>
+#include <string>
+
+// The same values as the JSON benchmarks, the counter "size" compares the encodings in bytes
+
+namespace {
+
+std::map<std::string, int> object(int64_t size) {
+  std::map<std::string, int> result;
+  for (int64_t i = 0; i < size; ++i) result["key" + std::to_string(i)] = static_cast<int>(i);
+  return result;
+}
+
+std::list<double> array(int64_t size) {
+  std::list<double> result;
+  for (int64_t i = 0; i < size; ++i) result.push_back(i * 0.5);
+  return result;
+}
+
+// A sensor reading, as an object with members of the usual types
+class Reading {
+  std::string name_{"temperature"};
+  double value_{21.5};
+  unsigned int time_{1700000000};
+  bool valid_{true};
+
+ public:
+  void to_json(std::string& out) const {
+    CoAP::append_json(out, "name", name_);
+    out += ',';
+    CoAP::append_json(out, "value", value_);
+    out += ',';
+    CoAP::append_json(out, "time", time_);
+    out += ',';
+    CoAP::append_json(out, "valid", valid_);
+  }
+
+  void from_json(CoAP::StringView members) {
+    CoAP::from_json(members, "name", name_);
+    CoAP::from_json(members, "value", value_);
+    CoAP::from_json(members, "time", time_);
+    CoAP::from_json(members, "valid", valid_);
+  }
+
+  void to_cbor(std::string& out) const {
+    CoAP::append_cbor(out, "name", name_);
+    CoAP::append_cbor(out, "value", value_);
+    CoAP::append_cbor(out, "time", time_);
+    CoAP::append_cbor(out, "valid", valid_);
+  }
+
+  void from_cbor(CoAP::StringView map) {
+    CoAP::from_cbor(map, "name", name_);
+    CoAP::from_cbor(map, "value", value_);
+    CoAP::from_cbor(map, "time", time_);
+    CoAP::from_cbor(map, "valid", valid_);
+  }
+};
+
+template <typename T>
+void encodeJson(benchmark::State& state, const T& value) {
+  std::string out;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_json(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+  state.counters["size"] = out.size();
+}
+
+template <typename T>
+void encodeCbor(benchmark::State& state, const T& value) {
+  std::string out;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_cbor(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+  state.counters["size"] = out.size();
+}
+
+template <typename T>
+void decodeJson(benchmark::State& state, const T& value) {
+  const auto json = CoAP::to_json(value);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    T result;
+    CoAP::from_json(json, result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+  state.counters["size"] = json.size();
+}
+
+template <typename T>
+void decodeCbor(benchmark::State& state, const T& value) {
+  const auto cbor = CoAP::to_cbor(value);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    T result;
+    CoAP::from_cbor(cbor, result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * cbor.size());
+  state.counters["size"] = cbor.size();
+}
+
+void BM_Cbor_EncodeObject(benchmark::State& state) { encodeCbor(state, object(state.range(0))); }
+BENCHMARK(BM_Cbor_EncodeObject)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Cbor_DecodeObject(benchmark::State& state) { decodeCbor(state, object(state.range(0))); }
+BENCHMARK(BM_Cbor_DecodeObject)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Cbor_EncodeArray(benchmark::State& state) { encodeCbor(state, array(state.range(0))); }
+BENCHMARK(BM_Cbor_EncodeArray)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Cbor_DecodeArray(benchmark::State& state) { decodeCbor(state, array(state.range(0))); }
+BENCHMARK(BM_Cbor_DecodeArray)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Cbor_EncodeReadings(benchmark::State& state) { encodeCbor(state, std::list<Reading>(state.range(0))); }
+BENCHMARK(BM_Cbor_EncodeReadings)->ArgName("readings")->Arg(1)->Arg(16);
+
+void BM_Cbor_DecodeReadings(benchmark::State& state) { decodeCbor(state, std::list<Reading>(state.range(0))); }
+BENCHMARK(BM_Cbor_DecodeReadings)->ArgName("readings")->Arg(1)->Arg(16);
+
+void BM_Json_EncodeReadings(benchmark::State& state) { encodeJson(state, std::list<Reading>(state.range(0))); }
+BENCHMARK(BM_Json_EncodeReadings)->ArgName("readings")->Arg(1)->Arg(16);
+
+void BM_Json_DecodeReadings(benchmark::State& state) { decodeJson(state, std::list<Reading>(state.range(0))); }
+BENCHMARK(BM_Json_DecodeReadings)->ArgName("readings")->Arg(1)->Arg(16);
+
+}  // namespace
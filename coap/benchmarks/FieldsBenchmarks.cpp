@@ -0,0 +1,136 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Fields.h"
+#include "cbor.h"
+#include "json.h"
+
+#include <string>
+
+// Objects with 16 members, read by hand with one scan per member or in one pass with the field list
+
+namespace {
+
+struct Members {
+  int a{1}, b{2}, c{3}, d{4}, e{5}, f{6}, g{7}, h{8}, i{9}, j{10}, k{11}, l{12}, m{13}, n{14}, o{15}, p{16};
+};
+
+class ByHand : public Members {
+ public:
+  void to_json(std::string& out) const {
+    const char* keys[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+                          "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa"};
+    const int values[] = {a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p};
+    for (int x = 0; x < 16; ++x) {
+      if (x > 0) out += ',';
+      CoAP::append_json(out, keys[x], values[x]);
+    }
+  }
+
+  void from_json(CoAP::StringView members) {
+    CoAP::from_json(members, "alpha", a);
+    CoAP::from_json(members, "bravo", b);
+    CoAP::from_json(members, "charlie", c);
+    CoAP::from_json(members, "delta", d);
+    CoAP::from_json(members, "echo", e);
+    CoAP::from_json(members, "foxtrot", f);
+    CoAP::from_json(members, "golf", g);
+    CoAP::from_json(members, "hotel", h);
+    CoAP::from_json(members, "india", i);
+    CoAP::from_json(members, "juliett", j);
+    CoAP::from_json(members, "kilo", k);
+    CoAP::from_json(members, "lima", l);
+    CoAP::from_json(members, "mike", m);
+    CoAP::from_json(members, "november", n);
+    CoAP::from_json(members, "oscar", o);
+    CoAP::from_json(members, "papa", p);
+  }
+};
+
+class WithFields : public Members {
+ public:
+  static constexpr auto fields() {
+    using CoAP::field;
+    return CoAP::fields(field("alpha", &Members::a), field("bravo", &Members::b),
+                        field("charlie", &Members::c), field("delta", &Members::d),
+                        field("echo", &Members::e), field("foxtrot", &Members::f),
+                        field("golf", &Members::g), field("hotel", &Members::h),
+                        field("india", &Members::i), field("juliett", &Members::j),
+                        field("kilo", &Members::k), field("lima", &Members::l),
+                        field("mike", &Members::m), field("november", &Members::n),
+                        field("oscar", &Members::o), field("papa", &Members::p));
+  }
+};
+
+void BM_Fields_DecodeJsonByHand(benchmark::State& state) {
+  const auto json = CoAP::to_json(ByHand());
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    ByHand value;
+    CoAP::from_json(json, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_Fields_DecodeJsonByHand);
+
+void BM_Fields_DecodeJson(benchmark::State& state) {
+  const auto json = CoAP::to_json(ByHand());
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    WithFields value;
+    CoAP::from_json(json, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_Fields_DecodeJson);
+
+void BM_Fields_EncodeJsonByHand(benchmark::State& state) {
+  const ByHand value;
+  std::string out;
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_json(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_Fields_EncodeJsonByHand);
+
+void BM_Fields_EncodeJson(benchmark::State& state) {
+  const WithFields value;
+  std::string out;
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_json(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_Fields_EncodeJson);
+
+void BM_Fields_DecodeCbor(benchmark::State& state) {
+  const auto cbor = CoAP::to_cbor(WithFields());
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    WithFields value;
+    CoAP::from_cbor(cbor, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * cbor.size());
+}
+BENCHMARK(BM_Fields_DecodeCbor);
+
+}  // namespace
@@ -0,0 +1,230 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "JsonScan.h"
+#include "json.h"
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::map<std::string, int> object(int64_t size) {
+  std::map<std::string, int> result;
+  for (int64_t i = 0; i < size; ++i) result["key" + std::to_string(i)] = static_cast<int>(i);
+  return result;
+}
+
+std::list<double> array(int64_t size) {
+  std::list<double> result;
+  for (int64_t i = 0; i < size; ++i) result.push_back(i * 0.5);
+  return result;
+}
+
+// The encoding before the appending writer, as baseline
+namespace legacy {
+
+std::string to_json(int value) {
+  return std::to_string(value);
+}
+
+std::string to_json(double value) {
+  auto r = std::to_string(value);
+  auto dotPos = r.find_first_of('.');
+  auto lastNonZeroPos = r.find_last_not_of('0');
+  if (lastNonZeroPos == dotPos) --lastNonZeroPos;
+  if (dotPos != std::string::npos) r = r.substr(0, lastNonZeroPos+1);
+  return r;
+}
+
+std::string to_json(std::string str) {
+  return '\"' + str + '\"';
+}
+
+template <typename T>
+std::string to_json(const std::list<T>& valueList) {
+  std::string s;
+  if (!valueList.empty()) {
+    std::stringstream ss;
+    std::list<std::string> ls;
+    std::transform(valueList.begin(),
+                   valueList.end(),
+                   std::back_insert_iterator<std::list<std::string>>(ls),
+                   [](const T& t) { return to_json(t); });
+
+    std::copy(ls.begin(), ls.end(), std::ostream_iterator<std::string>(ss, ","));
+    s = ss.str();
+    s = s.substr(0, s.size() - 1);
+  }
+  return "[" + s + ']';
+}
+
+template <typename T>
+std::string to_json(const std::map<std::string, T>& valueMap) {
+  std::string s;
+
+  for (auto& e : valueMap) {
+    s += to_json(e.first) + ":" + to_json(e.second) + ",";
+  }
+
+  s = s.empty() ? "" : s.substr(0, s.size() - 1);
+
+  return "{" + s + "}";
+}
+
+}  // namespace legacy
+
+void BM_Json_EncodeObjectLegacy(benchmark::State& state) {
+  const auto value = object(state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(legacy::to_json(value));
+  }
+  state.SetBytesProcessed(state.iterations() * legacy::to_json(value).size());
+}
+BENCHMARK(BM_Json_EncodeObjectLegacy)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_EncodeArrayLegacy(benchmark::State& state) {
+  const auto value = array(state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(legacy::to_json(value));
+  }
+  state.SetBytesProcessed(state.iterations() * legacy::to_json(value).size());
+}
+BENCHMARK(BM_Json_EncodeArrayLegacy)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_EncodeObject(benchmark::State& state) {
+  const auto value = object(state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CoAP::to_json(value));
+  }
+  state.SetBytesProcessed(state.iterations() * CoAP::to_json(value).size());
+}
+BENCHMARK(BM_Json_EncodeObject)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+// Appending into a buffer that is reused, the way a server encodes its responses
+void BM_Json_AppendObject(benchmark::State& state) {
+  const auto value = object(state.range(0));
+  std::string out;
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_json(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_Json_AppendObject)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_DecodeObject(benchmark::State& state) {
+  const auto json = CoAP::to_json(object(state.range(0)));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    std::map<std::string, int> value;
+    CoAP::from_json(json, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_Json_DecodeObject)->ArgName("members")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_EncodeArray(benchmark::State& state) {
+  const auto value = array(state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CoAP::to_json(value));
+  }
+  state.SetBytesProcessed(state.iterations() * CoAP::to_json(value).size());
+}
+BENCHMARK(BM_Json_EncodeArray)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_AppendArray(benchmark::State& state) {
+  const auto value = array(state.range(0));
+  std::string out;
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    out.clear();
+    CoAP::append_json(out, value);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_Json_AppendArray)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_Json_DecodeArray(benchmark::State& state) {
+  const auto json = CoAP::to_json(array(state.range(0)));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    std::list<double> value;
+    CoAP::from_json(json, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_Json_DecodeArray)->ArgName("elements")->Arg(1)->Arg(16)->Arg(256);
+
+// Strings of 1 KB with the scan level 0 (scalar), 1 (SSE2) or 2 (AVX2)
+void BM_Json_DecodeLongStrings(benchmark::State& state) {
+  const auto level = static_cast<CoAP::JsonScanLevel>(state.range(0));
+  if (not CoAP::isJsonScanLevelSupported(level)) {
+    state.SkipWithError("Scan level not supported by the CPU");
+    return;
+  }
+  const auto previous = CoAP::jsonScanLevel();
+  CoAP::setJsonScanLevel(level);
+
+  const auto json = CoAP::to_json(std::list<std::string>(16, std::string(1024, 'x')));
+  std::list<std::string> value;
+  for (auto _ : state) {
+    CoAP::from_json(json, value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+  CoAP::setJsonScanLevel(previous);
+}
+BENCHMARK(BM_Json_DecodeLongStrings)->ArgName("level")->Arg(0)->Arg(1)->Arg(2);
+
+// Skips 16 members of 1 KB to read the last one
+void BM_Json_SkipMembers(benchmark::State& state) {
+  const auto level = static_cast<CoAP::JsonScanLevel>(state.range(0));
+  if (not CoAP::isJsonScanLevelSupported(level)) {
+    state.SkipWithError("Scan level not supported by the CPU");
+    return;
+  }
+  const auto previous = CoAP::jsonScanLevel();
+  CoAP::setJsonScanLevel(level);
+
+  std::map<std::string, std::list<std::string>> object;
+  for (int i = 0; i < 16; ++i) object["key" + std::to_string(i)] = std::list<std::string>(8, std::string(128, 'x'));
+  object["last"] = {};
+  const auto json = CoAP::to_json(object);
+  const auto members = json.substr(1, json.size() - 2);
+  for (auto _ : state) {
+    std::list<std::string> value;
+    CoAP::from_json(members, "last", value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+  CoAP::setJsonScanLevel(previous);
+}
+BENCHMARK(BM_Json_SkipMembers)->ArgName("level")->Arg(0)->Arg(1)->Arg(2);
+
+}  // namespace
@@ -0,0 +1,56 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Logging.h"
+
+#include <iostream>
+#include <sstream>
+
+SETLOGLEVEL(LLDEBUG)
+
+namespace {
+
+// Discards everything written to it
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+void BM_Logging_Record(benchmark::State& state) {
+  NullBuffer buffer;
+  std::ostream null(&buffer);
+  CoAP::setLogStream(null);
+
+  const std::string token = "0x1234abcd";
+  uint16_t messageId = 0;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    // A typical statement of the messaging on the debug level
+    DLOG << "Sending confirmable message with msgID=" << ++messageId << " and token=" << token << '\n';
+    // Keeps the ring buffer from overflowing, which would measure dropping instead of queueing
+    if (messageId % 256 == 0) {
+      state.PauseTiming();
+      CoAP::flushLog();
+      state.ResumeTiming();
+    }
+  }
+
+  CoAP::setLogStream(std::cout);
+}
+BENCHMARK(BM_Logging_Record);
+
+void BM_Logging_Disabled(benchmark::State& state) {
+  uint16_t messageId = 0;
+  for (auto _ : state) {
+    TLOG << "Sending confirmable message with msgID=" << ++messageId << '\n';
+    benchmark::DoNotOptimize(messageId);
+  }
+}
+BENCHMARK(BM_Logging_Disabled);
+
+}  // namespace
@@ -0,0 +1,79 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "IConnection.h"
+#include "Messaging.h"
+#include "RequestHandlers.h"
+
+#include <arpa/inet.h>
+#include <deque>
+
+namespace {
+
+using Queue = std::deque<CoAP::Telegram>;
+
+// One side of an in-memory pair of connections, the telegrams are received from the address of the other side
+class PipeConnection : public CoAP::IConnection {
+ public:
+  PipeConnection(const CoAP::Endpoint& address, std::shared_ptr<Queue> in, std::shared_ptr<Queue> out)
+      : address_(address), in_(in), out_(out) { }
+
+  void send(CoAP::Telegram&& telegram) override {
+    out_->emplace_back(address_, telegram.getMessage());
+  }
+
+  Optional<CoAP::Telegram> get(std::chrono::milliseconds) override {
+    if (in_->empty()) return Optional<CoAP::Telegram>();
+
+    auto telegram = std::move(in_->front());
+    in_->pop_front();
+    return Optional<CoAP::Telegram>(std::move(telegram));
+  }
+
+ private:
+  CoAP::Endpoint address_;
+  std::shared_ptr<Queue> in_;
+  std::shared_ptr<Queue> out_;
+};
+
+void requests(benchmark::State& state, bool confirmable) {
+  auto toServer = std::make_shared<Queue>();
+  auto toClient = std::make_shared<Queue>();
+  const auto serverAddress = CoAP::Endpoint(inet_addr("127.0.0.1"), 5683);
+  const auto clientAddress = CoAP::Endpoint(inet_addr("127.0.0.1"), 40000);
+  CoAP::Messaging server(std::make_shared<PipeConnection>(serverAddress, toServer, toClient));
+  CoAP::Messaging client(std::make_shared<PipeConnection>(clientAddress, toClient, toServer));
+
+  server.requestHandler().onUri("hello").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("world");
+  });
+  auto coapClient = client.getClientFor("127.0.0.1");
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto response = coapClient.GET("hello", confirmable);
+    while (response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
+      server.loopOnce();
+      client.loopOnce();
+    }
+    benchmark::DoNotOptimize(response.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A request and its response pass through the complete stack of a client and a server
+void BM_Loopback_NonConfirmableGet(benchmark::State& state) {
+  requests(state, false);
+}
+BENCHMARK(BM_Loopback_NonConfirmableGet);
+
+void BM_Loopback_ConfirmableGet(benchmark::State& state) {
+  requests(state, true);
+}
+BENCHMARK(BM_Loopback_ConfirmableGet);
+
+}  // namespace
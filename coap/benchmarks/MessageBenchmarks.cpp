@@ -0,0 +1,49 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Message.h"
+
+namespace {
+
+// Option mixes from an empty acknowledgement to a request using all supported options
+CoAP::Message message(int64_t mix) {
+  switch (mix) {
+    case 0:
+      return CoAP::Message(CoAP::Type::Acknowledgement, 0x1234, CoAP::Code::Empty, 0, "");
+    case 1:
+      return CoAP::Message(CoAP::Type::Confirmable, 0x1234, CoAP::Code::GET, 0x42, "sensors/temperature/kitchen");
+    default:
+      return CoAP::Message(CoAP::Type::Confirmable, 0x1234, CoAP::Code::PUT, 0x4242424242,
+                           "sensors/temperature/kitchen?unit=celsius&precision=2", std::string(64, 'x'))
+          .withContentFormat(50)
+          .withObserveValue(0x1234);
+  }
+}
+
+void BM_Message_AsBuffer(benchmark::State& state) {
+  const auto msg = message(state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(msg.asBuffer());
+  }
+  state.SetBytesProcessed(state.iterations() * msg.asBuffer().size());
+}
+BENCHMARK(BM_Message_AsBuffer)->ArgName("options")->DenseRange(0, 2);
+
+void BM_Message_FromBuffer(benchmark::State& state) {
+  const auto buffer = message(state.range(0)).asBuffer();
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CoAP::Message::fromBuffer(buffer));
+  }
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+BENCHMARK(BM_Message_FromBuffer)->ArgName("options")->DenseRange(0, 2);
+
+}  // namespace
@@ -0,0 +1,77 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "IConnection.h"
+#include "Messaging.h"
+#include "ServerImpl.h"
+
+#include <string>
+
+namespace {
+
+class NullConnection : public CoAP::IConnection {
+ public:
+  void send(CoAP::Telegram&&) override { }
+
+  Optional<CoAP::Telegram> get(std::chrono::milliseconds) override { return Optional<CoAP::Telegram>(); }
+};
+
+CoAP::RestResponse request(CoAP::Messaging& messaging, CoAP::Code code, const std::string& uri,
+                           const std::string& payload = "") {
+  const auto message = CoAP::Message(CoAP::Type::NonConfirmable, 1, code, 1, uri, payload);
+  return messaging.getServer().onRequest(message, CoAP::Endpoint());
+}
+
+// Registers the endpoints, every 1000th with a rare resource type
+void registerEndpoints(CoAP::Messaging& messaging, int64_t endpoints) {
+  messaging.enableResourceDirectory();
+  for (int64_t i = 0; i < endpoints; ++i) {
+    const auto resourceType = (i % 1000 == 0) ? "rare" : "common";
+    request(messaging, CoAP::Code::POST, "/rd?ep=node" + std::to_string(i) + "&base=coap://10.0.0.1",
+            std::string("</temp>;rt=") + resourceType + ";if=sensor,</led>;rt=light");
+  }
+}
+
+void BM_ResourceDirectory_Register(benchmark::State& state) {
+  CoAP::Messaging messaging(std::make_shared<NullConnection>());
+  registerEndpoints(messaging, state.range(0));
+  int64_t i = 0;
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    // Registrations of the same endpoints replace each other
+    const auto uri = "/rd?ep=node" + std::to_string(i++ % state.range(0)) + "&base=coap://10.0.0.2";
+    benchmark::DoNotOptimize(request(messaging, CoAP::Code::POST, uri, "</temp>;rt=common;if=sensor"));
+  }
+}
+BENCHMARK(BM_ResourceDirectory_Register)->ArgName("endpoints")->Arg(1000)->Arg(100000);
+
+// The resource type index limits the lookup to the matching endpoints
+void BM_ResourceDirectory_LookupIndexed(benchmark::State& state) {
+  CoAP::Messaging messaging(std::make_shared<NullConnection>());
+  registerEndpoints(messaging, state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(request(messaging, CoAP::Code::GET, "/rd-lookup/res?rt=rare&page=0&count=10"));
+  }
+}
+BENCHMARK(BM_ResourceDirectory_LookupIndexed)->ArgName("endpoints")->Arg(1000)->Arg(100000);
+
+// Wildcards are not indexed, the registrations are visited until the page is full
+void BM_ResourceDirectory_LookupWildcard(benchmark::State& state) {
+  CoAP::Messaging messaging(std::make_shared<NullConnection>());
+  registerEndpoints(messaging, state.range(0));
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(request(messaging, CoAP::Code::GET, "/rd-lookup/res?rt=ra*&page=0&count=10"));
+  }
+}
+BENCHMARK(BM_ResourceDirectory_LookupWildcard)->ArgName("endpoints")->Arg(1000)->Arg(100000);
+
+}  // namespace
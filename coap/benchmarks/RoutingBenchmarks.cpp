@@ -0,0 +1,81 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Path.h"
+#include "PathPattern.h"
+#include "RequestHandlers.h"
+
+#include <string>
+
+namespace {
+
+void BM_Path_Construct(benchmark::State& state) {
+  const std::string uri = "/building/floor-2/room-17/sensors/temperature";
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Path(uri));
+  }
+}
+BENCHMARK(BM_Path_Construct);
+
+void BM_Path_GetPart(benchmark::State& state) {
+  const Path path("/building/floor-2/room-17/sensors/temperature");
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(path.getPart(3));
+  }
+}
+BENCHMARK(BM_Path_GetPart);
+
+// Patterns of increasing generality matching the same path
+const char* patterns[] = {
+    "/building/floor-2/room-17/sensors/temperature",
+    "/building/?/?/sensors/temperature",
+    "/building/*",
+};
+
+void BM_PathPattern_Match(benchmark::State& state) {
+  const PathPattern pattern{std::string(patterns[state.range(0)])};
+  const Path path("/building/floor-2/room-17/sensors/temperature");
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pattern.match(path));
+  }
+}
+BENCHMARK(BM_PathPattern_Match)->ArgName("pattern")->DenseRange(0, 2);
+
+// Looks up the route registered last, the worst case for a linear search
+void BM_RequestHandlers_GetHandler(benchmark::State& state) {
+  const auto routes = state.range(0);
+  CoAP::RequestHandlers handlers;
+  for (int64_t i = 0; i < routes; ++i) handlers.onUri("devices/" + std::to_string(i) + "/state");
+  const Path path("devices/" + std::to_string(routes - 1) + "/state");
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(handlers.getHandler(path));
+  }
+}
+BENCHMARK(BM_RequestHandlers_GetHandler)->ArgName("routes")->Arg(10)->Arg(1000)->Arg(10000);
+
+void BM_RequestHandlers_GetHandlerMiss(benchmark::State& state) {
+  const auto routes = state.range(0);
+  CoAP::RequestHandlers handlers;
+  for (int64_t i = 0; i < routes; ++i) handlers.onUri("devices/" + std::to_string(i) + "/state");
+  const Path path("unknown/resource");
+
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(handlers.getHandler(path));
+  }
+}
+BENCHMARK(BM_RequestHandlers_GetHandlerMiss)->ArgName("routes")->Arg(10)->Arg(1000)->Arg(10000);
+
+}  // namespace
@@ -0,0 +1,142 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Aggregation_h
+#define __Aggregation_h
+
+#include "Endpoint.h"
+#include "Parameters.h"
+#include "RestResponse.h"
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace CoAP {
+
+/*
+ * Class: Aggregation
+ *
+ * Collects the responses to a multicast request, one per server.
+ *
+ * The aggregation completes when the requested number of servers responded, when
+ * the timeout passed or when it is cancelled. Further responses are ignored then
+ * and the token of the request is released.
+ *
+ * The payload of every server is copied once, the callback and the results share it.
+ *
+ * Aggregations can be created with <MClient::GET()>.
+ */
+class Aggregation {
+ public:
+  // Payload of a response, shared by the callback and the results
+  using Payload = std::shared_ptr<const std::vector<uint8_t>>;
+
+  struct Response {
+    Endpoint from;
+    Code code{Code::Empty};
+    Payload payload;
+  };
+
+  using Callback = std::function<void(const Response&)>;
+
+  struct Options {
+    // Number of servers after which the aggregation completes
+    size_t maxResponses{std::numeric_limits<size_t>::max()};
+
+    // Time after which the aggregation completes, servers respond within the leisure period
+    std::chrono::milliseconds timeout{static_cast<long>(DEFAULT_LEASURE * 1000) + ACK_TIMEOUT.count()};
+
+    // Called for the first response of every server
+    Callback onResponse{nullptr};
+
+    // Whether the responses shall be kept for <results()>, disable it to only count them
+    bool keepResponses{true};
+  };
+
+  /*
+   * Constructor: Aggregation
+   *
+   * Parameters:
+   *    options  - Completion criteria of the aggregation
+   *    onCancel - Called when the aggregation gets cancelled, e.g. to release the token of the request
+   */
+  explicit Aggregation(const Options& options, std::function<void()> onCancel = nullptr);
+
+  /*
+   * Method: results
+   *
+   * Returns:
+   *    A future with the responses of the servers, it becomes ready when the aggregation completed.
+   */
+  std::shared_future<std::vector<Response>> results() const { return results_; }
+
+  /*
+   * Method: count
+   *
+   * Returns:
+   *    The number of servers that responded so far.
+   */
+  size_t count() const;
+
+  /*
+   * Method: done
+   *
+   * Returns:
+   *    true if the aggregation completed.
+   */
+  bool done() const;
+
+  /*
+   * Method: cancel
+   *
+   * Completes the aggregation with the responses received so far, further responses
+   * are not received anymore.
+   */
+  void cancel();
+
+  /*
+   * Method: onResponse
+   *
+   * onResponse is being called for every response to the request.
+   *
+   * Parameters:
+   *    from    - Sender of the response
+   *    code    - Response code
+   *    payload - Payload of the response, it is copied only for the first response of a server
+   *
+   * Returns:
+   *    false if the aggregation completed and needs no further responses.
+   */
+  bool onResponse(const Endpoint& from, Code code, const std::string& payload);
+
+  /*
+   * Method: complete
+   *
+   * complete is being called when no further responses will be accepted.
+   */
+  void complete();
+
+ private:
+  const Options options_;
+  std::function<void()> onCancel_;
+
+  mutable std::mutex mutex_;
+  std::unordered_set<Endpoint> senders_;
+  std::vector<Response> responses_;
+  std::promise<std::vector<Response>> promise_;
+  std::shared_future<std::vector<Response>> results_;
+  bool done_{false};
+};
+
+}  // namespace CoAP
+
+#endif  // __Aggregation_h
@@ -0,0 +1,121 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __BatchClient_h
+#define __BatchClient_h
+
+#include "Endpoint.h"
+#include "Notifications.h"
+#include "Parameters.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CoAP {
+
+class ClientImpl;
+
+/*
+ * Class: BatchClient
+ *
+ * Client for sending the same request to many servers at once.
+ *
+ * The request is encoded only once and then sent as nonconfirmable message to
+ * all targets with individual tokens and message IDs. The results are provided
+ * as one stream of <RestResponse> with the sender address set, one per target.
+ * Targets that do not respond within the timeout are reported with the code
+ * GatewayTimeout. The stream is closed when every target has been reported.
+ *
+ * Batch clients can be created with <IMessaging::getBatchClient()>.
+ */
+class BatchClient {
+ public:
+  // Server address (IP and port) of a target
+  using Target = Endpoint;
+
+  explicit BatchClient(ClientImpl& impl);
+
+  /*
+   * Method: GET
+   *
+   * Sends a GET request to all targets in order to read a resource.
+   *
+   * Parameters:
+   *    targets - Servers to send the request to
+   *    uri     - URI of the ressource to be returned
+   *    timeout - Time to wait for the response of each target
+   *
+   * Returns:
+   *    Results with one <RestResponse> per target.
+   */
+  std::shared_ptr<Notifications> GET(const std::vector<Target>& targets,
+                                     std::string uri,
+                                     std::chrono::milliseconds timeout = MAX_TRANSMIT_WAIT);
+
+  /*
+   * Method: PUT
+   *
+   * Sends a PUT request to all targets in order to update a resource.
+   *
+   * Parameters:
+   *    targets - Servers to send the request to
+   *    uri     - URI of the ressource to be updated
+   *    payload - Payload of the PUT request being sent
+   *    timeout - Time to wait for the response of each target
+   *
+   * Returns:
+   *    Results with one <RestResponse> per target.
+   */
+  std::shared_ptr<Notifications> PUT(const std::vector<Target>& targets,
+                                     std::string uri,
+                                     std::string payload,
+                                     std::chrono::milliseconds timeout = MAX_TRANSMIT_WAIT);
+
+  /*
+   * Method: POST
+   *
+   * Sends a POST request to all targets in order to create a resource.
+   *
+   * Parameters:
+   *    targets - Servers to send the request to
+   *    uri     - URI of the ressource to be created
+   *    payload - Payload of the POST request being sent
+   *    timeout - Time to wait for the response of each target
+   *
+   * Returns:
+   *    Results with one <RestResponse> per target.
+   */
+  std::shared_ptr<Notifications> POST(const std::vector<Target>& targets,
+                                      std::string uri,
+                                      std::string payload,
+                                      std::chrono::milliseconds timeout = MAX_TRANSMIT_WAIT);
+
+  /*
+   * Method: DELETE
+   *
+   * Sends a DELETE request to all targets in order to delete a resource.
+   *
+   * Parameters:
+   *    targets - Servers to send the request to
+   *    uri     - URI of the ressource to be deleted
+   *    timeout - Time to wait for the response of each target
+   *
+   * Returns:
+   *    Results with one <RestResponse> per target.
+   */
+  std::shared_ptr<Notifications> DELETE(const std::vector<Target>& targets,
+                                        std::string uri,
+                                        std::chrono::milliseconds timeout = MAX_TRANSMIT_WAIT);
+
+ private:
+  ClientImpl& impl_;
+};
+
+}  // namespace CoAP
+
+#endif  // __BatchClient_h
@@ -7,12 +7,14 @@
 #ifndef __Client_h
 #define __Client_h
 
+#include "Endpoint.h"
 #include "Notifications.h"
+#include "PipelineStatistics.h"
 #include "RestResponse.h"
 
+#include <functional>
 #include <string>
 #include <future>
-#include <netinet/in.h>
 #include <map>
 
 namespace CoAP {
@@ -26,11 +28,15 @@ class IRequestHandler;
  * Instance of CoAP client connected to a CoAP server. It provides users with the
  * ability to send REST requests in an asynchronous way.
  *
- * Clients can be created with <IMessaging::getClientFor()>.
+ * Clients can be created with <IMessaging::getClientFor()>. The server name is
+ * resolved in the background, requests sent before the resolution finished
+ * wait for it in the message processing loop, such that no call blocks the
+ * caller. Requests to servers whose name cannot be resolved are answered with
+ * <Code::ServiceUnavailable>.
  */
 class Client {
  public:
-  Client(ClientImpl& impl, std::string server, uint16_t server_port);
+  Client(ClientImpl& impl, std::shared_future<Endpoint> server_ip, uint16_t server_port);
 
   /*
    * Method: GET
@@ -47,6 +53,22 @@ class Client {
    */
   std::future<RestResponse> GET(std::string uri, bool confirmable = false);
 
+  /*
+   * Method: GET
+   *
+   * Sends a GET request to the CoAP server in order to read a resource in the given content format.
+   *
+   * Parameters:
+   *    uri         - URI of the ressource to be returned
+   *    confirmable - true: confirmable messaging /
+   *                  false: nonconfirmable messaging
+   *    accept      - Content format of the response, see <ContentFormat>
+   *
+   * Returns:
+   *    A future with the <RestResponse>, once it will be received.
+   */
+  std::future<RestResponse> GET(std::string uri, bool confirmable, uint16_t accept);
+
   /*
    * Method: PUT
    *
@@ -120,12 +142,37 @@ class Client {
    */
   std::shared_ptr<Notifications> OBSERVE(std::string uri, bool confirmable = false);
 
+  /*
+   * Method: setWindow
+   *
+   * Limits the number of requests in flight to the server. Further requests are
+   * queued and sent as soon as responses for the requests in flight arrive.
+   * The window is shared by all clients of the same server.
+   *
+   * Parameters:
+   *    window - Maximum number of requests in flight, at least one
+   */
+  void setWindow(unsigned window);
+
+  /*
+   * Method: statistics
+   *
+   * Returns:
+   *    The <PipelineStatistics> of all requests sent to the server.
+   */
+  PipelineStatistics statistics() const;
+
  private:
   std::future<RestResponse> asFuture(const std::shared_ptr<Notifications>& responses);
 
+  // Sends the request with the sender once the address of the server is resolved, without blocking the caller
+  template <typename Sender>
+  std::shared_ptr<Notifications> send(Sender sender);
+
   ClientImpl& impl_;
 
-  in_addr_t server_ip_;
+  // IPv4 or IPv6 address of the server, once resolved
+  std::shared_future<Endpoint> server_ip_;
   uint16_t server_port_;
 
   // Continuously increasing unique id for promises made by this client
@@ -8,9 +8,16 @@
 #define __CoAP_h
 
 #include "Client.h"
+#include "ContentFormat.h"
+#include "DtlsCredentials.h"
+#include "Endpoint.h"
 #include "RequestHandler.h"
 #include "RequestHandlers.h"
 #include "IMessaging.h"
+#include "Metrics.h"
+#include "Tracing.h"
+#include "cbor.h"
+#include "json.h"
 
 namespace CoAP {
 
@@ -31,6 +38,107 @@ namespace CoAP {
  */
 std::unique_ptr<IMessaging> newMessaging(uint16_t port = 5683);
 
+/*
+ * Function: newTcpMessaging
+ *
+ * Instantiates a CoAP messaging system using the reliable transport over TCP
+ * according to RFC 8323 instead of UDP.
+ *
+ * Connections to servers are established on demand and kept open, confirmable
+ * messages are acknowledged by the transport and large payloads are transferred
+ * in one message.
+ *
+ * Parameters:
+ *    port - TCP port on which the server is listening for connections.
+ *
+ * Returns:
+ *    An instance of the messaging system.
+ */
+std::unique_ptr<IMessaging> newTcpMessaging(uint16_t port = 5683);
+
+/*
+ * Function: newSecureMessaging
+ *
+ * Instantiates a CoAP messaging system for coaps, protecting all messages
+ * with DTLS 1.2 in PSK or certificate mode.
+ *
+ * Parameters:
+ *    credentials - Keys or certificates of this endpoint.
+ *    port        - UDP port on which the server is listening for handshakes.
+ *
+ * Returns:
+ *    An instance of the messaging system.
+ *
+ * Throws:
+ *    std::logic_error   - if the library was built without DTLS support.
+ *    std::runtime_error - if the credentials are invalid.
+ */
+std::unique_ptr<IMessaging> newSecureMessaging(const DtlsCredentials& credentials, uint16_t port = 20220);
+
+/*
+ * Function: newUnixMessaging
+ *
+ * Instantiates a CoAP messaging system using Unix domain datagram sockets
+ * instead of UDP, for the communication between processes on the same host.
+ *
+ * Clients reach a server by its socket path, like getClientFor("/run/coap.sock"),
+ * the port of the client is ignored.
+ *
+ * Parameters:
+ *    path - File system path or abstract name starting with '@' of the socket,
+ *           an empty path binds to a unique abstract name chosen by the kernel.
+ *
+ * Returns:
+ *    An instance of the messaging system.
+ *
+ * Throws:
+ *    std::runtime_error - if the socket could not be opened.
+ */
+std::unique_ptr<IMessaging> newUnixMessaging(const std::string& path = "");
+
+/*
+ * Function: newShmMessaging
+ *
+ * Instantiates a CoAP messaging system that communicates with one peer process
+ * on the same host through shared memory instead of UDP.
+ *
+ * This side creates the shared memory, the peer attaches to it with
+ * <newShmMessaging(int fd)> after receiving the file descriptor, e.g. by
+ * inheriting it through fork() or via SCM_RIGHTS. Clients address the peer
+ * with its endpoint, all received messages stem from it.
+ *
+ * Parameters:
+ *    self     - Endpoint of this side as seen by the peer.
+ *    peer     - Endpoint of the peer.
+ *    fd       - Receives the file descriptor of the shared memory, it is closed with the messaging system.
+ *    capacity - Size of the ring buffer of each direction in bytes, a power of two.
+ *
+ * Returns:
+ *    An instance of the messaging system.
+ *
+ * Throws:
+ *    std::runtime_error - if the shared memory could not be created.
+ */
+std::unique_ptr<IMessaging> newShmMessaging(const Endpoint& self, const Endpoint& peer, int& fd,
+                                            size_t capacity = 1024 * 1024);
+
+/*
+ * Function: newShmMessaging
+ *
+ * Instantiates a CoAP messaging system that attaches to the shared memory created
+ * by the peer process, see <newShmMessaging(const Endpoint&, const Endpoint&, int&, size_t)>.
+ *
+ * Parameters:
+ *    fd - File descriptor of the shared memory, it is duplicated.
+ *
+ * Returns:
+ *    An instance of the messaging system.
+ *
+ * Throws:
+ *    std::runtime_error - if the file descriptor does not refer to the shared memory of a peer.
+ */
+std::unique_ptr<IMessaging> newShmMessaging(int fd);
+
 }  // namespace CoAP
 
 #endif // __CoAP_h
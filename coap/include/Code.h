@@ -11,33 +11,34 @@
 
 namespace CoAP {
 
+// Value, name and HTTP status code of the codes, the HTTP status codes follow RFC 8075, section 7
 #define COAP_CODES \
-  COAP_CODE(0x00, Empty) \
-  COAP_CODE(0x01, GET) \
-  COAP_CODE(0x02, POST) \
-  COAP_CODE(0x03, PUT) \
-  COAP_CODE(0x04, DELETE) \
-  COAP_CODE(0x41, Created)                  /* 2.01 */ \
-  COAP_CODE(0x42, Deleted)                  /* 2.02 */ \
-  COAP_CODE(0x43, Valid)                    /* 2.03 */ \
-  COAP_CODE(0x44, Changed)                  /* 2.04 */ \
-  COAP_CODE(0x45, Content)                  /* 2.05 */ \
-  COAP_CODE(0x80, BadRequest)               /* 4.00 */ \
-  COAP_CODE(0x81, Unauthorized)             /* 4.01 */ \
-  COAP_CODE(0x82, BadOption)                /* 4.02 */ \
-  COAP_CODE(0x83, Forbidden)                /* 4.03 */ \
-  COAP_CODE(0x84, NotFound)                 /* 4.04 */ \
-  COAP_CODE(0x85, MethodNotAllowed)         /* 4.05 */ \
-  COAP_CODE(0x86, NotAcceptable)            /* 4.06 */ \
-  COAP_CODE(0x8c, PreconditionFailed)       /* 4.12 */ \
-  COAP_CODE(0x8d, RequestEntityTooLarge)    /* 4.13 */ \
-  COAP_CODE(0x8f, UnsupportedContentFormat) /* 4.15 */ \
-  COAP_CODE(0xa0, InternalServerError)      /* 5.00 */ \
-  COAP_CODE(0xa1, NotImplemented)           /* 5.01 */ \
-  COAP_CODE(0xa2, BadGateway)               /* 5.02 */ \
-  COAP_CODE(0xa3, ServiceUnavailable)       /* 5.03 */ \
-  COAP_CODE(0xa4, GatewayTimeout)           /* 5.04 */ \
-  COAP_CODE(0xa5, ProxyingNotSupported)     /* 5.05 */
+  COAP_CODE(0x00, Empty, 0) \
+  COAP_CODE(0x01, GET, 0) \
+  COAP_CODE(0x02, POST, 0) \
+  COAP_CODE(0x03, PUT, 0) \
+  COAP_CODE(0x04, DELETE, 0) \
+  COAP_CODE(0x41, Created, 201)                   /* 2.01 */ \
+  COAP_CODE(0x42, Deleted, 200)                   /* 2.02 */ \
+  COAP_CODE(0x43, Valid, 200)                     /* 2.03 */ \
+  COAP_CODE(0x44, Changed, 200)                   /* 2.04 */ \
+  COAP_CODE(0x45, Content, 200)                   /* 2.05 */ \
+  COAP_CODE(0x80, BadRequest, 400)                /* 4.00 */ \
+  COAP_CODE(0x81, Unauthorized, 403)              /* 4.01 */ \
+  COAP_CODE(0x82, BadOption, 400)                 /* 4.02 */ \
+  COAP_CODE(0x83, Forbidden, 403)                 /* 4.03 */ \
+  COAP_CODE(0x84, NotFound, 404)                  /* 4.04 */ \
+  COAP_CODE(0x85, MethodNotAllowed, 405)          /* 4.05 */ \
+  COAP_CODE(0x86, NotAcceptable, 406)             /* 4.06 */ \
+  COAP_CODE(0x8c, PreconditionFailed, 412)        /* 4.12 */ \
+  COAP_CODE(0x8d, RequestEntityTooLarge, 413)     /* 4.13 */ \
+  COAP_CODE(0x8f, UnsupportedContentFormat, 415)  /* 4.15 */ \
+  COAP_CODE(0xa0, InternalServerError, 500)       /* 5.00 */ \
+  COAP_CODE(0xa1, NotImplemented, 501)            /* 5.01 */ \
+  COAP_CODE(0xa2, BadGateway, 502)                /* 5.02 */ \
+  COAP_CODE(0xa3, ServiceUnavailable, 503)        /* 5.03 */ \
+  COAP_CODE(0xa4, GatewayTimeout, 504)            /* 5.04 */ \
+  COAP_CODE(0xa5, ProxyingNotSupported, 502)      /* 5.05 */
 
 
 /*
@@ -76,12 +77,20 @@ namespace CoAP {
  *
  */
 enum class Code {
-#define COAP_CODE(V, N) N = V,
+#define COAP_CODE(V, N, H) N = V,
   COAP_CODES
 #undef COAP_CODE
 };
 
 
+/*
+ * Function: httpStatus
+ *
+ * Returns:
+ *    The HTTP status code of the response code, which a HTTP-to-CoAP proxy returns, or 0 for request codes.
+ */
+unsigned httpStatus(Code code);
+
 std::ostream& operator<<(std::ostream& os, Code rhs);
 
 }  // namespace CoAP
@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __ContentFormat_h
+#define __ContentFormat_h
+
+#include "Optional.h"
+#include "StringView.h"
+
+#include <cstdint>
+
+namespace CoAP {
+
+/*
+ * Namespace: ContentFormat
+ *
+ * Numbers of the content formats in the Content-Format and Accept options,
+ * see the CoAP Content-Formats registry of IANA.
+ */
+namespace ContentFormat {
+
+constexpr uint16_t TextPlain = 0;
+constexpr uint16_t LinkFormat = 40;
+constexpr uint16_t OctetStream = 42;
+constexpr uint16_t Json = 50;
+constexpr uint16_t Cbor = 60;
+
+/*
+ * Function: mediaType
+ *
+ * Returns:
+ *    The Internet media type of the content format, e.g. for the Content-Type header of HTTP,
+ *    or nullptr if the content format is not known.
+ */
+const char* mediaType(uint16_t contentFormat);
+
+/*
+ * Function: fromMediaType
+ *
+ * Parameters:
+ *    mediaType - Internet media type, parameters besides charset=utf-8 are ignored
+ *
+ * Returns:
+ *    The content format of the media type, if it is known.
+ */
+Optional<uint16_t> fromMediaType(StringView mediaType);
+
+}  // namespace ContentFormat
+
+}  // namespace CoAP
+
+#endif  // __ContentFormat_h
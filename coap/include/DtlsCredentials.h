@@ -0,0 +1,60 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __DtlsCredentials_h
+#define __DtlsCredentials_h
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+namespace CoAP {
+
+/*
+ * Class: DtlsCredentials
+ *
+ * Security settings of the DTLS 1.2 transport used for coaps.
+ *
+ * Either a pre-shared key (PSK mode) or a certificate with its private key
+ * (certificate mode) must be given, both may be combined.
+ */
+struct DtlsCredentials {
+  // Identity sent to servers in PSK mode
+  std::string pskIdentity;
+
+  // Raw key bytes for PSK mode, empty disables PSK mode
+  std::string psk;
+
+  // Lookup of the key for an identity announced by a client, by default
+  // only pskIdentity is accepted. Returns an empty key for unknown identities.
+  std::function<std::string(const std::string& identity)> pskLookup;
+
+  // PEM encoded certificate chain and private key for certificate mode
+  std::string certificate;
+  std::string privateKey;
+
+  // PEM encoded certificates trusted for peer verification. Servers must always
+  // present a certificate signed by one of them, such that clients without trusted
+  // certificates only succeed with PSK handshakes. If given, clients are asked
+  // for their certificate as well.
+  std::string trustedCertificates;
+
+  // Sessions without any received record for this time are closed
+  std::chrono::milliseconds idleTimeout{std::chrono::minutes(5)};
+
+  // Sessions to servers that have been silent for this time are resumed with an
+  // abbreviated handshake before sending, as the address of this client might
+  // have changed in the meantime (NAT rebinding).
+  std::chrono::milliseconds resumeAfterIdle{std::chrono::seconds(30)};
+
+  // Handshakes of clients pending at the same time, further ClientHellos are ignored
+  // until one of them is finished or timed out.
+  unsigned maxPendingHandshakes{32};
+};
+
+}  // namespace CoAP
+
+#endif  // __DtlsCredentials_h
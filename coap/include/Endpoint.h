@@ -0,0 +1,180 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Endpoint_h
+#define __Endpoint_h
+
+#include "Optional.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iosfwd>
+#include <netinet/in.h>
+#include <string>
+
+namespace CoAP {
+
+/*
+ * Class: Endpoint
+ *
+ * Address of a communication partner consisting of an IPv4 or IPv6 address
+ * and a port.
+ *
+ * Endpoints are compact (24 bytes), trivially copyable, comparable and hashable,
+ * such that they can be used as keys for the state kept per communication partner.
+ * IPv4-mapped IPv6 addresses as received on dual-stack sockets are stored as
+ * IPv4 addresses.
+ */
+class Endpoint {
+ public:
+  /*
+   * Constructor
+   *
+   * Creates an unspecified endpoint.
+   */
+  Endpoint() = default;
+
+  /*
+   * Constructor
+   *
+   * Parameters:
+   *    ip   - IPv4 address in network byte order
+   *    port - Port in host byte order
+   */
+  Endpoint(in_addr_t ip, uint16_t port);
+
+  /*
+   * Constructor
+   *
+   * Parameters:
+   *    ip      - IPv6 address
+   *    port    - Port in host byte order
+   *    scopeId - Interface index for link-local addresses
+   */
+  Endpoint(const in6_addr& ip, uint16_t port, uint32_t scopeId = 0);
+
+  /*
+   * Method: fromString
+   *
+   * Parses a numeric IPv4 or IPv6 address, the latter optionally with an interface
+   * name or index as scope, e.g. "ff02::fd%eth0".
+   *
+   * Returns:
+   *    The endpoint or nothing if the string is no valid address.
+   */
+  static Optional<Endpoint> fromString(const std::string& ip, uint16_t port);
+
+  /*
+   * Method: fromSockaddr
+   *
+   * Returns:
+   *    The endpoint for the socket address of family AF_INET or AF_INET6.
+   */
+  static Endpoint fromSockaddr(const sockaddr* address);
+
+  /*
+   * Method: toSockaddr
+   *
+   * Fills the socket address for sending to this endpoint.
+   *
+   * Parameters:
+   *    address - Socket address to be filled
+   *    family  - Address family of the socket, IPv4 endpoints are mapped for AF_INET6 sockets
+   *
+   * Returns:
+   *    The length of the socket address
+   *
+   * Throws:
+   *    std::invalid_argument - for IPv6 endpoints and AF_INET sockets, unless the address is IPv4-mapped
+   */
+  socklen_t toSockaddr(sockaddr_storage& address, int family) const;
+
+  bool isIPv4() const { return family_ == AF_INET; }
+
+  bool isIPv6() const { return family_ == AF_INET6; }
+
+  /*
+   * Method: isMulticast
+   *
+   * Returns:
+   *    true if the address is an IPv4 or IPv6 multicast address.
+   */
+  bool isMulticast() const;
+
+  /*
+   * Method: ipv4
+   *
+   * Returns:
+   *    The IPv4 address in network byte order or 0 for IPv6 endpoints.
+   */
+  in_addr_t ipv4() const;
+
+  /*
+   * Method: ipv6
+   *
+   * Returns:
+   *    The IPv6 address, IPv4 addresses are returned IPv4-mapped.
+   */
+  in6_addr ipv6() const;
+
+  uint16_t port() const { return port_; }
+
+  uint32_t scopeId() const { return scopeId_; }
+
+  /*
+   * Method: withPort
+   *
+   * Returns:
+   *    A copy of the endpoint with the port replaced.
+   */
+  Endpoint withPort(uint16_t port) const {
+    auto endpoint = *this;
+    endpoint.port_ = port;
+    return endpoint;
+  }
+
+  /*
+   * Method: toString
+   *
+   * Returns:
+   *    Textual representation like "192.168.0.1:5683" or "[ff02::fd]:5683".
+   */
+  std::string toString() const;
+
+  size_t hash() const {
+    uint64_t words[3];
+    memcpy(words, this, sizeof(words));
+    return std::hash<uint64_t>()(words[0] ^ (words[1] * 0x9e3779b97f4a7c15ULL) ^ (words[2] * 0xc2b2ae3d27d4eb4fULL));
+  }
+
+  bool operator==(const Endpoint& rhs) const { return memcmp(this, &rhs, sizeof(Endpoint)) == 0; }
+
+  bool operator!=(const Endpoint& rhs) const { return not (*this == rhs); }
+
+  bool operator<(const Endpoint& rhs) const { return memcmp(this, &rhs, sizeof(Endpoint)) < 0; }
+
+ private:
+  // All members are initialized, such that endpoints can be compared and hashed bytewise
+  uint16_t family_{AF_UNSPEC};
+  uint16_t port_{0};
+  uint32_t scopeId_{0};
+  uint8_t address_[16]{};
+};
+
+static_assert(sizeof(Endpoint) == 24, "Endpoint must stay compact");
+
+std::ostream& operator<<(std::ostream& os, const Endpoint& endpoint);
+
+}  // namespace CoAP
+
+namespace std {
+template<> struct hash<CoAP::Endpoint> {
+  size_t operator()(const CoAP::Endpoint& endpoint) const { return endpoint.hash(); }
+};
+}  // namespace std
+
+#endif  // __Endpoint_h
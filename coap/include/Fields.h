@@ -0,0 +1,180 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/**
+ * Declarative field lists for the conversions of json.h and cbor.h.
+ *
+ * Instead of writing to_json()/from_json() and to_cbor()/from_cbor() by hand, an object lists its members once:
+ *
+ *    class Reading {
+ *      std::string name_;
+ *      double value_;
+ *     public:
+ *      static constexpr auto fields() {
+ *        return CoAP::fields(CoAP::field("name", &Reading::name_),
+ *                            CoAP::field("value", &Reading::value_));
+ *      }
+ *    };
+ *
+ * The conversions then write the members in the order of the list and read an object in a single pass.
+ * The keys are found with a perfect hash, which is computed from the list at compile time.
+ */
+
+#pragma once
+
+#ifndef __Fields_h
+#define __Fields_h
+
+#include "StringView.h"
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace CoAP {
+
+/*
+ * Struct: Field
+ *
+ * Key and member pointer of a member of type M in objects of type T.
+ */
+template <typename T, typename M>
+struct Field {
+  using Object = T;
+  using Member = M;
+
+  const char* key;
+  size_t size;
+  M T::* member;
+};
+
+/*
+ * Function: field
+ *
+ * Returns:
+ *    The field of the member with the key, which is a string literal.
+ */
+template <typename T, typename M, size_t N>
+constexpr Field<T, M> field(const char (&key)[N], M T::* member) {
+  return Field<T, M>{key, N - 1, member};
+}
+
+/*
+ * Function: fields
+ *
+ * Returns:
+ *    The list of fields, to be returned by the static method fields() of the object.
+ */
+template <typename... F>
+constexpr std::tuple<F...> fields(F... f) {
+  return std::tuple<F...>(f...);
+}
+
+namespace __internal__ {
+
+// The conversions dispatch on HasFields<T>::type, a type of namespace std,
+// so that argument dependent lookup does not mix the JSON and CBOR overloads
+template <typename T, typename = void>
+struct HasFields : std::false_type {};
+
+template <typename T>
+struct HasFields<T, decltype(void(T::fields()))> : std::true_type {};
+
+template <typename T>
+using FieldList = decltype(T::fields());
+
+template <typename T>
+using FieldIndices = std::make_index_sequence<std::tuple_size<FieldList<T>>::value>;
+
+// FNV-1a, the seed selects one of a family of hash functions
+constexpr uint32_t keyHash(const char* key, size_t size, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(key[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Power of two with at most half of the slots used, which keeps the search for a seed short
+constexpr size_t keySlots(size_t count) {
+  size_t slots = 2;
+  while (slots < 2 * count) slots *= 2;
+  return slots;
+}
+
+/**
+ * Perfect hash of the keys of N fields: the slot of every key holds its index plus one,
+ * all other slots are 0.
+ */
+template <size_t N>
+struct KeyTable {
+  static constexpr size_t slotCount = keySlots(N);
+
+  uint32_t seed;
+  uint8_t slots[slotCount];
+  const char* keys[N];
+  size_t sizes[N];
+
+  // The low bits of FNV-1a depend only on the low bits of the seed, the slot is taken from the upper half
+  constexpr size_t slot(const char* key, size_t size) const {
+    return (keyHash(key, size, seed) >> 16) & (slotCount - 1);
+  }
+
+  // Returns the index of the field with the key, or N if there is none
+  size_t find(StringView key) const {
+    const auto index = slots[slot(key.data(), key.size())];
+    if (index == 0) return N;
+    if (sizes[index - 1] != key.size() || memcmp(keys[index - 1], key.data(), key.size()) != 0) return N;
+    return index - 1;
+  }
+};
+
+template <typename T, size_t... I>
+constexpr KeyTable<sizeof...(I)> makeKeyTable(std::index_sequence<I...>) {
+  constexpr size_t count = sizeof...(I);
+  static_assert(count > 0, "Objects need at least one field");
+  static_assert(count < 256, "Objects have less than 256 fields");
+
+  constexpr auto list = T::fields();
+  KeyTable<count> table{0, {}, {std::get<I>(list).key...}, {std::get<I>(list).size...}};
+  for (;; ++table.seed) {
+    for (auto& slot : table.slots) slot = 0;
+    bool collision = false;
+    for (size_t i = 0; i < count && not collision; ++i) {
+      auto& slot = table.slots[table.slot(table.keys[i], table.sizes[i])];
+      collision = slot != 0;
+      slot = static_cast<uint8_t>(i + 1);
+    }
+    if (not collision) return table;
+  }
+}
+
+// Computed at compile time, a duplicate key never finds a seed and fails the compilation
+template <typename T>
+constexpr KeyTable<std::tuple_size<FieldList<T>>::value> keyTable = makeKeyTable<T>(FieldIndices<T>());
+
+/**
+ * Calls the function with the key and the member of every field of the object, in the order of the list.
+ */
+template <typename T, typename F, size_t... I>
+void forEachField(T& object, F&& function, std::index_sequence<I...>) {
+  constexpr auto list = std::remove_const_t<T>::fields();
+  const int expand[] = {(function(StringView(std::get<I>(list).key, std::get<I>(list).size),
+                                  object.*(std::get<I>(list).member)), 0)...};
+  (void) expand;
+}
+
+template <typename T, typename F>
+void forEachField(T& object, F&& function) {
+  forEachField(object, std::forward<F>(function), FieldIndices<std::remove_const_t<T>>());
+}
+
+}  // namespace __internal__
+
+}  // namespace CoAP
+
+#endif  // __Fields_h
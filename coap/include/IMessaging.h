@@ -7,8 +7,13 @@
 #ifndef __IMessaging_h
 #define __IMessaging_h
 
+#include "BatchClient.h"
 #include "Client.h"
 #include "MClient.h"
+#include "ProxyOptions.h"
+#include "ResourceDirectoryOptions.h"
+
+#include <chrono>
 
 namespace CoAP {
 
@@ -32,6 +37,18 @@ class IMessaging {
    */
   virtual void loopOnce() = 0;
 
+  /*
+   * Method: loopOnce
+   *
+   * Executes the message processing loop one time, waiting at most for the
+   * given time for an incoming message. This allows event loops that have
+   * to do other work at specific times, e.g. sending requests at a fixed rate.
+   *
+   * Parameters:
+   *    timeout - Maximum time to wait for a message, 0 to not wait at all
+   */
+  virtual void loopOnce(std::chrono::milliseconds timeout) = 0;
+
   /*
    * Method: loopStart
    *
@@ -54,13 +71,24 @@ class IMessaging {
    */
   virtual RequestHandlers& requestHandler() = 0;
 
+  /*
+   * Method: exposeMetrics
+   *
+   * Serves the metrics of the <Metrics::global()> registry at /.well-known/metrics
+   * in the text format of Prometheus. The resource is not registered by default,
+   * as the metrics reveal the load and traffic of the node.
+   */
+  virtual void exposeMetrics() = 0;
+
   /*
    * Method: getClientFor
    *
    * Request a client for sending requests to a specific server.
+   * The server name is resolved asynchronously and cached, thus this call never blocks.
    *
    * Parameters:
-   *    server      - URI of the server (FQDN or IP address)
+   *    server      - URI of the server (FQDN or IP address), or the socket path of a Unix domain
+   *                  server, see <newUnixMessaging>
    *    server_port - UDP port of the server to connect to
    *
    * Returns:
@@ -80,6 +108,110 @@ class IMessaging {
    *    A CoAP client for the communication with the server.
    */
   virtual MClient getMulticastClient(uint16_t server_port = 5683) = 0;
+
+  /*
+   * Method: getMulticastClient
+   *
+   * Returns a client for issuing multicast requests to the specified group, e.g. the
+   * IPv6 "All CoAP Nodes" groups <MClient::allNodesLinkLocal()> and <MClient::allNodesSiteLocal()>.
+   *
+   * Parameters:
+   *    group - Multicast address and UDP port of the servers
+   *
+   * Returns:
+   *    A CoAP client for the communication with the servers.
+   */
+  virtual MClient getMulticastClient(const Endpoint& group) = 0;
+
+  /*
+   * Method: joinMulticastGroup
+   *
+   * Lets the server receive requests sent to the multicast group, e.g. <MClient::allNodesIPv4()>.
+   * The group is received with a separate socket, the unicast traffic is not affected.
+   * Responses to multicast requests are delayed randomly within the leisure period and
+   * error responses are suppressed (RFC 7252, section 8.2).
+   *
+   * Parameters:
+   *    group     - Multicast address and UDP port of the group
+   *    interface - Index of the network interface to join the group on, 0 for the default interface.
+   *                Call it once per interface to join the group on several interfaces.
+   */
+  virtual void joinMulticastGroup(const Endpoint& group, uint32_t interface = 0) = 0;
+
+  /*
+   * Method: setMulticastLeisure
+   *
+   * Sets the period within which responses to multicast requests are sent, <DEFAULT_LEASURE> by default.
+   *
+   * Parameters:
+   *    leisure - Maximum delay of a response to a multicast request
+   */
+  virtual void setMulticastLeisure(std::chrono::milliseconds leisure) = 0;
+
+  /*
+   * Method: enableProxy
+   *
+   * Lets the server act as reverse proxy for the path prefixes of the routes and, if enabled
+   * in the options, as forward proxy for requests with a Proxy-Uri or Proxy-Scheme option
+   * (RFC 7252, section 5.7).
+   * The requests are forwarded without blocking the message processing loop, the responses are
+   * relayed to the clients and, if enabled, cached for their Max-Age. Only the coap scheme is
+   * supported, other requests for another server and observations are answered with
+   * 5.05 Proxying Not Supported.
+   * Call it before the message processing loop is started.
+   *
+   * Parameters:
+   *    options - Configuration of the proxy
+   */
+  virtual void enableProxy(const ProxyOptions& options = ProxyOptions()) = 0;
+
+  /*
+   * Method: enableHttpProxy
+   *
+   * Starts an HTTP/1.1 front end, which forwards HTTP requests as CoAP requests (RFC 8075).
+   * The front end runs its own thread, keeps connections alive and forwards pipelined requests
+   * at the same time. Methods, content formats and response codes are mapped as in RFC 8075,
+   * requests with a chunked body are answered with 501 Not Implemented.
+   * Call it once, before the message processing loop is started.
+   *
+   * Parameters:
+   *    options - Configuration of the front end
+   *
+   * Returns:
+   *    The TCP port the front end listens on
+   *
+   * Throws:
+   *    std::logic_error if the front end is enabled already
+   */
+  virtual uint16_t enableHttpProxy(const HttpProxyOptions& options = HttpProxyOptions()) = 0;
+
+  /*
+   * Method: enableResourceDirectory
+   *
+   * Lets the server act as resource directory (RFC 9176). Endpoints register their links at /rd
+   * and update or remove their registration at the returned location, registrations expire
+   * after their lifetime. The lookups at /rd-lookup/ep and /rd-lookup/res filter by attributes
+   * and are paginated with the page and count parameters. /.well-known/core lists the entry
+   * points of the directory. The handlers do not know the address of the endpoints, therefore
+   * registrations need the base parameter. Call it once, before the message processing loop is started.
+   *
+   * Parameters:
+   *    options - Configuration of the directory
+   *
+   * Throws:
+   *    std::logic_error if the directory is enabled already
+   */
+  virtual void enableResourceDirectory(const ResourceDirectoryOptions& options = ResourceDirectoryOptions()) = 0;
+
+  /*
+   * Method: getBatchClient
+   *
+   * Returns a client for sending the same request to many servers at once.
+   *
+   * Returns:
+   *    A CoAP <BatchClient>.
+   */
+  virtual BatchClient getBatchClient() = 0;
 };
 
 }
@@ -0,0 +1,287 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/**
+ * Single pass JSON parsing without intermediate strings.
+ *
+ * JsonCursor reads the tokens of a JSON text one after the other and is the base of
+ * the from_json() functions of json.h. Strings are read with their raw content, unescape()
+ * resolves the escape sequences.
+ * Strings and skipped containers are scanned with the vector instructions of the CPU, see JsonScan.h.
+ */
+
+#pragma once
+
+#ifndef __JsonParser_h
+#define __JsonParser_h
+
+#include "JsonScan.h"
+#include "StringView.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace CoAP {
+
+/*
+ * Class: JsonCursor
+ *
+ * Reads the tokens of a JSON text from left to right, skipping the whitespace between them.
+ * All methods throw std::runtime_error if the text does not continue as expected.
+ */
+class JsonCursor {
+ public:
+  explicit JsonCursor(StringView json) : json_(json) {}
+
+  // Position of the next character to be read
+  size_t position() const { return pos_; }
+
+  // Returns whether only whitespace is left
+  bool atEnd() {
+    skipWhitespace();
+    return pos_ == json_.size();
+  }
+
+  // Returns the next character without consuming it
+  char peek() {
+    if (atEnd()) fail("unexpected end");
+    return json_[pos_];
+  }
+
+  // Consumes the character if it comes next
+  bool consume(char c) {
+    if (atEnd() || json_[pos_] != c) return false;
+    ++pos_;
+    return true;
+  }
+
+  void expect(char c) {
+    if (not consume(c)) fail(std::string("expected '") + c + '\'');
+  }
+
+  // Consumes null if it comes next
+  bool null() {
+    return literal("null");
+  }
+
+  bool boolean() {
+    if (literal("true")) return true;
+    if (literal("false")) return false;
+    fail("expected boolean");
+    return false;
+  }
+
+  // Returns the number as written in the text
+  StringView number() {
+    skipWhitespace();
+    const auto start = pos_;
+    consumeRaw('-');
+    if (not consumeRaw('0') && digits() == 0) fail("expected number");
+    if (consumeRaw('.') && digits() == 0) fail("expected fraction digits");
+    if (consumeRaw('e') || consumeRaw('E')) {
+      if (not consumeRaw('+')) consumeRaw('-');
+      if (digits() == 0) fail("expected exponent digits");
+    }
+    return json_.substr(start, pos_ - start);
+  }
+
+  // Returns the content of the string without the quotation marks and with the escape sequences in place
+  StringView string() {
+    expect('\"');
+    const auto start = pos_;
+    for (;;) {
+      pos_ = findStringSpecial(json_.data(), pos_, json_.size());
+      if (pos_ >= json_.size()) fail("unterminated string");
+      if (json_[pos_] == '\"') break;
+      // Skips the escaped character
+      pos_ += 2;
+    }
+    return json_.substr(start, pos_++ - start);
+  }
+
+  // Skips the next value, returns the text of it
+  StringView value() {
+    const auto c = peek();
+    const auto start = pos_;
+    if (c == '\"') {
+      string();
+    } else if (c == '{' || c == '[') {
+      size_t depth = 0;
+      do {
+        switch (json_[pos_]) {
+          case '\"': string(); break;
+          case '{': case '[': ++depth; ++pos_; break;
+          default: --depth; ++pos_;
+        }
+        if (depth > 0) pos_ = findStructural(json_.data(), pos_, json_.size());
+      } while (depth > 0 && pos_ < json_.size());
+      if (depth > 0) fail("unterminated " + std::string(c == '{' ? "object" : "array"));
+    } else if (c == 't' || c == 'f') {
+      boolean();
+    } else if (not null()) {
+      number();
+    }
+    return json_.substr(start, pos_ - start);
+  }
+
+  // Verifies that nothing but whitespace follows
+  void finish() {
+    if (not atEnd()) fail("unexpected characters after the value");
+  }
+
+  [[noreturn]] void fail(const std::string& what) const {
+    throw std::runtime_error("Invalid JSON at position " + std::to_string(pos_) + ": " + what);
+  }
+
+ private:
+  void skipWhitespace() {
+    while (pos_ < json_.size()
+           && (json_[pos_] == ' ' || json_[pos_] == '\n' || json_[pos_] == '\r' || json_[pos_] == '\t')) ++pos_;
+  }
+
+  bool consumeRaw(char c) {
+    if (pos_ == json_.size() || json_[pos_] != c) return false;
+    ++pos_;
+    return true;
+  }
+
+  size_t digits() {
+    const auto start = pos_;
+    while (pos_ < json_.size() && json_[pos_] >= '0' && json_[pos_] <= '9') ++pos_;
+    return pos_ - start;
+  }
+
+  bool literal(StringView word) {
+    skipWhitespace();
+    if (json_.size() - pos_ < word.size() || json_.substr(pos_, word.size()) != word) return false;
+    pos_ += word.size();
+    return true;
+  }
+
+  StringView json_;
+  size_t pos_{0};
+};
+
+/*
+ * Function: unescape
+ *
+ * Appends the raw content of a JSON string to the result, with the escape sequences resolved.
+ * Escaped unicode characters are encoded in UTF-8.
+ *
+ * Throws:
+ *    std::runtime_error - on invalid escape sequences
+ */
+inline void unescape(StringView raw, std::string& result) {
+  result.reserve(result.size() + raw.size());
+  for (size_t i = 0; i < raw.size(); ++i) {
+    // Raw strings contain quotation marks only escaped, thus the scan stops at backslashes
+    const auto escape = findStringSpecial(raw.data(), i, raw.size());
+    result.append(raw.data() + i, escape - i);
+    i = escape;
+    if (i == raw.size()) break;
+    if (raw[i] != '\\' || ++i == raw.size()) throw std::runtime_error("Invalid JSON escape sequence");
+
+    switch (raw[i]) {
+      case '\"': case '\\': case '/': result += raw[i]; break;
+      case 'b': result += '\b'; break;
+      case 'f': result += '\f'; break;
+      case 'n': result += '\n'; break;
+      case 'r': result += '\r'; break;
+      case 't': result += '\t'; break;
+      case 'u': {
+        if (i + 4 >= raw.size()) throw std::runtime_error("Invalid JSON escape sequence");
+        char hex[5] = {raw[i + 1], raw[i + 2], raw[i + 3], raw[i + 4], 0};
+        char* end;
+        auto code = strtoul(hex, &end, 16);
+        if (end != hex + 4) throw std::runtime_error("Invalid JSON escape sequence");
+        i += 4;
+        // Characters outside the basic multilingual plane are escaped as surrogate pair
+        if (code >= 0xd800 && code < 0xdc00 && i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+          char low[5] = {raw[i + 3], raw[i + 4], raw[i + 5], raw[i + 6], 0};
+          const auto second = strtoul(low, &end, 16);
+          if (end == low + 4 && second >= 0xdc00 && second < 0xe000) {
+            code = 0x10000 + ((code - 0xd800) << 10) + (second - 0xdc00);
+            i += 6;
+          }
+        }
+        if (code < 0x80) {
+          result += static_cast<char>(code);
+        } else if (code < 0x800) {
+          result += static_cast<char>(0xc0 | (code >> 6));
+          result += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+          result += static_cast<char>(0xe0 | (code >> 12));
+          result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+          result += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+          result += static_cast<char>(0xf0 | (code >> 18));
+          result += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+          result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+          result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        break;
+      }
+      default: throw std::runtime_error("Invalid JSON escape sequence");
+    }
+  }
+}
+
+inline std::string unescape(StringView raw) {
+  std::string result;
+  unescape(raw, result);
+  return result;
+}
+
+/*
+ * Function: toInteger
+ *
+ * Returns:
+ *    The value of a JSON number without fraction and exponent.
+ *
+ * Throws:
+ *    std::runtime_error - if the number is not an integer or does not fit into the type
+ */
+template <typename I>
+I toInteger(StringView number) {
+  const bool negative = not number.empty() && number[0] == '-';
+  if (negative && not std::numeric_limits<I>::is_signed) throw std::runtime_error(std::string(number) + " is negative");
+
+  uint64_t magnitude = 0;
+  for (size_t i = negative ? 1 : 0; i < number.size(); ++i) {
+    const auto c = number[i];
+    if (c < '0' || c > '9') throw std::runtime_error(std::string(number) + " is not an integer");
+    if (magnitude > (std::numeric_limits<uint64_t>::max() - (c - '0')) / 10) {
+      throw std::runtime_error(std::string(number) + " is out of range");
+    }
+    magnitude = magnitude * 10 + (c - '0');
+  }
+
+  const auto limit = negative ? static_cast<uint64_t>(std::numeric_limits<I>::max()) + 1
+                              : static_cast<uint64_t>(std::numeric_limits<I>::max());
+  if (magnitude > limit) throw std::runtime_error(std::string(number) + " is out of range");
+  return negative ? static_cast<I>(0 - magnitude) : static_cast<I>(magnitude);
+}
+
+/*
+ * Function: toDouble
+ *
+ * Returns:
+ *    The value of a JSON number.
+ */
+inline double toDouble(StringView number) {
+  // strtod needs a terminated string
+  char buffer[64];
+  if (number.size() >= sizeof(buffer)) throw std::runtime_error(std::string(number) + " is too long");
+  memcpy(buffer, number.data(), number.size());
+  buffer[number.size()] = '\0';
+  return strtod(buffer, nullptr);
+}
+
+}  // namespace CoAP
+
+#endif  // __JsonParser_h
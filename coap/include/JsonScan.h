@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __JsonScan_h
+#define __JsonScan_h
+
+#include <cstddef>
+
+namespace CoAP {
+
+/*
+ * Enum: JsonScanLevel
+ *
+ * Instruction sets of the JSON scanning functions.
+ *
+ *    Scalar - one character after the other
+ *    SSE2   - 16 characters at a time
+ *    AVX2   - 32 characters at a time
+ */
+enum class JsonScanLevel { Scalar, SSE2, AVX2 };
+
+/*
+ * Function: jsonScanLevel
+ *
+ * Returns:
+ *    The instruction set the scanning functions use, by default the best one supported by the CPU.
+ */
+JsonScanLevel jsonScanLevel();
+
+/*
+ * Function: setJsonScanLevel
+ *
+ * Selects the instruction set of the scanning functions, for tests and benchmarks.
+ * Must not be called while JSON is parsed in other threads.
+ *
+ * Throws:
+ *    std::logic_error - if the CPU does not support the instruction set
+ */
+void setJsonScanLevel(JsonScanLevel level);
+
+/*
+ * Function: isJsonScanLevelSupported
+ *
+ * Returns:
+ *    Whether the instruction set is supported by the CPU.
+ */
+bool isJsonScanLevelSupported(JsonScanLevel level);
+
+/*
+ * Function: findStringSpecial
+ *
+ * Returns:
+ *    The position of the first quotation mark or backslash at or after pos, size if there is none.
+ */
+size_t findStringSpecial(const char* data, size_t pos, size_t size);
+
+/*
+ * Function: findStructural
+ *
+ * Returns:
+ *    The position of the first quotation mark or bracket at or after pos, size if there is none.
+ */
+size_t findStructural(const char* data, size_t pos, size_t size);
+
+}  // namespace CoAP
+
+#endif  // __JsonScan_h
@@ -7,7 +7,12 @@
 #ifndef __Logging_h
 #define __Logging_h
 
-#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <sstream>
+#include <string>
 
 enum LogLevel {
   LLTRACE = 0,
@@ -17,9 +22,15 @@ enum LogLevel {
   LLERROR = 4
 };
 
+// Build-wide minimum level, messages below are removed by the compiler regardless of the level of the file
+#ifndef COAP_MIN_LOGLEVEL
+#define COAP_MIN_LOGLEVEL LLTRACE
+#endif
+
 #define SETLOGLEVEL(LEVEL) static const LogLevel FILE_LOGLEVEL = LEVEL;
 
-#define LOG(LEVEL, PREFIX) (LEVEL >= FILE_LOGLEVEL) && std::cout << __FILE__  << ':' << __LINE__ << ' ' << PREFIX << ' '
+#define LOG(LEVEL, PREFIX) \
+  (LEVEL >= COAP_MIN_LOGLEVEL && LEVEL >= FILE_LOGLEVEL) && CoAP::LogRecord(__FILE__, __LINE__, PREFIX)
 
 #define TLOG LOG(LLTRACE, "(TRACE)")
 #define DLOG LOG(LLDEBUG, "(DEBUG)")
@@ -27,4 +38,108 @@ enum LogLevel {
 #define WLOG LOG(LLWARNING, "(WARNING)")
 #define ELOG LOG(LLERROR, "(ERROR)")
 
+namespace CoAP {
+
+/*
+ * Class: LogRecord
+ *
+ * A log message under construction, created by the LOG macros.
+ *
+ * The arguments are not formatted by the logging thread but recorded in binary form
+ * together with the location of the log statement. When the record is complete it
+ * is queued in a lock-free ring buffer of the thread and a background thread formats
+ * it to the log stream. Records are dropped if the ring buffer of the thread is full.
+ * Types without binary representation are formatted with their output operator.
+ */
+class LogRecord {
+ public:
+  enum Tag : uint8_t { CHAR, BOOL, INT, UINT, DOUBLE, POINTER, STRING };
+
+  LogRecord(const char* file, uint32_t line, const char* prefix) {
+    append(&file, sizeof(file));
+    append(&line, sizeof(line));
+    append(&prefix, sizeof(prefix));
+  }
+
+  // Queues the record when the log statement is complete
+  ~LogRecord();
+
+  LogRecord(const LogRecord&) = delete;
+  LogRecord& operator=(const LogRecord&) = delete;
+
+  // Allows chaining with && in the LOG macro
+  explicit operator bool() const { return true; }
+
+  LogRecord& operator<<(char value) { return field(CHAR, value); }
+  LogRecord& operator<<(signed char value) { return field(CHAR, static_cast<char>(value)); }
+  LogRecord& operator<<(unsigned char value) { return field(CHAR, static_cast<char>(value)); }
+  LogRecord& operator<<(bool value) { return field(BOOL, value); }
+  LogRecord& operator<<(short value) { return field(INT, static_cast<int64_t>(value)); }
+  LogRecord& operator<<(int value) { return field(INT, static_cast<int64_t>(value)); }
+  LogRecord& operator<<(long value) { return field(INT, static_cast<int64_t>(value)); }
+  LogRecord& operator<<(long long value) { return field(INT, static_cast<int64_t>(value)); }
+  LogRecord& operator<<(unsigned short value) { return field(UINT, static_cast<uint64_t>(value)); }
+  LogRecord& operator<<(unsigned value) { return field(UINT, static_cast<uint64_t>(value)); }
+  LogRecord& operator<<(unsigned long value) { return field(UINT, static_cast<uint64_t>(value)); }
+  LogRecord& operator<<(unsigned long long value) { return field(UINT, static_cast<uint64_t>(value)); }
+  LogRecord& operator<<(float value) { return field(DOUBLE, static_cast<double>(value)); }
+  LogRecord& operator<<(double value) { return field(DOUBLE, value); }
+  LogRecord& operator<<(const void* value) { return field(POINTER, value); }
+  LogRecord& operator<<(const char* value) { return string(value, strlen(value)); }
+  LogRecord& operator<<(const std::string& value) { return string(value.data(), value.size()); }
+
+  template<typename T>
+  LogRecord& operator<<(const T& value) {
+    std::ostringstream os;
+    os << value;
+    return *this << os.str();
+  }
+
+  // Size of a record, longer messages are truncated
+  static constexpr size_t capacity = 512;
+
+ private:
+  template<typename T>
+  LogRecord& field(Tag tag, T value) {
+    if (size_ + 1 + sizeof(value) > capacity) return *this;
+    data_[size_++] = tag;
+    append(&value, sizeof(value));
+    return *this;
+  }
+
+  LogRecord& string(const char* value, size_t length) {
+    if (size_ + 1 + sizeof(uint16_t) >= capacity) return *this;
+    const auto size = static_cast<uint16_t>(std::min(length, capacity - size_ - 1 - sizeof(uint16_t)));
+    data_[size_++] = STRING;
+    append(&size, sizeof(size));
+    append(value, size);
+    return *this;
+  }
+
+  void append(const void* data, size_t size) {
+    memcpy(data_ + size_, data, size);
+    size_ += size;
+  }
+
+  uint8_t data_[capacity];
+  size_t size_{0};
+};
+
+/*
+ * Function: setLogStream
+ *
+ * Sets the stream the background thread writes the log to, std::cout by default.
+ * The log is flushed before the stream is changed.
+ */
+void setLogStream(std::ostream& stream);
+
+/*
+ * Function: flushLog
+ *
+ * Waits until all log records that were queued before the call are written to the log stream.
+ */
+void flushLog();
+
+}  // namespace CoAP
+
 #endif //__Logging_h
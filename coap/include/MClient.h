@@ -7,10 +7,11 @@
 #ifndef __MClient_h
 #define __MClient_h
 
+#include "Aggregation.h"
+#include "Endpoint.h"
 #include "Notifications.h"
 
 #include <memory>
-#include <netinet/in.h>
 
 namespace CoAP {
 
@@ -18,8 +19,19 @@ class ClientImpl;
 
 class MClient {
  public:
+  // Multicast "All CoAP Nodes" addresses
+  static Endpoint allNodesIPv4(uint16_t port = 5683) { return Endpoint(htonl(0xE00001BB), port); }  // 224.0.1.187
+  static Endpoint allNodesLinkLocal(uint32_t interface, uint16_t port = 5683);  // ff02::fd
+  static Endpoint allNodesSiteLocal(uint32_t interface = 0, uint16_t port = 5683);  // ff05::fd
+
   MClient(ClientImpl& impl, uint16_t server_port);
 
+  /**
+   * Creates a multicast client for the given group, link-local IPv6 groups need the scope ID
+   * of the interface to be set.
+   */
+  MClient(ClientImpl& impl, const Endpoint& group);
+
   /**
    * Send a nonconfirmable GET request to multicast address
    *
@@ -29,11 +41,19 @@ class MClient {
    */
   std::shared_ptr<Notifications> GET(std::string uri);
 
+  /**
+   * Send a nonconfirmable GET request to multicast address and aggregate the responses
+   *
+   * Only the first response of every server is taken into account. The aggregation completes
+   * after the given number of servers responded or when the timeout passed, whatever comes first.
+   * Afterwards further responses are ignored and the token is released.
+   */
+  std::shared_ptr<Aggregation> GET(std::string uri, const Aggregation::Options& options);
+
  private:
   ClientImpl& impl_;
 
-  in_addr_t multicast_ip_;
-  uint16_t server_port_;
+  Endpoint group_;
 };
 
 }  // namespace CoAP
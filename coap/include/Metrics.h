@@ -0,0 +1,208 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Metrics_h
+#define __Metrics_h
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CoAP {
+
+namespace __internal__ {
+
+// Number of slots the values of a metric are spread over, each thread updates its own slot
+constexpr unsigned METRIC_SHARDS = 16;
+
+// Slots of different threads are a cache line apart to avoid false sharing
+constexpr unsigned METRIC_STRIDE = 64 / sizeof(std::atomic<uint64_t>);
+
+// Returns the slot of the calling thread
+unsigned metricShard();
+
+}  // namespace __internal__
+
+/*
+ * Class: Counter
+ *
+ * Monotonically increasing count of events, e.g. the received datagrams.
+ * Incrementing is lock-free and does not contend between threads.
+ */
+class Counter {
+ public:
+  Counter() = default;
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void increment(uint64_t n = 1) {
+    cells_[__internal__::metricShard() * __internal__::METRIC_STRIDE].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /*
+   * Method: value
+   *
+   * Returns:
+   *    The sum of the increments of all threads.
+   */
+  uint64_t value() const;
+
+ private:
+  std::atomic<uint64_t> cells_[__internal__::METRIC_SHARDS * __internal__::METRIC_STRIDE]{};
+};
+
+/*
+ * Class: Gauge
+ *
+ * Value that goes up and down, e.g. the number of active observations.
+ */
+class Gauge {
+ public:
+  Gauge() = default;
+
+  Gauge(const Gauge&) = delete;
+  Gauge& operator=(const Gauge&) = delete;
+
+  void add(int64_t n) {
+    cells_[__internal__::metricShard() * __internal__::METRIC_STRIDE].fetch_add(static_cast<uint64_t>(n),
+                                                                               std::memory_order_relaxed);
+  }
+
+  void increment() { add(1); }
+
+  void decrement() { add(-1); }
+
+  int64_t value() const;
+
+ private:
+  std::atomic<uint64_t> cells_[__internal__::METRIC_SHARDS * __internal__::METRIC_STRIDE]{};
+};
+
+/*
+ * Class: Histogram
+ *
+ * Distribution of values over fixed buckets, e.g. latencies in microseconds.
+ */
+class Histogram {
+ public:
+  struct Snapshot {
+    // Upper bounds of the buckets, the last bucket takes all larger values
+    std::vector<uint64_t> bounds;
+    // Number of values per bucket, one more than bounds
+    std::vector<uint64_t> counts;
+    uint64_t count{0};
+    uint64_t sum{0};
+  };
+
+  /*
+   * Constructor
+   *
+   * Parameters:
+   *    bounds - Ascending upper bounds (inclusive) of the buckets
+   */
+  explicit Histogram(std::vector<uint64_t> bounds);
+
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  void record(uint64_t value);
+
+  /*
+   * Method: snapshot
+   *
+   * Returns:
+   *    The buckets summed up over all threads.
+   */
+  Snapshot snapshot() const;
+
+ private:
+  std::vector<uint64_t> bounds_;
+  // Buckets, overflow bucket and sum of each shard
+  size_t stride_;
+  std::unique_ptr<std::atomic<uint64_t>[]> cells_;
+};
+
+/*
+ * Class: Metrics
+ *
+ * Registry of the named counters, gauges and histograms of the process.
+ * The library records the traffic of its connections, the messaging and the
+ * client and server in the <global()> registry. Metrics are registered once and
+ * updated through the returned reference, reading sums up the values of all threads.
+ *
+ * The metrics can be served to other nodes with <IMessaging::exposeMetrics()>.
+ */
+class Metrics {
+ public:
+  Metrics();
+
+  ~Metrics();
+
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  /*
+   * Function: global
+   *
+   * Returns:
+   *    The registry of the library.
+   */
+  static Metrics& global();
+
+  /*
+   * Method: counter
+   *
+   * Returns:
+   *    The counter with the name, it is created on first use.
+   *
+   * Throws:
+   *    std::logic_error - if a metric of another kind has the name.
+   */
+  Counter& counter(const std::string& name);
+
+  Gauge& gauge(const std::string& name);
+
+  /*
+   * Method: histogram
+   *
+   * Returns:
+   *    The histogram with the name, it is created with the bounds on first use.
+   */
+  Histogram& histogram(const std::string& name, std::vector<uint64_t> bounds);
+
+  /*
+   * Function: latencyBounds
+   *
+   * Returns:
+   *    Bucket bounds from 10 microseconds to 10 seconds for latencies in microseconds.
+   */
+  static std::vector<uint64_t> latencyBounds();
+
+  /*
+   * Method: toText
+   *
+   * Returns:
+   *    All metrics in the text exposition format of Prometheus, one value per line.
+   *    Histogram buckets that hold no values are left out for compactness.
+   */
+  std::string toText() const;
+
+ private:
+  struct Entry;
+
+  Entry& find(const std::string& name, int kind);
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+}  // namespace CoAP
+
+#endif  // __Metrics_h
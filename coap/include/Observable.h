@@ -17,6 +17,7 @@
 template<class T> class Observable {
  public:
   using Callback = std::function<void(const T&)>;
+  using CloseCallback = std::function<void()>;
 
   explicit Observable(std::function<void()> onDelete = nullptr) : onDelete_(onDelete) { }
 
@@ -37,7 +38,7 @@ template<class T> class Observable {
    *
    * onClose is being called when no further values will be available.
    */
-  void onClose();
+  void onClose() const { if (closeCallback_) closeCallback_(); }
 
   /*
    * Method: onError
@@ -57,8 +58,23 @@ template<class T> class Observable {
    */
   void subscribe(Callback callback) { callback_ = callback; }
 
+  /*
+   * Method: subscribe
+   *
+   * Clients can register an Observer for new values and for the end of the values.
+   *
+   * Parameters:
+   *    callback      - A Callback function that is to be called for each new value.
+   *    closeCallback - A Callback function that is to be called when no further values will be available.
+   */
+  void subscribe(Callback callback, CloseCallback closeCallback) {
+    callback_ = callback;
+    closeCallback_ = closeCallback;
+  }
+
  private:
   Callback callback_{nullptr};
+  CloseCallback closeCallback_{nullptr};
   std::function<void()> onDelete_;
 };
 
@@ -18,6 +18,16 @@ const auto NSTART = unsigned(1);
 const auto DEFAULT_LEASURE = double(5);
 const auto PROBING_RATE = double(1);
 
+// Freshness of responses without Max-Age option (RFC 7252, section 5.10.5)
+const auto DEFAULT_MAX_AGE = std::chrono::seconds(60);
+
+// Maximum time from the first transmission of a confirmable message to its last retransmission.
+const auto MAX_TRANSMIT_SPAN = ACK_TIMEOUT * ((1 << MAX_RETRANSMITS) - 1) * ACK_RANDOM_NUMBER / 100;
+
+// Maximum time from the first transmission of a confirmable message to the time
+// when the sender gives up on receiving an acknowledgement or reset.
+const auto MAX_TRANSMIT_WAIT = ACK_TIMEOUT * ((1 << (MAX_RETRANSMITS + 1)) - 1) * ACK_RANDOM_NUMBER / 100;
+
 }  // namespace CoAP
 
 #endif //__Parameters_h
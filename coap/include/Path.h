@@ -27,6 +27,15 @@ class Path {
    */
   explicit Path(std::string from);
 
+  /*
+   * Constructor
+   *
+   * Parameters:
+   *   from    - String representation of the path.
+   *   queries - Query parameters of the request, like "ep=node1".
+   */
+  Path(std::string from, std::vector<std::string> queries);
+
   /*
    * Method: size
    *
@@ -77,10 +86,19 @@ class Path {
    */
   std::string toString() const;
 
+  /*
+   * Method: queries
+   *
+   * Returns:
+   *   The query parameters of the request, empty for paths of patterns.
+   */
+  const std::vector<std::string>& queries() const { return queries_; }
+
  private:
   Path() = default;
 
   std::string path_;
+  std::vector<std::string> queries_;
 };
 
 #endif  // __Path_h
@@ -0,0 +1,77 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __PipelineStatistics_h
+#define __PipelineStatistics_h
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace CoAP {
+
+/*
+ * Class: PipelineStatistics
+ *
+ * Aggregated throughput and latency statistics of the requests sent to one server.
+ * They are meant to support tuning the in-flight window of a <Client>.
+ */
+struct PipelineStatistics {
+  using Duration = std::chrono::steady_clock::duration;
+  using Time = std::chrono::steady_clock::time_point;
+
+  // Number of requests issued
+  uint64_t requests{0};
+
+  // Number of requests that were answered
+  uint64_t responses{0};
+
+  // Number of requests for which no response was received within MAX_TRANSMIT_WAIT
+  uint64_t expired{0};
+
+  // Number of requests currently sent and waiting for their response
+  unsigned inFlight{0};
+
+  // Number of requests currently waiting for a free slot in the window
+  size_t queued{0};
+
+  // Maximum number of requests that were waiting for a free slot
+  size_t maxQueued{0};
+
+  // Time between sending a request and receiving its response
+  Duration totalLatency{0};
+  Duration minLatency{Duration::max()};
+  Duration maxLatency{0};
+
+  // Time of the first request and the last response
+  Time firstRequest;
+  Time lastResponse;
+
+  /*
+   * Method: meanLatency
+   *
+   * Returns:
+   *    The mean time between sending a request and receiving its response.
+   */
+  Duration meanLatency() const {
+    return responses ? totalLatency / static_cast<Duration::rep>(responses) : Duration(0);
+  }
+
+  /*
+   * Method: throughput
+   *
+   * Returns:
+   *    The number of responses per second between the first request and the last response.
+   */
+  double throughput() const {
+    const auto period = std::chrono::duration<double>(lastResponse - firstRequest).count();
+    return (responses && period > 0) ? responses / period : 0;
+  }
+};
+
+}  // namespace CoAP
+
+#endif  // __PipelineStatistics_h
@@ -0,0 +1,82 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __ProxyOptions_h
+#define __ProxyOptions_h
+
+#include "Parameters.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace CoAP {
+
+/*
+ * Struct: ProxyOptions
+ *
+ * Configuration of the proxy, see <IMessaging::enableProxy()>.
+ *
+ * The proxy forwards requests with a Proxy-Uri or Proxy-Scheme option (forward proxy) and
+ * requests to the path prefixes of the routes (reverse proxy) to the upstream servers.
+ * Requests to other paths are handled by the request handlers of the server as usual.
+ * Notifications are not relayed, thus requests registering an observation are answered
+ * with 5.05 Proxying Not Supported.
+ */
+struct ProxyOptions {
+  // Time after which an upstream request without response is answered with 5.04 Gateway Timeout.
+  // By default the answer reaches clients that sent the request with their last retransmission
+  // before they give up.
+  std::chrono::milliseconds timeout{MAX_TRANSMIT_WAIT - MAX_TRANSMIT_SPAN};
+
+  // Number of responses kept in the cache, 0 disables the cache.
+  // Successful responses to GET requests are cached for their Max-Age.
+  size_t cacheSize{0};
+
+  // Whether requests with a Proxy-Uri or Proxy-Scheme option are forwarded to any server
+  bool forwardProxy{false};
+
+  // Path prefixes of the server mapped to the URIs they are forwarded to, e.g.
+  // "/sensors" -> "coap://10.0.0.1:5683/api" forwards "/sensors/temp" to "/api/temp" of 10.0.0.1
+  std::map<std::string, std::string> routes;
+};
+
+/*
+ * Struct: HttpProxyOptions
+ *
+ * Configuration of the HTTP front end, see <IMessaging::enableHttpProxy()>.
+ *
+ * HTTP requests to paths starting with the prefix carry the URI of the CoAP resource,
+ * e.g. GET /hc/coap://10.0.0.2:5683/temp (RFC 8075, section 5). Requests to other paths
+ * are sent to the target, if it is set, and answered with 404 Not Found otherwise.
+ */
+struct HttpProxyOptions {
+  // TCP port to listen on, 0 for an ephemeral port
+  uint16_t port{8080};
+
+  // Time after which a request without response is answered with 504 Gateway Timeout
+  std::chrono::milliseconds timeout{std::chrono::seconds(5)};
+
+  // Prefix of the paths with the URI of the CoAP resource
+  std::string prefix{"/hc/"};
+
+  // CoAP server of the requests to other paths, e.g. "coap://10.0.0.2:5683/api"
+  std::string target;
+
+  // Number of pipelined requests of a connection that are forwarded at the same time,
+  // further requests are read when their responses have been sent
+  size_t pipelineDepth{16};
+
+  // Maximum size of a request including its headers. Requests beyond the pipeline are buffered
+  // up to maxRequestSize * pipelineDepth bytes, larger amounts are answered with 413 Payload Too Large.
+  size_t maxRequestSize{64 * 1024};
+};
+
+}  // namespace CoAP
+
+#endif  // __ProxyOptions_h
@@ -0,0 +1,43 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/**
+ * Representations of values in the content formats of json.h and cbor.h, kept apart from
+ * RestResponse.h so that only the users of the codecs include them.
+ */
+
+#pragma once
+
+#ifndef __Representations_h
+#define __Representations_h
+
+#include "ContentFormat.h"
+#include "RestResponse.h"
+#include "cbor.h"
+#include "json.h"
+
+namespace CoAP {
+
+/*
+ * Function: withValue
+ *
+ * Offers the value as JSON and CBOR, see <RestResponse::withRepresentations>.
+ *
+ * Parameters:
+ *    response - Response to set the representations of
+ *    value    - Value with to_json() and to_cbor() functions
+ *
+ * Returns:
+ *    The response with the representations set.
+ */
+template <typename T>
+RestResponse& withValue(RestResponse& response, T value) {
+  return response.withRepresentations({ContentFormat::Json, ContentFormat::Cbor}, [value](uint16_t contentFormat) {
+    return contentFormat == ContentFormat::Cbor ? to_cbor(value) : to_json(value);
+  });
+}
+
+}  // namespace CoAP
+
+#endif  // __Representations_h
@@ -0,0 +1,33 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __ResourceDirectoryOptions_h
+#define __ResourceDirectoryOptions_h
+
+#include <chrono>
+#include <cstddef>
+
+namespace CoAP {
+
+/*
+ * Struct: ResourceDirectoryOptions
+ *
+ * Configuration of the resource directory, see <IMessaging::enableResourceDirectory()>.
+ */
+struct ResourceDirectoryOptions {
+  // Lifetime of registrations without lt parameter, 25 hours as in RFC 9176
+  std::chrono::seconds defaultLifetime{90000};
+
+  // Number of registrations, further endpoints are answered with 5.03 Service Unavailable
+  size_t maxRegistrations{100000};
+
+  // Number of links of a lookup without count parameter, the response has to fit into a datagram
+  size_t pageSize{20};
+};
+
+}  // namespace CoAP
+
+#endif  // __ResourceDirectoryOptions_h
@@ -8,9 +8,17 @@
 #define __RestResponse_h
 
 #include "Code.h"
+#include "ContentFormat.h"
+#include "Endpoint.h"
+#include "Optional.h"
 
+#include <algorithm>
+#include <functional>
 #include <netinet/in.h>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace CoAP {
 
@@ -21,18 +29,42 @@ namespace CoAP {
  */
 class RestResponse {
  public:
+  /*
+   * Method: from
+   *
+   * Returns:
+   *    The <Endpoint> of the server from which the response was received.
+   */
+  const Endpoint& from() const { return from_; }
+
+  /*
+   * Method: withSender
+   *
+   * Sets the sender of this response.
+   *
+   * Parameters:
+   *    from - Sender IP address and port
+   *
+   * Returns:
+   *    A copy of the response with the sender set.
+   */
+  RestResponse& withSender(const Endpoint& from) {
+    from_ = from;
+    return *this;
+  }
+
   /*
    * Method: fromIp
    *
    * Returns:
-   *    The IP address of the server from which the response was received.
+   *    The IPv4 address of the server from which the response was received or 0 for IPv6 servers.
    */
-  in_addr_t fromIp() const { return fromIP_; }
+  in_addr_t fromIp() const { return from_.ipv4(); }
 
   /*
    * Method: withSenderIP
    *
-   * Sets the sender IP address of this response.
+   * Sets the sender IPv4 address of this response.
    *
    * Parameters:
    *    fromIP - Sender IP address
@@ -41,7 +73,7 @@ class RestResponse {
    *    A copy of the response with the sender IP address set.
    */
   RestResponse& withSenderIP(in_addr_t fromIP) {
-    fromIP_ = fromIP;
+    from_ = Endpoint(fromIP, from_.port());
     return *this;
   }
 
@@ -51,7 +83,7 @@ class RestResponse {
    * Returns:
    *    The UDP port of the server from which the response was received.
    */
-  uint16_t fromPort() const { return fromPort_; }
+  uint16_t fromPort() const { return from_.port(); }
 
   /*
    * Method: withSenderPort
@@ -65,7 +97,7 @@ class RestResponse {
    *    A copy of the response with the sender port set.
    */
   RestResponse& withSenderPort(uint16_t fromPort) {
-    fromPort_ = fromPort;
+    from_ = from_.withPort(fromPort);
     return *this;
   }
 
@@ -114,7 +146,7 @@ class RestResponse {
    */
   // Learning: In this simple example call by value is faster than call by const ref
   RestResponse& withPayload(std::string payload) {
-    payload_ = payload;
+    payload_ = std::move(payload);
     return *this;
   }
 
@@ -129,7 +161,7 @@ class RestResponse {
    * Returns:
    *    A copy of the response with the content format set.
    */
-  RestResponse withContentFormat(uint8_t contentFormat) {
+  RestResponse& withContentFormat(uint16_t contentFormat) {
     hasContentFormat_ = true;
     contentFormat_ = contentFormat;
     return *this;
@@ -154,16 +186,138 @@ class RestResponse {
    * See:
    *    <hasContentFormat>
    */
-  uint8_t contentFormat() const {
+  uint16_t contentFormat() const {
     return contentFormat_;
   }
+
+  /*
+   * Method: withMaxAge
+   *
+   * Sets the number of seconds the response may be cached, 60 seconds if it is not set.
+   *
+   * Parameters:
+   *    seconds - Max-Age of the response
+   *
+   * Returns:
+   *    A copy of the response with the Max-Age set.
+   */
+  RestResponse& withMaxAge(uint32_t seconds) {
+    hasMaxAge_ = true;
+    maxAge_ = seconds;
+    return *this;
+  }
+
+  /*
+   * Method: hasMaxAge
+   *
+   * Returns:
+   *    true if the Max-Age was set, otherwise false.
+   */
+  bool hasMaxAge() const {
+    return hasMaxAge_;
+  }
+
+  /*
+   * Method: maxAge
+   *
+   * Returns:
+   *    The Max-Age in seconds if it was set.
+   *
+   * See:
+   *    <hasMaxAge>
+   */
+  uint32_t maxAge() const {
+    return maxAge_;
+  }
+
+  /*
+   * Method: withLocationPath
+   *
+   * Sets the path of the resource created by a POST request.
+   *
+   * Parameters:
+   *    path - Location-Path of the response, like "/rd/4"
+   *
+   * Returns:
+   *    A copy of the response with the Location-Path set.
+   */
+  RestResponse& withLocationPath(std::string path) {
+    locationPath_ = std::move(path);
+    return *this;
+  }
+
+  /*
+   * Method: locationPath
+   *
+   * Returns:
+   *    The Location-Path, empty if it was not set.
+   */
+  const std::string& locationPath() const {
+    return locationPath_;
+  }
+
+  using Encoder = std::function<std::string(uint16_t contentFormat)>;
+
+  /*
+   * Method: withRepresentations
+   *
+   * Offers the payload in several content formats. It is encoded once the server
+   * negotiated the content format with the Accept option of the request.
+   *
+   * Parameters:
+   *    contentFormats - Content formats of the payload, the first one is used without Accept option
+   *    encode         - Returns the payload in the requested content format
+   *
+   * Returns:
+   *    This response with the representations set.
+   *
+   * See:
+   *    <withValue> of Representations.h for values with JSON and CBOR encoding
+   */
+  RestResponse& withRepresentations(std::vector<uint16_t> contentFormats, Encoder encode) {
+    if (contentFormats.empty()) throw std::logic_error("Representations need at least one content format");
+    contentFormats_ = std::move(contentFormats);
+    encode_ = std::move(encode);
+    return *this;
+  }
+
+  /*
+   * Method: negotiate
+   *
+   * Encodes the payload in the content format the client accepts, if the response has representations.
+   * Responses without acceptable representation are changed to 4.06 Not Acceptable.
+   *
+   * Parameters:
+   *    accept - Value of the Accept option of the request
+   */
+  void negotiate(const Optional<uint16_t>& accept) {
+    if (not encode_) return;
+
+    const auto contentFormat = accept ? accept.value() : contentFormats_.front();
+    if (std::find(contentFormats_.begin(), contentFormats_.end(), contentFormat) == contentFormats_.end()) {
+      code_ = Code::NotAcceptable;
+      payload_.clear();
+      hasContentFormat_ = false;
+    } else {
+      payload_ = encode_(contentFormat);
+      hasContentFormat_ = true;
+      contentFormat_ = contentFormat;
+    }
+    encode_ = nullptr;
+    contentFormats_.clear();
+  }
+
  private:
   Code code_ = Code::NotFound;
   std::string payload_;
   bool hasContentFormat_{false};
-  uint8_t contentFormat_;
-  in_addr_t fromIP_;
-  uint16_t fromPort_;
+  uint16_t contentFormat_;
+  bool hasMaxAge_{false};
+  uint32_t maxAge_{0};
+  std::string locationPath_;
+  Endpoint from_;
+  std::vector<uint16_t> contentFormats_;
+  Encoder encode_;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const RestResponse& r) {
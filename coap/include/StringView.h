@@ -0,0 +1,94 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __StringView_h
+#define __StringView_h
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace CoAP {
+
+/*
+ * Class: StringView
+ *
+ * Non-owning reference to a sequence of characters, a subset of std::string_view of C++17.
+ * The referenced characters must outlive the view.
+ */
+class StringView {
+ public:
+  static constexpr size_t npos = std::string::npos;
+
+  constexpr StringView() = default;
+
+  constexpr StringView(const char* data, size_t size) : data_(data), size_(size) {}
+
+  StringView(const char* str) : data_(str), size_(strlen(str)) {}
+
+  StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  // Implicit, such that functions taking a std::string accept a view as well
+  operator std::string() const { return std::string(data_, size_); }
+
+  constexpr const char* data() const { return data_; }
+
+  constexpr size_t size() const { return size_; }
+
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const char* begin() const { return data_; }
+
+  constexpr const char* end() const { return data_ + size_; }
+
+  constexpr char operator[](size_t pos) const { return data_[pos]; }
+
+  char front() const { return data_[0]; }
+
+  char back() const { return data_[size_ - 1]; }
+
+  /*
+   * Method: substr
+   *
+   * Returns:
+   *    The view of at most count characters starting at pos.
+   *
+   * Throws:
+   *    std::out_of_range - if pos is behind the end
+   */
+  StringView substr(size_t pos, size_t count = npos) const {
+    if (pos > size_) throw std::out_of_range("StringView::substr");
+    return StringView(data_ + pos, std::min(count, size_ - pos));
+  }
+
+  size_t find(char c, size_t pos = 0) const {
+    if (pos >= size_) return npos;
+    auto found = static_cast<const char*>(memchr(data_ + pos, c, size_ - pos));
+    return found ? static_cast<size_t>(found - data_) : npos;
+  }
+
+  bool operator==(StringView rhs) const {
+    return size_ == rhs.size_ && (size_ == 0 || memcmp(data_, rhs.data_, size_) == 0);
+  }
+
+  bool operator!=(StringView rhs) const {
+    return not (*this == rhs);
+  }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+};
+
+inline std::ostream& operator<<(std::ostream& os, StringView view) {
+  return os.write(view.data(), view.size());
+}
+
+}  // namespace CoAP
+
+#endif  // __StringView_h
@@ -0,0 +1,128 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Tracing_h
+#define __Tracing_h
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+namespace CoAP {
+
+/*
+ * Class: Tracer
+ *
+ * Records where the time of an exchange is spent while a message passes through the library:
+ *
+ *    queued  - from the kernel receive timestamp until the telegram was read from the socket
+ *    parse   - decoding of the received telegram
+ *    handler - request handler of the server
+ *    encode  - encoding of a message to be sent
+ *    send    - handing the telegram to the kernel
+ *
+ * Spans carry the message ID, thus the spans of a request and its piggybacked response belong together.
+ * Tracing is disabled by default, the spans are kept in a lock-free ring buffer that overwrites the
+ * oldest spans and can be exported in the Chrome trace format for chrome://tracing or Perfetto.
+ */
+class Tracer {
+ public:
+  /*
+   * Constructor
+   *
+   * Parameters:
+   *    capacity - Number of spans that are kept, rounded up to a power of two
+   */
+  explicit Tracer(size_t capacity = 65536);
+
+  ~Tracer();
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  /*
+   * Function: global
+   *
+   * Returns:
+   *    The tracer the library records its spans in.
+   */
+  static Tracer& global();
+
+  /*
+   * Function: now
+   *
+   * Returns:
+   *    The time in nanoseconds of the realtime clock, which is the clock of the kernel timestamps.
+   */
+  static int64_t now();
+
+  void enable(bool enabled = true) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /*
+   * Method: record
+   *
+   * Records a span, even if the tracer is disabled.
+   *
+   * Parameters:
+   *    name  - Name of the span, a string literal as only its address is stored
+   *    id    - Message ID of the exchange
+   *    begin - Start of the span in nanoseconds of <now()>
+   *    end   - End of the span
+   */
+  void record(const char* name, uint64_t id, int64_t begin, int64_t end);
+
+  /*
+   * Method: exportChromeTrace
+   *
+   * Writes the recorded spans as JSON object in the Chrome trace event format.
+   */
+  void exportChromeTrace(std::ostream& os) const;
+
+  /*
+   * Method: clear
+   *
+   * Discards the recorded spans.
+   */
+  void clear();
+
+ private:
+  struct Span;
+
+  std::atomic<bool> enabled_{false};
+  size_t mask_;
+  std::unique_ptr<Span[]> spans_;
+  std::atomic<uint64_t> next_{0};
+};
+
+/*
+ * Class: TraceSpan
+ *
+ * Records a span of the global tracer from its creation to its destruction, if the tracer is enabled.
+ */
+class TraceSpan {
+ public:
+  TraceSpan(const char* name, uint64_t id)
+      : name_(name), id_(id), begin_(Tracer::global().enabled() ? Tracer::now() : 0) {}
+
+  ~TraceSpan() {
+    if (begin_ != 0) Tracer::global().record(name_, id_, begin_, Tracer::now());
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t id_;
+  int64_t begin_;
+};
+
+}  // namespace CoAP
+
+#endif  // __Tracing_h
@@ -17,6 +17,7 @@ class URI {
    *
    * Supported formats are:
    *    coap[s]://server[:port]/endpoint
+   *    coap[s]://[IPv6 address][:port]/endpoint
    *
    * If the port is optional and if omitted the default port for coap/coaps will be used.
    *
@@ -0,0 +1,549 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/**
+ * This is a simple library to convert from C++ to CBOR (RFC 8949) and back again,
+ * the binary counterpart of json.h with the same kinds of values.
+ *
+ * The encoding is kept in a std::string, like the payloads of the messages.
+ * Objects provide the methods
+ *
+ *    void to_cbor(std::string& out) const  - appends the members with append_cbor(out, key, value)
+ *    void from_cbor(StringView map)        - reads the members with from_cbor(map, key, value)
+ *
+ * and are encoded as maps of indefinite length, so their members need not be counted.
+ * Objects that list their members with a static fields() method, see Fields.h, are encoded
+ * as maps of definite length instead and read in a single pass.
+ * Decoding accepts definite and indefinite lengths, tags are ignored and null leaves the value unchanged.
+ */
+
+#pragma once
+
+#ifndef __CBOR_h
+#define __CBOR_h
+
+#include "Fields.h"
+#include "StringView.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace CoAP {
+
+/*
+ * Class: CborCursor
+ *
+ * Reads the data items of a CBOR encoding one after the other.
+ * All methods throw std::runtime_error if the encoding does not continue as expected.
+ */
+class CborCursor {
+ public:
+  // Count of containers with indefinite length
+  static constexpr uint64_t indefinite = std::numeric_limits<uint64_t>::max();
+
+  enum Major : uint8_t {
+    UnsignedInteger = 0,
+    NegativeInteger = 1,
+    ByteString = 2,
+    TextString = 3,
+    Array = 4,
+    Map = 5,
+    Tag = 6,
+    Simple = 7,
+  };
+
+  explicit CborCursor(StringView cbor) : cbor_(cbor) {}
+
+  // Position of the next byte to be read
+  size_t position() const { return pos_; }
+
+  bool atEnd() const { return pos_ == cbor_.size(); }
+
+  // Returns the major type of the next data item, after its tags
+  Major peekMajor() {
+    skipTags();
+    return static_cast<Major>(initial() >> 5);
+  }
+
+  // Consumes null or undefined if it comes next
+  bool null() {
+    if (peekMajor() != Simple || (initial() != 0xf6 && initial() != 0xf7)) return false;
+    ++pos_;
+    return true;
+  }
+
+  bool boolean() {
+    if (peekMajor() != Simple || (initial() != 0xf4 && initial() != 0xf5)) fail("expected boolean");
+    return cbor_[pos_++] == static_cast<char>(0xf5);
+  }
+
+  uint64_t unsignedInteger() {
+    if (peekMajor() != UnsignedInteger) fail("expected unsigned integer");
+    return argument();
+  }
+
+  int64_t integer() {
+    const auto major = peekMajor();
+    if (major != UnsignedInteger && major != NegativeInteger) fail("expected integer");
+    const auto value = argument();
+    if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) fail("integer out of range");
+    return major == UnsignedInteger ? static_cast<int64_t>(value) : -1 - static_cast<int64_t>(value);
+  }
+
+  // Reads floating point numbers of all precisions and integers
+  double floatingPoint() {
+    const auto major = peekMajor();
+    if (major == UnsignedInteger) return static_cast<double>(argument());
+    if (major == NegativeInteger) return -1.0 - static_cast<double>(argument());
+    if (major != Simple) fail("expected floating point number");
+
+    switch (static_cast<uint8_t>(cbor_[pos_++])) {
+      case 0xf9: {
+        // Half precision, see appendix D of RFC 8949
+        const auto half = static_cast<uint16_t>(bytes(2));
+        const auto exponent = (half >> 10) & 0x1f;
+        const auto mantissa = half & 0x3ff;
+        double value;
+        if (exponent == 0) value = std::ldexp(mantissa, -24);
+        else if (exponent != 31) value = std::ldexp(mantissa + 1024, exponent - 25);
+        else value = mantissa == 0 ? INFINITY : NAN;
+        return half & 0x8000 ? -value : value;
+      }
+      case 0xfa: {
+        const auto bits = static_cast<uint32_t>(bytes(4));
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+      case 0xfb: {
+        const auto bits = bytes(8);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+      default: --pos_; fail("expected floating point number");
+    }
+  }
+
+  // Returns the text string, which is concatenated in the scratch string if it has indefinite length
+  StringView text(std::string& scratch) {
+    if (peekMajor() != TextString) fail("expected text string");
+    const auto length = argument();
+    if (length != indefinite) return take(length);
+
+    scratch.clear();
+    while (not breakCode()) {
+      if (peekMajor() != TextString) fail("expected text string chunk");
+      const auto chunk = argument();
+      if (chunk == indefinite) fail("nested indefinite text string");
+      const auto view = take(chunk);
+      scratch.append(view.data(), view.size());
+    }
+    return scratch;
+  }
+
+  // Returns the number of elements, or indefinite
+  uint64_t beginArray() {
+    if (peekMajor() != Array) fail("expected array");
+    return argument();
+  }
+
+  // Returns the number of pairs, or indefinite
+  uint64_t beginMap() {
+    if (peekMajor() != Map) fail("expected map");
+    return argument();
+  }
+
+  // Returns whether the next element of a container with the count is to be read after index elements
+  bool more(uint64_t count, uint64_t index) {
+    return count == indefinite ? not breakCode() : index < count;
+  }
+
+  // Consumes the break code that ends containers of indefinite length
+  bool breakCode() {
+    if (atEnd()) fail("unexpected end");
+    if (cbor_[pos_] != static_cast<char>(0xff)) return false;
+    ++pos_;
+    return true;
+  }
+
+  // Skips the next data item, returns the encoding of it
+  StringView item() {
+    const auto start = pos_;
+    skip(0);
+    return cbor_.substr(start, pos_ - start);
+  }
+
+  // Verifies that nothing follows
+  void finish() {
+    if (not atEnd()) fail("unexpected bytes after the data item");
+  }
+
+  [[noreturn]] void fail(const std::string& what) const {
+    throw std::runtime_error("Invalid CBOR at position " + std::to_string(pos_) + ": " + what);
+  }
+
+ private:
+  uint8_t initial() const { return static_cast<uint8_t>(cbor_[pos_]); }
+
+  uint64_t bytes(size_t count) {
+    if (cbor_.size() - pos_ < count) fail("unexpected end");
+    uint64_t value = 0;
+    while (count-- > 0) value = (value << 8) | static_cast<uint8_t>(cbor_[pos_++]);
+    return value;
+  }
+
+  // Reads the initial byte and the argument of the header
+  uint64_t argument() {
+    if (atEnd()) fail("unexpected end");
+    const auto major = initial() >> 5;
+    const auto info = initial() & 0x1f;
+    ++pos_;
+    if (info < 24) return info;
+    if (info < 28) return bytes(size_t(1) << (info - 24));
+    // Only strings and containers have an indefinite length
+    if (info == 31 && major >= ByteString && major <= Map) return indefinite;
+    --pos_;
+    fail("invalid additional information");
+  }
+
+  StringView take(uint64_t length) {
+    if (cbor_.size() - pos_ < length) fail("unexpected end");
+    const auto view = cbor_.substr(pos_, length);
+    pos_ += length;
+    return view;
+  }
+
+  void skipTags() {
+    if (atEnd()) fail("unexpected end");
+    while (initial() >> 5 == Tag) {
+      argument();
+      if (atEnd()) fail("unexpected end");
+    }
+  }
+
+  void skip(unsigned depth) {
+    if (depth > 256) fail("nested too deep");
+    switch (peekMajor()) {
+      case UnsignedInteger: case NegativeInteger: argument(); break;
+      case ByteString: case TextString: {
+        const auto major = peekMajor();
+        const auto length = argument();
+        if (length != indefinite) {
+          take(length);
+          break;
+        }
+        while (not breakCode()) {
+          if (peekMajor() != major) fail("expected string chunk");
+          const auto chunk = argument();
+          if (chunk == indefinite) fail("nested indefinite string");
+          take(chunk);
+        }
+        break;
+      }
+      case Array: case Map: {
+        const auto perElement = peekMajor() == Map ? 2 : 1;
+        const auto count = argument();
+        for (uint64_t i = 0; more(count, i); ++i) {
+          for (auto j = 0; j < perElement; ++j) skip(depth + 1);
+        }
+        break;
+      }
+      default: {
+        const auto info = initial() & 0x1f;
+        if (info == 31) fail("unexpected break code");
+        argument();
+      }
+    }
+  }
+
+  StringView cbor_;
+  size_t pos_{0};
+};
+
+namespace __internal__ {
+namespace cbor {
+
+/**
+ * Appends the header of a data item with the major type and the argument.
+ */
+inline void writeHeader(std::string& out, uint8_t major, uint64_t argument) {
+  const auto type = static_cast<char>(major << 5);
+  if (argument < 24) {
+    out += static_cast<char>(type | argument);
+    return;
+  }
+  const unsigned info = argument <= 0xff ? 24 : argument <= 0xffff ? 25 : argument <= 0xffffffff ? 26 : 27;
+  const auto size = size_t(1) << (info - 24);
+  out += static_cast<char>(type | info);
+  for (auto shift = 8 * size; shift > 0; shift -= 8) out += static_cast<char>(argument >> (shift - 8));
+}
+
+/**
+ * Appends the encoding of the value, the counterparts of the read() functions.
+ */
+inline void write(std::string& out, bool value) {
+  out += static_cast<char>(value ? 0xf5 : 0xf4);
+}
+
+inline void write(std::string& out, int value) {
+  if (value >= 0) writeHeader(out, CborCursor::UnsignedInteger, static_cast<uint64_t>(value));
+  else writeHeader(out, CborCursor::NegativeInteger, static_cast<uint64_t>(-1 - static_cast<int64_t>(value)));
+}
+
+inline void write(std::string& out, unsigned int value) {
+  writeHeader(out, CborCursor::UnsignedInteger, value);
+}
+
+inline void write(std::string& out, double value) {
+  // Values that keep their precision in single precision take half of the bytes
+  const auto single = static_cast<float>(value);
+  if (std::isnan(value)) {
+    out.append("\xf9\x7e\x00", 3);
+  } else if (static_cast<double>(single) == value) {
+    uint32_t bits;
+    memcpy(&bits, &single, sizeof(bits));
+    out += static_cast<char>(0xfa);
+    for (auto shift = 32; shift > 0; shift -= 8) out += static_cast<char>(bits >> (shift - 8));
+  } else {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out += static_cast<char>(0xfb);
+    for (auto shift = 64; shift > 0; shift -= 8) out += static_cast<char>(bits >> (shift - 8));
+  }
+}
+
+inline void write(std::string& out, StringView str) {
+  writeHeader(out, CborCursor::TextString, str.size());
+  out.append(str.data(), str.size());
+}
+
+inline void write(std::string& out, const char* str) {
+  write(out, StringView(str));
+}
+
+inline void write(std::string& out, const std::string& str) {
+  write(out, StringView(str));
+}
+
+template <typename T>
+void write(std::string& out, const std::list<T>& valueList);
+
+template <typename T>
+void write(std::string& out, const std::map<std::string, T>& valueMap);
+
+template <typename T>
+void write(std::string& out, const T& object);
+
+template <typename T>
+void writeObject(std::string& out, const T& object, std::false_type) {
+  out += static_cast<char>(0xbf);
+  object.to_cbor(out);
+  out += static_cast<char>(0xff);
+}
+
+template <typename T>
+void writeObject(std::string& out, const T& object, std::true_type) {
+  writeHeader(out, CborCursor::Map, std::tuple_size<FieldList<T>>::value);
+  forEachField(object, [&out](StringView key, const auto& value) {
+    write(out, key);
+    write(out, value);
+  });
+}
+
+template <typename T>
+void write(std::string& out, const T& object) {
+  writeObject(out, object, typename HasFields<T>::type());
+}
+
+template <typename T>
+void write(std::string& out, const std::list<T>& valueList) {
+  writeHeader(out, CborCursor::Array, valueList.size());
+  for (auto& value : valueList) write(out, value);
+}
+
+template <typename T>
+void write(std::string& out, const std::map<std::string, T>& valueMap) {
+  writeHeader(out, CborCursor::Map, valueMap.size());
+  for (auto& e : valueMap) {
+    write(out, e.first);
+    write(out, e.second);
+  }
+}
+
+/**
+ * Reads the next value from the cursor, the counterparts of the write() functions.
+ */
+inline void read(CborCursor& cursor, bool& value) {
+  if (not cursor.null()) value = cursor.boolean();
+}
+
+inline void read(CborCursor& cursor, int& value) {
+  if (cursor.null()) return;
+  const auto integer = cursor.integer();
+  if (integer < std::numeric_limits<int>::min() || integer > std::numeric_limits<int>::max()) {
+    cursor.fail("integer out of range");
+  }
+  value = static_cast<int>(integer);
+}
+
+inline void read(CborCursor& cursor, unsigned int& value) {
+  if (cursor.null()) return;
+  const auto integer = cursor.unsignedInteger();
+  if (integer > std::numeric_limits<unsigned int>::max()) cursor.fail("integer out of range");
+  value = static_cast<unsigned int>(integer);
+}
+
+inline void read(CborCursor& cursor, double& value) {
+  if (not cursor.null()) value = cursor.floatingPoint();
+}
+
+inline void read(CborCursor& cursor, std::string& str) {
+  if (cursor.null()) return;
+  std::string scratch;
+  const auto text = cursor.text(scratch);
+  str.assign(text.data(), text.size());
+}
+
+template <typename T>
+void read(CborCursor& cursor, std::list<T>& valueList);
+
+template <typename T>
+void read(CborCursor& cursor, std::map<std::string, T>& result);
+
+template <typename T>
+void read(CborCursor& cursor, T& object);
+
+template <typename T>
+void readObject(CborCursor& cursor, T& object, std::false_type) {
+  if (cursor.peekMajor() != CborCursor::Map) cursor.fail("expected map");
+  // Objects read their members with from_cbor(map, key, value)
+  object.from_cbor(cursor.item());
+}
+
+template <typename T, size_t I>
+void readField(CborCursor& cursor, T& object) {
+  constexpr auto field = std::get<I>(T::fields());
+  read(cursor, object.*field.member);
+}
+
+// Objects with a field list are read in one pass, the key table selects the reader of the member
+template <typename T, size_t... I>
+void readFields(CborCursor& cursor, T& object, std::index_sequence<I...>) {
+  using Reader = void (*)(CborCursor&, T&);
+  static constexpr Reader readers[] = {&readField<T, I>...};
+  const auto count = cursor.beginMap();
+  std::string scratch;
+  for (uint64_t i = 0; cursor.more(count, i); ++i) {
+    const auto index = keyTable<T>.find(cursor.text(scratch));
+    if (index < sizeof...(I)) readers[index](cursor, object);
+    else cursor.item();
+  }
+}
+
+template <typename T>
+void readObject(CborCursor& cursor, T& object, std::true_type) {
+  readFields(cursor, object, FieldIndices<T>());
+}
+
+template <typename T>
+void read(CborCursor& cursor, T& object) {
+  if (cursor.null()) return;
+  readObject(cursor, object, typename HasFields<T>::type());
+}
+
+template <typename T>
+void read(CborCursor& cursor, std::list<T>& valueList) {
+  if (cursor.null()) return;
+  valueList.clear();
+  const auto count = cursor.beginArray();
+  for (uint64_t i = 0; cursor.more(count, i); ++i) {
+    valueList.emplace_back();
+    read(cursor, valueList.back());
+  }
+}
+
+template <typename T>
+void read(CborCursor& cursor, std::map<std::string, T>& result) {
+  if (cursor.null()) return;
+  const auto count = cursor.beginMap();
+  std::string scratch;
+  for (uint64_t i = 0; cursor.more(count, i); ++i) {
+    const auto key = cursor.text(scratch);
+    read(cursor, result[key]);
+  }
+}
+
+}  // namespace cbor
+}  // namespace __internal__
+
+/**
+ * Returns the CBOR encoding of the value.
+ */
+template <typename T>
+std::string to_cbor(const T& value) {
+  std::string cbor;
+  __internal__::cbor::write(cbor, value);
+  return cbor;
+}
+
+/**
+ * Appends the CBOR encoding of the value to the output.
+ * The output can be reused for the next value after clear(), which keeps its capacity.
+ */
+template <typename T>
+void append_cbor(std::string& out, const T& value) {
+  __internal__::cbor::write(out, value);
+}
+
+/**
+ * Appends the CBOR encoding of the object member with the key to the output,
+ * objects use it in the method void to_cbor(std::string& out) const.
+ */
+template <typename T>
+void append_cbor(std::string& out, StringView key, const T& value) {
+  __internal__::cbor::write(out, key);
+  __internal__::cbor::write(out, value);
+}
+
+/**
+ * Initializes the value from the CBOR encoding.
+ * Throws runtime_error if the encoding is no representation of the value.
+ */
+template <typename T>
+void from_cbor(StringView cbor, T& value) {
+  CborCursor cursor(cbor);
+  __internal__::cbor::read(cursor, value);
+  cursor.finish();
+}
+
+/**
+ * Initializes the object member with the key from the CBOR encoding of the object.
+ * The value is unchanged if there is no member with the key.
+ */
+template <typename T>
+void from_cbor(StringView map, StringView key, T& value) {
+  CborCursor cursor(map);
+  const auto count = cursor.beginMap();
+  std::string scratch;
+  for (uint64_t i = 0; cursor.more(count, i); ++i) {
+    if (cursor.text(scratch) == key) {
+      __internal__::cbor::read(cursor, value);
+      return;
+    }
+    cursor.item();
+  }
+}
+
+}  // namespace CoAP
+
+#endif  // __CBOR_h
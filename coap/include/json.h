@@ -7,9 +7,11 @@
  *
  * It down not support lists of different element types.
  *
- * Todos:
- *  - support for null
- *  - test double value with exponent
+ * The from_json() functions read the JSON text in a single pass with a JsonCursor,
+ * null leaves the value unchanged.
+ *
+ * Objects either list their members with a static fields() method, see Fields.h,
+ * or provide to_json() and from_json(StringView members) methods.
  */
 
 #pragma once
@@ -17,83 +19,280 @@
 #ifndef __JSON_h
 #define __JSON_h
 
-#include <algorithm>
-#include <iterator>
+#include "Fields.h"
+#include "JsonParser.h"
+#include "StringView.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <list>
 #include <map>
 #include <stdexcept>
-#include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 namespace CoAP {
 
 namespace __internal__ {
 /**
- * Returns a string without left and right delimiters.
- * Throws runtime_error if the string doesn't have the required delimiters.
+ * Appends the JSON representation of the value to the output, the counterparts of the read() functions.
  */
-inline std::string without(char left, char right, const std::string &s) {
-  if (s.front() != left) throw std::runtime_error(s + " did not start with " + left);
-  if (s.back() != right) throw std::runtime_error(s + " did not start with " + right);
-  return s.substr(1, s.length() - 2);
+inline void write(std::string& out, bool value) {
+  out += value ? "true" : "false";
 }
 
-/**
- * Same as without() but specialized for curly brackets.
- */
-inline std::string withoutCurly(const std::string &s) {
-  return without('{', '}', s);
+inline void writeInteger(std::string& out, uint64_t magnitude, bool negative) {
+  char digits[24];
+  auto pos = sizeof(digits);
+  do {
+    digits[--pos] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  if (negative) digits[--pos] = '-';
+  out.append(digits + pos, sizeof(digits) - pos);
 }
 
-/**
- * Same as without() but specialized for rectangular brackets.
- */
-inline std::string withoutRect(const std::string &s) {
-  return without('[', ']', s);
+inline void write(std::string& out, int value) {
+  writeInteger(out, value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), value < 0);
 }
 
-/**
- * Same as without() but specialized for quotation marks.
- */
-inline std::string withoutQuot(const std::string &s) {
-  return without('\"', '\"', s);
+inline void write(std::string& out, unsigned int value) {
+  writeInteger(out, value, false);
 }
 
-/**
- * Returns the position of the first list delimiter.
- * Returns std::string::npos if there is no list delimiter.
- */
-inline size_t findListDelimiter(const std::string &j) {
-  auto nesting = 0;
-  auto index = 0;
-  for (auto c : j) {
-    switch (c) {
-      case '{':
-      case '[':
-        ++nesting;
-        break;
-      case ']':
-      case '}':
-        --nesting;
-        break;
-      case ',':
-        if (nesting == 0) return index;
-        break;
+inline void write(std::string& out, double value) {
+  // JSON has no representation of infinity and NaN
+  if (not std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+
+  // Fixed notation of the largest double has 316 characters
+  char digits[320];
+  auto length = snprintf(digits, sizeof(digits), "%f", value);
+  if (length <= 0 || static_cast<size_t>(length) >= sizeof(digits)) throw std::runtime_error("Invalid double");
+  auto end = digits + length;
+  // Trailing zeros of the fraction are dropped and the dot without fraction digits as well
+  if (memchr(digits, '.', length)) {
+    while (end[-1] == '0') --end;
+    if (end[-1] == '.') --end;
+  }
+  out.append(digits, end);
+}
+
+inline void write(std::string& out, StringView str) {
+  out += '\"';
+  auto run = str.begin();
+  for (auto c = str.begin(); c != str.end(); ++c) {
+    const auto ch = static_cast<unsigned char>(*c);
+    if (ch >= 0x20 && ch != '\"' && ch != '\\') continue;
+    out.append(run, c);
+    run = c + 1;
+    switch (ch) {
+      case '\"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default: {
+        static const char hex[] = "0123456789abcdef";
+        const char escaped[] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xf]};
+        out.append(escaped, sizeof(escaped));
+      }
     }
-    ++index;
   }
-  return std::string::npos;
+  out.append(run, str.end());
+  out += '\"';
+}
+
+inline void write(std::string& out, const char* str) {
+  write(out, StringView(str));
+}
+
+inline void write(std::string& out, const std::string& str) {
+  write(out, StringView(str));
+}
+
+template <typename T>
+void write(std::string& out, const std::list<T>& valueList);
+
+template <typename T>
+void write(std::string& out, const std::map<std::string, T>& valueMap);
+
+template <typename T>
+void write(std::string& out, const T& object);
+
+// Objects either append their members to the output or return them
+template <typename T>
+auto writeMembers(std::string& out, const T& object, int) -> decltype(object.to_json(out)) {
+  return object.to_json(out);
+}
+
+template <typename T>
+void writeMembers(std::string& out, const T& object, long) {
+  out += object.to_json();
+}
+
+template <typename T>
+void writeObject(std::string& out, const T& object, std::false_type) {
+  out += '{';
+  writeMembers(out, object, 0);
+  out += '}';
+}
+
+// Objects with a field list
+template <typename T>
+void writeObject(std::string& out, const T& object, std::true_type) {
+  out += '{';
+  forEachField(object, [&out](StringView key, const auto& value) {
+    write(out, key);
+    out += ':';
+    write(out, value);
+    out += ',';
+  });
+  out.back() = '}';
+}
+
+template <typename T>
+void write(std::string& out, const T& object) {
+  writeObject(out, object, typename HasFields<T>::type());
+}
+
+template <typename T>
+void write(std::string& out, const std::list<T>& valueList) {
+  out += '[';
+  for (auto& value : valueList) {
+    write(out, value);
+    out += ',';
+  }
+  if (out.back() == ',') out.back() = ']';
+  else out += ']';
+}
+
+template <typename T>
+void write(std::string& out, const std::map<std::string, T>& valueMap) {
+  out += '{';
+  for (auto& e : valueMap) {
+    write(out, e.first);
+    out += ':';
+    write(out, e.second);
+    out += ',';
+  }
+  if (out.back() == ',') out.back() = '}';
+  else out += '}';
 }
 
 /**
- * Returns the string without leading and trailing spaces.
+ * Reads the next value from the cursor, the counterparts of the to_json() functions.
  */
-inline std::string trimmed(const std::string &s) {
-  auto start = s.find_first_not_of(' ');
-  if (start == std::string::npos) return "";
-  auto end = s.find_last_not_of(' ');
-  auto count = end != std::string::npos ? (end - start + 1) : end;
-  return s.substr(start, count);
+inline void read(JsonCursor& cursor, bool& value) {
+  if (not cursor.null()) value = cursor.boolean();
+}
+
+inline void read(JsonCursor& cursor, int& value) {
+  if (not cursor.null()) value = toInteger<int>(cursor.number());
+}
+
+inline void read(JsonCursor& cursor, unsigned int& value) {
+  if (not cursor.null()) value = toInteger<unsigned int>(cursor.number());
+}
+
+inline void read(JsonCursor& cursor, double& value) {
+  if (not cursor.null()) value = toDouble(cursor.number());
+}
+
+inline void read(JsonCursor& cursor, std::string& str) {
+  if (cursor.null()) return;
+  str.clear();
+  unescape(cursor.string(), str);
+}
+
+template <typename T>
+void read(JsonCursor& cursor, std::list<T>& valueList);
+
+template <typename T>
+void read(JsonCursor& cursor, std::map<std::string, T>& result);
+
+template <typename T>
+void read(JsonCursor& cursor, T& object);
+
+template <typename T>
+void readObject(JsonCursor& cursor, T& object, std::false_type) {
+  if (cursor.peek() != '{') cursor.fail("expected object");
+  auto members = cursor.value();
+  // Objects read their members with from_json(json, key, value)
+  object.from_json(members.substr(1, members.size() - 2));
+}
+
+template <typename T, size_t I>
+void readField(JsonCursor& cursor, T& object) {
+  constexpr auto field = std::get<I>(T::fields());
+  read(cursor, object.*field.member);
+}
+
+// Objects with a field list are read in one pass, the key table selects the reader of the member
+template <typename T, size_t... I>
+void readFields(JsonCursor& cursor, T& object, std::index_sequence<I...>) {
+  using Reader = void (*)(JsonCursor&, T&);
+  static constexpr Reader readers[] = {&readField<T, I>...};
+  cursor.expect('{');
+  if (cursor.consume('}')) return;
+  std::string scratch;
+  do {
+    auto key = cursor.string();
+    if (key.find('\\') != StringView::npos) {
+      scratch.clear();
+      unescape(key, scratch);
+      key = scratch;
+    }
+    cursor.expect(':');
+    const auto index = keyTable<T>.find(key);
+    if (index < sizeof...(I)) readers[index](cursor, object);
+    else cursor.value();
+  } while (cursor.consume(','));
+  cursor.expect('}');
+}
+
+template <typename T>
+void readObject(JsonCursor& cursor, T& object, std::true_type) {
+  readFields(cursor, object, FieldIndices<T>());
+}
+
+template <typename T>
+void read(JsonCursor& cursor, T& object) {
+  if (cursor.null()) return;
+  readObject(cursor, object, typename HasFields<T>::type());
+}
+
+template <typename T>
+void read(JsonCursor& cursor, std::list<T>& valueList) {
+  if (cursor.null()) return;
+  valueList.clear();
+  cursor.expect('[');
+  if (cursor.consume(']')) return;
+  do {
+    valueList.emplace_back();
+    read(cursor, valueList.back());
+  } while (cursor.consume(','));
+  cursor.expect(']');
+}
+
+template <typename T>
+void read(JsonCursor& cursor, std::map<std::string, T>& result) {
+  if (cursor.null()) return;
+  cursor.expect('{');
+  if (cursor.consume('}')) return;
+  do {
+    auto key = unescape(cursor.string());
+    cursor.expect(':');
+    read(cursor, result[key]);
+  } while (cursor.consume(','));
+  cursor.expect('}');
 }
 
 }  // namespace __internal__
@@ -105,15 +304,40 @@ inline std::string trimmed(const std::string &s) {
  */
 template <typename T>
 std::string to_json(const T& object) {
-  return "{" + object.to_json() + "}";
+  std::string json;
+  __internal__::write(json, object);
+  return json;
 }
 
 /**
- * Initializes the object from the JSON string.
+ * Appends the JSON representation of the value to the output.
+ * The output can be reused for the next value after clear(), which keeps its capacity.
  */
 template <typename T>
-void from_json(const std::string& json, T& object) {
-  object.from_json(__internal__::trimmed(__internal__::withoutCurly(__internal__::trimmed(json))));
+void append_json(std::string& out, const T& value) {
+  __internal__::write(out, value);
+}
+
+/**
+ * Appends the JSON representation of the object value with the key to the output,
+ * objects use it in the method void to_json(std::string& out) const.
+ */
+template <typename T>
+void append_json(std::string& out, StringView key, const T& value) {
+  __internal__::write(out, key);
+  out += ':';
+  __internal__::write(out, value);
+}
+
+/**
+ * Initializes the value from the JSON string.
+ * Throws runtime_error if the string is no JSON representation of the value.
+ */
+template <typename T>
+void from_json(StringView json, T& value) {
+  JsonCursor cursor(json);
+  __internal__::read(cursor, value);
+  cursor.finish();
 }
 
 // Boolean
@@ -125,56 +349,33 @@ inline std::string to_json(bool value) {
   return value ? "true" : "false";
 }
 
-inline void from_json(const std::string& json, bool& value) {
-  value = json == "true";
-}
-
 // Numbers
 
 /**
  * Returns the JSON representation of the value.
  */
 inline std::string to_json(int value) {
-  return std::to_string(value);
-}
-
-/**
- * Initializes the value from the JSON string.
- */
-inline void from_json(const std::string& json, int& value) {
-  value = std::stoi(__internal__::trimmed(json));
+  std::string json;
+  __internal__::write(json, value);
+  return json;
 }
 
 /**
  * Returns the JSON representation of the value.
  */
 inline std::string to_json(unsigned int value) {
-  return std::to_string(value);
-}
-
-/**
- * Initializes the value from the JSON string.
- */
-inline void from_json(const std::string& json, unsigned int& value) {
-  value = std::stoul(__internal__::trimmed(json));
+  std::string json;
+  __internal__::write(json, value);
+  return json;
 }
 
 /**
  * Returns the JSON representation of the value.
  */
 inline std::string to_json(double value) {
-  auto r = std::to_string(value);
-  auto dotPos = r.find_first_of('.');
-  auto lastNonZeroPos = r.find_last_not_of('0');
-  if (dotPos != std::string::npos) r = r.substr(0, lastNonZeroPos+1);
-  return r;
-}
-
-/**
- * Initializes the value from the JSON string.
- */
-inline void from_json(const std::string& json, double& value) {
-  value = std::stod(__internal__::trimmed(json));
+  std::string json;
+  __internal__::write(json, value);
+  return json;
 }
 
 // Strings
@@ -183,22 +384,19 @@ inline void from_json(const std::string& json, double& value) {
  * Returns the JSON representation of the string.
  */
 inline std::string to_json(const char* str) {
-  return std::string("\"") + str + '\"';
+  std::string json;
+  __internal__::write(json, str);
+  return json;
 }
 
 
 /**
  * Returns the JSON representation of the string.
  */
-inline std::string to_json(std::string str) {
-  return '\"' + str + '\"';
-}
-
-/**
- * Initializes the string from the JSON string.
- */
-inline void from_json(const std::string& json, std::string& str) {
-  str = __internal__::withoutQuot(__internal__::trimmed(json));
+inline std::string to_json(const std::string& str) {
+  std::string json;
+  __internal__::write(json, str);
+  return json;
 }
 
 // Lists
@@ -208,43 +406,9 @@ inline void from_json(const std::string& json, std::string& str) {
  */
 template <typename T>
 std::string to_json(const std::list<T>& valueList) {
-  std::string s;
-  if (!valueList.empty()) {
-    std::stringstream ss;
-    std::list<std::string> ls;
-    std::transform(valueList.begin(),
-                   valueList.end(),
-                   std::back_insert_iterator<std::list<std::string>>(ls),
-                   [](const T& t) { return to_json(t); });
-
-    std::copy(ls.begin(), ls.end(), std::ostream_iterator<std::string>(ss, ","));
-    s = ss.str();
-    s = s.substr(0, s.size() - 1);
-  }
-  return "[" + s + ']';
-}
-
-/**
- * Initializes the list from the JSON string.
- */
-template <typename T>
-void from_json(const std::string& json, std::list<T>& valueList) {
-  valueList.clear();
-
-  struct Helper {
-    void operator() (Helper& next, const std::string& json, std::list<T>& valueList) {
-      if (json.empty()) return;
-      auto pos = __internal__::findListDelimiter(json);
-      auto element = __internal__::trimmed(json.substr(0, pos));
-      T result;
-      from_json(element, result);
-      valueList.push_back(result);
-      if (pos != std::string::npos) next(next, json.substr(pos + 1), valueList);
-    }
-  } helper;
-
-  auto elements = __internal__::trimmed(__internal__::withoutRect(__internal__::trimmed(json)));
-  if (elements.size()) helper(helper, elements, valueList);
+  std::string json;
+  __internal__::write(json, valueList);
+  return json;
 }
 
 // Maps/Dictionaries
@@ -254,40 +418,9 @@ void from_json(const std::string& json, std::list<T>& valueList) {
  */
 template <typename T>
 std::string to_json(const std::map<std::string, T>& valueMap) {
-  std::string s;
-
-  for (auto& e : valueMap) {
-    s += to_json(e.first) + ":" + to_json(e.second) + ",";
-  }
-
-  s = s.empty() ? "" : s.substr(0, s.size() - 1);
-
-  return "{" + s + "}";
-}
-
-/**
- * Initializes a map with the key from the JSON string.
- */
-template<typename T>
-void from_json(const std::string& json, std::map<std::string, T>& result) {
-
-  struct Helper {
-    void operator()(Helper& next, const std::string& json, std::map<std::string, T>& result) {
-      auto commaPos = __internal__::findListDelimiter(json);
-      auto element = json.substr(0, commaPos);
-      auto colonPos = element.find_first_of(':');
-      if (colonPos != std::string::npos) {
-        std::string k;
-        from_json(__internal__::trimmed(element.substr(0, colonPos)), k);
-        T v;
-        from_json(__internal__::trimmed(element.substr(colonPos + 1)), v);
-        result.emplace(k, v);
-      }
-      if (commaPos != std::string::npos) next(next, json.substr(commaPos + 1), result);
-    }
-  } helper;
-
-  if (json.size()) helper(helper, __internal__::withoutCurly(json), result);
+  std::string json;
+  __internal__::write(json, valueMap);
+  return json;
 }
 
 // Objects
@@ -296,35 +429,30 @@ void from_json(const std::string& json, std::map<std::string, T>& result) {
  * Returns the JSON representation of the object value with the key.
  */
 template <typename T>
-std::string to_json(const std::string& key, T value) {
-  return to_json(key) + ":" + to_json(value);
+std::string to_json(const std::string& key, const T& value) {
+  std::string json;
+  append_json(json, key, value);
+  return json;
 }
 
 /**
- * Initializes the object value with the key from the JSON string.
+ * Initializes the object value with the key from the JSON string of the object members.
+ * The value is unchanged if there is no member with the key.
  */
 template <typename T>
-void from_json(const std::string& json, const std::string& key, T& value) {
-
-  struct Helper {
-    void operator() (Helper& next, const std::string& json, const std::string& key, T& value) {
-      if (json.empty()) return;
-      auto commaPos = __internal__::findListDelimiter(json);
-      auto element = json.substr(0, commaPos);
-      auto colonPos = element.find_first_of(':');
-      if (colonPos != std::string::npos) {
-        auto k = __internal__::trimmed(element.substr(0, colonPos));
-        if (k == key) {
-          auto v = __internal__::trimmed(element.substr(colonPos+1));
-          from_json(v, value);
-          return;
-        }
-      }
-      if (commaPos != std::string::npos) next(next, json.substr(commaPos + 1), key, value);
+void from_json(StringView json, StringView key, T& value) {
+  JsonCursor cursor(json);
+  if (cursor.atEnd()) return;
+  do {
+    auto k = cursor.string();
+    cursor.expect(':');
+    if (k == key || (k.find('\\') != StringView::npos && unescape(k) == std::string(key))) {
+      __internal__::read(cursor, value);
+      return;
     }
-  } helper;
-
-  if (json.size()) helper(helper, json, to_json(key), value);
+    cursor.value();
+  } while (cursor.consume(','));
+  cursor.finish();
 }
 
 }  // namespace CoAP
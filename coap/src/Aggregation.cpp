@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Aggregation.h"
+
+namespace CoAP {
+
+Aggregation::Aggregation(const Options& options, std::function<void()> onCancel)
+    : options_(options),
+      onCancel_(std::move(onCancel)),
+      results_(promise_.get_future().share()) {
+}
+
+size_t Aggregation::count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return senders_.size();
+}
+
+bool Aggregation::done() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_;
+}
+
+bool Aggregation::onResponse(const Endpoint& from, Code code, const std::string& payload) {
+  Response response;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (done_) return false;
+    // Servers may respond repeatedly, e.g. to retransmissions of the request
+    if (not senders_.insert(from).second) return true;
+
+    response = Response{from, code, std::make_shared<const std::vector<uint8_t>>(payload.begin(), payload.end())};
+    // Kept before the callback, such that a cancellation by the callback includes the response
+    if (options_.keepResponses) responses_.push_back(response);
+  }
+
+  // The callback is called without lock, such that it may query or cancel the aggregation
+  if (options_.onResponse) options_.onResponse(response);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (done_) return false;
+  if (senders_.size() < options_.maxResponses) return true;
+
+  done_ = true;
+  promise_.set_value(std::move(responses_));
+  return false;
+}
+
+void Aggregation::cancel() {
+  complete();
+  if (onCancel_) onCancel_();
+}
+
+void Aggregation::complete() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (done_) return;
+
+  done_ = true;
+  promise_.set_value(std::move(responses_));
+}
+
+}  // namespace CoAP
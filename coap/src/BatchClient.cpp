@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "BatchClient.h"
+
+#include "ClientImpl.h"
+
+namespace CoAP {
+
+BatchClient::BatchClient(ClientImpl& impl)
+    : impl_(impl) {
+}
+
+std::shared_ptr<Notifications> BatchClient::GET(const std::vector<Target>& targets,
+                                                std::string uri,
+                                                std::chrono::milliseconds timeout) {
+  return impl_.sendBatch(targets, Code::GET, uri, "", timeout);
+}
+
+std::shared_ptr<Notifications> BatchClient::PUT(const std::vector<Target>& targets,
+                                                std::string uri,
+                                                std::string payload,
+                                                std::chrono::milliseconds timeout) {
+  return impl_.sendBatch(targets, Code::PUT, uri, payload, timeout);
+}
+
+std::shared_ptr<Notifications> BatchClient::POST(const std::vector<Target>& targets,
+                                                 std::string uri,
+                                                 std::string payload,
+                                                 std::chrono::milliseconds timeout) {
+  return impl_.sendBatch(targets, Code::POST, uri, payload, timeout);
+}
+
+std::shared_ptr<Notifications> BatchClient::DELETE(const std::vector<Target>& targets,
+                                                   std::string uri,
+                                                   std::chrono::milliseconds timeout) {
+  return impl_.sendBatch(targets, Code::DELETE, uri, "", timeout);
+}
+
+}  // namespace CoAP
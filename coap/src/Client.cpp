@@ -11,35 +11,100 @@ SETLOGLEVEL(LLWARNING);
 
 namespace CoAP {
 
-Client::Client(ClientImpl& impl, std::string server, uint16_t server_port)
+Client::Client(ClientImpl& impl, std::shared_future<Endpoint> server_ip, uint16_t server_port)
     : impl_(impl)
-    , server_ip_(NetUtils().ipFromHostname(server))
+    , server_ip_(server_ip)
     , server_port_(server_port)
 {
 }
 
+template <typename Sender>
+std::shared_ptr<Notifications> Client::send(Sender sender) {
+  // Requests to resolved servers are sent right away, without the sender being wrapped
+  if (server_ip_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    Optional<Endpoint> server;
+    try {
+      server = Optional<Endpoint>(server_ip_.get().withPort(server_port_));
+    } catch (std::exception&) {
+      // Reported by the client like the failures of pending resolutions
+    }
+    if (server) return sender(server.value());
+  }
+  return impl_.sendWhenResolved(server_ip_, server_port_, std::move(sender));
+}
+
 std::future<RestResponse> Client::GET(std::string uri, bool confirmable) {
-  return asFuture(impl_.GET(server_ip_, server_port_, uri, confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable));
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  return asFuture(send([&impl, uri = std::move(uri), type](const Endpoint& server) mutable {
+    return impl.GET(server, std::move(uri), type);
+  }));
+}
+
+std::future<RestResponse> Client::GET(std::string uri, bool confirmable, uint16_t accept) {
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  return asFuture(send([&impl, uri = std::move(uri), type, accept](const Endpoint& server) mutable {
+    return impl.GET(server, std::move(uri), type, Optional<uint16_t>(accept));
+  }));
 }
 
 std::future<RestResponse> Client::PUT(std::string uri, std::string payload, bool confirmable) {
-  return asFuture(impl_.PUT(server_ip_, server_port_, uri, payload, confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable));
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  auto sender = [&impl, uri = std::move(uri), payload = std::move(payload), type](const Endpoint& server) mutable {
+    return impl.PUT(server, std::move(uri), std::move(payload), type);
+  };
+  return asFuture(send(std::move(sender)));
 }
 
 std::future<RestResponse> Client::POST(std::string uri, std::string payload, bool confirmable) {
-  return asFuture(impl_.POST(server_ip_, server_port_, uri, payload, confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable));
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  auto sender = [&impl, uri = std::move(uri), payload = std::move(payload), type](const Endpoint& server) mutable {
+    return impl.POST(server, std::move(uri), std::move(payload), type);
+  };
+  return asFuture(send(std::move(sender)));
 }
 
 std::future<RestResponse> Client::DELETE(std::string uri, bool confirmable) {
-  return asFuture(impl_.DELETE(server_ip_, server_port_, uri, confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable));
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  return asFuture(send([&impl, uri = std::move(uri), type](const Endpoint& server) mutable {
+    return impl.DELETE(server, std::move(uri), type);
+  }));
 }
 
 std::future<RestResponse> Client::PING() {
-  return asFuture(impl_.PING(server_ip_, server_port_));
+  auto& impl = impl_;
+  return asFuture(send([&impl](const Endpoint& server) { return impl.PING(server); }));
 }
 
 std::shared_ptr<Notifications> Client::OBSERVE(std::string uri, bool confirmable) {
-  return impl_.OBSERVE(server_ip_, server_port_, uri, confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable);
+  auto& impl = impl_;
+  const auto type = confirmable ? CoAP::Type::Confirmable : CoAP::Type::NonConfirmable;
+  return send([&impl, uri = std::move(uri), type](const Endpoint& server) mutable {
+    return impl.OBSERVE(server, std::move(uri), type);
+  });
+}
+
+void Client::setWindow(unsigned window) {
+  // Checked before the address is resolved, as the window may be set later by the message processing loop
+  if (window == 0) throw std::logic_error("The window must allow at least one request in flight.");
+
+  auto& impl = impl_;
+  impl_.whenResolved(server_ip_, server_port_, [&impl, window](const Endpoint& server) {
+    impl.setWindow(server, window);
+  }, nullptr);
+}
+
+PipelineStatistics Client::statistics() const {
+  if (server_ip_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return PipelineStatistics();
+  try {
+    return impl_.statistics(server_ip_.get().withPort(server_port_));
+  } catch (std::exception&) {
+    return PipelineStatistics();
+  }
 }
 
 std::future<RestResponse> Client::asFuture(const std::shared_ptr<Notifications>& responses) {
@@ -5,20 +5,75 @@
 #include "ClientImpl.h"
 
 #include "Messaging.h"
+#include "Metrics.h"
+#include "Parameters.h"
+
+#include <algorithm>
+#include <iterator>
 
 SETLOGLEVEL(LLWARNING);
 
 namespace CoAP {
 
+namespace {
+
+auto& requests = Metrics::global().counter("coap_client_requests_total");
+auto& responses = Metrics::global().counter("coap_client_responses_total");
+auto& expiredRequests = Metrics::global().counter("coap_client_requests_expired_total");
+auto& latencies = Metrics::global().histogram("coap_client_latency_us", Metrics::latencyBounds());
+
+// Returns the server if its address is resolved already, nothing if it is pending or could not be resolved
+Optional<Endpoint> resolved(const std::shared_future<Endpoint>& address, uint16_t port) {
+  if (address.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return Optional<Endpoint>();
+  try {
+    return Optional<Endpoint>(address.get().withPort(port));
+  } catch (std::exception&) {
+    return Optional<Endpoint>();
+  }
+}
+
+// The response carried by the message
+RestResponse responseOf(const Message& msg, const Endpoint& from) {
+  RestResponse response;
+  response.withSender(from)
+          .withCode(msg.code())
+          .withPayload(msg.payload());
+  if (msg.optionalContentFormat()) response.withContentFormat(msg.optionalContentFormat().value());
+  if (msg.optionalMaxAge()) response.withMaxAge(msg.optionalMaxAge().value());
+  if (msg.optionalLocationPath()) response.withLocationPath(msg.optionalLocationPath().value());
+  return response;
+}
+
+}  // namespace
+
 ClientImpl::~ClientImpl() {
   if (not notifications_.empty()) ELOG << "ClientImpl::notifications_ is not empty\n";
 }
 
-void ClientImpl::onMessage(const Message& msg_received, in_addr_t fromIP, uint16_t fromPort) {
+void ClientImpl::onMessage(const Message& msg_received, const Endpoint& from, bool answered) {
   ILOG << "onMessage(): Message(" << msg_received
        << " payload=" << msg_received.payload().length() << " bytes)\n";
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  complete(msg_received.token(), answered, messaging_.now());
+
+  if (batchTargets_.count(msg_received.token())) {
+    onBatchResult(msg_received.token(), responseOf(msg_received, from));
+    return;
+  }
+
+  auto aggregationIt = aggregations_.find(msg_received.token());
+  if (aggregationIt != aggregations_.end()) {
+    auto sp = aggregationIt->second.lock();
+    // The callback of the aggregation is called without lock, as it may cancel the aggregation
+    lock.unlock();
+    if (sp && sp->onResponse(from, msg_received.code(), msg_received.payload())) return;
+
+    lock.lock();
+    aggregations_.erase(msg_received.token());
+    return;
+  }
 
   auto notificationIt = notifications_.find(msg_received.token());
 
@@ -37,44 +92,119 @@ void ClientImpl::onMessage(const Message& msg_received, in_addr_t fromIP, uint16
     return;
   }
 
-  sp->onNext(RestResponse()
-                 .withSenderIP(fromIP)
-                 .withSenderPort(fromPort)
-                 .withCode(msg_received.code())
-                 .withPayload(msg_received.payload()));
+  sp->onNext(responseOf(msg_received, from));
+}
+
+void ClientImpl::whenResolved(const std::shared_future<Endpoint>& address,
+                              uint16_t port,
+                              std::function<void(const Endpoint& server)> onResolved,
+                              std::function<void()> onFailed) {
+  const auto server = resolved(address, port);
+  if (server) {
+    onResolved(server.value());
+    return;
+  }
+
+  // Failed resolutions are reported by the message processing loop as well, after the caller subscribed
+  std::lock_guard<std::mutex> lock(mutex_);
+  unresolved_.push_back(Unresolved{address, port, std::move(onResolved), std::move(onFailed)});
+}
+
+std::shared_ptr<Notifications> ClientImpl::sendWhenResolved(const std::shared_future<Endpoint>& address,
+                                                            uint16_t port,
+                                                            Sender send) {
+  const auto server = resolved(address, port);
+  if (server) return send(server.value());
+
+  // The notifications of the request exist once it is sent, until then the returned ones are
+  // kept by the caller and relay them afterwards. Releasing them releases the request.
+  auto request = std::make_shared<std::shared_ptr<Notifications>>();
+  auto notifications = std::make_shared<Notifications>([request]() { request->reset(); });
+  std::weak_ptr<Notifications> relay = notifications;
+
+  whenResolved(address, port, [request, relay, send](const Endpoint& server) {
+    // Holding the relay prevents its release while the request is assigned
+    auto sp = relay.lock();
+    if (not sp) return;
+
+    *request = send(server);
+    (*request)->subscribe([relay](const RestResponse& response) {
+      auto sp = relay.lock();
+      if (sp) sp->onNext(response);
+    }, [relay]() {
+      auto sp = relay.lock();
+      if (sp) sp->onClose();
+    });
+  }, [relay]() {
+    auto sp = relay.lock();
+    if (sp) sp->onNext(RestResponse().withCode(Code::ServiceUnavailable));
+  });
+  return notifications;
 }
 
-std::shared_ptr<Notifications> ClientImpl::GET(in_addr_t ip, uint16_t port, std::string uri, Type type) {
+void ClientImpl::processResolved() {
+  std::vector<Unresolved> done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (unresolved_.empty()) return;
+
+    auto it = std::partition(unresolved_.begin(), unresolved_.end(), [](const Unresolved& unresolved) {
+      return unresolved.address_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    });
+    std::move(it, unresolved_.end(), std::back_inserter(done));
+    unresolved_.erase(it, unresolved_.end());
+  }
+
+  // The functions send requests, thus they are called without the lock
+  for (auto& unresolved : done) {
+    Endpoint server;
+    try {
+      server = unresolved.address_.get().withPort(unresolved.port_);
+    } catch (std::exception& e) {
+      WLOG << "Cannot send request: " << e.what() << '\n';
+      if (unresolved.onFailed_) unresolved.onFailed_();
+      continue;
+    }
+    unresolved.onResolved_(server);
+  }
+}
+
+std::shared_ptr<Notifications> ClientImpl::GET(const Endpoint& server,
+                                               std::string uri,
+                                               Type type,
+                                               const Optional<uint16_t>& accept) {
   ILOG << "Sending " << ((type == Type::Confirmable) ? "confirmable " : "") << "GET request with URI=" << uri << '\n';
-  return sendRequest(ip, port, Message(type, messageId_++, CoAP::Code::GET, newToken(), uri));
+  auto msg = Message(type, messageId_++, CoAP::Code::GET, newToken(), uri);
+  if (accept) msg.withAccept(accept.value());
+  return sendRequest(server, std::move(msg));
 }
 
-std::shared_ptr<Notifications> ClientImpl::PUT(in_addr_t ip, uint16_t port, std::string uri, std::string payload, Type type) {
+std::shared_ptr<Notifications> ClientImpl::PUT(const Endpoint& server, std::string uri, std::string payload, Type type) {
   ILOG << "Sending " << ((type == Type::Confirmable) ? "confirmable " : "") << "PUT request with URI=" << uri << '\n';
-  return sendRequest(ip, port, Message(type, messageId_++, CoAP::Code::PUT, newToken(), uri, payload));
+  return sendRequest(server, Message(type, messageId_++, CoAP::Code::PUT, newToken(), uri, payload));
 }
 
-std::shared_ptr<Notifications> ClientImpl::POST(in_addr_t ip, uint16_t port, std::string uri, std::string payload, Type type) {
+std::shared_ptr<Notifications> ClientImpl::POST(const Endpoint& server, std::string uri, std::string payload, Type type) {
   ILOG << "Sending " << ((type == Type::Confirmable) ? "confirmable " : "") << "POST request with URI=" << uri << '\n';
-  return sendRequest(ip, port, Message(type, messageId_++, CoAP::Code::POST, newToken(), uri, payload));
+  return sendRequest(server, Message(type, messageId_++, CoAP::Code::POST, newToken(), uri, payload));
 }
 
-std::shared_ptr<Notifications> ClientImpl::DELETE(in_addr_t ip, uint16_t port, std::string uri, Type type) {
+std::shared_ptr<Notifications> ClientImpl::DELETE(const Endpoint& server, std::string uri, Type type) {
   ILOG << "Sending " << ((type == Type::Confirmable) ? "confirmable " : "") << "DELETE request with URI=" << uri << '\n';
-  return sendRequest(ip, port, Message(type, messageId_++, CoAP::Code::DELETE, newToken(), uri));
+  return sendRequest(server, Message(type, messageId_++, CoAP::Code::DELETE, newToken(), uri));
 }
 
-std::shared_ptr<Notifications> ClientImpl::PING(in_addr_t ip, uint16_t port) {
+std::shared_ptr<Notifications> ClientImpl::PING(const Endpoint& server) {
   ILOG << "Sending ping request to the server\n";
-  return sendRequest(ip, port, Message(Type::Confirmable, messageId_++, Code::Empty, newToken(), ""));
+  return sendRequest(server, Message(Type::Confirmable, messageId_++, Code::Empty, newToken(), ""));
 }
 
-std::shared_ptr<Notifications> ClientImpl::OBSERVE(in_addr_t ip, uint16_t port, std::string uri, Type type) {
+std::shared_ptr<Notifications> ClientImpl::OBSERVE(const Endpoint& server, std::string uri, Type type) {
   ILOG << "Sending " << ((type == Type::Confirmable) ? "confirmable " : "") << "OBSERVATION request with URI=" << uri << '\n';
-  return sendObservation(ip, port, Message(type, messageId_++, CoAP::Code::GET, newToken(), uri));
+  return sendObservation(server, Message(type, messageId_++, CoAP::Code::GET, newToken(), uri));
 }
 
-std::shared_ptr<Notifications> ClientImpl::sendRequest(in_addr_t ip, uint16_t port, Message msg) {
+std::shared_ptr<Notifications> ClientImpl::sendRequest(const Endpoint& server, Message msg) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto token = msg.token();
@@ -85,20 +215,18 @@ std::shared_ptr<Notifications> ClientImpl::sendRequest(in_addr_t ip, uint16_t po
   // If there is already a request with the given token, we cannot send the request.
   if (not x.second) throw std::runtime_error("Sending request with already used token failed!");
 
-  DLOG << "Sending " << ((msg.type() == Type::Confirmable) ? "confirmable " : "") << "message with msgID="
-      << msg.messageId() << '\n';
-  messaging_.sendMessage(ip, port, std::move(msg));
+  enqueue(server, std::move(msg));
   return notifications;
 }
 
-std::shared_ptr<Notifications> ClientImpl::sendObservation(in_addr_t ip, uint16_t port, Message msg) {
+std::shared_ptr<Notifications> ClientImpl::sendObservation(const Endpoint& server, Message msg) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto token = msg.token();
-  auto notifications = std::make_shared<Notifications>([this, ip, port, msg, token](){
+  auto notifications = std::make_shared<Notifications>([this, server, msg, token](){
     this->notifications_.erase(token);
     auto unobserve = msg;
-    this->messaging_.sendMessage(ip, port, unobserve.withObserveValue(1));
+    this->messaging_.sendMessage(server, unobserve.withObserveValue(1));
   });
   auto x = notifications_.emplace(token, notifications);
   // If there is already a request with the given token, we cannot send the request.
@@ -106,8 +234,269 @@ std::shared_ptr<Notifications> ClientImpl::sendObservation(in_addr_t ip, uint16_
 
   DLOG << "Sending " << ((msg.type() == Type::Confirmable) ? "confirmable " : "") << "message with msgID="
       << msg.messageId() << '\n';
-  messaging_.sendMessage(ip, port, std::move(msg.withObserveValue(0)));
+  messaging_.sendMessage(server, std::move(msg.withObserveValue(0)));
   return notifications;
 }
 
+std::shared_ptr<Aggregation> ClientImpl::aggregate(const Endpoint& group,
+                                                    std::string uri,
+                                                    const Aggregation::Options& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ILOG << "Sending multicast GET request with URI=" << uri << '\n';
+  auto msg = Message(Type::NonConfirmable, messageId_++, CoAP::Code::GET, newToken(), uri);
+
+  const auto token = msg.token();
+  const auto deadline = messaging_.now() + options.timeout;
+  // The aggregation may be cancelled by any thread and may outlive the client
+  std::weak_ptr<ClientImpl> client = self_;
+  auto aggregation = std::make_shared<Aggregation>(options, [client, token, deadline]() {
+    auto sp = client.lock();
+    if (sp) sp->forgetAggregation(token, deadline);
+  });
+  aggregations_.emplace(token, aggregation);
+  aggregationDeadlines_.emplace(deadline, token);
+
+  messaging_.sendMessage(group, std::move(msg));
+  return aggregation;
+}
+
+void ClientImpl::forgetAggregation(uint64_t token, Time deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  aggregations_.erase(token);
+
+  auto range = aggregationDeadlines_.equal_range(deadline);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second != token) continue;
+    aggregationDeadlines_.erase(it);
+    break;
+  }
+}
+
+std::shared_ptr<Notifications> ClientImpl::sendBatch(const std::vector<Endpoint>& targets,
+                                                     Code code,
+                                                     std::string uri,
+                                                     std::string payload,
+                                                     std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ILOG << "Sending batch request with URI=" << uri << " to " << targets.size() << " targets\n";
+
+  // Every target gets its own token out of a consecutive range
+  const auto firstToken = token_;
+  const auto count = targets.size();
+  token_ += count;
+
+  auto batch = std::make_shared<Batch>();
+  batch->pending_ = count;
+  auto results = std::make_shared<Notifications>([this, firstToken, count](){
+    for (auto token = firstToken; token < firstToken + count; ++token) this->batchTargets_.erase(token);
+  });
+  batch->results_ = results;
+  if (targets.empty()) return results;
+
+  // The request is encoded once with the largest token, such that all tokens fit into
+  // the same number of bytes, and then patched with message ID and token per target.
+  const auto lastToken = firstToken + count - 1;
+  const auto tokenLength = Message::tokenLength(lastToken);
+  const auto encoded = Message(Type::NonConfirmable, 0, code, lastToken, uri, payload).asBuffer();
+
+  const auto deadline = messaging_.now() + timeout;
+  std::vector<Telegram> telegrams;
+  telegrams.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const auto token = firstToken + i;
+    const auto messageId = messageId_++;
+
+    auto buffer = encoded;
+    buffer[2] = static_cast<uint8_t>((messageId >> 8) & 0xff);
+    buffer[3] = static_cast<uint8_t>(messageId & 0xff);
+    for (size_t b = 0; b < tokenLength; ++b) {
+      buffer[4 + b] = static_cast<uint8_t>((token >> ((tokenLength - b - 1) * 8)) & 0xff);
+    }
+
+    batchTargets_.emplace(token, BatchTarget{batch, targets[i]});
+    batchDeadlines_.emplace(deadline, token);
+    telegrams.emplace_back(targets[i], std::move(buffer));
+  }
+
+  messaging_.sendTelegrams(std::move(telegrams));
+  return results;
+}
+
+std::shared_ptr<Notifications> ClientImpl::forward(const Endpoint& server,
+                                                   const Message& request,
+                                                   std::string uri,
+                                                   std::chrono::milliseconds timeout,
+                                                   Notifications::Callback onResponse) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ILOG << "Forwarding request with token=" << request.token() << " to URI=" << uri << '\n';
+  auto msg = Message(request.type(), messageId_++, request.code(), newToken(), uri, request.payload());
+  if (request.optionalContentFormat()) msg.withContentFormat(request.optionalContentFormat().value());
+  if (request.optionalAccept()) msg.withAccept(request.optionalAccept().value());
+
+  // A batch with a single target, which reports the timeout as Code::GatewayTimeout. The target is
+  // released by the response or the timeout, thus the result may be dropped by any thread.
+  const auto token = msg.token();
+  auto batch = std::make_shared<Batch>();
+  batch->pending_ = 1;
+  auto result = std::make_shared<Notifications>();
+  result->subscribe(std::move(onResponse));
+  batch->results_ = result;
+
+  batchTargets_.emplace(token, BatchTarget{batch, server});
+  batchDeadlines_.emplace(messaging_.now() + timeout, token);
+  requests.increment();
+
+  messaging_.sendMessage(server, std::move(msg));
+  return result;
+}
+
+void ClientImpl::onBatchResult(uint64_t token, const RestResponse& response) {
+  auto it = batchTargets_.find(token);
+  auto batch = it->second.batch_;
+  batchTargets_.erase(it);
+
+  auto sp = batch->results_.lock();
+  if (not sp) return;
+
+  sp->onNext(response);
+  if (--batch->pending_ == 0) sp->onClose();
+}
+
+void ClientImpl::setWindow(const Endpoint& server, unsigned window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (window == 0) throw std::logic_error("The window must allow at least one request in flight.");
+
+  auto& pipeline = pipelines_[server];
+  pipeline.window_ = window;
+  release(server, pipeline);
+}
+
+PipelineStatistics ClientImpl::statistics(const Endpoint& server) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = pipelines_.find(server);
+  if (it == pipelines_.end()) return PipelineStatistics();
+
+  auto statistics = it->second.statistics_;
+  statistics.inFlight = it->second.inFlight_;
+  statistics.queued = it->second.queued_.size();
+  return statistics;
+}
+
+void ClientImpl::expireRequests(Time now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Requests are sent in chronological order, thus only the oldest ones need to be checked.
+  // Entries of requests that were already answered are dropped on the way.
+  while (not sendOrder_.empty()) {
+    const auto sent = sendOrder_.front().first;
+    const auto token = sendOrder_.front().second;
+    const auto it = inFlight_.find(token);
+    if (it != inFlight_.end() && it->second.sent_ == sent) {
+      if (sent + MAX_TRANSMIT_WAIT > now) break;
+      DLOG << "Request with token=" << token << " expired without response\n";
+      complete(token, false, now);
+    }
+    sendOrder_.pop_front();
+  }
+
+  while (not batchDeadlines_.empty() && batchDeadlines_.begin()->first <= now) {
+    const auto token = batchDeadlines_.begin()->second;
+    batchDeadlines_.erase(batchDeadlines_.begin());
+
+    auto it = batchTargets_.find(token);
+    if (it == batchTargets_.end()) continue;
+
+    const auto server = it->second.server_;
+    DLOG << "Batch request with token=" << token << " timed out\n";
+    onBatchResult(token, RestResponse()
+                             .withSender(server)
+                             .withCode(Code::GatewayTimeout));
+  }
+
+  while (not aggregationDeadlines_.empty() && aggregationDeadlines_.begin()->first <= now) {
+    const auto token = aggregationDeadlines_.begin()->second;
+    aggregationDeadlines_.erase(aggregationDeadlines_.begin());
+
+    auto it = aggregations_.find(token);
+    if (it == aggregations_.end()) continue;
+
+    DLOG << "Aggregation of multicast request with token=" << token << " completed\n";
+    auto sp = it->second.lock();
+    if (sp) sp->complete();
+    aggregations_.erase(it);
+  }
+}
+
+void ClientImpl::enqueue(const Server& server, Message msg) {
+  auto& pipeline = pipelines_[server];
+  auto& statistics = pipeline.statistics_;
+
+  if (statistics.requests++ == 0) statistics.firstRequest = messaging_.now();
+
+  if (pipeline.inFlight_ < pipeline.window_) {
+    dispatch(server, pipeline, std::move(msg));
+  } else {
+    DLOG << "Queueing request with token=" << msg.token() << ", " << pipeline.inFlight_ << " requests in flight\n";
+    pipeline.queued_.emplace_back(std::move(msg));
+    statistics.maxQueued = std::max(statistics.maxQueued, pipeline.queued_.size());
+  }
+}
+
+void ClientImpl::dispatch(const Server& server, Pipeline& pipeline, Message msg) {
+  const auto now = messaging_.now();
+  ++pipeline.inFlight_;
+  inFlight_[msg.token()] = Request{server, now};
+  sendOrder_.emplace_back(now, msg.token());
+  requests.increment();
+
+  DLOG << "Sending " << ((msg.type() == Type::Confirmable) ? "confirmable " : "") << "message with msgID="
+      << msg.messageId() << '\n';
+  messaging_.sendMessage(server, std::move(msg));
+}
+
+void ClientImpl::release(const Server& server, Pipeline& pipeline) {
+  while (pipeline.inFlight_ < pipeline.window_ && not pipeline.queued_.empty()) {
+    auto msg = std::move(pipeline.queued_.front());
+    pipeline.queued_.pop_front();
+
+    // Nobody is interested in the response anymore, thus the request needs not to be sent.
+    auto notificationIt = notifications_.find(msg.token());
+    if (notificationIt == notifications_.end() || notificationIt->second.expired()) continue;
+
+    dispatch(server, pipeline, std::move(msg));
+  }
+}
+
+void ClientImpl::complete(uint64_t token, bool answered, Time now) {
+  auto it = inFlight_.find(token);
+  if (it == inFlight_.end()) return;
+
+  const auto server = it->second.server_;
+  const auto latency = now - it->second.sent_;
+  inFlight_.erase(it);
+
+  auto& pipeline = pipelines_[server];
+  auto& statistics = pipeline.statistics_;
+  --pipeline.inFlight_;
+  if (answered) {
+    ++statistics.responses;
+    statistics.totalLatency += latency;
+    statistics.minLatency = std::min(statistics.minLatency, latency);
+    statistics.maxLatency = std::max(statistics.maxLatency, latency);
+    statistics.lastResponse = now;
+    responses.increment();
+    latencies.record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  } else {
+    ++statistics.expired;
+    expiredRequests.increment();
+  }
+
+  release(server, pipeline);
+}
+
 }  // namespace CoAP
\ No newline at end of file
@@ -7,18 +7,26 @@
 #ifndef  __ClientImpl_h
 #define  __ClientImpl_h
 
+#include "Aggregation.h"
+#include "Endpoint.h"
 #include "IConnection.h"
 #include "Logging.h"
 #include "Message.h"
 #include "NetUtils.h"
 #include "Notifications.h"
+#include "PipelineStatistics.h"
 #include "RestResponse.h"
 
 #include <cassert>
+#include <deque>
+#include <functional>
 #include <future>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 
 namespace CoAP {
@@ -27,25 +35,120 @@ class Messaging;
 
 class ClientImpl {
  public:
+  using Time = std::chrono::steady_clock::time_point;
+
+  // Requests in flight per server are not limited by default
+  static constexpr unsigned DEFAULT_WINDOW = std::numeric_limits<unsigned>::max();
+
   ClientImpl(Messaging& messaging)
       : messaging_(messaging) {
   }
 
   ~ClientImpl();
 
-  void onMessage(const Message& msg_received, in_addr_t fromIP, uint16_t fromPort);
+  /**
+   * Handles responses of servers. Responses synthesized for requests that were not answered,
+   * like the Service Unavailable of expired confirmable requests, are not answered.
+   */
+  void onMessage(const Message& msg_received, const Endpoint& from, bool answered = true);
+
+  /**
+   * Limits the number of requests in flight to the server, further requests are
+   * queued and sent when responses arrive.
+   */
+  void setWindow(const Endpoint& server, unsigned window);
+
+  /**
+   * Returns the statistics of the requests sent to the server.
+   */
+  PipelineStatistics statistics(const Endpoint& server);
+
+  /**
+   * Frees the window slots of requests that did not receive a response within MAX_TRANSMIT_WAIT
+   * and reports the targets of batch requests whose timeout passed.
+   */
+  void expireRequests(Time now);
+
+  using Sender = std::function<std::shared_ptr<Notifications>(const Endpoint& server)>;
+
+  /**
+   * Calls onResolved with the server once its address is resolved, right away if it is known already,
+   * otherwise from processResolved() in the message processing loop. If the address could not be
+   * resolved, onFailed is called instead, if given.
+   */
+  void whenResolved(const std::shared_future<Endpoint>& address,
+                    uint16_t port,
+                    std::function<void(const Endpoint& server)> onResolved,
+                    std::function<void()> onFailed);
+
+  /**
+   * Sends the request with the sender once the address of the server is resolved, see whenResolved(),
+   * such that the caller is never blocked. Requests to servers whose address could not be resolved
+   * are answered with Code::ServiceUnavailable.
+   *
+   * @return Shared pointer to the observable with the notifications of the request.
+   */
+  std::shared_ptr<Notifications> sendWhenResolved(const std::shared_future<Endpoint>& address,
+                                                  uint16_t port,
+                                                  Sender send);
+
+  /**
+   * Calls the functions waiting for addresses that have been resolved in the meantime.
+   */
+  void processResolved();
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> GET(in_addr_t ip, uint16_t port, std::string uri, Type type);
+  /**
+   * Sends a GET request, with the Accept option if the content format of the response is given.
+   */
+  std::shared_ptr<Observable<CoAP::RestResponse>> GET(const Endpoint& server,
+                                                      std::string uri,
+                                                      Type type,
+                                                      const Optional<uint16_t>& accept = Optional<uint16_t>());
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> PUT(in_addr_t ip, uint16_t port, std::string uri, std::string payload, Type type);
+  std::shared_ptr<Observable<CoAP::RestResponse>> PUT(const Endpoint& server, std::string uri, std::string payload, Type type);
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> POST(in_addr_t ip, uint16_t port, std::string uri, std::string payload, Type type);
+  std::shared_ptr<Observable<CoAP::RestResponse>> POST(const Endpoint& server, std::string uri, std::string payload, Type type);
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> DELETE(in_addr_t ip, uint16_t port, std::string uri, Type type);
+  std::shared_ptr<Observable<CoAP::RestResponse>> DELETE(const Endpoint& server, std::string uri, Type type);
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> PING(in_addr_t ip, uint16_t port);
+  std::shared_ptr<Observable<CoAP::RestResponse>> PING(const Endpoint& server);
 
-  std::shared_ptr<Observable<CoAP::RestResponse>> OBSERVE(in_addr_t ip, uint16_t port, std::string uri, Type type);
+  std::shared_ptr<Observable<CoAP::RestResponse>> OBSERVE(const Endpoint& server, std::string uri, Type type);
+
+  /**
+   * Sends a nonconfirmable GET request to the multicast group and collects the responses.
+   *
+   * @return Shared pointer to the aggregation of the responses. When the shared pointer gets
+   *         released the responses are ignored.
+   */
+  std::shared_ptr<Aggregation> aggregate(const Endpoint& group, std::string uri, const Aggregation::Options& options);
+
+  /**
+   * Sends the same nonconfirmable request to all targets, encoding it only once.
+   *
+   * @return Shared pointer to the observable with one result per target. Targets without
+   *         response within the timeout are reported with Code::GatewayTimeout.
+   */
+  std::shared_ptr<Notifications> sendBatch(const std::vector<Endpoint>& targets,
+                                           Code code,
+                                           std::string uri,
+                                           std::string payload,
+                                           std::chrono::milliseconds timeout);
+
+  /**
+   * Forwards the request of another client to the server with a token and message ID of this client.
+   * Type, method, payload, Content-Format and Accept are taken over, the Observe option is not.
+   * The callback is registered before the request is sent and called with the lock of the client held.
+   *
+   * @return Shared pointer to the observable, which calls the callback with the response, or with
+   *         Code::GatewayTimeout if there was no response within the timeout. When the shared pointer
+   *         gets released the response is ignored.
+   */
+  std::shared_ptr<Notifications> forward(const Endpoint& server,
+                                         const Message& request,
+                                         std::string uri,
+                                         std::chrono::milliseconds timeout,
+                                         Notifications::Callback onResponse);
 
  private:
 
@@ -61,8 +164,58 @@ class ClientImpl {
    * @return Shared pointer to the observable with the notifications. When the shared
    *         pointer gets released the Interest in the notifications vanishes.
    */
-  std::shared_ptr<Notifications> sendRequest(in_addr_t ip, uint16_t port, Message msg);
-  std::shared_ptr<Notifications> sendObservation(in_addr_t ip, uint16_t port, Message msg);
+  std::shared_ptr<Notifications> sendRequest(const Endpoint& server, Message msg);
+  std::shared_ptr<Notifications> sendObservation(const Endpoint& server, Message msg);
+
+  using Server = Endpoint;
+
+  // Requests to one server, limited by the window
+  struct Pipeline {
+    unsigned window_{DEFAULT_WINDOW};
+    unsigned inFlight_{0};
+    std::deque<Message> queued_;
+    PipelineStatistics statistics_;
+  };
+
+  struct Request {
+    Server server_;
+    Time sent_;
+  };
+
+  void enqueue(const Server& server, Message msg);
+  void dispatch(const Server& server, Pipeline& pipeline, Message msg);
+  void release(const Server& server, Pipeline& pipeline);
+  void complete(uint64_t token, bool answered, Time now);
+
+  // Requests sent to several servers, reported as one stream of results
+  struct Batch {
+    std::weak_ptr<Notifications> results_;
+    size_t pending_;
+  };
+
+  struct BatchTarget {
+    std::shared_ptr<Batch> batch_;
+    Server server_;
+  };
+
+  void onBatchResult(uint64_t token, const RestResponse& response);
+
+  // Releases the token of a cancelled aggregation
+  void forgetAggregation(uint64_t token, Time deadline);
+
+  // Functions waiting for the address of a server
+  struct Unresolved {
+    std::shared_future<Endpoint> address_;
+    uint16_t port_;
+    std::function<void(const Endpoint& server)> onResolved_;
+    std::function<void()> onFailed_;
+  };
+
+  std::vector<Unresolved> unresolved_;
+
+  // Aggregations of responses to multicast requests by token and by deadline
+  std::unordered_map<uint64_t, std::weak_ptr<Aggregation>> aggregations_;
+  std::multimap<Time, uint64_t> aggregationDeadlines_;
 
   // Continuously increasing message id for messages sent by this client.
   uint16_t messageId_{0};
@@ -74,7 +227,20 @@ class ClientImpl {
 
   std::map<uint64_t, std::weak_ptr<Observable<CoAP::RestResponse>>> notifications_;
 
+  std::unordered_map<Server, Pipeline> pipelines_;
+
+  // Requests in flight by token and in the order they were sent
+  std::unordered_map<uint64_t, Request> inFlight_;
+  std::deque<std::pair<Time, uint64_t>> sendOrder_;
+
+  // Targets of batch requests waiting for their response by token and by deadline
+  std::unordered_map<uint64_t, BatchTarget> batchTargets_;
+  std::multimap<Time, uint64_t> batchDeadlines_;
+
   Messaging& messaging_;
+
+  // Non-owning handle for callbacks that may outlive the client, released first on destruction
+  std::shared_ptr<ClientImpl> self_{this, [](ClientImpl*) {}};
 };
 
 }  // namespace CoAP;
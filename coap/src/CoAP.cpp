@@ -4,7 +4,12 @@
 
 #include "CoAP.h"
 
+#include "Connection.h"
+#include "DtlsConnection.h"
 #include "Messaging.h"
+#include "ShmConnection.h"
+#include "TcpConnection.h"
+#include "UnixConnection.h"
 
 namespace CoAP {
 
@@ -12,4 +17,41 @@ std::unique_ptr<IMessaging> newMessaging(uint16_t port) {
   return std::unique_ptr<IMessaging>(new Messaging(port));
 }
 
-}  // namespace CoAP
\ No newline at end of file
+std::unique_ptr<IMessaging> newTcpMessaging(uint16_t port) {
+  auto conn = std::make_shared<TcpConnection>();
+  conn->open(port);
+  return std::unique_ptr<IMessaging>(new Messaging(conn));
+}
+
+std::unique_ptr<IMessaging> newSecureMessaging(const DtlsCredentials& credentials, uint16_t port) {
+#ifdef WITH_DTLS
+  auto conn = std::make_shared<Connection>();
+  conn->open(port);
+  return std::unique_ptr<IMessaging>(new Messaging(std::make_shared<DtlsConnection>(conn, credentials)));
+#else
+  (void)credentials;
+  (void)port;
+  throw std::logic_error("The library was built without DTLS support.");
+#endif
+}
+
+std::unique_ptr<IMessaging> newUnixMessaging(const std::string& path) {
+  auto conn = std::make_shared<UnixConnection>();
+  conn->open(path);
+  return std::unique_ptr<IMessaging>(new Messaging(conn));
+}
+
+std::unique_ptr<IMessaging> newShmMessaging(const Endpoint& self, const Endpoint& peer, int& fd, size_t capacity) {
+  auto conn = std::make_shared<ShmConnection>();
+  conn->create(self, peer, capacity);
+  fd = conn->fd();
+  return std::unique_ptr<IMessaging>(new Messaging(conn));
+}
+
+std::unique_ptr<IMessaging> newShmMessaging(int fd) {
+  auto conn = std::make_shared<ShmConnection>();
+  conn->attach(fd);
+  return std::unique_ptr<IMessaging>(new Messaging(conn));
+}
+
+}  // namespace CoAP
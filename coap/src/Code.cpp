@@ -11,13 +11,21 @@ namespace CoAP {
 
 std::string toString(Code code) {
   switch (code) {
-#define COAP_CODE(V, N) case Code::N: return #N;
+#define COAP_CODE(V, N, H) case Code::N: return #N;
     COAP_CODES
 #undef COAP_CODE
   }
   return "<undefined>";
 }
 
+unsigned httpStatus(Code code) {
+  switch (code) {
+#define COAP_CODE(V, N, H) case Code::N: return H;
+    COAP_CODES
+#undef COAP_CODE
+  }
+  return 0;
+}
 
 std::ostream& operator<<(std::ostream& os, Code rhs) {
   const auto code = 100 * (static_cast<unsigned>(rhs) >> 5) +
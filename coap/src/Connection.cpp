@@ -3,89 +3,252 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "Connection.h"
+#include "Metrics.h"
 #include "NetUtils.h"
+#include "Tracing.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
 
 namespace CoAP {
 
-// Multicast "All CoAP Nodes" Address
-// for IPv4: 224.0.1.187
-// for IPv6: link-local scoped address ff02::fd and the site-local scoped address ff05::fd
+namespace {
+
+auto& datagramsReceived = Metrics::global().counter("coap_datagrams_received_total");
+auto& bytesReceived = Metrics::global().counter("coap_bytes_received_total");
+auto& datagramsSent = Metrics::global().counter("coap_datagrams_sent_total");
+auto& bytesSent = Metrics::global().counter("coap_bytes_sent_total");
+
+}  // namespace
+
 void Connection::open(uint16_t port) {
   if (socket_ != 0) throw std::logic_error("Cannot open already open connection.");
 
-  socket_ = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (socket_ == 0) throw std::runtime_error("Socket creation failed.");
+  // A dual-stack socket serves IPv6 and IPv4 (as IPv4-mapped addresses) at once,
+  // hosts without IPv6 support fall back to an IPv4 socket.
+  family_ = AF_INET6;
+  socket_ = socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket_ <= 0) {
+    family_ = AF_INET;
+    socket_ = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  }
+  if (socket_ <= 0) {
+    socket_ = 0;
+    throw std::runtime_error("Socket creation failed.");
+  }
 
-  auto constexpr WITH_MULTICAST = false;
-  if (WITH_MULTICAST) {
-    // enable multicast messages to be sent back to the local host
-    u_char loop = 1;
-    if (-1 == setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop))) {
+  if (family_ == AF_INET6) {
+    int v6only = 0;
+    if (-1 == setsockopt(socket_, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only))) {
       close();
-      throw std::runtime_error("Setting multicast loopback on socket failed.");
+      throw std::runtime_error("Enabling dual-stack on socket failed.");
     }
+  }
 
-    // joining a multicast group
-    ip_mreq mreq;
-    mreq.imr_interface.s_addr = INADDR_ANY;
-    mreq.imr_multiaddr.s_addr = inet_addr("224.0.1.187");
-    if (-1 == setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq))) {
-      close();
-      throw std::runtime_error("Setting multicast membership on socket failed.");
-    }
+  // Telegrams to multicast groups joined by other sockets shall not be received by the unicast socket
+  int all = 0;
+  if (-1 == setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all))) {
+    close();
+    throw std::runtime_error("Disabling multicast reception on socket failed.");
   }
+  // Older kernels do not know the option for IPv6, they deliver joined groups only anyways
+  if (family_ == AF_INET6) setsockopt(socket_, IPPROTO_IPV6, IPV6_MULTICAST_ALL, &all, sizeof(all));
 
-  struct sockaddr_in sa;
-  memset(&sa, 0, sizeof(sa));
-  sa.sin_family = AF_INET;
-  sa.sin_addr.s_addr = htonl(INADDR_ANY);
-  sa.sin_port = htons(port);
+  sockaddr_storage sa;
+  const auto length = (family_ == AF_INET6 ? Endpoint(in6addr_any, port) : Endpoint(htonl(INADDR_ANY), port))
+                          .toSockaddr(sa, family_);
 
-  if (-1 == bind(socket_, (struct sockaddr*) &sa, sizeof(sa))) {
+  if (-1 == bind(socket_, reinterpret_cast<sockaddr*>(&sa), length)) {
     close();
     throw std::runtime_error("bind failed.") ;
   }
 }
 
 void Connection::close() {
+  for (auto& group : groups_) ::close(group.second);
+  groups_.clear();
+
   ::close(socket_);
   socket_ = 0;
 }
 
+// Multicast "All CoAP Nodes" Address
+// for IPv4: 224.0.1.187
+// for IPv6: link-local scoped address ff02::fd and the site-local scoped address ff05::fd
+void Connection::joinGroup(const Endpoint& group, uint32_t interface) {
+  if (socket_ == 0) throw std::logic_error("Cannot join group if connection was not opened before.");
+  if (not group.isMulticast()) throw std::logic_error("Cannot join group with unicast address.");
+
+  auto it = std::find_if(groups_.begin(), groups_.end(),
+                         [&group](const std::pair<Endpoint, int>& g) { return g.first == group; });
+  if (it == groups_.end()) {
+    // The unicast socket shares its port with the sockets of the multicast groups only, without groups
+    // another process binding the port fails instead of receiving the unicast telegrams
+    int reuse = 1;
+    if (groups_.empty() && -1 == setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse))) {
+      throw std::runtime_error("Setting address reuse on socket failed.");
+    }
+
+    const auto family = group.isIPv4() ? AF_INET : AF_INET6;
+    auto groupSocket = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if (groupSocket <= 0) throw std::runtime_error("Socket creation failed.");
+
+    int on = 1;
+    sockaddr_storage sa;
+    const auto length = group.toSockaddr(sa, family);
+    if (-1 == setsockopt(groupSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+        || (family == AF_INET6 && -1 == setsockopt(groupSocket, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)))
+        || -1 == bind(groupSocket, reinterpret_cast<sockaddr*>(&sa), length)) {
+      ::close(groupSocket);
+      throw std::runtime_error("Binding socket to multicast group failed.");
+    }
+
+    if (timestamps_) setsockopt(groupSocket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    groups_.emplace_back(group, groupSocket);
+    it = groups_.end() - 1;
+  }
+
+  int result;
+  if (group.isIPv4()) {
+    ip_mreqn mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr.s_addr = group.ipv4();
+    mreq.imr_address.s_addr = htonl(INADDR_ANY);
+    mreq.imr_ifindex = interface;
+    result = setsockopt(it->second, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+  } else {
+    ipv6_mreq mreq;
+    mreq.ipv6mr_multiaddr = group.ipv6();
+    mreq.ipv6mr_interface = interface ? interface : group.scopeId();
+    result = setsockopt(it->second, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq));
+  }
+  if (-1 == result) throw std::runtime_error("Setting multicast membership on socket failed.");
+}
+
 Optional<Telegram> Connection::get(std::chrono::milliseconds timeout) {
   if (socket_ == 0) throw std::logic_error("Cannot receive if connection was not opened before.");
+  if (not timestamps_ && Tracer::global().enabled()) enableTimestamps();
 
-  setReceiveTimeout(timeout);
+  if (groups_.empty()) {
+    // A receive timeout of 0 would block forever
+    if (timeout.count() <= 0) return receive(socket_, MSG_DONTWAIT, false);
+    setReceiveTimeout(timeout);
+    return receive(socket_, 0, false);
+  }
+
+  // Waiting for the unicast socket and the sockets of the multicast groups at once
+  std::vector<pollfd> fds(groups_.size() + 1);
+  fds[0].fd = socket_;
+  for (size_t i = 0; i < groups_.size(); ++i) fds[i + 1].fd = groups_[i].second;
+  for (auto& fd : fds) fd.events = POLLIN;
+
+  if (poll(fds.data(), fds.size(), timeout.count()) < 0) {
+    if (errno == EINTR) return Optional<Telegram>();
+    throw std::runtime_error("Waiting for telegrams failed.");
+  }
+
+  for (size_t i = 0; i < fds.size(); ++i) {
+    if (fds[i].revents & POLLIN) return receive(fds[i].fd, MSG_DONTWAIT, i > 0);
+  }
+  return Optional<Telegram>();
+}
 
-  struct sockaddr_in sa;
-  socklen_t fromlen = sizeof(sa);
+void Connection::enableTimestamps() {
+  int on = 1;
+  if (-1 == setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on))) {
+    throw std::runtime_error("Enabling receive timestamps on socket failed.");
+  }
+  for (const auto& group : groups_) setsockopt(group.second, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+  timestamps_ = true;
+}
+
+Optional<Telegram> Connection::receive(int fd, int flags, bool multicast) {
+  sockaddr_storage sa;
   memset(&sa, 0, sizeof(sa));
-  ssize_t bytesReceived = recvfrom(socket_, buffer_, bufferSize_, 0, (struct sockaddr*) &sa, &fromlen);
+  iovec iov{buffer_, bufferSize_};
+  uint8_t control[CMSG_SPACE(sizeof(timespec))];
+
+  msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_name = &sa;
+  hdr.msg_namelen = sizeof(sa);
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = sizeof(control);
+  ssize_t bytesReceived = recvmsg(fd, &hdr, flags);
 
-  if (bytesReceived < 0)
+  if (bytesReceived < 0) {
     if (errno == EAGAIN) return Optional<Telegram>();
     else throw std::runtime_error("Receiving telegram failed.");
-  else
-    return Optional<Telegram>(sa.sin_addr.s_addr, ntohs(sa.sin_port), std::vector<uint8_t>(buffer_, buffer_+bytesReceived));
+  }
+
+  datagramsReceived.increment();
+  CoAP::bytesReceived.increment(bytesReceived);
+  Telegram telegram(Endpoint::fromSockaddr(reinterpret_cast<sockaddr*>(&sa)),
+                    std::vector<uint8_t>(buffer_, buffer_+bytesReceived),
+                    multicast);
+
+  for (auto cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      telegram.withTimestamp(static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec);
+    }
+  }
+  return Optional<Telegram>(std::move(telegram));
 }
 
 void Connection::send(Telegram&& telegram) {
   if (socket_ == 0) throw std::logic_error("Cannot send if connection was not opened before.");
 
-  struct sockaddr_in sa;
-  memset(&sa, 0, sizeof(sa));
-  sa.sin_family = AF_INET;
-  sa.sin_addr.s_addr = telegram.getIP();
-  sa.sin_port = htons(telegram.getPort());
+  sockaddr_storage sa;
+  const auto length = telegram.getEndpoint().toSockaddr(sa, family_);
 
-  // TODO: How can we replace this temporary copy, e.g. by a move or reference
-  auto msg = telegram.getMessage();
-  auto bytes_sent = sendto(socket_, msg.data(), msg.size(), 0, (struct sockaddr*) &sa, sizeof(sa));
+  const auto& msg = telegram.getMessage();
+  auto bytes_sent = sendto(socket_, msg.data(), msg.size(), 0, reinterpret_cast<sockaddr*>(&sa), length);
   if (bytes_sent < 0) throw std::runtime_error("Sending telegram failed.");
+
+  datagramsSent.increment();
+  bytesSent.increment(bytes_sent);
+}
+
+void Connection::sendBatch(std::vector<Telegram>&& telegrams) {
+  if (socket_ == 0) throw std::logic_error("Cannot send if connection was not opened before.");
+
+  std::vector<sockaddr_storage> addresses(telegrams.size());
+  std::vector<iovec> iovecs(telegrams.size());
+  std::vector<mmsghdr> headers(telegrams.size());
+
+  for (size_t i = 0; i < telegrams.size(); ++i) {
+    auto& sa = addresses[i];
+    const auto length = telegrams[i].getEndpoint().toSockaddr(sa, family_);
+
+    const auto& msg = telegrams[i].getMessage();
+    iovecs[i].iov_base = const_cast<uint8_t*>(msg.data());
+    iovecs[i].iov_len = msg.size();
+
+    auto& hdr = headers[i].msg_hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_name = &sa;
+    hdr.msg_namelen = length;
+    hdr.msg_iov = &iovecs[i];
+    hdr.msg_iovlen = 1;
+  }
+
+  // sendmmsg may send fewer telegrams than requested, thus continue with the remaining ones
+  size_t sent = 0;
+  while (sent < headers.size()) {
+    auto count = sendmmsg(socket_, &headers[sent], headers.size() - sent, 0);
+    if (count < 0) throw std::runtime_error("Sending telegrams failed.");
+    for (auto i = sent; i < sent + count; ++i) bytesSent.increment(headers[i].msg_len);
+    sent += count;
+  }
+  datagramsSent.increment(sent);
 }
 
 void Connection::setReceiveTimeout(std::chrono::milliseconds timeout) {
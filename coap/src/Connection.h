@@ -25,6 +25,9 @@ class Connection : public IConnection {
   /**
    * Opens a connection on the given port.
    *
+   * The connection uses a dual-stack socket for IPv6 and IPv4 if the host supports IPv6,
+   * otherwise it is limited to IPv4.
+   *
    * @param port  Number of the port to open for incoming and outgoing telegrams
    *
    * @throws  std::logic_error    when open was already called before
@@ -39,6 +42,16 @@ class Connection : public IConnection {
 
   void send(Telegram&& telegram) override;
 
+  void sendBatch(std::vector<Telegram>&& telegrams) override;
+
+  /**
+   * Joins the multicast group on the interface.
+   *
+   * Telegrams to the group are received with a separate socket bound to the group address,
+   * such that the unicast socket stays unaffected. Responses are sent from the unicast socket.
+   */
+  void joinGroup(const Endpoint& group, uint32_t interface) override;
+
   Optional<Telegram> get(std::chrono::milliseconds timeout) override;
 
  protected:
@@ -55,9 +68,19 @@ class Connection : public IConnection {
   virtual int setsockopt(int socket, int level, int option_name, const void* option_value, socklen_t option_len) const;
 
  private:
+  Optional<Telegram> receive(int fd, int flags, bool multicast);
+
+  // Lets the kernel timestamp received telegrams once the tracer is enabled
+  void enableTimestamps();
+
   int socket_{0};
+  bool timestamps_{false};
+  int family_{AF_INET};
   static constexpr int bufferSize_{2048};
   uint8_t buffer_[bufferSize_];
+
+  // Sockets bound to the joined multicast groups
+  std::vector<std::pair<Endpoint, int>> groups_;
 };
 
 }  // namespace CoAP
@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ContentFormat.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace CoAP {
+
+namespace ContentFormat {
+
+namespace {
+
+struct MediaType {
+  uint16_t contentFormat;
+  const char* name;
+};
+
+// text/plain is sent with charset, CoAP defines it as UTF-8
+const MediaType mediaTypes[] = {
+    {TextPlain, "text/plain; charset=utf-8"},
+    {LinkFormat, "application/link-format"},
+    {OctetStream, "application/octet-stream"},
+    {Json, "application/json"},
+    {Cbor, "application/cbor"},
+};
+
+// Compares the media type without parameters, ignoring case and spaces
+bool sameType(StringView type, const char* name) {
+  const auto length = strcspn(name, ";");
+  size_t end = type.find(';');
+  if (end == StringView::npos) end = type.size();
+  while (end > 0 && isspace(static_cast<unsigned char>(type[end - 1]))) --end;
+
+  size_t begin = 0;
+  while (begin < end && isspace(static_cast<unsigned char>(type[begin]))) ++begin;
+  if (end - begin != length) return false;
+
+  for (size_t i = 0; i < length; ++i) {
+    if (tolower(static_cast<unsigned char>(type[begin + i])) != name[i]) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+const char* mediaType(uint16_t contentFormat) {
+  for (auto& type : mediaTypes) {
+    if (type.contentFormat == contentFormat) return type.name;
+  }
+  return nullptr;
+}
+
+Optional<uint16_t> fromMediaType(StringView mediaType) {
+  for (auto& type : mediaTypes) {
+    if (sameType(mediaType, type.name)) return Optional<uint16_t>(type.contentFormat);
+  }
+  return Optional<uint16_t>();
+}
+
+}  // namespace ContentFormat
+
+}  // namespace CoAP
@@ -0,0 +1,586 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifdef WITH_DTLS
+
+#include "DtlsConnection.h"
+
+#include "Logging.h"
+
+#include <openssl/err.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+
+#include <algorithm>
+#include <cstring>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+namespace {
+
+// Minimum MTU of IPv6, such that no fragmentation on the network layer is needed
+constexpr long LINK_MTU = 1280;
+
+// Largest plaintext of a record
+constexpr size_t MAX_PLAINTEXT = 16384;
+
+constexpr uint8_t CONTENT_TYPE_HANDSHAKE = 22;
+constexpr uint8_t HANDSHAKE_CLIENT_HELLO = 1;
+constexpr size_t RECORD_HEADER_SIZE = 13;
+
+// Returns true if the datagram starts with a ClientHello of epoch 0, which starts a new session
+bool isClientHello(const std::vector<uint8_t>& datagram) {
+  return datagram.size() > RECORD_HEADER_SIZE
+      && datagram[0] == CONTENT_TYPE_HANDSHAKE
+      && datagram[3] == 0 && datagram[4] == 0
+      && datagram[RECORD_HEADER_SIZE] == HANDSHAKE_CLIENT_HELLO;
+}
+
+std::string lastError() {
+  auto error = ERR_get_error();
+  ERR_clear_error();
+  if (error == 0) return "unknown error";
+
+  char buffer[256];
+  ERR_error_string_n(error, buffer, sizeof(buffer));
+  return buffer;
+}
+
+}  // namespace
+
+void DtlsConnection::SslDeleter::operator()(SSL* ssl) const {
+  SSL_free(ssl);
+}
+
+void DtlsConnection::SslDeleter::operator()(SSL_SESSION* session) const {
+  SSL_SESSION_free(session);
+}
+
+void DtlsConnection::SslDeleter::operator()(BIO_ADDR* address) const {
+  BIO_ADDR_free(address);
+}
+
+DtlsConnection::DtlsConnection(std::shared_ptr<IConnection> transport, const DtlsCredentials& credentials)
+    : transport_(transport),
+      credentials_(credentials) {
+  if (credentials_.psk.empty() && credentials_.certificate.empty() && credentials_.trustedCertificates.empty()) {
+    throw std::runtime_error("DTLS requires a pre-shared key or certificates.");
+  }
+
+  auto fail = [this](const std::string& what) {
+    auto reason = what + ": " + lastError();
+    if (context_) SSL_CTX_free(context_);
+    if (bioMethod_) BIO_meth_free(bioMethod_);
+    context_ = nullptr;
+    bioMethod_ = nullptr;
+    throw std::runtime_error(reason);
+  };
+
+  context_ = SSL_CTX_new(DTLS_method());
+  bioMethod_ = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "CoAP datagram");
+  if (not context_ || not bioMethod_) fail("Creating DTLS context failed");
+
+  BIO_meth_set_write(bioMethod_, bioWrite);
+  BIO_meth_set_read(bioMethod_, bioRead);
+  BIO_meth_set_ctrl(bioMethod_, bioCtrl);
+  BIO_meth_set_create(bioMethod_, [](BIO* bio) { BIO_set_init(bio, 1); return 1; });
+
+  SSL_CTX_set_app_data(context_, this);
+  SSL_CTX_set_min_proto_version(context_, DTLS1_2_VERSION);
+  SSL_CTX_set_options(context_, SSL_OP_NO_QUERY_MTU);
+
+  // Clients keep their sessions per server themselves, servers use the internal cache
+  SSL_CTX_set_session_cache_mode(context_, SSL_SESS_CACHE_SERVER);
+  static const unsigned char sessionContext[] = "CoaPP";
+  SSL_CTX_set_session_id_context(context_, sessionContext, sizeof(sessionContext) - 1);
+
+  const bool certificates = not credentials_.certificate.empty() || not credentials_.trustedCertificates.empty();
+  const char* ciphers = credentials_.psk.empty() ? "DEFAULT" : certificates ? "DEFAULT:PSK" : "PSK";
+  if (1 != SSL_CTX_set_cipher_list(context_, ciphers)) fail("Setting DTLS ciphers failed");
+
+  if (not credentials_.psk.empty()) {
+    SSL_CTX_set_psk_client_callback(context_, pskClient);
+    SSL_CTX_set_psk_server_callback(context_, pskServer);
+  }
+
+  if (1 != RAND_bytes(cookieSecret_.data(), static_cast<int>(cookieSecret_.size()))) {
+    fail("Creating DTLS cookie secret failed");
+  }
+  SSL_CTX_set_cookie_generate_cb(context_, generateCookie);
+  SSL_CTX_set_cookie_verify_cb(context_, verifyCookie);
+
+  if (not credentials_.certificate.empty()) {
+    std::unique_ptr<BIO, decltype(&BIO_free)> pem(
+        BIO_new_mem_buf(credentials_.certificate.data(), static_cast<int>(credentials_.certificate.size())), BIO_free);
+    auto certificate = PEM_read_bio_X509(pem.get(), nullptr, nullptr, nullptr);
+    if (not certificate || 1 != SSL_CTX_use_certificate(context_, certificate)) {
+      X509_free(certificate);
+      fail("Loading DTLS certificate failed");
+    }
+    X509_free(certificate);
+
+    // Further certificates complete the chain
+    while (auto intermediate = PEM_read_bio_X509(pem.get(), nullptr, nullptr, nullptr)) {
+      SSL_CTX_add_extra_chain_cert(context_, intermediate);
+    }
+    ERR_clear_error();
+
+    std::unique_ptr<BIO, decltype(&BIO_free)> keyPem(
+        BIO_new_mem_buf(credentials_.privateKey.data(), static_cast<int>(credentials_.privateKey.size())), BIO_free);
+    auto key = PEM_read_bio_PrivateKey(keyPem.get(), nullptr, nullptr, nullptr);
+    if (not key || 1 != SSL_CTX_use_PrivateKey(context_, key) || 1 != SSL_CTX_check_private_key(context_)) {
+      EVP_PKEY_free(key);
+      fail("Loading DTLS private key failed");
+    }
+    EVP_PKEY_free(key);
+  }
+
+  if (not credentials_.trustedCertificates.empty()) {
+    std::unique_ptr<BIO, decltype(&BIO_free)> pem(
+        BIO_new_mem_buf(credentials_.trustedCertificates.data(), static_cast<int>(credentials_.trustedCertificates.size())),
+        BIO_free);
+    auto store = SSL_CTX_get_cert_store(context_);
+    unsigned count = 0;
+    while (auto certificate = PEM_read_bio_X509(pem.get(), nullptr, nullptr, nullptr)) {
+      X509_STORE_add_cert(store, certificate);
+      X509_free(certificate);
+      ++count;
+    }
+    ERR_clear_error();
+    if (count == 0) fail("Loading trusted DTLS certificates failed");
+
+    SSL_CTX_set_verify(context_, SSL_VERIFY_PEER, nullptr);
+  }
+
+  listenAddress_.reset(BIO_ADDR_new());
+  if (not listenAddress_) fail("Creating DTLS listener failed");
+  try {
+    renewListener();
+  } catch (std::exception&) {
+    fail("Creating DTLS listener failed");
+  }
+}
+
+DtlsConnection::~DtlsConnection() {
+  // Peers shall not wait for the idle timeout to drop their sessions
+  for (auto& entry : sessions_) {
+    if (not entry.second.established_) continue;
+    SSL_shutdown(entry.second.ssl_.get());
+    try {
+      flush(entry.first, entry.second);
+    } catch (std::exception&) {
+      // the transport might already be closed
+    }
+  }
+
+  sessions_.clear();
+  resumable_.clear();
+  listener_.ssl_.reset();
+  if (context_) SSL_CTX_free(context_);
+  if (bioMethod_) BIO_meth_free(bioMethod_);
+  context_ = nullptr;
+  bioMethod_ = nullptr;
+}
+
+void DtlsConnection::send(Telegram&& telegram) {
+  const auto& endpoint = telegram.getEndpoint();
+  if (endpoint.isMulticast()) throw std::logic_error("DTLS does not support multicast.");
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = sessions_.find(endpoint);
+  if (it != sessions_.end() && it->second.client_ && it->second.established_
+      && Clock::now() - it->second.lastReceived_ > credentials_.resumeAfterIdle) {
+    DLOG << "Resuming idle DTLS session with " << endpoint << '\n';
+    drop(endpoint, true);
+    it = sessions_.end();
+  }
+
+  if (it == sessions_.end()) {
+    auto& session = newSession(endpoint);
+    session.pending_.push_back(telegram.getMessage());
+    if (not handshake(endpoint, session)) {
+      drop(endpoint);
+      throw std::runtime_error("DTLS handshake with " + endpoint.toString() + " failed.");
+    }
+    return;
+  }
+
+  auto& session = it->second;
+  if (not session.established_) {
+    session.pending_.push_back(telegram.getMessage());
+    return;
+  }
+
+  const auto& message = telegram.getMessage();
+  if (SSL_write(session.ssl_.get(), message.data(), static_cast<int>(message.size())) <= 0) {
+    WLOG << "Encrypting telegram for " << endpoint << " failed: " << lastError() << '\n';
+    drop(endpoint);
+    throw std::runtime_error("Sending telegram failed.");
+  }
+  flush(endpoint, session);
+}
+
+Optional<Telegram> DtlsConnection::get(std::chrono::milliseconds timeout) {
+  std::chrono::milliseconds wait;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handleTimeouts(Clock::now());
+
+    if (not received_.empty()) {
+      auto telegram = std::move(received_.front());
+      received_.pop_front();
+      return Optional<Telegram>(std::move(telegram));
+    }
+
+    // Retransmissions of handshake messages must not wait for the full timeout
+    wait = nextTimeout(timeout);
+  }
+
+  auto record = transport_->get(wait);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (record) {
+    if (record.value().isMulticast()) DLOG << "Ignoring multicast telegram from " << record.value().getEndpoint() << '\n';
+    else onRecord(record.value().getEndpoint(), record.value().getMessage());
+  }
+
+  if (received_.empty()) return Optional<Telegram>();
+
+  auto telegram = std::move(received_.front());
+  received_.pop_front();
+  return Optional<Telegram>(std::move(telegram));
+}
+
+size_t DtlsConnection::sessions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sessions_.size();
+}
+
+DtlsConnection::Statistics DtlsConnection::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+SSL* DtlsConnection::newSsl() {
+  auto ssl = SSL_new(context_);
+  auto bio = ssl ? BIO_new(bioMethod_) : nullptr;
+  if (not bio) {
+    SSL_free(ssl);
+    throw std::runtime_error("Creating DTLS session failed.");
+  }
+
+  SSL_set_bio(ssl, bio, bio);
+  DTLS_set_link_mtu(ssl, LINK_MTU);
+  return ssl;
+}
+
+void DtlsConnection::renewListener() {
+  auto ssl = newSsl();
+  BIO_set_data(SSL_get_rbio(ssl), &listener_);
+  SSL_set_app_data(ssl, &listeningTo_);
+  SSL_set_accept_state(ssl);
+  listener_.ssl_.reset(ssl);
+}
+
+DtlsConnection::Session& DtlsConnection::newSession(const Endpoint& endpoint) {
+  auto ssl = newSsl();
+
+  // The session is never moved within the map, such that the BIO may refer to it
+  auto& session = sessions_[endpoint];
+  session.ssl_.reset(ssl);
+  session.client_ = true;
+  session.lastReceived_ = Clock::now();
+  BIO_set_data(SSL_get_rbio(ssl), &session);
+
+  // Servers are verified even without trusted certificates, such that only PSK handshakes succeed then
+  SSL_set_verify(ssl, SSL_VERIFY_PEER, nullptr);
+  SSL_set_connect_state(ssl);
+  auto cached = resumable_.find(endpoint);
+  if (cached != resumable_.end()) SSL_set_session(ssl, cached->second.get());
+
+  handshaking_.insert(endpoint);
+  return session;
+}
+
+bool DtlsConnection::listen(const Endpoint& endpoint, const std::vector<uint8_t>& datagram) {
+  listeningTo_ = endpoint;
+  listener_.input_ = &datagram;
+  auto result = DTLSv1_listen(listener_.ssl_.get(), listenAddress_.get());
+  listener_.input_ = nullptr;
+
+  // The HelloVerifyRequest, if the cookie was missing or invalid
+  flush(endpoint, listener_);
+
+  if (result < 0) {
+    DLOG << "Ignoring invalid ClientHello from " << endpoint << ": " << lastError() << '\n';
+    ERR_clear_error();
+  }
+  return result > 0;
+}
+
+DtlsConnection::Session& DtlsConnection::accept(const Endpoint& endpoint) {
+  // The listener is replaced first, such that a failure leaves the sessions untouched
+  std::unique_ptr<SSL, SslDeleter> ssl(std::move(listener_.ssl_));
+  try {
+    renewListener();
+  } catch (std::exception&) {
+    listener_.ssl_ = std::move(ssl);
+    throw;
+  }
+
+  auto& session = sessions_[endpoint];
+  session.ssl_ = std::move(ssl);
+  session.lastReceived_ = Clock::now();
+  BIO_set_data(SSL_get_rbio(session.ssl_.get()), &session);
+  // The cookie of the ClientHello is verified again when the handshake continues
+  SSL_set_app_data(session.ssl_.get(), &sessions_.find(endpoint)->first);
+
+  handshaking_.insert(endpoint);
+  return session;
+}
+
+size_t DtlsConnection::pendingAccepts() const {
+  return std::count_if(handshaking_.begin(), handshaking_.end(), [this](const Endpoint& endpoint) {
+    return not sessions_.at(endpoint).client_;
+  });
+}
+
+void DtlsConnection::onRecord(const Endpoint& endpoint, const std::vector<uint8_t>& datagram) {
+  auto it = sessions_.find(endpoint);
+
+  // A ClientHello for an established session means that the client lost it, e.g. by a restart
+  const bool clientHello = isClientHello(datagram);
+  bool accepted = false;
+  if (it == sessions_.end() || (clientHello && it->second.established_ && not it->second.client_)) {
+    if (not clientHello) {
+      DLOG << "Ignoring record from " << endpoint << " without session\n";
+      return;
+    }
+
+    // Clients have to prove that they receive at their address before any state is kept for them
+    if (not listen(endpoint, datagram)) return;
+    if (pendingAccepts() >= credentials_.maxPendingHandshakes) {
+      WLOG << "Ignoring ClientHello from " << endpoint << ", too many DTLS handshakes are pending\n";
+      return;
+    }
+
+    if (it != sessions_.end()) drop(endpoint);
+    accept(endpoint);
+    it = sessions_.find(endpoint);
+    accepted = true;
+  }
+
+  auto& session = it->second;
+  session.lastReceived_ = Clock::now();
+  // The ClientHello of an accepted session has already been read by the listener
+  session.input_ = accepted ? nullptr : &datagram;
+
+  if (not session.established_ && (not handshake(endpoint, session) || not session.established_)) {
+    session.input_ = nullptr;
+    if (not session.ssl_) drop(endpoint);
+    return;
+  }
+
+  // Records following the handshake in the same datagram are buffered by the SSL object
+  uint8_t buffer[MAX_PLAINTEXT];
+  for (;;) {
+    auto bytes = SSL_read(session.ssl_.get(), buffer, sizeof(buffer));
+    if (bytes > 0) {
+      received_.emplace_back(endpoint, std::vector<uint8_t>(buffer, buffer + bytes));
+      continue;
+    }
+
+    auto error = SSL_get_error(session.ssl_.get(), bytes);
+    if (error == SSL_ERROR_WANT_READ) break;
+
+    if (error == SSL_ERROR_ZERO_RETURN) DLOG << "DTLS session closed by " << endpoint << '\n';
+    else WLOG << "Decrypting record from " << endpoint << " failed: " << lastError() << '\n';
+    session.input_ = nullptr;
+    flush(endpoint, session);
+    drop(endpoint);
+    return;
+  }
+
+  session.input_ = nullptr;
+  flush(endpoint, session);
+}
+
+bool DtlsConnection::handshake(const Endpoint& endpoint, Session& session) {
+  auto ssl = session.ssl_.get();
+  auto result = SSL_do_handshake(ssl);
+  flush(endpoint, session);
+
+  if (result == 1) {
+    session.established_ = true;
+    handshaking_.erase(endpoint);
+
+    const bool resumed = SSL_session_reused(ssl);
+    if (resumed) ++statistics_.resumedHandshakes;
+    else ++statistics_.fullHandshakes;
+    DLOG << "DTLS session with " << endpoint << (resumed ? " resumed\n" : " established\n");
+
+    if (session.client_) resumable_[endpoint].reset(SSL_get1_session(ssl));
+
+    for (const auto& message : session.pending_) {
+      if (SSL_write(ssl, message.data(), static_cast<int>(message.size())) <= 0) {
+        WLOG << "Encrypting telegram for " << endpoint << " failed: " << lastError() << '\n';
+      }
+    }
+    session.pending_.clear();
+    flush(endpoint, session);
+    return true;
+  }
+
+  auto error = SSL_get_error(ssl, result);
+  if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return true;
+
+  WLOG << "DTLS handshake with " << endpoint << " failed: " << lastError() << '\n';
+  ++statistics_.failedHandshakes;
+
+  // A failed resumption must not be tried again
+  if (session.client_) resumable_.erase(endpoint);
+  session.ssl_.reset();
+  return false;
+}
+
+void DtlsConnection::handleTimeouts(Clock::time_point now) {
+  // Retransmission of lost handshake flights
+  std::vector<Endpoint> failed;
+  std::vector<Endpoint> idle;
+  for (const auto& endpoint : handshaking_) {
+    auto& session = sessions_[endpoint];
+    if (DTLSv1_handle_timeout(session.ssl_.get()) < 0) {
+      WLOG << "DTLS handshake with " << endpoint << " timed out\n";
+      ERR_clear_error();
+      ++statistics_.failedHandshakes;
+      failed.push_back(endpoint);
+      continue;
+    }
+    flush(endpoint, session);
+  }
+
+  if (now >= nextExpiry_) {
+    for (const auto& entry : sessions_) {
+      if (now - entry.second.lastReceived_ > credentials_.idleTimeout) idle.push_back(entry.first);
+    }
+    nextExpiry_ = now + std::min<Clock::duration>(std::chrono::seconds(1), credentials_.idleTimeout);
+  }
+
+  for (const auto& endpoint : failed) drop(endpoint);
+  for (const auto& endpoint : idle) drop(endpoint, true);
+}
+
+std::chrono::milliseconds DtlsConnection::nextTimeout(std::chrono::milliseconds timeout) const {
+  for (const auto& endpoint : handshaking_) {
+    timeval remaining;
+    if (DTLSv1_get_timeout(sessions_.at(endpoint).ssl_.get(), &remaining) != 1) continue;
+    auto ms = std::chrono::milliseconds(remaining.tv_sec * 1000 + remaining.tv_usec / 1000 + 1);
+    timeout = std::min(timeout, ms);
+  }
+  return timeout;
+}
+
+void DtlsConnection::flush(const Endpoint& endpoint, Session& session) {
+  for (auto& datagram : session.output_) transport_->send(Telegram(endpoint, std::move(datagram)));
+  session.output_.clear();
+}
+
+void DtlsConnection::drop(const Endpoint& endpoint, bool resumable) {
+  // Sessions freed without shutdown are considered broken and cannot be resumed anymore
+  auto it = sessions_.find(endpoint);
+  if (resumable && it != sessions_.end() && it->second.established_) {
+    SSL_set_shutdown(it->second.ssl_.get(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+
+  handshaking_.erase(endpoint);
+  sessions_.erase(endpoint);
+}
+
+int DtlsConnection::bioWrite(BIO* bio, const char* data, int size) {
+  auto session = static_cast<Session*>(BIO_get_data(bio));
+  session->output_.emplace_back(data, data + size);
+  return size;
+}
+
+int DtlsConnection::bioRead(BIO* bio, char* data, int size) {
+  BIO_clear_retry_flags(bio);
+
+  auto session = static_cast<Session*>(BIO_get_data(bio));
+  if (not session->input_) {
+    BIO_set_retry_read(bio);
+    return -1;
+  }
+
+  // Datagram semantics, the rest of a datagram exceeding the buffer is lost
+  auto bytes = std::min(static_cast<size_t>(size), session->input_->size());
+  memcpy(data, session->input_->data(), bytes);
+  session->input_ = nullptr;
+  return static_cast<int>(bytes);
+}
+
+long DtlsConnection::bioCtrl(BIO*, int cmd, long, void*) {
+  switch (cmd) {
+    case BIO_CTRL_FLUSH:
+      return 1;
+    case BIO_CTRL_DGRAM_GET_MTU_OVERHEAD:
+      return 48;  // IPv6 and UDP header
+    default:
+      return 0;
+  }
+}
+
+unsigned DtlsConnection::pskClient(SSL* ssl, const char*, char* identity, unsigned maxIdentityLength,
+                                   unsigned char* psk, unsigned maxPskLength) {
+  auto self = static_cast<DtlsConnection*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  const auto& credentials = self->credentials_;
+  if (credentials.pskIdentity.size() >= maxIdentityLength || credentials.psk.size() > maxPskLength) return 0;
+
+  memcpy(identity, credentials.pskIdentity.c_str(), credentials.pskIdentity.size() + 1);
+  memcpy(psk, credentials.psk.data(), credentials.psk.size());
+  return static_cast<unsigned>(credentials.psk.size());
+}
+
+unsigned DtlsConnection::pskServer(SSL* ssl, const char* identity, unsigned char* psk, unsigned maxPskLength) {
+  auto self = static_cast<DtlsConnection*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  const auto& credentials = self->credentials_;
+
+  std::string key;
+  if (credentials.pskLookup) key = credentials.pskLookup(identity);
+  else if (identity == credentials.pskIdentity) key = credentials.psk;
+
+  if (key.empty() || key.size() > maxPskLength) {
+    DLOG << "Unknown PSK identity " << identity << '\n';
+    return 0;
+  }
+  memcpy(psk, key.data(), key.size());
+  return static_cast<unsigned>(key.size());
+}
+
+int DtlsConnection::generateCookie(SSL* ssl, unsigned char* cookie, unsigned* length) {
+  auto self = static_cast<DtlsConnection*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  auto peer = static_cast<const Endpoint*>(SSL_get_app_data(ssl));
+  if (not peer) return 0;
+
+  const auto address = peer->toString();
+  const auto& secret = self->cookieSecret_;
+  return HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+              reinterpret_cast<const unsigned char*>(address.data()), address.size(), cookie, length) ? 1 : 0;
+}
+
+int DtlsConnection::verifyCookie(SSL* ssl, const unsigned char* cookie, unsigned length) {
+  unsigned char expected[EVP_MAX_MD_SIZE];
+  unsigned expectedLength = 0;
+  if (not generateCookie(ssl, expected, &expectedLength)) return 0;
+  return length == expectedLength && 0 == CRYPTO_memcmp(cookie, expected, length) ? 1 : 0;
+}
+
+}  // namespace CoAP
+
+#endif  // WITH_DTLS
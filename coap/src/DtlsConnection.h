@@ -0,0 +1,151 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __DtlsConnection_h
+#define __DtlsConnection_h
+
+#include "DtlsCredentials.h"
+#include "IConnection.h"
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+typedef struct ssl_session_st SSL_SESSION;
+typedef struct bio_st BIO;
+typedef struct bio_method_st BIO_METHOD;
+typedef union bio_addr_st BIO_ADDR;
+
+namespace CoAP {
+
+/**
+ * DTLS 1.2 protection of the telegrams of another connection (RFC 7252, section 9).
+ *
+ * The decorator keeps one DTLS session per peer. Sending to a peer without session
+ * starts a handshake as client, the telegrams are queued until it is finished.
+ * Receiving a ClientHello from an unknown peer starts a handshake as server, once the
+ * peer returned the cookie of a HelloVerifyRequest (RFC 6347, section 4.2.1). No state
+ * is kept for peers that did not prove to receive at their address, and at most
+ * DtlsCredentials::maxPendingHandshakes handshakes as server are pending at a time.
+ *
+ * Servers are always verified by their certificate, such that certificate based
+ * handshakes of clients without DtlsCredentials::trustedCertificates fail.
+ *
+ * Sessions established as client are cached per server and resumed with an
+ * abbreviated handshake when the session has to be re-established, e.g. after
+ * it was idle for longer than DtlsCredentials::resumeAfterIdle.
+ *
+ * Multicast is not supported, as DTLS does not protect group communication.
+ */
+class DtlsConnection : public IConnection {
+ public:
+  struct Statistics {
+    unsigned fullHandshakes{0};
+    unsigned resumedHandshakes{0};
+    unsigned failedHandshakes{0};
+  };
+
+  /**
+   * @param transport    Connection used for the records, e.g. an open UDP connection
+   * @param credentials  Keys or certificates of this endpoint
+   *
+   * @throws  std::runtime_error  when the credentials are invalid
+   */
+  DtlsConnection(std::shared_ptr<IConnection> transport, const DtlsCredentials& credentials);
+
+  virtual ~DtlsConnection();
+
+  DtlsConnection(const DtlsConnection&) = delete;
+  DtlsConnection& operator=(const DtlsConnection&) = delete;
+
+  void send(Telegram&& telegram) override;
+
+  Optional<Telegram> get(std::chrono::milliseconds timeout) override;
+
+  /// Returns the number of established or pending sessions
+  size_t sessions() const;
+
+  Statistics statistics() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct SslDeleter {
+    void operator()(SSL* ssl) const;
+    void operator()(SSL_SESSION* session) const;
+    void operator()(BIO_ADDR* address) const;
+  };
+
+  struct Session {
+    std::unique_ptr<SSL, SslDeleter> ssl_;
+    bool client_{false};
+    bool established_{false};
+    Clock::time_point lastReceived_;
+    // plaintext waiting for the end of the handshake
+    std::deque<std::vector<uint8_t>> pending_;
+    // datagram to be read by the SSL object and the datagrams written by it
+    const std::vector<uint8_t>* input_{nullptr};
+    std::vector<std::vector<uint8_t>> output_;
+  };
+
+  // Creates an SSL object with a BIO for the datagrams of a session
+  SSL* newSsl();
+  void renewListener();
+  // Starts a handshake as client
+  Session& newSession(const Endpoint& endpoint);
+  // Answers a ClientHello without valid cookie statelessly, returns true if the cookie was valid
+  bool listen(const Endpoint& endpoint, const std::vector<uint8_t>& datagram);
+  // Continues the handshake of the listener as server in a new session
+  Session& accept(const Endpoint& endpoint);
+  size_t pendingAccepts() const;
+  void onRecord(const Endpoint& endpoint, const std::vector<uint8_t>& datagram);
+  // Continues the handshake, returns false if it failed
+  bool handshake(const Endpoint& endpoint, Session& session);
+  void handleTimeouts(Clock::time_point now);
+  std::chrono::milliseconds nextTimeout(std::chrono::milliseconds timeout) const;
+  void flush(const Endpoint& endpoint, Session& session);
+  // Closes the session, resumable if it was not dropped because of an error
+  void drop(const Endpoint& endpoint, bool resumable = false);
+
+  static int bioWrite(BIO* bio, const char* data, int size);
+  static int bioRead(BIO* bio, char* data, int size);
+  static long bioCtrl(BIO* bio, int cmd, long num, void* ptr);
+  static unsigned pskClient(SSL* ssl, const char* hint, char* identity, unsigned maxIdentityLength,
+                            unsigned char* psk, unsigned maxPskLength);
+  static unsigned pskServer(SSL* ssl, const char* identity, unsigned char* psk, unsigned maxPskLength);
+  static int generateCookie(SSL* ssl, unsigned char* cookie, unsigned* length);
+  static int verifyCookie(SSL* ssl, const unsigned char* cookie, unsigned length);
+
+  std::shared_ptr<IConnection> transport_;
+  DtlsCredentials credentials_;
+  SSL_CTX* context_{nullptr};
+  BIO_METHOD* bioMethod_{nullptr};
+  // Key of the cookies, which are bound to the address of the client
+  std::array<unsigned char, 32> cookieSecret_;
+
+  // Protection of the sessions, as send() and get() may be called by different threads
+  mutable std::mutex mutex_;
+
+  std::unordered_map<Endpoint, Session> sessions_;
+  std::unordered_set<Endpoint> handshaking_;
+  std::unordered_map<Endpoint, std::unique_ptr<SSL_SESSION, SslDeleter>> resumable_;
+  // SSL object verifying the cookies of ClientHellos before a session is created
+  Session listener_;
+  Endpoint listeningTo_;
+  std::unique_ptr<BIO_ADDR, SslDeleter> listenAddress_;
+  std::deque<Telegram> received_;
+  Clock::time_point nextExpiry_;
+  Statistics statistics_;
+};
+
+}  // namespace CoAP
+
+#endif  // __DtlsConnection_h
@@ -0,0 +1,127 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Endpoint.h"
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <ostream>
+#include <stdexcept>
+
+namespace CoAP {
+
+Endpoint::Endpoint(in_addr_t ip, uint16_t port)
+    : family_(AF_INET), port_(port) {
+  memcpy(address_, &ip, sizeof(ip));
+}
+
+Endpoint::Endpoint(const in6_addr& ip, uint16_t port, uint32_t scopeId)
+    : family_(AF_INET6), port_(port), scopeId_(scopeId) {
+  if (IN6_IS_ADDR_V4MAPPED(&ip)) {
+    family_ = AF_INET;
+    scopeId_ = 0;
+    memcpy(address_, ip.s6_addr + 12, 4);
+  } else {
+    memcpy(address_, ip.s6_addr, sizeof(address_));
+  }
+}
+
+Optional<Endpoint> Endpoint::fromString(const std::string& ip, uint16_t port) {
+  in_addr addr4;
+  if (inet_pton(AF_INET, ip.c_str(), &addr4) == 1) return Endpoint(addr4.s_addr, port);
+
+  const auto percent = ip.find('%');
+  uint32_t scopeId = 0;
+  if (percent != std::string::npos) {
+    const auto scope = ip.substr(percent + 1);
+    scopeId = if_nametoindex(scope.c_str());
+    if (scopeId == 0) scopeId = strtoul(scope.c_str(), nullptr, 10);
+    if (scopeId == 0) return Optional<Endpoint>();
+  }
+
+  in6_addr addr6;
+  if (inet_pton(AF_INET6, ip.substr(0, percent).c_str(), &addr6) == 1) return Endpoint(addr6, port, scopeId);
+
+  return Optional<Endpoint>();
+}
+
+Endpoint Endpoint::fromSockaddr(const sockaddr* address) {
+  if (address->sa_family == AF_INET) {
+    auto sa = reinterpret_cast<const sockaddr_in*>(address);
+    return Endpoint(sa->sin_addr.s_addr, ntohs(sa->sin_port));
+  }
+  if (address->sa_family == AF_INET6) {
+    auto sa = reinterpret_cast<const sockaddr_in6*>(address);
+    return Endpoint(sa->sin6_addr, ntohs(sa->sin6_port), sa->sin6_scope_id);
+  }
+  return Endpoint();
+}
+
+socklen_t Endpoint::toSockaddr(sockaddr_storage& address, int family) const {
+  if (family == AF_INET) {
+    // IPv4-mapped addresses are stored as IPv4, thus all remaining IPv6 addresses are unreachable
+    if (isIPv6()) throw std::invalid_argument("IPv6 endpoint " + toString() + " cannot be reached by IPv4 sockets.");
+
+    auto& sa = reinterpret_cast<sockaddr_in&>(address);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = ipv4();
+    sa.sin_port = htons(port_);
+    return sizeof(sa);
+  }
+
+  auto& sa = reinterpret_cast<sockaddr_in6&>(address);
+  memset(&sa, 0, sizeof(sa));
+  sa.sin6_family = AF_INET6;
+  sa.sin6_addr = ipv6();
+  sa.sin6_port = htons(port_);
+  sa.sin6_scope_id = scopeId_;
+  return sizeof(sa);
+}
+
+bool Endpoint::isMulticast() const {
+  if (family_ == AF_INET) return IN_MULTICAST(ntohl(ipv4()));
+  if (family_ == AF_INET6) return address_[0] == 0xff;
+  return false;
+}
+
+in_addr_t Endpoint::ipv4() const {
+  in_addr_t ip = 0;
+  if (family_ == AF_INET) memcpy(&ip, address_, sizeof(ip));
+  return ip;
+}
+
+in6_addr Endpoint::ipv6() const {
+  in6_addr ip = IN6ADDR_ANY_INIT;
+  if (family_ == AF_INET6) {
+    memcpy(ip.s6_addr, address_, sizeof(address_));
+  } else if (family_ == AF_INET) {
+    ip.s6_addr[10] = 0xff;
+    ip.s6_addr[11] = 0xff;
+    memcpy(ip.s6_addr + 12, address_, 4);
+  }
+  return ip;
+}
+
+std::string Endpoint::toString() const {
+  char buffer[INET6_ADDRSTRLEN];
+  if (family_ == AF_INET) {
+    inet_ntop(AF_INET, address_, buffer, sizeof(buffer));
+    return std::string(buffer) + ':' + std::to_string(port_);
+  }
+  if (family_ == AF_INET6) {
+    inet_ntop(AF_INET6, address_, buffer, sizeof(buffer));
+    auto ip = std::string(buffer);
+    if (scopeId_) ip += '%' + std::to_string(scopeId_);
+    return '[' + ip + "]:" + std::to_string(port_);
+  }
+  return "<unspecified>";
+}
+
+std::ostream& operator<<(std::ostream& os, const Endpoint& endpoint) {
+  os << endpoint.toString();
+  return os;
+}
+
+}  // namespace CoAP
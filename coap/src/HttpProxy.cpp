@@ -0,0 +1,577 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HttpProxy.h"
+
+#include "ClientImpl.h"
+#include "ContentFormat.h"
+#include "Logging.h"
+#include "Metrics.h"
+#include "Resolver.h"
+#include "URI.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+namespace {
+
+auto& requests = Metrics::global().counter("coap_http_requests_total");
+auto& activeConnections = Metrics::global().gauge("coap_http_connections_active");
+
+const std::string COAP_SCHEME = "coap";
+
+// Identifiers of the epoll events besides the connections
+constexpr uint64_t LISTENER = 0;
+constexpr uint64_t WAKE_UP = 1;
+
+const char* reasonPhrase(unsigned status) {
+  switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 412: return "Precondition Failed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "";
+  }
+}
+
+bool equalsIgnoreCase(StringView lhs, const char* rhs) {
+  if (lhs.size() != strlen(rhs)) return false;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (tolower(static_cast<unsigned char>(lhs[i])) != rhs[i]) return false;
+  }
+  return true;
+}
+
+bool containsIgnoreCase(StringView text, const char* word) {
+  const auto length = strlen(word);
+  for (size_t i = 0; i + length <= text.size(); ++i) {
+    if (equalsIgnoreCase(text.substr(i, length), word)) return true;
+  }
+  return false;
+}
+
+StringView trim(StringView text) {
+  size_t begin = 0;
+  size_t end = text.size();
+  while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+  while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) --end;
+  return text.substr(begin, end - begin);
+}
+
+// The first media type of the Accept header, wildcards do not restrict the content format
+Optional<uint16_t> acceptedFormat(StringView accept) {
+  const auto first = trim(accept.substr(0, accept.find(',')));
+  if (first.empty() || first.find('*') != StringView::npos) return Optional<uint16_t>();
+  return ContentFormat::fromMediaType(first);
+}
+
+}  // namespace
+
+HttpProxy::HttpProxy(ClientImpl& client, Resolver& resolver, const HttpProxyOptions& options)
+    : client_(client), resolver_(resolver), options_(options) {
+  if (not options_.target.empty()) {
+    // The path of the target is optional
+    auto target = URI::fromString(options_.target);
+    if (not target) target = URI::fromString(options_.target + "/");
+    if (not target || target.value().getProtocol() != COAP_SCHEME) {
+      throw std::logic_error("The target of the HTTP proxy needs to be a coap URI, not " + options_.target);
+    }
+    targetHost_ = target.value().getServer();
+    targetPort_ = target.value().getPort();
+    targetPath_ = target.value().getPath();
+    while (not targetPath_.empty() && targetPath_.back() == '/') targetPath_.pop_back();
+  }
+
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeUp_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  // Dual-stack like the UDP connection, falling back to IPv4 only
+  auto family = AF_INET6;
+  listener_ = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener_ < 0) {
+    family = AF_INET;
+    listener_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  }
+
+  int off = 0;
+  int on = 1;
+  sockaddr_storage sa;
+  auto length = (family == AF_INET6 ? Endpoint(in6addr_any, options_.port) : Endpoint(htonl(INADDR_ANY), options_.port))
+                    .toSockaddr(sa, family);
+  epoll_event listenerEvent{};
+  listenerEvent.events = EPOLLIN;
+  listenerEvent.data.u64 = LISTENER;
+  epoll_event wakeUpEvent{};
+  wakeUpEvent.events = EPOLLIN;
+  wakeUpEvent.data.u64 = WAKE_UP;
+
+  if (epoll_ < 0 || wakeUp_ < 0 || listener_ < 0
+      || (family == AF_INET6 && -1 == ::setsockopt(listener_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)))
+      || -1 == ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+      || -1 == ::bind(listener_, reinterpret_cast<sockaddr*>(&sa), length)
+      || -1 == ::listen(listener_, SOMAXCONN)
+      || -1 == ::getsockname(listener_, reinterpret_cast<sockaddr*>(&sa), &length)
+      || -1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, listener_, &listenerEvent)
+      || -1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeUp_, &wakeUpEvent)) {
+    for (auto fd : {listener_, wakeUp_, epoll_}) {
+      if (fd >= 0) ::close(fd);
+    }
+    throw std::runtime_error("Listening for HTTP connections failed.");
+  }
+  port_ = Endpoint::fromSockaddr(reinterpret_cast<sockaddr*>(&sa)).port();
+
+  nextId_ = WAKE_UP + 1;
+  thread_ = std::thread([this]() { run(); });
+}
+
+HttpProxy::~HttpProxy() {
+  terminate_ = true;
+  wakeUp();
+  thread_.join();
+
+  for (auto& connection : connections_) ::close(connection.second.fd_);
+  activeConnections.add(-static_cast<int64_t>(connections_.size()));
+  ::close(listener_);
+  ::close(wakeUp_);
+  ::close(epoll_);
+}
+
+size_t HttpProxy::parse(const char* data, size_t size, Request& request) {
+  static const char END_OF_HEADER[] = "\r\n\r\n";
+  const auto headerEnd = std::search(data, data + size, END_OF_HEADER, END_OF_HEADER + 4);
+  if (headerEnd == data + size) return 0;
+  const auto header = StringView(data, headerEnd - data + 2);
+
+  // Request line: method, target and version
+  auto lineEnd = header.find('\r');
+  const auto line = header.substr(0, lineEnd);
+  const auto methodEnd = line.find(' ');
+  const auto targetEnd = line.find(' ', methodEnd + 1);
+  if (methodEnd == StringView::npos || targetEnd == StringView::npos) throw std::runtime_error("Invalid request line");
+  request.method_ = line.substr(0, methodEnd);
+  request.target_ = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+  const auto version = line.substr(targetEnd + 1);
+  if (request.target_.empty() || request.target_[0] != '/') throw std::runtime_error("Invalid request target");
+  if (version == "HTTP/1.1") request.keepAlive_ = true;
+  else if (version == "HTTP/1.0") request.keepAlive_ = false;
+  else throw std::runtime_error("Unsupported HTTP version");
+
+  // Header fields
+  size_t contentLength = 0;
+  for (auto lineStart = lineEnd + 2; lineStart < header.size(); lineStart = lineEnd + 2) {
+    lineEnd = header.find('\r', lineStart);
+    const auto field = header.substr(lineStart, lineEnd - lineStart);
+    const auto colon = field.find(':');
+    if (colon == StringView::npos) throw std::runtime_error("Invalid header field");
+    const auto name = field.substr(0, colon);
+    const auto value = trim(field.substr(colon + 1));
+
+    if (equalsIgnoreCase(name, "content-length")) {
+      if (value.empty() || value.size() > 18) throw std::runtime_error("Invalid Content-Length");
+      contentLength = 0;
+      for (auto c : value) {
+        if (not isdigit(static_cast<unsigned char>(c))) throw std::runtime_error("Invalid Content-Length");
+        contentLength = contentLength * 10 + (c - '0');
+      }
+    } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+      request.chunked_ = true;
+    } else if (equalsIgnoreCase(name, "connection")) {
+      if (containsIgnoreCase(value, "close")) request.keepAlive_ = false;
+      else if (containsIgnoreCase(value, "keep-alive")) request.keepAlive_ = true;
+    } else if (equalsIgnoreCase(name, "content-type")) {
+      request.contentType_ = value;
+    } else if (equalsIgnoreCase(name, "accept")) {
+      request.accept_ = value;
+    }
+  }
+
+  const size_t headerSize = headerEnd - data + 4;
+  if (request.chunked_) return headerSize;
+  if (size - headerSize < contentLength) return 0;
+
+  request.body_.assign(data + headerSize, contentLength);
+  return headerSize + contentLength;
+}
+
+std::string HttpProxy::format(const RestResponse& response, bool head, bool close) {
+  auto status = httpStatus(response.code());
+  // Responses without response code
+  if (status == 0) status = httpStatus(Code::BadGateway);
+
+  const auto payload = response.payload();
+  std::string out;
+  out.reserve(160 + payload.size());
+  out += "HTTP/1.1 ";
+  out += std::to_string(status);
+  out += ' ';
+  out += reasonPhrase(status);
+  out += "\r\n";
+  if (response.hasContentFormat() && not payload.empty()) {
+    const auto mediaType = ContentFormat::mediaType(response.contentFormat());
+    out += "Content-Type: ";
+    out += mediaType ? mediaType : ContentFormat::mediaType(ContentFormat::OctetStream);
+    out += "\r\n";
+  }
+  if (response.hasMaxAge()) {
+    out += "Cache-Control: max-age=";
+    out += std::to_string(response.maxAge());
+    out += "\r\n";
+  }
+  out += "Content-Length: ";
+  out += std::to_string(payload.size());
+  out += "\r\n";
+  if (close) out += "Connection: close\r\n";
+  out += "\r\n";
+  if (not head) out += payload;
+  return out;
+}
+
+void HttpProxy::run() {
+  epoll_event events[64];
+  while (not terminate_) {
+    // The resolver does not notify about finished lookups, thus they are polled
+    const auto timeout = unresolved_.empty() ? -1 : 10;
+    const auto count = epoll_wait(epoll_, events, 64, timeout);
+    if (count < 0 && errno != EINTR) {
+      ELOG << "Waiting for HTTP connections failed\n";
+      return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      const auto id = events[i].data.u64;
+      if (id == LISTENER) {
+        accept();
+        continue;
+      }
+      if (id == WAKE_UP) {
+        uint64_t value;
+        auto bytes = ::read(wakeUp_, &value, sizeof(value));
+        (void) bytes;
+        continue;
+      }
+
+      auto it = connections_.find(id);
+      if (it != connections_.end() && (events[i].events & EPOLLOUT)) deliver(id, it->second);
+      it = connections_.find(id);
+      if (it != connections_.end() && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        onReadable(id, it->second);
+      }
+    }
+
+    forwardResolved();
+    completeResponses();
+  }
+}
+
+void HttpProxy::accept() {
+  for (;;) {
+    auto fd = ::accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) WLOG << "Accepting HTTP connection failed\n";
+      return;
+    }
+
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    const auto id = nextId_++;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (-1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event)) {
+      ::close(fd);
+      continue;
+    }
+
+    connections_[id].fd_ = fd;
+    activeConnections.increment();
+  }
+}
+
+void HttpProxy::onReadable(uint64_t id, Connection& connection) {
+  if (connection.eof_) {
+    // Hang up or error of a connection, which is not read anymore
+    disconnect(id);
+    return;
+  }
+
+  char buffer[16384];
+  ssize_t bytes;
+  for (;;) {
+    bytes = ::recv(connection.fd_, buffer, sizeof(buffer), 0);
+    if (bytes <= 0) break;
+    connection.in_.append(buffer, bytes);
+    // The rest is read once the buffered requests are taken over by the pipeline
+    if (connection.in_.size() > maxBuffered()) break;
+  }
+
+  if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    disconnect(id);
+    return;
+  }
+
+  // The client may close its side after sending its requests, their responses are still sent
+  connection.eof_ = (bytes == 0);
+  readRequests(id, connection);
+}
+
+void HttpProxy::readRequests(uint64_t id, Connection& connection) {
+  // Requests that are answered right away make room for further buffered requests
+  size_t offset;
+  do {
+    handOver(connection);
+    offset = 0;
+    while (not connection.closing_ && connection.slots_.size() < options_.pipelineDepth) {
+      Request request;
+      size_t size = 0;
+      try {
+        size = parse(connection.in_.data() + offset, connection.in_.size() - offset, request);
+      } catch (std::runtime_error& e) {
+        DLOG << "Rejecting malformed HTTP request: " << e.what() << '\n';
+        reject(connection, Code::BadRequest);
+        break;
+      }
+
+      if (size == 0) {
+        if (connection.in_.size() - offset > options_.maxRequestSize) reject(connection, Code::RequestEntityTooLarge);
+        break;
+      }
+      offset += size;
+      if (size > options_.maxRequestSize) {
+        reject(connection, Code::RequestEntityTooLarge);
+        break;
+      }
+      onRequest(id, connection, request);
+    }
+    connection.in_.erase(0, offset);
+  } while (offset > 0 && not connection.in_.empty() && not connection.slots_.empty()
+           && connection.slots_.front().done_);
+
+  if (not connection.closing_ && connection.in_.size() > maxBuffered()) {
+    DLOG << "Rejecting HTTP requests beyond " << maxBuffered() << " buffered bytes\n";
+    reject(connection, Code::RequestEntityTooLarge);
+  }
+
+  if (connection.eof_) connection.closing_ = true;
+  if (connection.closing_) connection.in_.clear();
+  deliver(id, connection);
+}
+
+void HttpProxy::reject(Connection& connection, Code code) {
+  connection.slots_.emplace_back();
+  connection.slots_.back().done_ = true;
+  connection.slots_.back().response_.withCode(code);
+  connection.closing_ = true;
+}
+
+void HttpProxy::onRequest(uint64_t id, Connection& connection, const Request& request) {
+  requests.increment();
+
+  const auto key = Key(id, connection.firstSequence_ + connection.slots_.size());
+  connection.slots_.emplace_back();
+  auto& slot = connection.slots_.back();
+  slot.head_ = (request.method_ == "HEAD");
+  if (not request.keepAlive_ || request.chunked_) connection.closing_ = true;
+
+  auto reply = [&slot](Code code) {
+    slot.done_ = true;
+    slot.response_.withCode(code);
+  };
+
+  if (request.chunked_) return reply(Code::NotImplemented);
+
+  Code code;
+  if (request.method_ == "GET" || request.method_ == "HEAD") code = Code::GET;
+  else if (request.method_ == "POST") code = Code::POST;
+  else if (request.method_ == "PUT") code = Code::PUT;
+  else if (request.method_ == "DELETE") code = Code::DELETE;
+  else return reply(Code::NotImplemented);
+
+  std::string host;
+  uint16_t port;
+  std::string uri;
+  const auto& prefix = options_.prefix;
+  if (request.target_.compare(0, prefix.length(), prefix) == 0) {
+    try {
+      const auto target = URI::fromString(request.target_.substr(prefix.length()));
+      if (not target) return reply(Code::BadRequest);
+      if (target.value().getProtocol() != COAP_SCHEME) return reply(Code::ProxyingNotSupported);
+      host = target.value().getServer();
+      port = target.value().getPort();
+      uri = target.value().getPath();
+    } catch (std::exception& e) {
+      // The port is out of range
+      return reply(Code::BadRequest);
+    }
+  } else if (not targetHost_.empty()) {
+    host = targetHost_;
+    port = targetPort_;
+    uri = targetPath_ + request.target_;
+  } else {
+    return reply(Code::NotFound);
+  }
+
+  auto message = Message(Type::NonConfirmable, 0, code, 0, "", request.body_);
+  if (not request.contentType_.empty()) {
+    const auto contentFormat = ContentFormat::fromMediaType(request.contentType_);
+    if (not contentFormat) return reply(Code::UnsupportedContentFormat);
+    message.withContentFormat(contentFormat.value());
+  }
+  const auto accept = acceptedFormat(request.accept_);
+  if (accept) message.withAccept(accept.value());
+
+  unresolved_.push_back(Unresolved{key, std::move(message), std::move(uri), port, resolver_.resolve(host)});
+}
+
+void HttpProxy::forwardResolved() {
+  if (unresolved_.empty()) return;
+
+  auto resolved = std::partition(unresolved_.begin(), unresolved_.end(), [](const Unresolved& unresolved) {
+    return unresolved.address_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  });
+  const std::vector<Unresolved> ready(std::make_move_iterator(resolved), std::make_move_iterator(unresolved_.end()));
+  unresolved_.erase(resolved, unresolved_.end());
+
+  for (auto& unresolved : ready) forward(unresolved);
+}
+
+void HttpProxy::forward(const Unresolved& unresolved) {
+  const auto key = unresolved.key_;
+  try {
+    const auto server = unresolved.address_.get().withPort(unresolved.port_);
+    exchanges_[key] = client_.forward(server, unresolved.request_, unresolved.uri_, options_.timeout,
+                                      [this, key](const RestResponse& response) {
+      // Called by the message processing loop
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        responses_.emplace_back(key, response);
+      }
+      wakeUp();
+    });
+  } catch (std::exception& e) {
+    WLOG << "Cannot forward HTTP request to URI=" << unresolved.uri_ << ": " << e.what() << '\n';
+    complete(key, RestResponse().withCode(Code::BadGateway));
+  }
+}
+
+void HttpProxy::completeResponses() {
+  std::vector<std::pair<Key, RestResponse>> responses;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    responses.swap(responses_);
+  }
+
+  for (auto& response : responses) {
+    exchanges_.erase(response.first);
+    complete(response.first, response.second);
+  }
+}
+
+void HttpProxy::complete(const Key& key, const RestResponse& response) {
+  auto it = connections_.find(key.first);
+  if (it == connections_.end()) return;
+
+  auto& connection = it->second;
+  const auto index = key.second - connection.firstSequence_;
+  if (key.second < connection.firstSequence_ || index >= connection.slots_.size()) return;
+
+  connection.slots_[index].done_ = true;
+  connection.slots_[index].response_ = response;
+
+  // Further pipelined requests may be read now
+  readRequests(key.first, connection);
+}
+
+void HttpProxy::handOver(Connection& connection) {
+  while (not connection.slots_.empty() && connection.slots_.front().done_) {
+    const auto& slot = connection.slots_.front();
+    const auto last = connection.closing_ && connection.slots_.size() == 1;
+    connection.out_ += format(slot.response_, slot.head_, last);
+    connection.slots_.pop_front();
+    ++connection.firstSequence_;
+  }
+}
+
+void HttpProxy::deliver(uint64_t id, Connection& connection) {
+  handOver(connection);
+
+  if (not flush(id, connection) || (connection.closing_ && connection.slots_.empty() && connection.out_.empty())) {
+    disconnect(id);
+  }
+}
+
+bool HttpProxy::flush(uint64_t id, Connection& connection) {
+  while (connection.outOffset_ < connection.out_.size()) {
+    const auto bytes = ::send(connection.fd_, connection.out_.data() + connection.outOffset_,
+                              connection.out_.size() - connection.outOffset_, MSG_NOSIGNAL);
+    if (bytes < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return false;
+    }
+    connection.outOffset_ += bytes;
+  }
+
+  if (connection.outOffset_ == connection.out_.size()) {
+    connection.out_.clear();
+    connection.outOffset_ = 0;
+  }
+
+  // Writability is only of interest while output is pending, further requests only while the pipeline has room
+  uint32_t events = 0;
+  if (not connection.eof_ && connection.slots_.size() < options_.pipelineDepth) events |= EPOLLIN;
+  if (not connection.out_.empty()) events |= EPOLLOUT;
+  if (events != connection.events_) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (-1 == epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd_, &event)) return false;
+    connection.events_ = events;
+  }
+  return true;
+}
+
+void HttpProxy::disconnect(uint64_t id) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) return;
+
+  epoll_ctl(epoll_, EPOLL_CTL_DEL, it->second.fd_, nullptr);
+  ::close(it->second.fd_);
+  connections_.erase(it);
+  activeConnections.decrement();
+}
+
+size_t HttpProxy::maxBuffered() const {
+  return options_.maxRequestSize * options_.pipelineDepth;
+}
+
+void HttpProxy::wakeUp() {
+  const uint64_t one = 1;
+  auto bytes = ::write(wakeUp_, &one, sizeof(one));
+  (void) bytes;
+}
+
+}  // namespace CoAP
@@ -0,0 +1,176 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __HttpProxy_h
+#define __HttpProxy_h
+
+#include "Endpoint.h"
+#include "Message.h"
+#include "Notifications.h"
+#include "ProxyOptions.h"
+#include "RestResponse.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+
+namespace CoAP {
+
+class ClientImpl;
+class Resolver;
+
+/**
+ * HTTP/1.1 front end, which forwards HTTP requests as CoAP requests (RFC 8075).
+ *
+ * All connections are served by one thread with one epoll instance. Connections are kept alive
+ * and pipelined requests are forwarded at the same time, up to the pipeline depth, while their
+ * responses are sent in the order of the requests. The CoAP requests are sent as nonconfirmable
+ * requests by the ClientImpl, which needs no state of the messaging and thus may be done by the
+ * thread of the front end. The responses are handed over from the message processing loop.
+ */
+class HttpProxy {
+ public:
+  struct Request {
+    std::string method_;
+    std::string target_;
+    std::string contentType_;
+    std::string accept_;
+    std::string body_;
+    bool keepAlive_{true};
+    // Transfer-Encoding is not supported, the end of the body is not known then
+    bool chunked_{false};
+  };
+
+  /**
+   * Listens on the port of the options and starts the thread serving the connections.
+   *
+   * @throws  std::logic_error    if the target of the options is not a coap URI
+   * @throws  std::runtime_error  if listening on the port failed
+   */
+  HttpProxy(ClientImpl& client, Resolver& resolver, const HttpProxyOptions& options);
+
+  ~HttpProxy();
+
+  HttpProxy(const HttpProxy&) = delete;
+  HttpProxy& operator=(const HttpProxy&) = delete;
+
+  /// Returns the TCP port the front end listens on
+  uint16_t port() const { return port_; }
+
+  /**
+   * Parses the first request in the buffer.
+   *
+   * @return The size of the request, or 0 if it is not complete yet.
+   * @throws std::runtime_error if the request is malformed.
+   */
+  static size_t parse(const char* data, size_t size, Request& request);
+
+  /**
+   * Formats the CoAP response as HTTP response, with the status code of the Code table.
+   */
+  static std::string format(const RestResponse& response, bool head, bool close);
+
+ private:
+  struct Slot {
+    bool done_{false};
+    bool head_{false};
+    RestResponse response_;
+  };
+
+  struct Connection {
+    int fd_{-1};
+    std::string in_;
+    std::string out_;
+    size_t outOffset_{0};
+    // Registered epoll events, EPOLLIN while the pipeline has room and EPOLLOUT while output is pending
+    uint32_t events_{EPOLLIN};
+    // The client closed its side of the connection
+    bool eof_{false};
+    // No further requests are read, the connection is closed when the responses have been sent
+    bool closing_{false};
+    // Sequence number of the request of the first slot
+    uint64_t firstSequence_{0};
+    // Responses in the order of the requests
+    std::deque<Slot> slots_;
+  };
+
+  // Request of a connection, identified by the connection and its sequence number
+  using Key = std::pair<uint64_t, uint64_t>;
+
+  struct Unresolved {
+    Key key_;
+    Message request_;
+    std::string uri_;
+    uint16_t port_;
+    std::shared_future<Endpoint> address_;
+  };
+
+  void run();
+  void accept();
+  void onReadable(uint64_t id, Connection& connection);
+  void readRequests(uint64_t id, Connection& connection);
+  // Answers without forwarding and closes the connection afterwards
+  void reject(Connection& connection, Code code);
+  void onRequest(uint64_t id, Connection& connection, const Request& request);
+  void forwardResolved();
+  void forward(const Unresolved& unresolved);
+  void completeResponses();
+  void complete(const Key& key, const RestResponse& response);
+  // Appends the responses that are ready to the output, in the order of the requests
+  void handOver(Connection& connection);
+  void deliver(uint64_t id, Connection& connection);
+  // Returns false if the connection failed
+  bool flush(uint64_t id, Connection& connection);
+  void disconnect(uint64_t id);
+  // Requests that do not fit into the pipeline wait in the input buffer, up to this size
+  size_t maxBuffered() const;
+  void wakeUp();
+
+  ClientImpl& client_;
+  Resolver& resolver_;
+  const HttpProxyOptions options_;
+
+  // Server, port and base path of the target
+  std::string targetHost_;
+  uint16_t targetPort_{0};
+  std::string targetPath_;
+
+  int listener_{-1};
+  int epoll_{-1};
+  int wakeUp_{-1};
+  uint16_t port_{0};
+
+  uint64_t nextId_{0};
+  std::unordered_map<uint64_t, Connection> connections_;
+
+  // Requests waiting for the address of the server
+  std::vector<Unresolved> unresolved_;
+
+  // Forwarded requests, whose results are kept until their response was handed over
+  std::map<Key, std::shared_ptr<Notifications>> exchanges_;
+
+  // Protection of the responses handed over by the message processing loop
+  std::mutex mutex_;
+  std::vector<std::pair<Key, RestResponse>> responses_;
+
+  std::atomic<bool> terminate_{false};
+  std::thread thread_;
+};
+
+}  // namespace CoAP
+
+#endif  // __HttpProxy_h
@@ -11,6 +11,9 @@
 #include "Telegram.h"
 
 #include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace CoAP {
 
@@ -28,6 +31,44 @@ class IConnection {
    */
   virtual void send(Telegram&& telegram) = 0;
 
+  /**
+   * Sends several telegrams at once.
+   *
+   * The default implementation sends the telegrams one by one, connections may
+   * override it with a more efficient way to hand them over to the network.
+   *
+   * @param telegrams  Telegrams to send
+   *
+   * @throws  std::logic_error    when the connection is not open
+   * @throws  std::runtime_error  when sending a telegram failed
+   */
+  virtual void sendBatch(std::vector<Telegram>&& telegrams) {
+    for (auto& telegram : telegrams) send(std::move(telegram));
+  }
+
+  /**
+   * Joins a multicast group, telegrams received via the group are marked as multicast.
+   *
+   * @param group      Multicast address and port of the group
+   * @param interface  Index of the network interface or 0 for the default interface
+   *
+   * @throws  std::logic_error    when the connection does not support multicast
+   * @throws  std::runtime_error  when joining the group failed
+   */
+  virtual void joinGroup(const Endpoint& /*group*/, uint32_t /*interface*/) {
+    throw std::logic_error("Multicast is not supported by this connection.");
+  }
+
+  /**
+   * Returns the endpoint of a server the connection addresses by name itself, like the socket
+   * path of a Unix domain socket.
+   *
+   * @return Either the endpoint or nothing if the name is a host name or IP address to be resolved.
+   */
+  virtual Optional<Endpoint> endpointOf(const std::string& /*server*/) {
+    return Optional<Endpoint>();
+  }
+
   /**
    * Waits for and reads a telegram from the network.
    *
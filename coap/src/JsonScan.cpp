@@ -0,0 +1,167 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "JsonScan.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace CoAP {
+
+namespace {
+
+inline bool isStringSpecial(char c) {
+  return c == '\"' || c == '\\';
+}
+
+// '[' and '{' as well as ']' and '}' differ only in the bit 0x20
+inline bool isStructural(char c) {
+  return c == '\"' || (c | 0x20) == '{' || (c | 0x20) == '}';
+}
+
+size_t findStringSpecialScalar(const char* data, size_t pos, size_t size) {
+  while (pos < size && not isStringSpecial(data[pos])) ++pos;
+  return pos;
+}
+
+size_t findStructuralScalar(const char* data, size_t pos, size_t size) {
+  while (pos < size && not isStructural(data[pos])) ++pos;
+  return pos;
+}
+
+#ifdef JSON_SCAN_X86
+
+// The vector loops handle complete blocks only and leave the rest to the scalar loop
+
+__attribute__((target("sse2")))
+size_t findStringSpecialSSE2(const char* data, size_t pos, size_t size) {
+  const auto quote = _mm_set1_epi8('\"');
+  const auto backslash = _mm_set1_epi8('\\');
+  for (; pos + 16 <= size; pos += 16) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const auto matches = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+    const auto mask = _mm_movemask_epi8(matches);
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return findStringSpecialScalar(data, pos, size);
+}
+
+__attribute__((target("sse2")))
+size_t findStructuralSSE2(const char* data, size_t pos, size_t size) {
+  const auto quote = _mm_set1_epi8('\"');
+  const auto bit = _mm_set1_epi8(0x20);
+  const auto open = _mm_set1_epi8('{');
+  const auto close = _mm_set1_epi8('}');
+  for (; pos + 16 <= size; pos += 16) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const auto folded = _mm_or_si128(block, bit);
+    const auto matches = _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                      _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+    const auto mask = _mm_movemask_epi8(matches);
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return findStructuralScalar(data, pos, size);
+}
+
+__attribute__((target("avx2")))
+size_t findStringSpecialAVX2(const char* data, size_t pos, size_t size) {
+  const auto quote = _mm256_set1_epi8('\"');
+  const auto backslash = _mm256_set1_epi8('\\');
+  for (; pos + 32 <= size; pos += 32) {
+    const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    const auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash));
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return findStringSpecialSSE2(data, pos, size);
+}
+
+__attribute__((target("avx2")))
+size_t findStructuralAVX2(const char* data, size_t pos, size_t size) {
+  const auto quote = _mm256_set1_epi8('\"');
+  const auto bit = _mm256_set1_epi8(0x20);
+  const auto open = _mm256_set1_epi8('{');
+  const auto close = _mm256_set1_epi8('}');
+  for (; pos + 32 <= size; pos += 32) {
+    const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    const auto folded = _mm256_or_si256(block, bit);
+    const auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(folded, open),
+                                                         _mm256_cmpeq_epi8(folded, close)));
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return findStructuralSSE2(data, pos, size);
+}
+
+#endif
+
+struct Scanner {
+  JsonScanLevel level;
+  size_t (*findStringSpecial)(const char*, size_t, size_t);
+  size_t (*findStructural)(const char*, size_t, size_t);
+};
+
+Scanner scannerFor(JsonScanLevel level) {
+  switch (level) {
+#ifdef JSON_SCAN_X86
+    case JsonScanLevel::AVX2: return {level, findStringSpecialAVX2, findStructuralAVX2};
+    case JsonScanLevel::SSE2: return {level, findStringSpecialSSE2, findStructuralSSE2};
+#endif
+    default: return {JsonScanLevel::Scalar, findStringSpecialScalar, findStructuralScalar};
+  }
+}
+
+JsonScanLevel bestLevel() {
+  if (isJsonScanLevelSupported(JsonScanLevel::AVX2)) return JsonScanLevel::AVX2;
+  if (isJsonScanLevelSupported(JsonScanLevel::SSE2)) return JsonScanLevel::SSE2;
+  return JsonScanLevel::Scalar;
+}
+
+// Initialized on first use, thus available to the static initialization of other translation units
+Scanner& scanner() {
+  static Scanner scanner = scannerFor(bestLevel());
+  return scanner;
+}
+
+}  // namespace
+
+bool isJsonScanLevelSupported(JsonScanLevel level) {
+#ifdef JSON_SCAN_X86
+  // Might run before the constructors of libgcc
+  __builtin_cpu_init();
+#endif
+  switch (level) {
+#ifdef JSON_SCAN_X86
+    case JsonScanLevel::AVX2: return __builtin_cpu_supports("avx2");
+    case JsonScanLevel::SSE2: return __builtin_cpu_supports("sse2");
+#endif
+    case JsonScanLevel::Scalar: return true;
+    default: return false;
+  }
+}
+
+JsonScanLevel jsonScanLevel() {
+  return scanner().level;
+}
+
+void setJsonScanLevel(JsonScanLevel level) {
+  if (not isJsonScanLevelSupported(level)) throw std::logic_error("JSON scan level not supported by the CPU");
+  scanner() = scannerFor(level);
+}
+
+size_t findStringSpecial(const char* data, size_t pos, size_t size) {
+  return scanner().findStringSpecial(data, pos, size);
+}
+
+size_t findStructural(const char* data, size_t pos, size_t size) {
+  return scanner().findStructural(data, pos, size);
+}
+
+}  // namespace CoAP
@@ -0,0 +1,225 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Logging.h"
+
+#include "Metrics.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace CoAP {
+
+constexpr size_t LogRecord::capacity;
+
+namespace {
+
+auto& droppedRecords = Metrics::global().counter("coap_log_records_dropped_total");
+
+// Single producer single consumer queue of the records of one thread
+class LogRing {
+ public:
+  bool push(const uint8_t* record, uint16_t size) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (CAPACITY - (tail - head_.load(std::memory_order_acquire)) < sizeof(size) + size) return false;
+
+    copyIn(tail, &size, sizeof(size));
+    copyIn(tail + sizeof(size), record, size);
+    tail_.store(tail + sizeof(size) + size, std::memory_order_release);
+    return true;
+  }
+
+  // Calls the function with each queued record, returns whether there were any
+  template<typename F>
+  bool consume(F f) {
+    const auto tail = tail_.load(std::memory_order_acquire);
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail) return false;
+
+    uint8_t record[LogRecord::capacity];
+    while (head != tail) {
+      uint16_t size;
+      copyOut(head, &size, sizeof(size));
+      copyOut(head + sizeof(size), record, size);
+      f(record, size);
+      head += sizeof(size) + size;
+    }
+    // Released only after writing, thus flushLog() knows when the records are written
+    head_.store(head, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  void copyIn(uint64_t position, const void* data, size_t size) {
+    const auto offset = position % CAPACITY;
+    const auto first = std::min(size, CAPACITY - offset);
+    memcpy(buffer_ + offset, data, first);
+    memcpy(buffer_, static_cast<const uint8_t*>(data) + first, size - first);
+  }
+
+  void copyOut(uint64_t position, void* data, size_t size) const {
+    const auto offset = position % CAPACITY;
+    const auto first = std::min(size, CAPACITY - offset);
+    memcpy(data, buffer_ + offset, first);
+    memcpy(static_cast<uint8_t*>(data) + first, buffer_, size - first);
+  }
+
+  static constexpr size_t CAPACITY = 64 * 1024;
+  uint8_t buffer_[CAPACITY];
+  // Positions grow monotonically, the consumer and producer update them on different cache lines
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+constexpr size_t LogRing::CAPACITY;
+
+template<typename T>
+T read(const uint8_t*& data) {
+  T value;
+  memcpy(&value, data, sizeof(value));
+  data += sizeof(value);
+  return value;
+}
+
+void format(std::ostream& os, const uint8_t* data, size_t size) {
+  const auto end = data + size;
+  const auto file = read<const char*>(data);
+  const auto line = read<uint32_t>(data);
+  const auto prefix = read<const char*>(data);
+  os << file << ':' << line << ' ' << prefix << ' ';
+
+  while (data < end) {
+    switch (read<uint8_t>(data)) {
+      case LogRecord::CHAR: os << read<char>(data); break;
+      case LogRecord::BOOL: os << read<bool>(data); break;
+      case LogRecord::INT: os << read<int64_t>(data); break;
+      case LogRecord::UINT: os << read<uint64_t>(data); break;
+      case LogRecord::DOUBLE: os << read<double>(data); break;
+      case LogRecord::POINTER: os << read<const void*>(data); break;
+      case LogRecord::STRING: {
+        const auto length = read<uint16_t>(data);
+        os.write(reinterpret_cast<const char*>(data), length);
+        data += length;
+        break;
+      }
+      default: return;
+    }
+  }
+}
+
+// Formats the records of all threads on a background thread
+class Logger {
+ public:
+  std::shared_ptr<LogRing> ring() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.emplace_back(std::make_shared<LogRing>());
+    if (not thread_.joinable() && not stopped_) {
+      thread_ = std::thread([this]() { run(); });
+      std::atexit([]() { instance().stop(); });
+    }
+    return rings_.back();
+  }
+
+  // Whether the records are written by the background thread
+  bool running() const { return not stopped_; }
+
+  void setStream(std::ostream& stream) {
+    flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream_ = &stream;
+  }
+
+  void flush() {
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_ || std::all_of(rings_.begin(), rings_.end(), [](const std::shared_ptr<LogRing>& ring) {
+              return ring->empty();
+            })) return;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  // Writes a record directly if the background thread is gone
+  void write(const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    format(*stream_, data, size);
+    stream_->flush();
+  }
+
+  static Logger& instance() {
+    // Never destroyed, as records may still be written during the destruction of static objects
+    static Logger* logger = new Logger;
+    return *logger;
+  }
+
+ private:
+  void run() {
+    while (not stopping_) {
+      if (not drain()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain();
+  }
+
+  bool drain() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool written = false;
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      written |= (*it)->consume([this](const uint8_t* data, size_t size) { format(*stream_, data, size); });
+      // Only the logger holds on to the ring of a terminated thread
+      if (it->use_count() == 1 && (*it)->empty()) it = rings_.erase(it);
+      else ++it;
+    }
+    if (written) stream_->flush();
+    return written;
+  }
+
+  void stop() {
+    stopping_ = true;
+    if (thread_.joinable()) thread_.join();
+    stopped_ = true;
+    // Records queued while the thread was finishing
+    drain();
+  }
+
+  std::mutex mutex_;
+  std::list<std::shared_ptr<LogRing>> rings_;
+  std::ostream* stream_{&std::cout};
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> stopped_{false};
+};
+
+}  // namespace
+
+LogRecord::~LogRecord() {
+  auto& logger = Logger::instance();
+  if (not logger.running()) {
+    logger.write(data_, size_);
+    return;
+  }
+
+  thread_local std::shared_ptr<LogRing> ring = logger.ring();
+  if (not ring->push(data_, static_cast<uint16_t>(size_))) droppedRecords.increment();
+}
+
+void setLogStream(std::ostream& stream) {
+  Logger::instance().setStream(stream);
+}
+
+void flushLog() {
+  Logger::instance().flush();
+}
+
+}  // namespace CoAP
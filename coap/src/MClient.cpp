@@ -8,13 +8,38 @@
 
 namespace CoAP {
 
+namespace {
+Endpoint allNodesIPv6(uint8_t scope, uint32_t interface, uint16_t port) {
+  in6_addr group = IN6ADDR_ANY_INIT;
+  group.s6_addr[0] = 0xff;
+  group.s6_addr[1] = scope;
+  group.s6_addr[15] = 0xfd;
+  return Endpoint(group, port, interface);
+}
+}
+
+Endpoint MClient::allNodesLinkLocal(uint32_t interface, uint16_t port) {
+  return allNodesIPv6(0x02, interface, port);
+}
+
+Endpoint MClient::allNodesSiteLocal(uint32_t interface, uint16_t port) {
+  return allNodesIPv6(0x05, interface, port);
+}
+
 MClient::MClient(ClientImpl &impl, uint16_t server_port)
-    : impl_(impl), multicast_ip_(htonl(0xE00001BB)) // "224.0.1.187"
-    , server_port_(server_port) {
+    : MClient(impl, allNodesIPv4(server_port)) {
+}
+
+MClient::MClient(ClientImpl &impl, const Endpoint& group)
+    : impl_(impl), group_(group) {
 }
 
 std::shared_ptr<Notifications> MClient::GET(std::string uri) {
-  return impl_.GET(multicast_ip_, server_port_, uri, Type::NonConfirmable);
+  return impl_.GET(group_, uri, Type::NonConfirmable);
+}
+
+std::shared_ptr<Aggregation> MClient::GET(std::string uri, const Aggregation::Options& options) {
+  return impl_.aggregate(group_, uri, options);
 }
 
 }  // CoAP
\ No newline at end of file
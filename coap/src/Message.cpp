@@ -36,6 +36,21 @@ void appendUnsigned(Message::Buffer& buffer, uint64_t value, unsigned length) {
   }
 }
 
+void Message::appendOption(Buffer& buffer, int& option, Option number, uint32_t value) {
+  const auto length = static_cast<unsigned>(tokenLength(value));
+  auto optionHeader = makeOptionHeader(number - option, length);
+  std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
+  appendUnsigned(buffer, value, length);
+  option = number;
+}
+
+void Message::appendOption(Buffer& buffer, int& option, Option number, const std::string& value) {
+  auto optionHeader = makeOptionHeader(number - option, value.length());
+  std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
+  std::copy(begin(value), end(value), std::back_inserter(buffer));
+  option = number;
+}
+
 Message::Buffer Message::asBuffer() const {
   Buffer buffer;
   buffer.reserve(256);
@@ -62,56 +77,45 @@ Message::Buffer Message::asBuffer() const {
   // Token (optional)
   appendUnsigned(buffer, token_, token_length);
 
-  // Options (optional)
+  // Options (optional), in the order of their numbers
   int option = 0;
 
-  // Option: Observe
-  if (observeValue_) {
-    const int option_offset = Observe - option;
-    option += option_offset;
+  // Option: Uri-Host
+  if (uriHost_) appendOption(buffer, option, UriHost, uriHost_.value());
 
-    unsigned int length = tokenLength(observeValue_.value());
+  // Option: Observe
+  if (observeValue_) appendOption(buffer, option, Observe, observeValue_.value());
 
-    auto optionHeader = makeOptionHeader(option_offset, length);
-    std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
+  // Option: Uri-Port
+  if (uriPort_) appendOption(buffer, option, UriPort, uriPort_.value());
 
-    appendUnsigned(buffer, observeValue_.value(), length);
+  // Option: Location-Path
+  if (locationPath_) {
+    auto location = Path(locationPath_.value());
+    for (size_t i = 0U; i < location.size(); ++i) appendOption(buffer, option, LocationPath, location.getPart(i));
   }
 
   // Option: Uri-Path
   auto path = Path(path_);
-  for (size_t i = 0U; i < path.size(); ++i) {
-    const int option_offset = UriPath - option;
-    option += option_offset;
-
-    auto part = path.getPart(i);
-    auto optionHeader = makeOptionHeader(option_offset, part.length());
-    std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
-    std::copy(begin(part), end(part), std::back_inserter(buffer));
-  }
+  for (size_t i = 0U; i < path.size(); ++i) appendOption(buffer, option, UriPath, path.getPart(i));
 
   // Option: Content-Format
-  if (contentFormat_) {
-    const int option_offset = ContentFormat - option;
-    option += option_offset;
+  if (contentFormat_) appendOption(buffer, option, ContentFormat, contentFormat_.value());
 
-    unsigned int length = tokenLength(contentFormat_.value());
+  // Option: Max-Age
+  if (maxAge_) appendOption(buffer, option, MaxAge, maxAge_.value());
 
-    auto optionHeader = makeOptionHeader(option_offset, length);
-    std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
+  // Option: Uri-Query
+  for (auto& query : queries_) appendOption(buffer, option, UriQuery, query);
 
-    appendUnsigned(buffer, contentFormat_.value(), length);
-  }
+  // Option: Accept
+  if (accept_) appendOption(buffer, option, Accept, accept_.value());
 
-  // Option: Uri-Query
-  for (auto query : queries_) {
-    const int option_offset = UriQuery - option;
-    option += option_offset;
+  // Option: Proxy-Uri
+  if (proxyUri_) appendOption(buffer, option, ProxyUri, proxyUri_.value());
 
-    auto optionHeader = makeOptionHeader(option_offset, query.length());
-    std::copy(begin(optionHeader), end(optionHeader), std::back_inserter(buffer));
-    std::copy(begin(query), end(query), std::back_inserter(buffer));
-  }
+  // Option: Proxy-Scheme
+  if (proxyScheme_) appendOption(buffer, option, ProxyScheme, proxyScheme_.value());
 
   // Payload (optional)
   if (payload_.size()) {
@@ -185,8 +189,15 @@ Message Message::fromBuffer(const std::vector<uint8_t>& buffer) {
   unsigned length{0};
   unsigned consumed_bytes{0};
   Optional<uint16_t> contentFormat;
+  Optional<uint16_t> accept;
   Optional<uint16_t> observeValue;
+  Optional<uint32_t> maxAge;
+  Optional<uint16_t> uriPort;
+  Optional<std::string> uriHost;
+  Optional<std::string> proxyUri;
+  Optional<std::string> proxyScheme;
   Buffer path_buffer;
+  Buffer location_buffer;
   std::string queries = "?";
   while (it < endOfBuffer && *it != 0xff) {
     std::tie(option, length, consumed_bytes) = parseOptionHeader(option, &*it, &*endOfBuffer);
@@ -205,6 +216,12 @@ Message Message::fromBuffer(const std::vector<uint8_t>& buffer) {
         it += length;
         break;
 
+      case LocationPath:
+        location_buffer.push_back(length);
+        std::copy(it, it + length, std::back_inserter(location_buffer));
+        it += length;
+        break;
+
       case ContentFormat:contentFormat = parseUnsigned<uint16_t>(it, endOfBuffer, length);
         break;
 
@@ -213,9 +230,34 @@ Message Message::fromBuffer(const std::vector<uint8_t>& buffer) {
         it += length;
         break;
 
+      case Accept:accept = parseUnsigned<uint16_t>(it, endOfBuffer, length);
+        break;
+
+      case MaxAge:maxAge = parseUnsigned<uint32_t>(it, endOfBuffer, length);
+        break;
+
+      case UriPort:uriPort = parseUnsigned<uint16_t>(it, endOfBuffer, length);
+        break;
+
+      case UriHost:
+        uriHost = std::string(it, it + length);
+        it += length;
+        break;
+
+      case ProxyUri:
+        proxyUri = std::string(it, it + length);
+        it += length;
+        break;
+
+      case ProxyScheme:
+        proxyScheme = std::string(it, it + length);
+        it += length;
+        break;
+
       default:
         // TODO: Handle unrecognized options according to the standard
         WLOG << "Unrecognized option " << option << " with length=" << length << " bytes.\n";
+        it += length;
         break;
     }
   }
@@ -232,7 +274,14 @@ Message Message::fromBuffer(const std::vector<uint8_t>& buffer) {
 
   auto msg = Message(type, msgId, code, token, path, payload);
   if (contentFormat) msg.withContentFormat(contentFormat.value());
+  if (accept) msg.withAccept(accept.value());
   if (observeValue) msg.withObserveValue(observeValue.value());
+  if (maxAge) msg.withMaxAge(maxAge.value());
+  if (uriHost) msg.withUriHost(uriHost.value());
+  if (uriPort) msg.withUriPort(uriPort.value());
+  if (not location_buffer.empty()) msg.withLocationPath(Path::fromBuffer(location_buffer).toString());
+  if (proxyUri) msg.withProxyUri(proxyUri.value());
+  if (proxyScheme) msg.withProxyScheme(proxyScheme.value());
   return msg;
 }
 
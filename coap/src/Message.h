@@ -35,10 +35,17 @@ class Message {
  public:
   enum Option {
     EmptyOption = 0,
+    UriHost = 3,
     Observe = 6,
+    UriPort = 7,
+    LocationPath = 8,
     UriPath = 11,
     ContentFormat = 12,
+    MaxAge = 14,
     UriQuery = 15,
+    Accept = 17,
+    ProxyUri = 35,
+    ProxyScheme = 39,
   };
 
   using Buffer = std::vector<uint8_t>;
@@ -124,6 +131,140 @@ class Message {
     return *this;
   }
 
+  /*
+   * Method: accept
+   *
+   * Returns:
+   *   The content format the client accepts in the response.
+   */
+  Optional<uint16_t> optionalAccept() const { return accept_; }
+
+  /*
+   * Method: withAccept
+   *
+   * Defines the content format the client accepts in the response.
+   */
+  Message& withAccept(uint16_t contentFormat) {
+    accept_ = contentFormat;
+    return *this;
+  }
+
+  /*
+   * Method: maxAge
+   *
+   * Returns:
+   *   The number of seconds the response may be cached.
+   */
+  Optional<uint32_t> optionalMaxAge() const { return maxAge_; }
+
+  /*
+   * Method: withMaxAge
+   *
+   * Defines the number of seconds the response may be cached.
+   */
+  Message& withMaxAge(uint32_t seconds) {
+    maxAge_ = seconds;
+    return *this;
+  }
+
+  /*
+   * Method: uriHost
+   *
+   * Returns:
+   *   The host of the requested resource, if it is not the server.
+   */
+  Optional<std::string> optionalUriHost() const { return uriHost_; }
+
+  /*
+   * Method: withUriHost
+   *
+   * Defines the host of the requested resource.
+   */
+  Message& withUriHost(const std::string& host) {
+    uriHost_ = host;
+    return *this;
+  }
+
+  /*
+   * Method: uriPort
+   *
+   * Returns:
+   *   The port of the requested resource, if it is not the port of the server.
+   */
+  Optional<uint16_t> optionalUriPort() const { return uriPort_; }
+
+  /*
+   * Method: withUriPort
+   *
+   * Defines the port of the requested resource.
+   */
+  Message& withUriPort(uint16_t port) {
+    uriPort_ = port;
+    return *this;
+  }
+
+  /*
+   * Method: locationPath
+   *
+   * Returns:
+   *   The path of the resource created by the request.
+   */
+  Optional<std::string> optionalLocationPath() const { return locationPath_; }
+
+  /*
+   * Method: withLocationPath
+   *
+   * Defines the path of the resource created by the request, like "/rd/4".
+   */
+  Message& withLocationPath(const std::string& path) {
+    locationPath_ = path;
+    return *this;
+  }
+
+  /*
+   * Method: proxyUri
+   *
+   * Returns:
+   *   The absolute URI of the resource, which a forward proxy requests on behalf of the client.
+   */
+  Optional<std::string> optionalProxyUri() const { return proxyUri_; }
+
+  /*
+   * Method: withProxyUri
+   *
+   * Defines the absolute URI of the resource to be requested by a forward proxy.
+   */
+  Message& withProxyUri(const std::string& uri) {
+    proxyUri_ = uri;
+    return *this;
+  }
+
+  /*
+   * Method: proxyScheme
+   *
+   * Returns:
+   *   The scheme of the resource, which a forward proxy requests with the URI of the request options.
+   */
+  Optional<std::string> optionalProxyScheme() const { return proxyScheme_; }
+
+  /*
+   * Method: withProxyScheme
+   *
+   * Defines the scheme of the resource to be requested by a forward proxy.
+   */
+  Message& withProxyScheme(const std::string& scheme) {
+    proxyScheme_ = scheme;
+    return *this;
+  }
+
+  /*
+   * Method: isProxyRequest
+   *
+   * Returns:
+   *   True if the request is to be forwarded by a proxy, as it has a Proxy-Uri or Proxy-Scheme option.
+   */
+  bool isProxyRequest() const { return proxyUri_ || proxyScheme_; }
+
   /*
    * Method: observeValue
    *
@@ -148,7 +289,7 @@ class Message {
    * Returns:
    *   The message payload.
    */
-  std::string payload() const { return payload_; }
+  const std::string& payload() const { return payload_; }
 
   /*
    * Method: asBuffer
@@ -213,6 +354,10 @@ class Message {
   static size_t tokenLength(uint64_t token);
 
  private:
+  // Appends the option with the number, option is the number of the previous option
+  static void appendOption(Buffer& buffer, int& option, Option number, uint32_t value);
+  static void appendOption(Buffer& buffer, int& option, Option number, const std::string& value);
+
   // Mandatory message parts
   Type type_{Type::Reset};
   MessageId messageId_{0};
@@ -224,7 +369,14 @@ class Message {
   // Optional message parts
   std::vector<std::string> queries_;
   Optional<uint16_t> contentFormat_;
+  Optional<uint16_t> accept_;
   Optional<uint16_t> observeValue_;
+  Optional<uint32_t> maxAge_;
+  Optional<std::string> uriHost_;
+  Optional<uint16_t> uriPort_;
+  Optional<std::string> locationPath_;
+  Optional<std::string> proxyUri_;
+  Optional<std::string> proxyScheme_;
 };
 
 std::ostream& operator<<(std::ostream& ost, const Message& rhs);
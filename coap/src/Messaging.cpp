@@ -6,18 +6,30 @@
 #include "ClientImpl.h"
 
 #include "Connection.h"
+#include "HttpProxy.h"
 #include "Logging.h"
 #include "Message.h"
+#include "Metrics.h"
 #include "Optional.h"
 #include "Parameters.h"
+#include "Proxy.h"
+#include "ResourceDirectory.h"
+#include "RestResponse.h"
 #include "ServerImpl.h"
-
-#include <cmath>
+#include "Tracing.h"
 
 SETLOGLEVEL(LLWARNING)
 
 namespace CoAP {
 
+namespace {
+
+auto& parseFailures = Metrics::global().counter("coap_parse_failures_total");
+auto& retransmissions = Metrics::global().counter("coap_retransmissions_total");
+auto& expirations = Metrics::global().counter("coap_confirmables_expired_total");
+
+}  // namespace
+
 Messaging::Messaging(uint16_t port)
     : timeProvider_(std::chrono::steady_clock::now),
       conn_(std::make_shared<Connection>()),
@@ -53,8 +65,18 @@ Message messageFromTelegram(const Telegram& telegram) {
 }
 
 void Messaging::loopOnce() {
+  loopOnce(std::chrono::milliseconds(100));
+}
+
+void Messaging::loopOnce(std::chrono::milliseconds timeout) {
   resendUnacknowledged();
-  onTelegram(conn_->get(std::chrono::milliseconds(100)));
+  forgetIdlePeers(timeProvider_());
+  client_->expireRequests(timeProvider_());
+  client_->processResolved();
+  server_->sendDeferredReplies(timeProvider_());
+  server_->forwardResolved();
+  if (resourceDirectory_) resourceDirectory_->expire(timeProvider_());
+  onTelegram(conn_->get(timeout));
 }
 
 void Messaging::loopStart() {
@@ -71,14 +93,34 @@ void Messaging::loopStop() {
 }
 
 void Messaging::onTelegram(const Optional<CoAP::Telegram>& telegram) {
-  auto message = lift<Telegram, Message>(messageFromTelegram)(telegram);
-  if (message) onMessage(message.value(), telegram.value().getIP(), telegram.value().getPort());
+  if (not telegram) return;
+
+  auto& tracer = Tracer::global();
+  const auto received = tracer.enabled() ? Tracer::now() : 0;
+
+  Optional<Message> message;
+  try {
+    message = messageFromTelegram(telegram.value());
+  } catch (std::exception& e) {
+    parseFailures.increment();
+    WLOG << "Dropping malformed message from " << telegram.value().getEndpoint() << ": " << e.what() << '\n';
+    return;
+  }
+
+  if (received != 0) {
+    const auto messageId = message.value().messageId();
+    if (telegram.value().timestamp() != 0) tracer.record("queued", messageId, telegram.value().timestamp(), received);
+    tracer.record("parse", messageId, received, Tracer::now());
+  }
+
+  if (telegram.value().isMulticast()) server_->onMulticastMessage(message.value(), telegram.value().getEndpoint());
+  else onMessage(message.value(), telegram.value().getEndpoint());
 }
 
-void Messaging::onMessage(const Message& msg_received, in_addr_t fromIP, uint16_t fromPort) {
+void Messaging::onMessage(const Message& msg_received, const Endpoint& from) {
   switch (msg_received.type()) {
     case Type::Reset:
-      onResetMessage(msg_received, fromIP, fromPort);
+      onResetMessage(msg_received, from);
       break;
 
     case Type::Acknowledgement:
@@ -90,17 +132,17 @@ void Messaging::onMessage(const Message& msg_received, in_addr_t fromIP, uint16_
     case Type::Confirmable:
     case Type::NonConfirmable:
       if (msg_received.isRequestCode()) {
-        server_->onMessage(msg_received, fromIP, fromPort);
+        server_->onMessage(msg_received, from);
       } else {
         // When the client receives a confirmable response it can immediately acknowledge it
         if (msg_received.type() == Type::Confirmable) {
           DLOG << "Received confirmable request with msgID=" << msg_received.messageId()
                << " and token=" << msg_received.token() << '\n';
           acknowledgeMessage(msg_received.messageId());
-          acknowledge(fromIP, fromPort, msg_received.messageId());
+          acknowledge(from, msg_received.messageId());
         }
 
-        client_->onMessage(msg_received, fromIP, fromPort);
+        client_->onMessage(msg_received, from);
       }
       break;
 
@@ -111,48 +153,164 @@ void Messaging::onMessage(const Message& msg_received, in_addr_t fromIP, uint16_
 
 void Messaging::acknowledgeMessage(MessageId messageId) {
   auto it = unacknowledged_.find(messageId);
-  if (it != unacknowledged_.end()) {
-    DLOG << "Message with msgID=" << messageId << " acknowledged\n";
-    unacknowledged_.erase(it);
+  if (it == unacknowledged_.end()) return;
+
+  DLOG << "Message with msgID=" << messageId << " acknowledged\n";
+  const auto endpoint = it->second.endpoint_;
+  const auto retransmits = it->second.retransmits_;
+  const auto now = timeProvider_();
+  const auto rtt = now - it->second.sent_;
+  unacknowledged_.erase(it);
+
+  auto& peer = peers_[endpoint];
+  // Acknowledges after more than two retransmissions (and expired messages)
+  // carry too little information about the RTT to be taken into account.
+  if (retransmits == 0) peer.onStrongRtt(rtt, now);
+  else if (retransmits <= 2) peer.onWeakRtt(rtt, now);
+  peer.finishExchange();
+
+  // Start the exchanges that have been waiting for this one to finish
+  while (peer.mayStartExchange() && not peer.pending().empty()) {
+    auto msg = std::move(peer.pending().front());
+    peer.pending().pop_front();
+    sendConfirmable(endpoint, peer, std::move(msg));
   }
 }
 
-void Messaging::onResetMessage(const Message& msg_received, in_addr_t fromIP, uint16_t fromPort) {
+void Messaging::onResetMessage(const Message& msg_received, const Endpoint& from) {
   acknowledgeMessage(msg_received.messageId());
-  client_->onMessage(msg_received, fromIP, fromPort);
-  server_->onMessage(msg_received, fromIP, fromPort);
+  client_->onMessage(msg_received, from);
+  server_->onMessage(msg_received, from);
 }
 
 RequestHandlers& Messaging::requestHandler() {
   return server_->requestHandler();
 }
 
+void Messaging::exposeMetrics() {
+  requestHandler().onUri("/.well-known/metrics").onGet([](const Path&) {
+    return RestResponse()
+        .withCode(Code::Content)
+        .withContentFormat(ContentFormat::TextPlain)
+        .withPayload(Metrics::global().toText());
+  });
+}
+
 Client Messaging::getClientFor(const char* server, uint16_t server_port) {
-  return Client(*client_, server, server_port);
+  // Servers the connection addresses itself, like Unix domain socket paths, are not resolved
+  auto local = conn_->endpointOf(server);
+  if (local) {
+    std::promise<Endpoint> promise;
+    promise.set_value(local.value());
+    return Client(*client_, promise.get_future().share(), local.value().port());
+  }
+  return Client(*client_, resolver_.resolve(server), server_port);
 }
 
 MClient Messaging::getMulticastClient(uint16_t server_port) {
   return MClient(*client_, server_port);
 }
 
-void Messaging::acknowledge(in_addr_t ip, uint16_t port, MessageId messageId) {
+MClient Messaging::getMulticastClient(const Endpoint& group) {
+  return MClient(*client_, group);
+}
+
+void Messaging::joinMulticastGroup(const Endpoint& group, uint32_t interface) {
+  conn_->joinGroup(group, interface);
+}
+
+void Messaging::setMulticastLeisure(std::chrono::milliseconds leisure) {
+  server_->setLeisure(leisure);
+}
+
+void Messaging::enableProxy(const ProxyOptions& options) {
+  server_->setProxy(std::unique_ptr<Proxy>(new Proxy(*this, *client_, resolver_, options)));
+}
+
+uint16_t Messaging::enableHttpProxy(const HttpProxyOptions& options) {
+  if (httpProxy_) throw std::logic_error("The HTTP proxy is enabled already");
+  httpProxy_.reset(new HttpProxy(*client_, resolver_, options));
+  return httpProxy_->port();
+}
+
+void Messaging::enableResourceDirectory(const ResourceDirectoryOptions& options) {
+  if (resourceDirectory_) throw std::logic_error("The resource directory is enabled already");
+  resourceDirectory_.reset(new ResourceDirectory(*this, options));
+}
+
+BatchClient Messaging::getBatchClient() {
+  return BatchClient(*client_);
+}
+
+void Messaging::acknowledge(const Endpoint& endpoint, MessageId messageId) {
   DLOG << "Replying with empty acknowledge message with msgID=" << messageId << '\n';
   auto msg = Message(Type::Acknowledgement, messageId, Code::Empty, 0, "", "");
-  sendMessage(ip, port, msg);
+  sendMessage(endpoint, msg);
+}
+
+void Messaging::sendMessage(const Endpoint& endpoint, Message msg) {
+  if (msg.type() != Type::Confirmable) {
+    transmit(endpoint, msg);
+    return;
+  }
+
+  auto& peer = peers_[endpoint];
+  if (not peer.mayStartExchange()) {
+    DLOG << "Queueing confirmable message with msgID=" << msg.messageId() << ", "
+         << peer.outstanding() << " exchanges outstanding\n";
+    peer.pending().emplace_back(std::move(msg));
+    return;
+  }
+
+  sendConfirmable(endpoint, peer, std::move(msg));
 }
 
-void Messaging::sendMessage(in_addr_t ip, uint16_t port, Message msg) {
-  Telegram telegram = Telegram(ip, port, msg.asBuffer());
+void Messaging::sendConfirmable(const Endpoint& endpoint, PeerState& peer, Message msg) {
+  const auto now = timeProvider_();
+
+  // The initial timeout is randomized between RTO and ACK_RANDOM_NUMBER percent of the RTO
+  std::uniform_real_distribution<double> dithering(1.0, ACK_RANDOM_NUMBER / 100.0);
+  const auto timeout = std::chrono::duration_cast<PeerState::Duration>(peer.rto(now) * dithering(random_));
+
+  MessageId messageId = msg.messageId();
+  auto x = unacknowledged_.emplace(messageId, UnacknowledgedMessage(endpoint, msg, now, timeout));
+  // A message with the same msgID is already in flight, thus this is no new exchange
+  if (x.second) peer.startExchange();
+
+  transmit(endpoint, msg);
+}
+
+void Messaging::sendTelegrams(std::vector<Telegram>&& telegrams) {
+  conn_->sendBatch(std::move(telegrams));
+}
 
-  if (msg.type() == Type::Confirmable) {
-    MessageId messageId = msg.messageId();
-    unacknowledged_.emplace(messageId, UnacknowledgedMessage(ip, port, std::move(msg), timeProvider_()));
+void Messaging::transmit(const Endpoint& endpoint, const Message& msg) {
+  auto& tracer = Tracer::global();
+  if (not tracer.enabled()) {
+    conn_->send(Telegram(endpoint, msg.asBuffer()));
+    return;
   }
 
+  const auto start = Tracer::now();
+  Telegram telegram(endpoint, msg.asBuffer());
+  const auto encoded = Tracer::now();
   conn_->send(std::move(telegram));
+  tracer.record("encode", msg.messageId(), start, encoded);
+  tracer.record("send", msg.messageId(), encoded, Tracer::now());
 }
 
 
+void Messaging::forgetIdlePeers(Time now) {
+  if (now < nextPeerSweep_) return;
+  nextPeerSweep_ = now + MAX_TRANSMIT_WAIT;
+
+  // Peers of short-lived clients would otherwise be kept forever
+  for (auto it = peers_.begin(); it != peers_.end();) {
+    if (it->second.idle(now)) it = peers_.erase(it);
+    else ++it;
+  }
+}
+
 void Messaging::resendUnacknowledged() {
   const auto now = timeProvider_();
 
@@ -160,26 +318,30 @@ void Messaging::resendUnacknowledged() {
 
   for (auto& unacknowledged : unacknowledged_) {
     auto& ua = unacknowledged.second;
-    const auto factor = std::pow(2, ua.retransmits_ + 1) - 1;
-    const auto nextTimeout = ua.sent_ + factor * ACK_TIMEOUT;
 
-    if (nextTimeout <= now) {
+    if (ua.nextTimeout_ <= now) {
       if (ua.retransmits_ < MAX_RETRANSMITS) {
         ++ua.retransmits_;
+        retransmissions.increment();
+        ua.timeout_ = std::chrono::duration_cast<PeerState::Duration>(ua.timeout_ * ua.backoffFactor_);
+        ua.nextTimeout_ += ua.timeout_;
         ILOG << "Resending confirmable request with msgID=" << ua.msg_.messageId() << '\n';
-        sendMessage(ua.ip_, ua.port_, ua.msg_);
+        transmit(ua.endpoint_, ua.msg_);
       }
-      else {
+      else if (ua.retransmits_ == MAX_RETRANSMITS) {
+        ++ua.retransmits_;
+        expirations.increment();
         ILOG << "Confirmable request with msgID=" << ua.msg_.messageId() << " expired\n";
         expiredConfirmables.emplace_back(Message(Type::Acknowledgement, ua.msg_.messageId(), Code::ServiceUnavailable, ua.msg_.token(), ""));
-        server_->onMessage(Message(Type::Reset, ua.msg_.messageId(), ua.msg_.code(), ua.msg_.token(), ua.msg_.path()), ua.ip_, ua.port_);
+        server_->onMessage(Message(Type::Reset, ua.msg_.messageId(), ua.msg_.code(), ua.msg_.token(), ua.msg_.path()), ua.endpoint_);
       }
     }
   }
 
-  // Handling the expired confirmable requests
+  // Handling the expired confirmable requests, which did not receive a response
   for (auto& expiredConfirmable : expiredConfirmables) {
-    onMessage(expiredConfirmable, 0, 0);
+    acknowledgeMessage(expiredConfirmable.messageId());
+    client_->onMessage(expiredConfirmable, Endpoint(), false);
   }
 }
 
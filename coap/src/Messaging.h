@@ -11,18 +11,24 @@
 
 #include "Client.h"
 #include "Message.h"
+#include "PeerState.h"
+#include "Resolver.h"
 
 #include <chrono>
 #include <functional>
 #include <map>
+#include <random>
 #include <thread>
+#include <unordered_map>
 
 namespace CoAP {
 
 class ClientImpl;
+class HttpProxy;
 class RequestHandlers;
 class IConnection;
 class IRequestHandler;
+class ResourceDirectory;
 class ServerImpl;
 class Telegram;
 
@@ -42,49 +48,89 @@ class Messaging : public IMessaging {
 
   void loopOnce() override;
 
+  void loopOnce(std::chrono::milliseconds timeout) override;
+
   void loopStart() override;
 
   void loopStop() override;
 
   RequestHandlers& requestHandler() override;
 
+  void exposeMetrics() override;
+
   Client getClientFor(const char* server, uint16_t server_port = 5683) override;
 
   MClient getMulticastClient(uint16_t server_port) override;
 
-  void acknowledge(in_addr_t ip, uint16_t port, MessageId messageId);
+  MClient getMulticastClient(const Endpoint& group) override;
+
+  BatchClient getBatchClient() override;
+
+  void joinMulticastGroup(const Endpoint& group, uint32_t interface = 0) override;
+
+  void setMulticastLeisure(std::chrono::milliseconds leisure) override;
+
+  void enableProxy(const ProxyOptions& options = ProxyOptions()) override;
+
+  uint16_t enableHttpProxy(const HttpProxyOptions& options = HttpProxyOptions()) override;
 
-  void sendMessage(in_addr_t ip, uint16_t port, Message msg);
+  void enableResourceDirectory(const ResourceDirectoryOptions& options = ResourceDirectoryOptions()) override;
 
-  void onMessage(const Message& msg, in_addr_t fromIP, uint16_t fromPort);
+  void acknowledge(const Endpoint& endpoint, MessageId messageId);
+
+  void sendMessage(const Endpoint& endpoint, Message msg);
+
+  /// Sends already encoded nonconfirmable messages in one go
+  void sendTelegrams(std::vector<Telegram>&& telegrams);
+
+  void onMessage(const Message& msg, const Endpoint& from);
 
   ServerImpl& getServer() { return *server_; }
 
+  Time now() const { return timeProvider_(); }
+
  private:
   void resendUnacknowledged();
+  void forgetIdlePeers(Time now);
   void onTelegram(const Optional<Telegram>& anOptional);
-  void onResetMessage(const Message& msg_received, in_addr_t fromIP, uint16_t fromPort);
+  void onResetMessage(const Message& msg_received, const Endpoint& from);
   void acknowledgeMessage(MessageId messageId);
+  void sendConfirmable(const Endpoint& endpoint, PeerState& peer, Message msg);
+  void transmit(const Endpoint& endpoint, const Message& msg);
 
   TimeProvider timeProvider_;
 
   struct UnacknowledgedMessage {
-    UnacknowledgedMessage(in_addr_t ip, uint16_t port, const Message& msg, Time sent)
-        : ip_(ip), port_(port), msg_(msg), sent_(sent) {
+    UnacknowledgedMessage(const Endpoint& endpoint, const Message& msg, Time sent, PeerState::Duration timeout)
+        : endpoint_(endpoint), msg_(msg), sent_(sent), timeout_(timeout), nextTimeout_(sent + timeout),
+          backoffFactor_(PeerState::backoffFactor(timeout)) {
     }
 
-    const in_addr_t ip_{0};
-    const uint16_t port_{0};
+    const Endpoint endpoint_;
     const Message msg_;
     uint32_t retransmits_{0};
     const Time sent_;
+    PeerState::Duration timeout_;
+    Time nextTimeout_;
+    const double backoffFactor_;
   };
   std::map<MessageId, UnacknowledgedMessage> unacknowledged_;
 
+  // congestion control state of the peers, idle ones are looked for once per MAX_TRANSMIT_WAIT
+  std::unordered_map<Endpoint, PeerState> peers_;
+  Time nextPeerSweep_;
+
+  // randomizes the initial timeout of confirmable messages
+  std::minstd_rand random_{std::random_device()()};
+
   std::shared_ptr<IConnection> conn_;
 
+  Resolver resolver_;
+
   std::unique_ptr<ClientImpl> client_;
   std::unique_ptr<ServerImpl> server_;
+  std::unique_ptr<HttpProxy> httpProxy_;
+  std::unique_ptr<ResourceDirectory> resourceDirectory_;
 
   std::thread loop_;
 
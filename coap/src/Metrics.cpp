@@ -0,0 +1,168 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace CoAP {
+
+namespace __internal__ {
+
+unsigned metricShard() {
+  static std::atomic<unsigned> next{0};
+  thread_local unsigned shard = next.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+  return shard;
+}
+
+}  // namespace __internal__
+
+using __internal__::METRIC_SHARDS;
+using __internal__::METRIC_STRIDE;
+
+namespace {
+
+enum Kind { COUNTER, GAUGE, HISTOGRAM };
+
+uint64_t sum(const std::atomic<uint64_t>* cells) {
+  uint64_t result = 0;
+  for (unsigned shard = 0; shard < METRIC_SHARDS; ++shard) {
+    result += cells[shard * METRIC_STRIDE].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+}  // namespace
+
+uint64_t Counter::value() const {
+  return sum(cells_);
+}
+
+int64_t Gauge::value() const {
+  return static_cast<int64_t>(sum(cells_));
+}
+
+Histogram::Histogram(std::vector<uint64_t> bounds)
+    : bounds_(std::move(bounds)),
+      // Rounded up to whole cache lines
+      stride_((bounds_.size() + 2 + METRIC_STRIDE - 1) / METRIC_STRIDE * METRIC_STRIDE),
+      cells_(new std::atomic<uint64_t>[METRIC_SHARDS * stride_]) {
+  if (not std::is_sorted(bounds_.begin(), bounds_.end())) throw std::logic_error("Bounds must be ascending.");
+  for (size_t i = 0; i < METRIC_SHARDS * stride_; ++i) cells_[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::record(uint64_t value) {
+  auto cells = &cells_[__internal__::metricShard() * stride_];
+  const auto bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  cells[bucket].fetch_add(1, std::memory_order_relaxed);
+  cells[bounds_.size() + 1].fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot;
+  snapshot.bounds = bounds_;
+  snapshot.counts.resize(bounds_.size() + 1);
+
+  for (unsigned shard = 0; shard < METRIC_SHARDS; ++shard) {
+    auto cells = &cells_[shard * stride_];
+    for (size_t bucket = 0; bucket <= bounds_.size(); ++bucket) {
+      snapshot.counts[bucket] += cells[bucket].load(std::memory_order_relaxed);
+    }
+    snapshot.sum += cells[bounds_.size() + 1].load(std::memory_order_relaxed);
+  }
+
+  for (auto count : snapshot.counts) snapshot.count += count;
+  return snapshot;
+}
+
+struct Metrics::Entry {
+  std::string name;
+  int kind;
+  std::unique_ptr<Counter> counter;
+  std::unique_ptr<Gauge> gauge;
+  std::unique_ptr<Histogram> histogram;
+};
+
+Metrics::Metrics() = default;
+
+Metrics::~Metrics() = default;
+
+Metrics& Metrics::global() {
+  static Metrics metrics;
+  return metrics;
+}
+
+Metrics::Entry& Metrics::find(const std::string& name, int kind) {
+  auto it = std::find_if(entries_.begin(), entries_.end(),
+                         [&name](const std::unique_ptr<Entry>& entry) { return entry->name == name; });
+  if (it != entries_.end()) {
+    if ((*it)->kind != kind) throw std::logic_error("Metric " + name + " is registered with another kind.");
+    return **it;
+  }
+
+  entries_.emplace_back(new Entry{name, kind, nullptr, nullptr, nullptr});
+  return *entries_.back();
+}
+
+Counter& Metrics::counter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = find(name, COUNTER);
+  if (not entry.counter) entry.counter.reset(new Counter);
+  return *entry.counter;
+}
+
+Gauge& Metrics::gauge(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = find(name, GAUGE);
+  if (not entry.gauge) entry.gauge.reset(new Gauge);
+  return *entry.gauge;
+}
+
+Histogram& Metrics::histogram(const std::string& name, std::vector<uint64_t> bounds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = find(name, HISTOGRAM);
+  if (not entry.histogram) entry.histogram.reset(new Histogram(std::move(bounds)));
+  return *entry.histogram;
+}
+
+std::vector<uint64_t> Metrics::latencyBounds() {
+  return {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+          100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+}
+
+std::string Metrics::toText() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::ostringstream os;
+  for (const auto& entry : entries_) {
+    switch (entry->kind) {
+      case COUNTER:
+        os << entry->name << ' ' << entry->counter->value() << '\n';
+        break;
+
+      case GAUGE:
+        os << entry->name << ' ' << entry->gauge->value() << '\n';
+        break;
+
+      case HISTOGRAM: {
+        const auto snapshot = entry->histogram->snapshot();
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < snapshot.bounds.size(); ++bucket) {
+          if (snapshot.counts[bucket] == 0) continue;
+          cumulative += snapshot.counts[bucket];
+          os << entry->name << "_bucket{le=\"" << snapshot.bounds[bucket] << "\"} " << cumulative << '\n';
+        }
+        os << entry->name << "_bucket{le=\"+Inf\"} " << snapshot.count << '\n';
+        os << entry->name << "_sum " << snapshot.sum << '\n';
+        os << entry->name << "_count " << snapshot.count << '\n';
+        break;
+      }
+    }
+  }
+  return os.str();
+}
+
+}  // namespace CoAP
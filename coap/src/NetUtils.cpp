@@ -11,21 +11,43 @@
 namespace CoAP {
 
 in_addr_t NetUtils::ipFromHostname(const std::string& hostname) {
-  hostent* host = gethostbyname(hostname);
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
 
-  if (host == 0 ||
-      host->h_length == 0) {
+  addrinfo* result = nullptr;
+  if (0 != getaddrinfo(hostname, &hints, &result) || result == nullptr) {
     throw std::runtime_error("Server name could not be resolved.");
   }
 
-  in_addr_t addr;
-  memcpy(&addr, host->h_addr_list[0], sizeof(addr));
+  auto addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(result);
 
   return addr;
 }
 
-hostent* NetUtils::gethostbyname(const std::string& server) const {
-  return ::gethostbyname(server.c_str());
+Endpoint NetUtils::endpointFromHostname(const std::string& hostname) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  addrinfo* result = nullptr;
+  if (0 != getaddrinfo(hostname, &hints, &result) || result == nullptr) {
+    throw std::runtime_error("Server name could not be resolved.");
+  }
+
+  // The results are sorted by preference of the system
+  auto endpoint = Endpoint::fromSockaddr(result->ai_addr);
+  freeaddrinfo(result);
+
+  return endpoint;
+}
+
+int NetUtils::getaddrinfo(const std::string& server, const addrinfo* hints, addrinfo** result) const {
+  return ::getaddrinfo(server.c_str(), nullptr, hints, result);
 }
 
 }  // namespace CoAP
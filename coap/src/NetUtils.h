@@ -7,6 +7,8 @@
 #ifndef __NetUtils_h
 #define __NetUtils_h
 
+#include "Endpoint.h"
+
 #include <arpa/inet.h>
 #include <iosfwd>
 #include <netdb.h>
@@ -18,11 +20,16 @@ namespace CoAP {
 
 class NetUtils {
  public:
+  virtual ~NetUtils() = default;
+
   in_addr_t ipFromHostname(const std::string& hostname);
 
+  /// Resolves the host name to its preferred IPv4 or IPv6 address, the port of the result is 0
+  Endpoint endpointFromHostname(const std::string& hostname);
+
  protected:
-  // trampoline for unit test to override system call gethostbyname
-  virtual hostent* gethostbyname(const std::string& server) const;
+  // trampoline for unit test to override system call getaddrinfo
+  virtual int getaddrinfo(const std::string& server, const addrinfo* hints, addrinfo** result) const;
 };
 
 }  // namespace CoAP
@@ -5,6 +5,7 @@
 #include "Path.h"
 
 #include <stdexcept>
+#include <utility>
 
 Path::Path(std::string from)
   : path_(from.substr(0, from.find_last_not_of('/') + 1)) {
@@ -22,6 +23,11 @@ Path::Path(std::string from)
   }
 }
 
+Path::Path(std::string from, std::vector<std::string> queries)
+  : Path(std::move(from)) {
+  queries_ = std::move(queries);
+}
+
 
 // TODO: Cache the size as it is constant
 size_t Path::size() const {
@@ -0,0 +1,92 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PeerState.h"
+
+#include <algorithm>
+
+namespace CoAP {
+
+namespace {
+// Estimator gains as in RFC 6298
+constexpr double ALPHA = 1.0 / 8;
+constexpr double BETA = 1.0 / 4;
+
+// Weights of the strong and weak estimators in the overall RTO
+constexpr double STRONG_WEIGHT = 0.5;
+constexpr double WEAK_WEIGHT = 0.25;
+
+const auto MIN_RTO = std::chrono::milliseconds(1);
+const auto MAX_RTO = std::chrono::seconds(60);
+
+const auto SMALL_RTO = std::chrono::seconds(1);
+const auto LARGE_RTO = std::chrono::seconds(3);
+
+PeerState::Duration scaled(PeerState::Duration d, double factor) {
+  return std::chrono::duration_cast<PeerState::Duration>(d * factor);
+}
+
+PeerState::Duration clamped(PeerState::Duration d) {
+  return std::min<PeerState::Duration>(std::max<PeerState::Duration>(d, MIN_RTO), MAX_RTO);
+}
+}  // namespace
+
+PeerState::PeerState(Duration initialRto)
+    : rto_(initialRto) {
+}
+
+PeerState::Duration PeerState::Estimator::update(Duration rtt) {
+  if (not initialized_) {
+    srtt_ = rtt;
+    rttvar_ = rtt / 2;
+    initialized_ = true;
+  } else {
+    const auto delta = (srtt_ > rtt) ? (srtt_ - rtt) : (rtt - srtt_);
+    rttvar_ = scaled(rttvar_, 1 - BETA) + scaled(delta, BETA);
+    srtt_ = scaled(srtt_, 1 - ALPHA) + scaled(rtt, ALPHA);
+  }
+  return srtt_ + std::max<Duration>(MIN_RTO, k_ * rttvar_);
+}
+
+void PeerState::updateOverall(Duration estimate, double weight, Time now) {
+  rto_ = clamped(scaled(estimate, weight) + scaled(rto_, 1 - weight));
+  lastUpdate_ = now;
+  updated_ = true;
+}
+
+void PeerState::onStrongRtt(Duration rtt, Time now) {
+  updateOverall(strong_.update(rtt), STRONG_WEIGHT, now);
+}
+
+void PeerState::onWeakRtt(Duration rtt, Time now) {
+  updateOverall(weak_.update(rtt), WEAK_WEIGHT, now);
+}
+
+PeerState::Duration PeerState::rto(Time now) {
+  if (updated_) {
+    // A small RTO that was not confirmed for a long time is doubled,
+    // a large one is moved towards the default.
+    if (rto_ < SMALL_RTO && now - lastUpdate_ > 16 * rto_) {
+      rto_ = clamped(2 * rto_);
+      lastUpdate_ = now;
+    } else if (rto_ > LARGE_RTO && now - lastUpdate_ > 4 * rto_) {
+      rto_ = clamped(SMALL_RTO + rto_ / 2);
+      lastUpdate_ = now;
+    }
+  }
+  return rto_;
+}
+
+bool PeerState::idle(Time now) const {
+  if (outstanding_ > 0 || not pending_.empty()) return false;
+  return not updated_ || now - lastUpdate_ > 16 * std::max<Duration>(rto_, SMALL_RTO);
+}
+
+double PeerState::backoffFactor(Duration initialTimeout) {
+  if (initialTimeout < SMALL_RTO) return 3;
+  if (initialTimeout > LARGE_RTO) return 1.5;
+  return 2;
+}
+
+}  // namespace CoAP
@@ -0,0 +1,114 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __PeerState_h
+#define __PeerState_h
+
+#include "Message.h"
+#include "Parameters.h"
+
+#include <chrono>
+#include <deque>
+
+namespace CoAP {
+
+/**
+ * Congestion control state for a single peer (IP address and port).
+ *
+ * Tracks the number of outstanding confirmable exchanges with the peer, queues
+ * further confirmable messages once NSTART exchanges are outstanding and
+ * estimates the retransmission timeout from measured round trip times following
+ * the CoCoA proposal (draft-ietf-core-cocoa):
+ *
+ *  - strong RTT samples stem from exchanges acknowledged without retransmission,
+ *  - weak RTT samples stem from exchanges acknowledged after one or two retransmissions,
+ *    measured from the initial transmission.
+ *
+ * Both estimators feed into an overall RTO that is aged towards the default when the
+ * peer has not been heard from for a while.
+ */
+class PeerState {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+  using Time = std::chrono::time_point<std::chrono::steady_clock>;
+
+  explicit PeerState(Duration initialRto = ACK_TIMEOUT);
+
+  /**
+   * Returns the retransmission timeout for a new exchange with the peer.
+   *
+   * @param now  Current time, used to age a stale RTO towards the default
+   */
+  Duration rto(Time now);
+
+  /**
+   * Feeds a round trip time measured for an exchange without retransmissions.
+   */
+  void onStrongRtt(Duration rtt, Time now);
+
+  /**
+   * Feeds a round trip time measured from the initial transmission of an exchange
+   * that was acknowledged after retransmissions.
+   */
+  void onWeakRtt(Duration rtt, Time now);
+
+  /**
+   * Returns the factor by which the timeout is multiplied on each retransmission
+   * (variable backoff factor), depending on the initial timeout of the exchange.
+   */
+  static double backoffFactor(Duration initialTimeout);
+
+  /**
+   * Returns true if another confirmable exchange may be started without
+   * exceeding NSTART outstanding exchanges.
+   */
+  bool mayStartExchange() const { return outstanding_ < NSTART; }
+
+  void startExchange() { ++outstanding_; }
+
+  void finishExchange() { if (outstanding_ > 0) --outstanding_; }
+
+  unsigned outstanding() const { return outstanding_; }
+
+  /**
+   * Returns true if the state may be forgotten: no exchange is outstanding or pending and
+   * the RTO was not confirmed for so long that it would be aged towards the default anyway.
+   */
+  bool idle(Time now) const;
+
+  /**
+   * Confirmable messages waiting for an outstanding exchange to finish.
+   */
+  std::deque<Message>& pending() { return pending_; }
+
+ private:
+  struct Estimator {
+    Estimator(unsigned k) : k_(k) { }
+
+    /// Updates the estimator with a new sample and returns the resulting RTO
+    Duration update(Duration rtt);
+
+    const unsigned k_;
+    bool initialized_{false};
+    Duration srtt_{0};
+    Duration rttvar_{0};
+  };
+
+  void updateOverall(Duration estimate, double weight, Time now);
+
+  Estimator strong_{4};
+  Estimator weak_{1};
+  Duration rto_;
+  Time lastUpdate_;
+  bool updated_{false};
+
+  unsigned outstanding_{0};
+  std::deque<Message> pending_;
+};
+
+}  // namespace CoAP
+
+#endif  // __PeerState_h
@@ -0,0 +1,247 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Proxy.h"
+
+#include "ClientImpl.h"
+#include "Logging.h"
+#include "Messaging.h"
+#include "Metrics.h"
+#include "Resolver.h"
+#include "ServerImpl.h"
+#include "URI.h"
+
+#include <algorithm>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+namespace {
+
+auto& forwarded = Metrics::global().counter("coap_proxy_requests_total");
+auto& cacheHits = Metrics::global().counter("coap_proxy_cache_hits_total");
+auto& pendingExchanges = Metrics::global().gauge("coap_proxy_exchanges_pending");
+
+const std::string COAP_SCHEME = "coap";
+const uint16_t COAP_PORT = 5683;
+
+// Path and queries of the request
+std::string uriOf(const Message& request) {
+  auto uri = request.path();
+  const auto queries = request.queries();
+  for (size_t i = 0; i < queries.size(); ++i) {
+    uri += (i == 0) ? '?' : '&';
+    uri += queries[i];
+  }
+  return uri;
+}
+
+// Prefixes and base paths are compared without trailing slash, "/" thus matches all paths
+std::string withoutTrailingSlash(std::string path) {
+  while (not path.empty() && path.back() == '/') path.pop_back();
+  return path;
+}
+
+}  // namespace
+
+Proxy::Proxy(Messaging& messaging, ClientImpl& client, Resolver& resolver, const ProxyOptions& options)
+    : messaging_(messaging), client_(client), resolver_(resolver), options_(options) {
+  for (auto& route : options_.routes) {
+    const auto uri = URI::fromString(route.second);
+    if (not uri || uri.value().getProtocol() != COAP_SCHEME) {
+      throw std::logic_error("Proxy route " + route.first + " needs a coap URI, not " + route.second);
+    }
+    routes_.push_back(Route{withoutTrailingSlash(route.first), uri.value().getServer(), uri.value().getPort(),
+                            withoutTrailingSlash(uri.value().getPath())});
+  }
+  std::sort(routes_.begin(), routes_.end(), [](const Route& lhs, const Route& rhs) {
+    return lhs.prefix_.length() > rhs.prefix_.length();
+  });
+}
+
+bool Proxy::accepts(const Message& request) const {
+  if (options_.forwardProxy && request.isProxyRequest()) return true;
+  return not request.isProxyRequest() && routeOf(request.path()) != nullptr;
+}
+
+const Proxy::Route* Proxy::routeOf(const std::string& path) const {
+  for (auto& route : routes_) {
+    const auto& prefix = route.prefix_;
+    if (path.compare(0, prefix.length(), prefix) != 0) continue;
+    if (path.length() == prefix.length() || path[prefix.length()] == '/') return &route;
+  }
+  return nullptr;
+}
+
+Optional<Code> Proxy::targetOf(const Message& request, Target& target) const {
+  // Notifications are not relayed, thus an observation would silently degrade to a single response
+  const auto observe = request.optionalObserveValue();
+  if (observe && observe.value() == 0) return Optional<Code>(Code::ProxyingNotSupported);
+
+  if (request.optionalProxyUri()) {
+    try {
+      const auto uri = URI::fromString(request.optionalProxyUri().value());
+      if (not uri) return Optional<Code>(Code::BadOption);
+      if (uri.value().getProtocol() != COAP_SCHEME) return Optional<Code>(Code::ProxyingNotSupported);
+      target = Target{uri.value().getServer(), uri.value().getPort(), uri.value().getPath()};
+    } catch (std::exception& e) {
+      // The port is out of range
+      return Optional<Code>(Code::BadOption);
+    }
+    return Optional<Code>();
+  }
+
+  if (request.optionalProxyScheme()) {
+    if (request.optionalProxyScheme().value() != COAP_SCHEME) return Optional<Code>(Code::ProxyingNotSupported);
+    if (not request.optionalUriHost()) return Optional<Code>(Code::BadRequest);
+    target = Target{request.optionalUriHost().value(), request.optionalUriPort().valueOr(COAP_PORT), uriOf(request)};
+    return Optional<Code>();
+  }
+
+  // Reverse proxy, the remainder of the path is appended to the base path of the route
+  const auto path = request.path();
+  const auto route = routeOf(path);
+  auto uri = route->path_ + path.substr(route->prefix_.length());
+  if (uri.empty()) uri = "/";
+  target = Target{route->host_, route->port_, uri + uriOf(request).substr(path.length())};
+  return Optional<Code>();
+}
+
+void Proxy::onRequest(const Message& request, const Endpoint& from) {
+  const auto key = std::make_tuple(from, request.token());
+  // Retransmission of a request that is forwarded already, the response follows separately
+  if (exchanges_.count(key)) {
+    DLOG << "Ignoring duplicate proxy request with msgID=" << request.messageId() << '\n';
+    if (request.type() == Type::Confirmable) messaging_.acknowledge(from, request.messageId());
+    return;
+  }
+
+  Target target;
+  const auto error = targetOf(request, target);
+  if (error) {
+    ILOG << "Rejecting proxy request with msgID=" << request.messageId() << " with code=" << error.value() << '\n';
+    reply(from, request, RestResponse().withCode(error.value()));
+    return;
+  }
+
+  // Only responses to GET requests are cached, they depend on the server, the URI and the accepted content format
+  std::string cacheKey;
+  if (options_.cacheSize > 0 && request.code() == Code::GET && not request.optionalObserveValue()) {
+    cacheKey = target.host_ + ':' + std::to_string(target.port_) + target.uri_;
+    if (request.optionalAccept()) cacheKey += "#" + std::to_string(request.optionalAccept().value());
+
+    const auto now = messaging_.now();
+    const auto entry = cached(cacheKey, now);
+    if (entry != nullptr) {
+      cacheHits.increment();
+      auto response = entry->response_;
+      const auto remaining = std::chrono::duration_cast<std::chrono::seconds>(entry->expires_ - now);
+      response.withMaxAge(static_cast<uint32_t>(remaining.count()));
+      reply(from, request, response);
+      return;
+    }
+  }
+
+  forwarded.increment();
+  pendingExchanges.increment();
+  auto& exchange = exchanges_.emplace(key, Exchange{request, target.uri_, target.port_, resolver_.resolve(target.host_),
+                                                    cacheKey, nullptr}).first->second;
+  if (exchange.address_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    forward(key, exchange);
+  } else {
+    DLOG << "Waiting for the address of " << target.host_ << '\n';
+    unresolved_.push_back(key);
+  }
+}
+
+void Proxy::forwardResolved() {
+  if (unresolved_.empty()) return;
+
+  auto resolved = std::partition(unresolved_.begin(), unresolved_.end(), [this](const Key& key) {
+    auto it = exchanges_.find(key);
+    return it != exchanges_.end()
+        && it->second.address_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  });
+  const std::vector<Key> keys(resolved, unresolved_.end());
+  unresolved_.erase(resolved, unresolved_.end());
+
+  for (auto& key : keys) {
+    auto it = exchanges_.find(key);
+    if (it != exchanges_.end()) forward(key, it->second);
+  }
+}
+
+void Proxy::forward(const Key& key, Exchange& exchange) {
+  Endpoint server;
+  try {
+    server = exchange.address_.get().withPort(exchange.port_);
+  } catch (std::exception& e) {
+    WLOG << "Cannot forward request with msgID=" << exchange.request_.messageId() << ": " << e.what() << '\n';
+    onResponse(key, RestResponse().withCode(Code::BadGateway));
+    return;
+  }
+
+  // Called by the client with its lock held, thus the response is relayed without calling the client again
+  exchange.response_ = client_.forward(server, exchange.request_, exchange.uri_, options_.timeout,
+                                       [this, key](const RestResponse& response) {
+    onResponse(key, response);
+  });
+}
+
+void Proxy::onResponse(const Key& key, const RestResponse& response) {
+  auto it = exchanges_.find(key);
+  if (it == exchanges_.end()) return;
+
+  auto& exchange = it->second;
+  const auto cacheable = not (response.hasMaxAge() && response.maxAge() == 0);
+  if (not exchange.cacheKey_.empty() && response.code() == Code::Content && cacheable) {
+    store(exchange.cacheKey_, response, messaging_.now());
+  }
+
+  reply(std::get<0>(key), exchange.request_, response);
+
+  // The client keeps the notifications alive until the callback returned
+  exchanges_.erase(it);
+  pendingExchanges.decrement();
+}
+
+void Proxy::reply(const Endpoint& to, const Message& request, const RestResponse& response) {
+  messaging_.sendMessage(to, ServerImpl::responseMessage(request.type(), request.messageId(), request.token(),
+                                                         response));
+}
+
+const Proxy::CacheEntry* Proxy::cached(const std::string& key, Time now) {
+  auto it = cache_.find(key);
+  if (it == cache_.end()) return nullptr;
+
+  if (it->second->expires_ <= now) {
+    lru_.erase(it->second);
+    cache_.erase(it);
+    return nullptr;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return &lru_.front();
+}
+
+void Proxy::store(const std::string& key, const RestResponse& response, Time now) {
+  const auto maxAge = response.hasMaxAge() ? std::chrono::seconds(response.maxAge()) : DEFAULT_MAX_AGE;
+
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    lru_.erase(it->second);
+    cache_.erase(it);
+  }
+
+  lru_.push_front(CacheEntry{key, response, now + maxAge});
+  cache_.emplace(key, lru_.begin());
+
+  if (lru_.size() > options_.cacheSize) {
+    cache_.erase(lru_.back().key_);
+    lru_.pop_back();
+  }
+}
+
+}  // namespace CoAP
@@ -0,0 +1,132 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Proxy_h
+#define __Proxy_h
+
+#include "Endpoint.h"
+#include "Message.h"
+#include "Notifications.h"
+#include "Optional.h"
+#include "ProxyOptions.h"
+#include "RestResponse.h"
+
+#include <chrono>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace CoAP {
+
+class ClientImpl;
+class Messaging;
+class Resolver;
+
+/**
+ * Forwards requests to upstream servers on behalf of the clients of the server.
+ *
+ * The upstream requests are sent by the ClientImpl with tokens of its own. The proxy relates their
+ * responses back to the downstream exchange by its endpoint and token, without blocking or threads of
+ * its own: everything happens in the message processing loop. Host names of upstream servers are
+ * resolved asynchronously, requests waiting for the address are forwarded by forwardResolved().
+ */
+class Proxy {
+ public:
+  using Time = std::chrono::steady_clock::time_point;
+
+  /**
+   * @throws std::logic_error if the URI of a route is not a valid coap URI.
+   */
+  Proxy(Messaging& messaging, ClientImpl& client, Resolver& resolver, const ProxyOptions& options);
+
+  /**
+   * Returns true if the request is to be forwarded, as it has a Proxy-Uri or Proxy-Scheme option
+   * or its path is within the prefix of a route.
+   */
+  bool accepts(const Message& request) const;
+
+  /**
+   * Forwards the request to the upstream server, or answers it from the cache.
+   */
+  void onRequest(const Message& request, const Endpoint& from);
+
+  /**
+   * Forwards the requests whose upstream host name has been resolved in the meantime.
+   */
+  void forwardResolved();
+
+ private:
+  // Upstream server and URI of a request
+  struct Target {
+    std::string host_;
+    uint16_t port_;
+    std::string uri_;
+  };
+
+  // Requests to paths starting with the prefix are forwarded to the base path of the server
+  struct Route {
+    std::string prefix_;
+    std::string host_;
+    uint16_t port_;
+    std::string path_;
+  };
+
+  // Downstream exchange, identified by the endpoint and token of the client
+  using Key = std::tuple<Endpoint, uint64_t>;
+
+  struct Exchange {
+    Message request_;
+    std::string uri_;
+    uint16_t port_;
+    std::shared_future<Endpoint> address_;
+    // Empty for responses that are not cached
+    std::string cacheKey_;
+    std::shared_ptr<Notifications> response_;
+  };
+
+  struct CacheEntry {
+    std::string key_;
+    RestResponse response_;
+    Time expires_;
+  };
+
+  Optional<Code> targetOf(const Message& request, Target& target) const;
+  const Route* routeOf(const std::string& path) const;
+
+  void forward(const Key& key, Exchange& exchange);
+  void onResponse(const Key& key, const RestResponse& response);
+  void reply(const Endpoint& to, const Message& request, const RestResponse& response);
+
+  const CacheEntry* cached(const std::string& key, Time now);
+  void store(const std::string& key, const RestResponse& response, Time now);
+
+  Messaging& messaging_;
+  ClientImpl& client_;
+  Resolver& resolver_;
+
+  const ProxyOptions options_;
+
+  // Routes by descending length of their prefix, the longest matching prefix wins
+  std::vector<Route> routes_;
+
+  std::map<Key, Exchange> exchanges_;
+
+  // Exchanges waiting for the address of the upstream server
+  std::vector<Key> unresolved_;
+
+  // Cached responses, the most recently used first
+  std::list<CacheEntry> lru_;
+  std::unordered_map<std::string, std::list<CacheEntry>::iterator> cache_;
+};
+
+}  // namespace CoAP
+
+#endif  // __Proxy_h
@@ -18,7 +18,7 @@ RequestHandler& RequestHandlers::onUri(std::string pathPattern) {
 }
 
 RequestHandler* RequestHandlers::getHandler(const Path &path) {
-  auto it = std::find_if(std::begin(requestHandlers_), std::end(requestHandlers_), [path](auto & e){ return e.first.match(path); });
+  auto it = std::find_if(std::begin(requestHandlers_), std::end(requestHandlers_), [&path](auto & e){ return e.first.match(path); });
   return (it != std::end(requestHandlers_)) ? &it->second : nullptr;
 }
 
@@ -0,0 +1,108 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Resolver.h"
+
+#include "Logging.h"
+#include "NetUtils.h"
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+constexpr std::chrono::seconds Resolver::DEFAULT_TTL;
+constexpr std::chrono::seconds Resolver::DEFAULT_NEGATIVE_TTL;
+constexpr size_t Resolver::MAX_THREADS;
+
+Resolver::Resolver(Lookup lookup,
+                   std::chrono::seconds ttl,
+                   std::chrono::seconds negativeTtl,
+                   TimeProvider timeProvider)
+    : lookup_(lookup ? lookup : [](const std::string& hostname) { return NetUtils().endpointFromHostname(hostname); }),
+      ttl_(ttl),
+      negativeTtl_(negativeTtl),
+      timeProvider_(timeProvider) {
+}
+
+Resolver::~Resolver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    terminate_ = true;
+  }
+  cv_.notify_all();
+
+  for (auto& thread : threads_) thread.join();
+}
+
+std::shared_future<Endpoint> Resolver::resolve(const std::string& hostname) {
+  // Numeric addresses need no lookup
+  auto numeric = Endpoint::fromString(hostname, 0);
+  if (numeric) {
+    std::promise<Endpoint> promise;
+    promise.set_value(numeric.value());
+    return promise.get_future().share();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto& entry = cache_[hostname];
+  if (entry.address_.valid() && (entry.pending_ || entry.expires_ > timeProvider_())) {
+    return entry.address_;
+  }
+
+  DLOG << "Resolving " << hostname << '\n';
+  auto promise = std::make_shared<std::promise<Endpoint>>();
+  entry.address_ = promise->get_future().share();
+  entry.pending_ = true;
+  queue_.emplace_back(hostname, promise);
+
+  // Lookups of other names wait for a thread only if all threads are busy
+  if (queue_.size() > idle_ && threads_.size() < MAX_THREADS) {
+    threads_.emplace_back([this]() { run(); });
+  }
+  cv_.notify_one();
+
+  return entry.address_;
+}
+
+void Resolver::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    ++idle_;
+    // Waiting until a deadline keeps the library compatible with older libstdc++ versions,
+    // newer ones define condition_variable::wait() with a new symbol version
+    cv_.wait_until(lock, Time::max(), [this]() { return terminate_ || not queue_.empty(); });
+    --idle_;
+    if (terminate_) break;
+
+    auto job = std::move(queue_.front());
+    queue_.pop_front();
+
+    // The lookup may take a while, thus it must not block other callers
+    lock.unlock();
+    Endpoint address;
+    std::exception_ptr error;
+    try {
+      address = lookup_(job.first);
+    } catch (std::exception& e) {
+      WLOG << "Resolving " << job.first << " failed: " << e.what() << '\n';
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    // The cache is updated before the result is published, such that callers
+    // seeing the result also see the cache entry being valid.
+    auto& entry = cache_[job.first];
+    entry.pending_ = false;
+    entry.expires_ = timeProvider_() + (error ? negativeTtl_ : ttl_);
+    if (error) job.second->set_exception(error);
+    else job.second->set_value(address);
+  }
+
+  // Pending lookups are abandoned, their futures report a broken promise
+  queue_.clear();
+}
+
+}  // namespace CoAP
@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Resolver_h
+#define __Resolver_h
+
+#include "Endpoint.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace CoAP {
+
+/**
+ * Asynchronous resolver for host names with a cache.
+ *
+ * Lookups are executed by up to MAX_THREADS background threads, such that callers
+ * never block while the name is being resolved and a slow lookup does not delay
+ * the lookups of other names. Successful lookups are cached for the TTL,
+ * failed lookups for the negative TTL. Concurrent requests for the same name
+ * share one lookup and numeric addresses are resolved without a lookup at all.
+ */
+class Resolver {
+ public:
+  using Time = std::chrono::time_point<std::chrono::steady_clock>;
+  using TimeProvider = std::function<Time()>;
+
+  /// Resolves a host name, throws std::runtime_error if it cannot be resolved
+  using Lookup = std::function<Endpoint(const std::string&)>;
+
+  static constexpr std::chrono::seconds DEFAULT_TTL{300};
+  static constexpr std::chrono::seconds DEFAULT_NEGATIVE_TTL{30};
+  static constexpr size_t MAX_THREADS{4};
+
+  explicit Resolver(Lookup lookup = nullptr,
+                    std::chrono::seconds ttl = DEFAULT_TTL,
+                    std::chrono::seconds negativeTtl = DEFAULT_NEGATIVE_TTL,
+                    TimeProvider timeProvider = std::chrono::steady_clock::now);
+
+  ~Resolver();
+
+  Resolver(const Resolver&) = delete;
+  Resolver& operator=(const Resolver&) = delete;
+
+  /**
+   * Returns the IPv4 or IPv6 address of the host.
+   *
+   * @param hostname  Host name or numeric IPv4 or IPv6 address
+   *
+   * @return A future with the address and port 0, it throws std::runtime_error if the
+   *         host name could not be resolved.
+   */
+  std::shared_future<Endpoint> resolve(const std::string& hostname);
+
+ private:
+  struct Entry {
+    std::shared_future<Endpoint> address_;
+    bool pending_{true};
+    Time expires_;
+  };
+
+  void run();
+
+  Lookup lookup_;
+  const std::chrono::seconds ttl_;
+  const std::chrono::seconds negativeTtl_;
+  TimeProvider timeProvider_;
+
+  // Protection of the cache and the queue of pending lookups
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  std::unordered_map<std::string, Entry> cache_;
+  std::deque<std::pair<std::string, std::shared_ptr<std::promise<Endpoint>>>> queue_;
+
+  bool terminate_{false};
+  // Threads waiting for a lookup to execute
+  size_t idle_{0};
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace CoAP
+
+#endif  // __Resolver_h
@@ -0,0 +1,499 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ResourceDirectory.h"
+
+#include "Logging.h"
+#include "Messaging.h"
+#include "Metrics.h"
+#include "RequestHandlers.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+namespace {
+
+auto& activeRegistrations = Metrics::global().gauge("coap_rd_registrations_active");
+auto& lookups = Metrics::global().counter("coap_rd_lookups_total");
+
+// Entry points of the directory (RFC 9176, section 4)
+const char* const DISCOVERY = "</rd>;rt=core.rd;ct=40,</rd-lookup/ep>;rt=core.rd-lookup-ep;ct=40,"
+                              "</rd-lookup/res>;rt=core.rd-lookup-res;ct=40";
+
+std::pair<std::string, std::string> nameAndValue(const std::string& query) {
+  const auto equals = query.find('=');
+  if (equals == std::string::npos) return std::make_pair(query, std::string());
+  return std::make_pair(query.substr(0, equals), query.substr(equals + 1));
+}
+
+bool parseNumber(const std::string& text, uint64_t& number) {
+  if (text.empty() || text.size() > 19) return false;
+  number = 0;
+  for (auto c : text) {
+    if (c < '0' || c > '9') return false;
+    number = number * 10 + (c - '0');
+  }
+  return true;
+}
+
+// Base URI without trailing slashes, the links are resolved by appending their path
+std::string withoutTrailingSlashes(std::string base) {
+  while (not base.empty() && base.back() == '/') base.pop_back();
+  return base;
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Filters ending with * match all values starting with the rest of the filter
+bool matches(StringView value, const std::string& filter) {
+  if (not filter.empty() && filter.back() == '*') {
+    const auto length = filter.size() - 1;
+    return value.size() >= length && memcmp(value.data(), filter.data(), length) == 0;
+  }
+  return value == StringView(filter);
+}
+
+// Calls f for each of the values separated by spaces, like the resource types of a link
+template <typename F>
+void forEachValue(const std::string& values, F f) {
+  size_t start = 0;
+  while (start < values.size()) {
+    auto end = values.find(' ', start);
+    if (end == std::string::npos) end = values.size();
+    if (end > start) f(StringView(values.data() + start, end - start));
+    start = end + 1;
+  }
+}
+
+bool matchesAnyValue(const std::string& values, const std::string& filter) {
+  bool found = matches(values, filter);
+  forEachValue(values, [&](StringView value) { found = found || matches(value, filter); });
+  return found;
+}
+
+// Filters on the attributes of the registration, all other filters apply to the links
+bool isRegistrationAttribute(const std::string& name) {
+  return name == "ep" || name == "d" || name == "et" || name == "base";
+}
+
+// Absolute URI of the link target
+std::string resolve(const std::string& base, const std::string& href) {
+  if (href.find("://") != std::string::npos) return href;
+  if (not href.empty() && href[0] == '/') return base + href;
+  return base + '/' + href;
+}
+
+bool matchesLink(const ResourceDirectory::Link& link, const std::string& base,
+                 const std::vector<std::pair<std::string, std::string>>& filters) {
+  for (auto& filter : filters) {
+    if (isRegistrationAttribute(filter.first)) continue;
+    if (filter.first == "href") {
+      if (not matches(resolve(base, link.href_), filter.second)) return false;
+      continue;
+    }
+
+    bool found = false;
+    for (auto& parameter : link.parameters_) {
+      if (parameter.first == filter.first && matchesAnyValue(parameter.second, filter.second)) {
+        found = true;
+        break;
+      }
+    }
+    if (not found) return false;
+  }
+  return true;
+}
+
+bool hasLinkFilters(const std::vector<std::pair<std::string, std::string>>& filters) {
+  for (auto& filter : filters) {
+    if (not isRegistrationAttribute(filter.first)) return true;
+  }
+  return false;
+}
+
+void appendLink(std::string& payload, const std::string& uri, const std::string& attributes) {
+  if (not payload.empty()) payload += ',';
+  payload += '<';
+  payload += uri;
+  payload += '>';
+  payload += attributes;
+}
+
+void appendAttribute(std::string& attributes, const char* name, const std::string& value) {
+  attributes += ';';
+  attributes += name;
+  attributes += "=\"";
+  attributes += value;
+  attributes += '"';
+}
+
+RestResponse linkFormat(std::string payload) {
+  return RestResponse().withCode(Code::Content).withContentFormat(ContentFormat::LinkFormat)
+                       .withPayload(std::move(payload));
+}
+
+}  // namespace
+
+ResourceDirectory::ResourceDirectory(Messaging& messaging, const ResourceDirectoryOptions& options)
+    : messaging_(messaging), options_(options), discovery_(parseLinks(DISCOVERY)) {
+  auto& handlers = messaging_.requestHandler();
+  handlers.onUri("/.well-known/core").onGet([this](const Path& path) { return discover(path); });
+  handlers.onUri("/rd").onPost([this](const Path& path, const std::string& payload) {
+    return registerEndpoint(path, payload);
+  });
+  handlers.onUri("/rd/?")
+      .onGet([this](const Path& path) { return read(path); })
+      .onPost([this](const Path& path, const std::string&) { return update(path); })
+      .onDelete([this](const Path& path) { return remove(path); });
+  handlers.onUri("/rd-lookup/ep").onGet([this](const Path& path) { return lookup(path, false); });
+  handlers.onUri("/rd-lookup/res").onGet([this](const Path& path) { return lookup(path, true); });
+}
+
+std::vector<ResourceDirectory::Link> ResourceDirectory::parseLinks(StringView text) {
+  std::vector<Link> links;
+  const auto size = text.size();
+  size_t pos = 0;
+  auto skipSpaces = [&]() {
+    while (pos < size && isSpace(text[pos])) ++pos;
+  };
+
+  skipSpaces();
+  while (pos < size) {
+    if (text[pos] != '<') throw std::runtime_error("Link without target");
+    const auto end = text.find('>', pos);
+    if (end == StringView::npos) throw std::runtime_error("Unterminated link target");
+
+    Link link;
+    link.href_ = text.substr(pos + 1, end - pos - 1);
+    pos = end + 1;
+    const auto attributesStart = pos;
+    auto attributesEnd = pos;
+
+    for (;;) {
+      skipSpaces();
+      if (pos >= size || text[pos] == ',') break;
+      if (text[pos] != ';') throw std::runtime_error("Invalid link parameter");
+      ++pos;
+      skipSpaces();
+
+      const auto nameStart = pos;
+      while (pos < size && text[pos] != '=' && text[pos] != ';' && text[pos] != ',' && not isSpace(text[pos])) ++pos;
+      if (pos == nameStart) throw std::runtime_error("Link parameter without name");
+      std::string name = text.substr(nameStart, pos - nameStart);
+
+      std::string value;
+      if (pos < size && text[pos] == '=') {
+        ++pos;
+        if (pos < size && text[pos] == '"') {
+          for (++pos; pos < size && text[pos] != '"'; ++pos) {
+            if (text[pos] == '\\' && pos + 1 < size) ++pos;
+            value += text[pos];
+          }
+          if (pos == size) throw std::runtime_error("Unterminated quoted string");
+          ++pos;
+        } else {
+          const auto valueStart = pos;
+          while (pos < size && text[pos] != ';' && text[pos] != ',' && not isSpace(text[pos])) ++pos;
+          value = text.substr(valueStart, pos - valueStart);
+        }
+      }
+      link.parameters_.emplace_back(std::move(name), std::move(value));
+      attributesEnd = pos;
+    }
+
+    link.attributes_ = text.substr(attributesStart, attributesEnd - attributesStart);
+    links.push_back(std::move(link));
+
+    // Separator of the next link
+    if (pos < size) ++pos;
+    skipSpaces();
+  }
+  return links;
+}
+
+template <typename Visitor>
+void ResourceDirectory::forEachCandidate(const Filters& filters, Visitor visit) const {
+  // The smallest index entry of the filters without wildcard
+  const std::set<uint64_t>* candidates = nullptr;
+  for (auto& filter : filters) {
+    if (filter.second.empty() || filter.second.back() == '*') continue;
+
+    const Index* index = nullptr;
+    if (filter.first == "ep") index = &byName_;
+    else if (filter.first == "rt") index = &byResourceType_;
+    else if (filter.first == "if") index = &byInterface_;
+    if (index == nullptr) continue;
+
+    auto it = index->find(filter.second);
+    if (it == index->end()) return;
+    if (candidates == nullptr || it->second.size() < candidates->size()) candidates = &it->second;
+  }
+
+  if (candidates == nullptr) {
+    for (auto& registration : registrations_) {
+      if (not visit(registration.first, registration.second)) return;
+    }
+    return;
+  }
+
+  for (auto id : *candidates) {
+    if (not visit(id, registrations_.find(id)->second)) return;
+  }
+}
+
+RestResponse ResourceDirectory::registerEndpoint(const Path& path, const std::string& payload) {
+  Registration registration;
+  uint64_t lifetime = options_.defaultLifetime.count();
+  for (auto& query : path.queries()) {
+    const auto parameter = nameAndValue(query);
+    if (parameter.second.find('"') != std::string::npos) return RestResponse().withCode(Code::BadRequest);
+
+    if (parameter.first == "ep") registration.name_ = parameter.second;
+    else if (parameter.first == "d") registration.sector_ = parameter.second;
+    else if (parameter.first == "base") registration.base_ = withoutTrailingSlashes(parameter.second);
+    else if (parameter.first == "et") registration.endpointType_ = parameter.second;
+    else if (parameter.first == "lt") {
+      if (not parseNumber(parameter.second, lifetime) || lifetime == 0
+          || lifetime > std::numeric_limits<uint32_t>::max()) {
+        return RestResponse().withCode(Code::BadRequest);
+      }
+    }
+  }
+  // The handlers do not know the address of the endpoint, thus the base URI is needed to resolve the links
+  if (registration.name_.empty() || registration.base_.empty()) return RestResponse().withCode(Code::BadRequest);
+  registration.lifetime_ = static_cast<uint32_t>(lifetime);
+
+  try {
+    registration.links_ = parseLinks(payload);
+  } catch (std::runtime_error& e) {
+    DLOG << "Rejecting registration of endpoint " << registration.name_ << ": " << e.what() << '\n';
+    return RestResponse().withCode(Code::BadRequest);
+  }
+
+  // Registering an endpoint again replaces its registration at the same location
+  auto it = registrations_.end();
+  auto named = byName_.find(registration.name_);
+  if (named != byName_.end()) {
+    for (auto id : named->second) {
+      auto candidate = registrations_.find(id);
+      if (candidate->second.sector_ == registration.sector_) it = candidate;
+    }
+  }
+
+  if (it != registrations_.end()) {
+    unindex(it->first, it->second);
+    expiries_.erase(it->second.expiry_);
+    it->second = std::move(registration);
+  } else {
+    if (registrations_.size() >= options_.maxRegistrations) {
+      WLOG << "Rejecting registration of endpoint " << registration.name_ << ", the directory is full\n";
+      return RestResponse().withCode(Code::ServiceUnavailable);
+    }
+    it = registrations_.emplace_hint(registrations_.end(), nextId_++, std::move(registration));
+    activeRegistrations.increment();
+  }
+
+  index(it->first, it->second);
+  schedule(it->first, it->second);
+  ILOG << "Registered endpoint " << it->second.name_ << " with " << it->second.links_.size() << " links\n";
+  return RestResponse().withCode(Code::Created).withLocationPath("/rd/" + std::to_string(it->first));
+}
+
+RestResponse ResourceDirectory::update(const Path& path) {
+  auto it = registrationOf(path);
+  if (it == registrations_.end()) return RestResponse().withCode(Code::NotFound);
+
+  // The parameters are validated before any of them changes the registration
+  auto& registration = it->second;
+  uint64_t lifetime = registration.lifetime_;
+  std::string base = registration.base_;
+  for (auto& query : path.queries()) {
+    const auto parameter = nameAndValue(query);
+    if (parameter.first == "lt") {
+      if (not parseNumber(parameter.second, lifetime) || lifetime == 0
+          || lifetime > std::numeric_limits<uint32_t>::max()) {
+        return RestResponse().withCode(Code::BadRequest);
+      }
+    } else if (parameter.first == "base") {
+      base = withoutTrailingSlashes(parameter.second);
+      if (base.empty() || base.find('"') != std::string::npos) return RestResponse().withCode(Code::BadRequest);
+    }
+  }
+  registration.lifetime_ = static_cast<uint32_t>(lifetime);
+  registration.base_ = std::move(base);
+
+  expiries_.erase(registration.expiry_);
+  schedule(it->first, registration);
+  return RestResponse().withCode(Code::Changed);
+}
+
+RestResponse ResourceDirectory::read(const Path& path) {
+  auto it = registrationOf(path);
+  if (it == registrations_.end()) return RestResponse().withCode(Code::NotFound);
+
+  std::string payload;
+  for (auto& link : it->second.links_) appendLink(payload, link.href_, link.attributes_);
+  return linkFormat(std::move(payload));
+}
+
+RestResponse ResourceDirectory::remove(const Path& path) {
+  auto it = registrationOf(path);
+  if (it == registrations_.end()) return RestResponse().withCode(Code::NotFound);
+
+  ILOG << "Removing registration of endpoint " << it->second.name_ << '\n';
+  erase(it);
+  return RestResponse().withCode(Code::Deleted);
+}
+
+RestResponse ResourceDirectory::lookup(const Path& path, bool resources) const {
+  lookups.increment();
+
+  Filters filters;
+  uint64_t page = 0;
+  uint64_t count = options_.pageSize;
+  for (auto& query : path.queries()) {
+    auto parameter = nameAndValue(query);
+    if (parameter.first == "page") {
+      if (not parseNumber(parameter.second, page)) return RestResponse().withCode(Code::BadRequest);
+    } else if (parameter.first == "count") {
+      if (not parseNumber(parameter.second, count) || count == 0) return RestResponse().withCode(Code::BadRequest);
+    } else {
+      filters.push_back(std::move(parameter));
+    }
+  }
+  // Pages beyond all registrations are empty
+  if (page > std::numeric_limits<uint64_t>::max() / count) return linkFormat("");
+
+  const auto linkFilters = hasLinkFilters(filters);
+  auto skip = page * count;
+  auto remaining = count;
+  std::string payload;
+  forEachCandidate(filters, [&](uint64_t id, const Registration& registration) {
+    for (auto& filter : filters) {
+      if (filter.first == "ep" && not matches(registration.name_, filter.second)) return true;
+      if (filter.first == "d" && not matches(registration.sector_, filter.second)) return true;
+      if (filter.first == "et" && not matches(registration.endpointType_, filter.second)) return true;
+      if (filter.first == "base" && not matches(registration.base_, filter.second)) return true;
+    }
+
+    if (resources) {
+      for (auto& link : registration.links_) {
+        if (not matchesLink(link, registration.base_, filters)) continue;
+        if (skip > 0) {
+          --skip;
+          continue;
+        }
+
+        auto attributes = link.attributes_;
+        bool anchored = false;
+        for (auto& parameter : link.parameters_) anchored = anchored || parameter.first == "anchor";
+        if (not anchored) appendAttribute(attributes, "anchor", registration.base_);
+        appendLink(payload, resolve(registration.base_, link.href_), attributes);
+        if (--remaining == 0) return false;
+      }
+      return true;
+    }
+
+    // Endpoints match if one of their links matches the filters on links
+    if (linkFilters) {
+      bool found = false;
+      for (auto& link : registration.links_) {
+        if (matchesLink(link, registration.base_, filters)) {
+          found = true;
+          break;
+        }
+      }
+      if (not found) return true;
+    }
+    if (skip > 0) {
+      --skip;
+      return true;
+    }
+
+    std::string attributes;
+    appendAttribute(attributes, "ep", registration.name_);
+    if (not registration.sector_.empty()) appendAttribute(attributes, "d", registration.sector_);
+    appendAttribute(attributes, "base", registration.base_);
+    if (not registration.endpointType_.empty()) appendAttribute(attributes, "et", registration.endpointType_);
+    attributes += ";rt=core.rd-ep";
+    appendLink(payload, "/rd/" + std::to_string(id), attributes);
+    return --remaining > 0;
+  });
+
+  return linkFormat(std::move(payload));
+}
+
+RestResponse ResourceDirectory::discover(const Path& path) const {
+  Filters filters;
+  for (auto& query : path.queries()) filters.push_back(nameAndValue(query));
+
+  std::string payload;
+  for (auto& link : discovery_) {
+    if (matchesLink(link, "", filters)) appendLink(payload, link.href_, link.attributes_);
+  }
+  return linkFormat(std::move(payload));
+}
+
+std::map<uint64_t, ResourceDirectory::Registration>::iterator ResourceDirectory::registrationOf(const Path& path) {
+  uint64_t id;
+  if (path.size() != 2 || not parseNumber(path.getPart(1), id)) return registrations_.end();
+  return registrations_.find(id);
+}
+
+void ResourceDirectory::index(uint64_t id, const Registration& registration) {
+  byName_[registration.name_].insert(id);
+  for (auto& link : registration.links_) {
+    for (auto& parameter : link.parameters_) {
+      Index* index = (parameter.first == "rt") ? &byResourceType_ : (parameter.first == "if") ? &byInterface_ : nullptr;
+      if (index == nullptr) continue;
+      forEachValue(parameter.second, [index, id](StringView value) { (*index)[value].insert(id); });
+    }
+  }
+}
+
+void ResourceDirectory::unindex(uint64_t id, const Registration& registration) {
+  auto removeFrom = [id](Index& index, const std::string& value) {
+    auto it = index.find(value);
+    if (it == index.end()) return;
+    it->second.erase(id);
+    if (it->second.empty()) index.erase(it);
+  };
+
+  removeFrom(byName_, registration.name_);
+  for (auto& link : registration.links_) {
+    for (auto& parameter : link.parameters_) {
+      Index* index = (parameter.first == "rt") ? &byResourceType_ : (parameter.first == "if") ? &byInterface_ : nullptr;
+      if (index == nullptr) continue;
+      forEachValue(parameter.second, [&](StringView value) { removeFrom(*index, value); });
+    }
+  }
+}
+
+void ResourceDirectory::schedule(uint64_t id, Registration& registration) {
+  registration.expiry_ = expiries_.emplace(messaging_.now() + std::chrono::seconds(registration.lifetime_), id);
+}
+
+void ResourceDirectory::erase(std::map<uint64_t, Registration>::iterator it) {
+  unindex(it->first, it->second);
+  expiries_.erase(it->second.expiry_);
+  registrations_.erase(it);
+  activeRegistrations.decrement();
+}
+
+void ResourceDirectory::expire(Time now) {
+  while (not expiries_.empty() && expiries_.begin()->first <= now) {
+    auto it = registrations_.find(expiries_.begin()->second);
+    ILOG << "Registration of endpoint " << it->second.name_ << " expired\n";
+    erase(it);
+  }
+}
+
+}  // namespace CoAP
@@ -0,0 +1,124 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __ResourceDirectory_h
+#define __ResourceDirectory_h
+
+#include "Path.h"
+#include "ResourceDirectoryOptions.h"
+#include "RestResponse.h"
+#include "StringView.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace CoAP {
+
+class Messaging;
+
+/**
+ * Resource directory (RFC 9176), served by request handlers of the server.
+ *
+ * Endpoints register their links at /rd and are found by the lookups at /rd-lookup/ep and
+ * /rd-lookup/res, whose responses are paginated with the page and count parameters. The
+ * registrations are indexed by endpoint name, resource type and interface, a lookup filtering
+ * on one of them only visits the registrations of the smallest index entry. Registrations expire
+ * after their lifetime in the message processing loop, like the deadlines of the client.
+ */
+class ResourceDirectory {
+ public:
+  using Time = std::chrono::steady_clock::time_point;
+
+  // Link of the link format (RFC 6690)
+  struct Link {
+    std::string href_;
+    // Parameters as received, like ;rt="temperature-c";if=sensor
+    std::string attributes_;
+    // Parameters with unquoted values
+    std::vector<std::pair<std::string, std::string>> parameters_;
+  };
+
+  /**
+   * Registers the request handlers of the directory and of /.well-known/core.
+   */
+  ResourceDirectory(Messaging& messaging, const ResourceDirectoryOptions& options);
+
+  ResourceDirectory(const ResourceDirectory&) = delete;
+  ResourceDirectory& operator=(const ResourceDirectory&) = delete;
+
+  /**
+   * Removes the registrations whose lifetime ended.
+   */
+  void expire(Time now);
+
+  /// Returns the number of registrations
+  size_t size() const { return registrations_.size(); }
+
+  /**
+   * Parses links in the link format.
+   *
+   * @throws std::runtime_error if the links are malformed.
+   */
+  static std::vector<Link> parseLinks(StringView text);
+
+ private:
+  using Filters = std::vector<std::pair<std::string, std::string>>;
+  using Index = std::unordered_map<std::string, std::set<uint64_t>>;
+
+  struct Registration {
+    std::string name_;
+    std::string sector_;
+    std::string base_;
+    std::string endpointType_;
+    uint32_t lifetime_{0};
+    std::multimap<Time, uint64_t>::iterator expiry_;
+    std::vector<Link> links_;
+  };
+
+  RestResponse registerEndpoint(const Path& path, const std::string& payload);
+  RestResponse update(const Path& path);
+  RestResponse read(const Path& path);
+  RestResponse remove(const Path& path);
+  RestResponse lookup(const Path& path, bool resources) const;
+  RestResponse discover(const Path& path) const;
+
+  // Registration of the path /rd/{id}
+  std::map<uint64_t, Registration>::iterator registrationOf(const Path& path);
+
+  // Calls visit for the registrations that may match the filters, in the order of registration,
+  // until it returns false
+  template <typename Visitor>
+  void forEachCandidate(const Filters& filters, Visitor visit) const;
+
+  void index(uint64_t id, const Registration& registration);
+  void unindex(uint64_t id, const Registration& registration);
+  void schedule(uint64_t id, Registration& registration);
+  void erase(std::map<uint64_t, Registration>::iterator it);
+
+  Messaging& messaging_;
+  const ResourceDirectoryOptions options_;
+
+  // Links of /.well-known/core
+  const std::vector<Link> discovery_;
+
+  uint64_t nextId_{1};
+  std::map<uint64_t, Registration> registrations_;
+  std::multimap<Time, uint64_t> expiries_;
+
+  Index byName_;
+  Index byResourceType_;
+  Index byInterface_;
+};
+
+}  // namespace CoAP
+
+#endif  // __ResourceDirectory_h
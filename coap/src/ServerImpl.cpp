@@ -10,6 +10,8 @@
 #include "Logging.h"
 #include "Message.h"
 #include "Messaging.h"
+#include "Metrics.h"
+#include "Tracing.h"
 
 #include <thread>
 
@@ -17,7 +19,31 @@ SETLOGLEVEL(LLWARNING)
 
 namespace CoAP {
 
-void ServerImpl::onMessage(const Message& request, in_addr_t fromIP, uint16_t fromPort) {
+namespace {
+
+auto& requests = Metrics::global().counter("coap_server_requests_total");
+auto& handlerLatency = Metrics::global().histogram("coap_server_handler_latency_us", Metrics::latencyBounds());
+auto& activeObservations = Metrics::global().gauge("coap_observations_active");
+
+// Records the time from its creation to its destruction as handler latency
+class HandlerTimer {
+ public:
+  ~HandlerTimer() {
+    const auto duration = std::chrono::steady_clock::now() - start_;
+    handlerLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  }
+
+ private:
+  const std::chrono::steady_clock::time_point start_{std::chrono::steady_clock::now()};
+};
+
+}  // namespace
+
+ServerImpl::~ServerImpl() {
+  activeObservations.add(-static_cast<int64_t>(observations_.size()));
+}
+
+void ServerImpl::onMessage(const Message& request, const Endpoint& from) {
   ILOG << "Received request with msgID=" << request.messageId()
       << " and token=" << request.token()
       << " with code=" << request.code()
@@ -25,26 +51,43 @@ void ServerImpl::onMessage(const Message& request, in_addr_t fromIP, uint16_t fr
 
   if (request.code() == Code::Empty && request.type() == Type::Confirmable) {
     // Ping request gets ping response
-    reply(fromIP, fromPort, Type::Reset, request.messageId(), request.token(), RestResponse().withCode(Code::Empty));
+    reply(from, Type::Reset, request.messageId(), request.token(), RestResponse().withCode(Code::Empty));
   }
   else if (request.type() == Type::Reset) {
     // TODO: Timeout for confirmable notification messages also cancels the observation
-    if (observations_.erase(std::make_tuple(fromIP, fromPort, request.token()))) {
+    if (observations_.erase(std::make_tuple(from, request.token()))) {
+      activeObservations.decrement();
       ILOG << "Observation cancelled, " << observations_.size() << " active observations\n";
     }
   }
+  else if (proxy_ && proxy_->accepts(request)) {
+    proxy_->onRequest(request, from);
+  }
   else {
-    reply(fromIP, fromPort, request.type(), request.messageId(), request.token(), onRequest(request, fromIP, fromPort));
+    reply(from, request.type(), request.messageId(), request.token(), onRequest(request, from));
   }
 }
 
-RestResponse ServerImpl::onRequest(const Message& request, in_addr_t fromIP, uint16_t fromPort) {
+RestResponse ServerImpl::onRequest(const Message& request, const Endpoint& from) {
+  requests.increment();
+  HandlerTimer timer;
+  TraceSpan span("handler", request.messageId());
+
+  auto response = handleRequest(request, from);
+  response.negotiate(request.optionalAccept());
+  return response;
+}
+
+RestResponse ServerImpl::handleRequest(const Message& request, const Endpoint& from) {
   Code code = request.code();
 
   // Ping request
   if (code == Code::Empty) return RestResponse().withCode(Code::Empty);
-  
-  const auto path = Path(request.path());
+
+  // Requests for other servers are only forwarded by proxies
+  if (request.isProxyRequest()) return RestResponse().withCode(Code::ProxyingNotSupported);
+
+  const auto path = Path(request.path(), request.queries());
   auto handler = requestHandler_.getHandler(path);
   if (handler == nullptr) return RestResponse().withCode(Code::NotFound);
 
@@ -53,13 +96,13 @@ RestResponse ServerImpl::onRequest(const Message& request, in_addr_t fromIP, uin
       if (request.optionalObserveValue()) {
         if (handler->isObserveDelayed()) {
           // Send acknowledgement for delayed responses
-          reply(fromIP, fromPort, CoAP::Type::Acknowledgement, request.messageId(), 0, RestResponse());
+          if (request.type() == Type::Confirmable) reply(from, CoAP::Type::Acknowledgement, request.messageId(), 0, RestResponse());
         }
 
         if (request.optionalObserveValue().value() == 0) {
-          return createObservation(fromIP, fromPort, request.type(), request.token(), path);
+          return createObservation(from, request.type(), request.token(), path, request.optionalAccept());
         } else if (request.optionalObserveValue().value() == 1) {
-          deleteObservation(fromIP, fromPort, request.token());
+          deleteObservation(from, request.token());
         } else {
           ELOG << "Received observe request with unsupported observe value "
                << request.optionalObserveValue().value() << '\n';
@@ -67,7 +110,7 @@ RestResponse ServerImpl::onRequest(const Message& request, in_addr_t fromIP, uin
       } else {
         if (handler->isGetDelayed()) {
           // Send acknowledgement for delayed responses
-          reply(fromIP, fromPort, CoAP::Type::Acknowledgement, request.messageId(), 0, RestResponse());
+          if (request.type() == Type::Confirmable) reply(from, CoAP::Type::Acknowledgement, request.messageId(), 0, RestResponse());
         }
       }
       return handler->GET(path);
@@ -87,42 +130,81 @@ RestResponse ServerImpl::onRequest(const Message& request, in_addr_t fromIP, uin
   }
 }
 
+void ServerImpl::onMulticastMessage(const Message& request, const Endpoint& from) {
+  // Multicast requests are always nonconfirmable, everything else is not meant for us
+  if (request.type() != Type::NonConfirmable || not request.isRequestCode() || request.code() == Code::Empty) {
+    DLOG << "Ignoring multicast message with msgID=" << request.messageId() << '\n';
+    return;
+  }
+
+  auto response = onRequest(request, from);
+  // Client (4.xx) and server (5.xx) errors
+  if (static_cast<int>(response.code()) >= 0x80) {
+    DLOG << "Suppressing error response " << response.code() << " to multicast request\n";
+    return;
+  }
+
+  std::uniform_int_distribution<std::chrono::milliseconds::rep> delay(0, leisure_.count());
+  const auto due = messaging_.now() + std::chrono::milliseconds(delay(random_));
+  deferred_.emplace(due, std::make_pair(from, responseMessage(Type::NonConfirmable, request.messageId(),
+                                                              request.token(), response)));
+}
+
+void ServerImpl::sendDeferredReplies(Time now) {
+  while (not deferred_.empty() && deferred_.begin()->first <= now) {
+    auto reply = std::move(deferred_.begin()->second);
+    deferred_.erase(deferred_.begin());
+    messaging_.sendMessage(reply.first, std::move(reply.second));
+  }
+}
+
+Message ServerImpl::responseMessage(Type type, MessageId messageId, uint64_t token, const RestResponse& response) {
+  auto message = CoAP::Message(type, messageId, response.code(), token, "", response.payload());
+  if (response.hasContentFormat()) message.withContentFormat(response.contentFormat());
+  if (response.hasMaxAge()) message.withMaxAge(response.maxAge());
+  if (not response.locationPath().empty()) message.withLocationPath(response.locationPath());
+  return message;
+}
+
 // TODO: Test that server responds with correct messageId
-void ServerImpl::reply(in_addr_t ip,
-                       uint16_t port,
+void ServerImpl::reply(const Endpoint& to,
                        Type type,
                        MessageId messageId,
                        uint64_t token,
                        const RestResponse& response) {
-  auto message = CoAP::Message(type, messageId, response.code(), token, "", response.payload());
-  if (response.hasContentFormat()) message.withContentFormat(response.contentFormat());
-  messaging_.sendMessage(ip, port, message);
+  messaging_.sendMessage(to, responseMessage(type, messageId, token, response));
 }
 
-RestResponse ServerImpl::createObservation(in_addr_t fromIP,
-                                           uint16_t fromPort,
+RestResponse ServerImpl::createObservation(const Endpoint& from,
                                            Type requestType,
                                            uint64_t token,
-                                           const Path& path) {
+                                           const Path& path,
+                                           const Optional<uint16_t>& accept) {
   // TODO: Keep sending notifications as long as the client is interested.
   //       The client indicates its disinterest in further notifications by replying with a reset messages.
   auto observation = std::make_shared<Notifications>();
-  observations_.emplace(std::make_tuple(fromIP, fromPort, token), observation);
+  if (observations_.emplace(std::make_tuple(from, token), observation).second) activeObservations.increment();
   ILOG << observations_.size() << " active observations\n";
-  observation->subscribe([this, fromIP, fromPort, requestType, token](const CoAP::RestResponse& response){
+  // Notifications are encoded in the content format of the request. The Accept option is captured
+  // as non-const copy, moving a const Optional would convert it to bool.
+  observation->subscribe([this, from, requestType, token, accept = Optional<uint16_t>(accept)]
+                         (CoAP::RestResponse response){
     // TODO: reply with unique messageIDs??
-    reply(fromIP, fromPort, requestType, 0, token, response);
+    response.negotiate(accept);
+    reply(from, requestType, 0, token, response);
   });
   auto handler = requestHandler_.getHandler(path);
   return (handler != nullptr) ? handler->OBSERVE(path, observation)
                               : RestResponse().withCode(Code::Empty);
 }
 
-void ServerImpl::deleteObservation(in_addr_t fromIP, uint16_t fromPort, uint64_t token) {
-  if (!observations_.erase(std::make_tuple(fromIP, fromPort, token))) {
+void ServerImpl::deleteObservation(const Endpoint& from, uint64_t token) {
+  if (!observations_.erase(std::make_tuple(from, token))) {
     ELOG << "Received remove observation request for not observed ressource with token "
          << token << '\n';
+    return;
   }
+  activeObservations.decrement();
 }
 
 }  // namespace CoAP
@@ -8,12 +8,17 @@
 #define __ServerImpl_h
 
 #include "RequestHandlers.h"
+#include "Endpoint.h"
 #include "IConnection.h"
 #include "Message.h"
 #include "Notifications.h"
+#include "Parameters.h"
+#include "Proxy.h"
 
+#include <chrono>
 #include <map>
 #include <memory>
+#include <random>
 #include <thread>
 
 namespace CoAP {
@@ -25,33 +30,85 @@ class Telegram;
 
 class ServerImpl {
  public:
+  using Time = std::chrono::steady_clock::time_point;
+
   ServerImpl(Messaging& messaging)
       : messaging_(messaging) {
   }
 
+  ~ServerImpl();
+
   RequestHandlers& requestHandler() {
     return requestHandler_;
   }
 
-  void onMessage(const Message& msg, in_addr_t fromIP, uint16_t fromPort);
+  void onMessage(const Message& msg, const Endpoint& from);
+
+  /**
+   * Handles the request and encodes the response in the content format accepted by the client.
+   */
+  RestResponse onRequest(const Message& request, const Endpoint& from);
+
+  /**
+   * Handles a request received via a multicast group.
+   *
+   * The response is deferred by a random delay within the leisure period, such that the
+   * responses of all servers in the group do not arrive at the client at the same time.
+   * Error responses are suppressed, as the client cannot tell which server they refer to.
+   */
+  void onMulticastMessage(const Message& request, const Endpoint& from);
+
+  /**
+   * Sends the deferred responses to multicast requests whose delay passed.
+   */
+  void sendDeferredReplies(Time now);
+
+  /**
+   * Sets the period within which responses to multicast requests are sent.
+   */
+  void setLeisure(std::chrono::milliseconds leisure) { leisure_ = leisure; }
+
+  /**
+   * Forwards the requests accepted by the proxy instead of handling them.
+   */
+  void setProxy(std::unique_ptr<Proxy> proxy) { proxy_ = std::move(proxy); }
+
+  /**
+   * Forwards the proxy requests whose upstream host name has been resolved.
+   */
+  void forwardResolved() {
+    if (proxy_) proxy_->forwardResolved();
+  }
 
-  RestResponse onRequest(const Message& request, in_addr_t fromIP, uint16_t fromPort);
+  static Message responseMessage(Type type, MessageId messageId, uint64_t token, const RestResponse& response);
 
  private:
-  void reply(in_addr_t ip, uint16_t port, Type type, MessageId messageId, uint64_t token, const RestResponse& response);
+  RestResponse handleRequest(const Message& request, const Endpoint& from);
+
+  void reply(const Endpoint& to, Type type, MessageId messageId, uint64_t token, const RestResponse& response);
 
   RequestHandlers requestHandler_;
 
+  std::chrono::milliseconds leisure_{static_cast<long>(DEFAULT_LEASURE * 1000)};
+
+  // Responses to multicast requests to be sent at the given time
+  std::multimap<Time, std::pair<Endpoint, Message>> deferred_;
+
+  // randomizes the delay of responses to multicast requests
+  std::minstd_rand random_{std::random_device()()};
+
   Messaging & messaging_;
 
-  // observations are uniquely identified by the tuple <IP, Port, Token>
-  std::map<std::tuple<in_addr_t, uint16_t, uint64_t>,std::shared_ptr<Notifications>> observations_;
-  RestResponse createObservation(in_addr_t fromIP,
-                                 uint16_t fromPort,
+  std::unique_ptr<Proxy> proxy_;
+
+  // observations are uniquely identified by the tuple <Endpoint, Token>
+  std::map<std::tuple<Endpoint, uint64_t>,std::shared_ptr<Notifications>> observations_;
+  RestResponse createObservation(const Endpoint& from,
                                  Type requestType,
                                  uint64_t token,
-                                 const Path& path);
-  void deleteObservation(in_addr_t fromIP, uint16_t fromPort, uint64_t token);
+                                 const Path& path,
+                                 const Optional<uint16_t>& accept);
+  void deleteObservation(const Endpoint& from, uint64_t token);
 };
 
 }  // namespace CoAP
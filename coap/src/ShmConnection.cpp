@@ -0,0 +1,262 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ShmConnection.h"
+
+#include "Logging.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+constexpr size_t ShmConnection::DEFAULT_CAPACITY;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Shared memory rings require lock-free atomics");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain integers");
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x436f4150;  // "CoAP"
+constexpr uint32_t VERSION = 1;
+
+// Length of the record that fills the rest of the ring before wrapping around
+constexpr uint32_t PADDING = 0xffffffff;
+
+constexpr size_t ALIGNMENT = 8;
+
+size_t aligned(size_t size, size_t alignment = ALIGNMENT) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+void futexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::milliseconds timeout) {
+  timespec ts;
+  ts.tv_sec = timeout.count() / 1000;
+  ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+  // Not FUTEX_PRIVATE, as the word is shared with another process
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+struct ShmConnection::Ring {
+  // Position up to which the producer has written
+  alignas(64) std::atomic<uint64_t> head;
+
+  // Position up to which the consumer has read
+  alignas(64) std::atomic<uint64_t> tail;
+
+  // Incremented for every telegram, the consumer sleeps on it while waiting is set
+  alignas(64) std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> waiting;
+};
+
+struct ShmConnection::Layout {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  Endpoint endpoints[2];
+  // Ring i is written by side i
+  Ring rings[2];
+};
+
+ShmConnection::~ShmConnection() {
+  close();
+}
+
+void ShmConnection::create(const Endpoint& self, const Endpoint& peer, size_t capacity) {
+  if (layout_) throw std::logic_error("Cannot create already open connection.");
+  if (capacity < 64 || (capacity & (capacity - 1)) != 0) throw std::logic_error("Capacity must be a power of two.");
+
+  const auto size = aligned(sizeof(Layout), 64) + 2 * capacity;
+  auto fd = memfd_create("coap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) throw std::runtime_error("Creating shared memory failed.");
+
+  // The peer must not be able to resize the memory under our feet
+  if (-1 == ftruncate(fd, size) || -1 == fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+    ::close(fd);
+    throw std::runtime_error("Creating shared memory failed.");
+  }
+
+  map(fd, size);
+  side_ = 0;
+
+  // The memory is zero initialized, thus the positions of the rings are zero already
+  layout_ = new (memory_) Layout;
+  layout_->magic = MAGIC;
+  layout_->version = VERSION;
+  layout_->capacity = capacity;
+  layout_->endpoints[0] = self;
+  layout_->endpoints[1] = peer;
+
+  out_ = &layout_->rings[0];
+  in_ = &layout_->rings[1];
+  outData_ = static_cast<uint8_t*>(memory_) + aligned(sizeof(Layout), 64);
+  inData_ = outData_ + capacity;
+}
+
+void ShmConnection::attach(int fd) {
+  if (layout_) throw std::logic_error("Cannot attach already open connection.");
+
+  auto own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  struct stat status;
+  if (own < 0 || -1 == fstat(own, &status) || static_cast<size_t>(status.st_size) < sizeof(Layout)) {
+    if (own >= 0) ::close(own);
+    throw std::runtime_error("Invalid shared memory.");
+  }
+
+  map(own, status.st_size);
+  auto layout = static_cast<Layout*>(memory_);
+  const auto capacity = layout->capacity;
+  if (layout->magic != MAGIC || layout->version != VERSION || (capacity & (capacity - 1)) != 0
+      || aligned(sizeof(Layout), 64) + 2 * capacity != size_) {
+    close();
+    throw std::runtime_error("Invalid shared memory.");
+  }
+
+  side_ = 1;
+  layout_ = layout;
+  out_ = &layout_->rings[1];
+  in_ = &layout_->rings[0];
+  inData_ = static_cast<uint8_t*>(memory_) + aligned(sizeof(Layout), 64);
+  outData_ = inData_ + capacity;
+}
+
+void ShmConnection::map(int fd, size_t size) {
+  auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    ::close(fd);
+    throw std::runtime_error("Mapping shared memory failed.");
+  }
+
+  fd_ = fd;
+  memory_ = memory;
+  size_ = size;
+}
+
+void ShmConnection::close() {
+  if (memory_) munmap(memory_, size_);
+  if (fd_ >= 0) ::close(fd_);
+
+  fd_ = -1;
+  memory_ = nullptr;
+  size_ = 0;
+  layout_ = nullptr;
+  in_ = out_ = nullptr;
+  inData_ = outData_ = nullptr;
+}
+
+const Endpoint& ShmConnection::self() const {
+  if (not layout_) throw std::logic_error("Connection is not open.");
+  return layout_->endpoints[side_];
+}
+
+const Endpoint& ShmConnection::peer() const {
+  if (not layout_) throw std::logic_error("Connection is not open.");
+  return layout_->endpoints[1 - side_];
+}
+
+void ShmConnection::send(Telegram&& telegram) {
+  if (not layout_) throw std::logic_error("Cannot send if connection was not opened before.");
+  if (telegram.getEndpoint() != peer()) {
+    throw std::runtime_error(telegram.getEndpoint().toString() + " is not reachable via shared memory.");
+  }
+
+  const auto& message = telegram.getMessage();
+  const uint64_t capacity = layout_->capacity;
+  const auto needed = aligned(sizeof(uint32_t) + message.size());
+  if (needed > capacity / 2) throw std::runtime_error("Telegram exceeds the capacity of the shared memory.");
+
+  std::lock_guard<std::mutex> lock(sendMutex_);
+
+  auto head = out_->head.load(std::memory_order_relaxed);
+  const auto tail = out_->tail.load(std::memory_order_acquire);
+  auto offset = head & (capacity - 1);
+  const auto contiguous = capacity - offset;
+
+  // Records are never split, the rest of the ring is skipped if the record does not fit
+  const auto total = needed + (contiguous < needed ? contiguous : 0);
+  if (head + total - tail > capacity) {
+    ++dropped_;
+    DLOG << "Dropping telegram, the ring of " << peer() << " is full\n";
+    return;
+  }
+
+  if (contiguous < needed) {
+    memcpy(outData_ + offset, &PADDING, sizeof(PADDING));
+    head += contiguous;
+    offset = 0;
+  }
+
+  const auto length = static_cast<uint32_t>(message.size());
+  memcpy(outData_ + offset, &length, sizeof(length));
+  memcpy(outData_ + offset + sizeof(length), message.data(), message.size());
+  out_->head.store(head + needed, std::memory_order_release);
+
+  // The system call is only needed if the peer sleeps
+  out_->sequence.fetch_add(1);
+  if (out_->waiting.load()) futexWake(&out_->sequence);
+}
+
+Optional<Telegram> ShmConnection::get(std::chrono::milliseconds timeout) {
+  if (not layout_) throw std::logic_error("Cannot receive if connection was not opened before.");
+
+  auto telegram = read();
+  if (telegram || timeout.count() <= 0) return telegram;
+
+  // A telegram written after the sequence was read makes the wait return immediately
+  const auto sequence = in_->sequence.load();
+  in_->waiting.store(1);
+  telegram = read();
+  if (not telegram) {
+    futexWait(&in_->sequence, sequence, timeout);
+    telegram = read();
+  }
+  in_->waiting.store(0, std::memory_order_relaxed);
+  return telegram;
+}
+
+Optional<Telegram> ShmConnection::read() {
+  const uint64_t capacity = layout_->capacity;
+  auto tail = in_->tail.load(std::memory_order_relaxed);
+
+  for (;;) {
+    const auto head = in_->head.load(std::memory_order_acquire);
+    if (tail == head) return Optional<Telegram>();
+
+    const auto offset = tail & (capacity - 1);
+    uint32_t length;
+    memcpy(&length, inData_ + offset, sizeof(length));
+
+    if (length == PADDING) {
+      tail += capacity - offset;
+      in_->tail.store(tail, std::memory_order_release);
+      continue;
+    }
+
+    if (sizeof(length) + length > capacity - offset || sizeof(length) + length > head - tail) {
+      throw std::runtime_error("Shared memory is corrupted.");
+    }
+
+    auto data = inData_ + offset + sizeof(length);
+    Telegram telegram(peer(), std::vector<uint8_t>(data, data + length));
+    in_->tail.store(tail + aligned(sizeof(length) + length), std::memory_order_release);
+    return Optional<Telegram>(std::move(telegram));
+  }
+}
+
+}  // namespace CoAP
@@ -0,0 +1,112 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __ShmConnection_h
+#define __ShmConnection_h
+
+#include "IConnection.h"
+#include "Telegram.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace CoAP {
+
+/**
+ * Transport between two processes on the same host through shared memory.
+ *
+ * One side creates an anonymous shared memory file (memfd) holding one lock-free
+ * single producer single consumer ring per direction, the other side attaches to
+ * it with the file descriptor, e.g. inherited through fork() or passed via
+ * SCM_RIGHTS. Telegrams are copied into the ring without any system call, the
+ * receiver is only woken with a futex if it is actually waiting.
+ *
+ * Each side is addressed with the endpoint given on creation, such that Messaging
+ * works unchanged: Telegrams can only be sent to the peer endpoint and all received
+ * telegrams stem from it. Like UDP, telegrams are dropped if the ring of the peer
+ * is full.
+ */
+class ShmConnection : public IConnection {
+ public:
+  static constexpr size_t DEFAULT_CAPACITY{1024 * 1024};
+
+  ShmConnection() = default;
+
+  virtual ~ShmConnection();
+
+  ShmConnection(const ShmConnection&) = delete;
+  ShmConnection& operator=(const ShmConnection&) = delete;
+
+  /**
+   * Creates the shared memory for the communication with a peer.
+   *
+   * @param self      Endpoint of this side as seen by the peer
+   * @param peer      Endpoint of the peer
+   * @param capacity  Size of each ring in bytes, a power of two
+   *
+   * @throws  std::logic_error    when the connection is already open
+   * @throws  std::runtime_error  when the shared memory could not be created
+   */
+  void create(const Endpoint& self, const Endpoint& peer, size_t capacity = DEFAULT_CAPACITY);
+
+  /**
+   * Attaches to the shared memory created by the peer.
+   *
+   * @param fd  File descriptor of the shared memory, it is duplicated by the connection
+   *
+   * @throws  std::logic_error    when the connection is already open
+   * @throws  std::runtime_error  when the file descriptor does not refer to a valid shared memory
+   */
+  void attach(int fd);
+
+  /**
+   * Unmaps the shared memory and resets the internal state of this object.
+   */
+  void close();
+
+  /// Returns the file descriptor to be handed over to the peer
+  int fd() const { return fd_; }
+
+  const Endpoint& self() const;
+
+  const Endpoint& peer() const;
+
+  /// Returns the number of telegrams dropped because the ring of the peer was full
+  size_t dropped() const { return dropped_; }
+
+  void send(Telegram&& telegram) override;
+
+  Optional<Telegram> get(std::chrono::milliseconds timeout) override;
+
+ private:
+  struct Ring;
+  struct Layout;
+
+  // Reads the next telegram from the incoming ring if there is one
+  Optional<Telegram> read();
+
+  void map(int fd, size_t size);
+
+  int fd_{-1};
+  void* memory_{nullptr};
+  size_t size_{0};
+  // 0 for the creating side, 1 for the attached side
+  int side_{0};
+
+  Layout* layout_{nullptr};
+  Ring* in_{nullptr};
+  Ring* out_{nullptr};
+  uint8_t* inData_{nullptr};
+  uint8_t* outData_{nullptr};
+
+  // The rings have a single producer, but several threads of this process may send
+  std::mutex sendMutex_;
+  std::atomic<size_t> dropped_{0};
+};
+
+}  // namespace CoAP
+
+#endif  // __ShmConnection_h
@@ -0,0 +1,554 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "TcpConnection.h"
+
+#include "Logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+constexpr size_t TcpConnection::DEFAULT_MAX_MESSAGE_SIZE;
+constexpr size_t TcpConnection::MAX_MESSAGE_SIZE;
+
+namespace {
+
+// Signaling codes (RFC 8323, section 5)
+constexpr uint8_t CSM = 0xe1;      // 7.01
+constexpr uint8_t PING = 0xe2;     // 7.02
+constexpr uint8_t PONG = 0xe3;     // 7.03
+constexpr uint8_t RELEASE = 0xe4;  // 7.04
+constexpr uint8_t ABORT = 0xe5;    // 7.05
+
+// Option of the CSM message
+constexpr unsigned MAX_MESSAGE_SIZE_OPTION = 2;
+
+struct FrameHeader {
+  size_t headerSize;  // Len/TKL, extended length, code and token
+  size_t bodySize;    // options and payload
+  uint8_t tokenLength;
+};
+
+// Parses the header of the frame, returns false if it is not complete yet
+bool parseHeader(const uint8_t* data, size_t size, FrameHeader& header) {
+  if (size < 1) return false;
+
+  const auto len = data[0] >> 4;
+  const size_t extendedLength = (len < 13) ? 0 : (len == 13) ? 1 : (len == 14) ? 2 : 4;
+  if (size < 1 + extendedLength) return false;
+
+  switch (len) {
+    case 13: header.bodySize = data[1] + 13; break;
+    case 14: header.bodySize = ((data[1] << 8) | data[2]) + 269; break;
+    case 15: header.bodySize = ((size_t(data[1]) << 24) | (data[2] << 16) | (data[3] << 8) | data[4]) + 65805; break;
+    default: header.bodySize = len;
+  }
+  header.tokenLength = data[0] & 0x0f;
+  header.headerSize = 1 + extendedLength + 1 + header.tokenLength;
+  return true;
+}
+
+std::vector<uint8_t> frame(uint8_t code, const uint8_t* token, size_t tokenLength, const uint8_t* body, size_t bodySize) {
+  std::vector<uint8_t> frame;
+  frame.reserve(bodySize + tokenLength + 6);
+
+  if (bodySize < 13) {
+    frame.push_back(static_cast<uint8_t>((bodySize << 4) | tokenLength));
+  } else if (bodySize < 269) {
+    frame.push_back(static_cast<uint8_t>((13 << 4) | tokenLength));
+    frame.push_back(static_cast<uint8_t>(bodySize - 13));
+  } else if (bodySize < 65805) {
+    frame.push_back(static_cast<uint8_t>((14 << 4) | tokenLength));
+    frame.push_back(static_cast<uint8_t>((bodySize - 269) >> 8));
+    frame.push_back(static_cast<uint8_t>((bodySize - 269) & 0xff));
+  } else {
+    frame.push_back(static_cast<uint8_t>((15 << 4) | tokenLength));
+    for (auto shift : {24, 16, 8, 0}) frame.push_back(static_cast<uint8_t>(((bodySize - 65805) >> shift) & 0xff));
+  }
+  frame.push_back(code);
+  frame.insert(frame.end(), token, token + tokenLength);
+  frame.insert(frame.end(), body, body + bodySize);
+  return frame;
+}
+
+std::vector<uint8_t> csm() {
+  const uint8_t body[] = {
+      (MAX_MESSAGE_SIZE_OPTION << 4) | 3,
+      static_cast<uint8_t>((TcpConnection::MAX_MESSAGE_SIZE >> 16) & 0xff),
+      static_cast<uint8_t>((TcpConnection::MAX_MESSAGE_SIZE >> 8) & 0xff),
+      static_cast<uint8_t>(TcpConnection::MAX_MESSAGE_SIZE & 0xff)};
+  return frame(CSM, nullptr, 0, body, sizeof(body));
+}
+
+// Returns the announced maximum message size or 0 if the CSM does not announce one
+size_t maxMessageSizeFromCsm(const uint8_t* body, size_t size) {
+  size_t pos = 0;
+  unsigned number = 0;
+  auto extended = [&](unsigned nibble) -> unsigned {
+    if (nibble == 13 && pos < size) return body[pos++] + 13;
+    if (nibble == 14 && pos + 1 < size) { pos += 2; return ((body[pos - 2] << 8) | body[pos - 1]) + 269; }
+    return nibble;
+  };
+
+  while (pos < size && body[pos] != 0xff) {
+    const auto delta = body[pos] >> 4;
+    const auto length = body[pos] & 0x0f;
+    ++pos;
+    number += extended(delta);
+    const auto valueLength = extended(length);
+    if (pos + valueLength > size) break;
+
+    if (number == MAX_MESSAGE_SIZE_OPTION) {
+      size_t value = 0;
+      for (size_t i = 0; i < valueLength; ++i) value = (value << 8) | body[pos + i];
+      return value;
+    }
+    pos += valueLength;
+  }
+  return 0;
+}
+
+}  // namespace
+
+TcpConnection::~TcpConnection() {
+  close();
+}
+
+void TcpConnection::open(uint16_t port) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (epoll_ >= 0) throw std::logic_error("Cannot open already open connection.");
+
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_ < 0) throw std::runtime_error("Creating epoll instance failed.");
+
+  // Dual-stack like the UDP connection, falling back to IPv4 only
+  family_ = AF_INET6;
+  listener_ = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener_ < 0) {
+    family_ = AF_INET;
+    listener_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  }
+
+  int off = 0;
+  int on = 1;
+  sockaddr_storage sa;
+  const auto length = (family_ == AF_INET6 ? Endpoint(in6addr_any, port) : Endpoint(htonl(INADDR_ANY), port))
+                          .toSockaddr(sa, family_);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = listener_;
+
+  if (listener_ < 0
+      || (family_ == AF_INET6 && -1 == ::setsockopt(listener_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)))
+      || -1 == ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+      || -1 == ::bind(listener_, reinterpret_cast<sockaddr*>(&sa), length)
+      || -1 == ::listen(listener_, SOMAXCONN)
+      || -1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, listener_, &event)) {
+    if (listener_ >= 0) ::close(listener_);
+    ::close(epoll_);
+    listener_ = -1;
+    epoll_ = -1;
+    throw std::runtime_error("Listening for TCP connections failed.");
+  }
+}
+
+void TcpConnection::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto& peer : peers_) ::close(peer.second.fd_);
+  peers_.clear();
+  endpoints_.clear();
+  received_.clear();
+
+  if (listener_ >= 0) ::close(listener_);
+  if (epoll_ >= 0) ::close(epoll_);
+  listener_ = -1;
+  epoll_ = -1;
+}
+
+size_t TcpConnection::connections() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peers_.size();
+}
+
+std::vector<uint8_t> TcpConnection::toFrame(const std::vector<uint8_t>& datagram) {
+  if (datagram.size() < 4) throw std::runtime_error("Message too short.");
+  const auto tokenLength = datagram[0] & 0x0f;
+  const size_t bodyOffset = 4 + tokenLength;
+  if (tokenLength > 8 || datagram.size() < bodyOffset) throw std::runtime_error("Invalid token length.");
+
+  return frame(datagram[1], &datagram[4], tokenLength, datagram.data() + bodyOffset, datagram.size() - bodyOffset);
+}
+
+size_t TcpConnection::frameSize(const uint8_t* data, size_t size) {
+  FrameHeader header;
+  if (not parseHeader(data, size, header)) return 0;
+
+  const auto total = header.headerSize + header.bodySize;
+  return (size >= total) ? total : 0;
+}
+
+std::vector<uint8_t> TcpConnection::toDatagram(const uint8_t* frame, size_t size) {
+  FrameHeader header;
+  if (not parseHeader(frame, size, header) || header.headerSize + header.bodySize > size) {
+    throw std::runtime_error("Incomplete frame.");
+  }
+
+  std::vector<uint8_t> datagram;
+  datagram.reserve(4 + header.tokenLength + header.bodySize);
+  datagram.push_back(static_cast<uint8_t>(0x40 | (static_cast<int>(Type::NonConfirmable) << 4) | header.tokenLength));
+  datagram.push_back(frame[header.headerSize - header.tokenLength - 1]);
+  datagram.push_back(0);
+  datagram.push_back(0);
+  datagram.insert(datagram.end(), frame + header.headerSize - header.tokenLength, frame + header.headerSize + header.bodySize);
+  return datagram;
+}
+
+void TcpConnection::send(Telegram&& telegram) {
+  const auto& datagram = telegram.getMessage();
+  if (datagram.size() < 4) throw std::runtime_error("Message too short.");
+
+  const auto type = static_cast<Type>((datagram[0] >> 4) & 0x03);
+  const auto code = datagram[1];
+  const auto messageId = static_cast<uint16_t>((datagram[2] << 8) | datagram[3]);
+  const auto& endpoint = telegram.getEndpoint();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (epoll_ < 0) throw std::logic_error("Cannot send if connection was not opened before.");
+
+  if (code == 0) {
+    // Empty acknowledgements and resets are not needed on a reliable transport
+    if (type != Type::Confirmable) return;
+
+    auto& peer = connect(endpoint);
+    const auto tokenLength = std::min<size_t>(datagram[0] & 0x0f, datagram.size() - 4);
+    peer.pings_.emplace_back(messageId, std::vector<uint8_t>(&datagram[4], &datagram[4] + tokenLength));
+    if (not write(peer, frame(PING, &datagram[4], tokenLength, nullptr, 0))) {
+      disconnect(endpoint);
+      throw std::runtime_error("Sending telegram failed.");
+    }
+    return;
+  }
+
+  auto frame = toFrame(datagram);
+  auto& peer = connect(endpoint);
+
+  // Retransmissions during a pending connect would be delivered twice, as frames carry no message ID
+  if (type == Type::Confirmable && not peer.connected_
+      && std::find(peer.unacknowledged_.begin(), peer.unacknowledged_.end(), messageId) != peer.unacknowledged_.end()) {
+    DLOG << "Ignoring retransmission of message " << messageId << " to " << endpoint << " while connecting\n";
+    return;
+  }
+
+  if (peer.csmReceived_ && frame.size() > peer.maxMessageSize_) {
+    throw std::runtime_error("Message exceeds the maximum message size of the peer.");
+  }
+  if (not write(peer, frame)) {
+    disconnect(endpoint);
+    throw std::runtime_error("Sending telegram failed.");
+  }
+
+  // TCP takes care of the delivery, thus the confirmable message is acknowledged once the connection
+  // is established. Messages of connections that cannot be established are retransmitted by the messaging.
+  if (type == Type::Confirmable) {
+    if (peer.connected_) acknowledge(endpoint, messageId);
+    else peer.unacknowledged_.push_back(messageId);
+  }
+}
+
+Optional<Telegram> TcpConnection::get(std::chrono::milliseconds timeout) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (epoll_ < 0) throw std::logic_error("Cannot receive if connection was not opened before.");
+    if (not received_.empty()) {
+      auto telegram = std::move(received_.front());
+      received_.pop_front();
+      return Optional<Telegram>(std::move(telegram));
+    }
+  }
+
+  epoll_event events[64];
+  auto count = epoll_wait(epoll_, events, 64, timeout.count());
+  if (count < 0) {
+    if (errno == EINTR) return Optional<Telegram>();
+    throw std::runtime_error("Waiting for telegrams failed.");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == listener_) {
+      accept();
+      continue;
+    }
+
+    auto it = endpoints_.find(events[i].data.fd);
+    if (it == endpoints_.end()) continue;
+    const auto endpoint = it->second;
+    auto& peer = peers_[endpoint];
+
+    if (events[i].events & EPOLLOUT) onWritable(endpoint, peer);
+    if (peers_.count(endpoint) && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) onReadable(endpoint, peer);
+  }
+
+  if (received_.empty()) return Optional<Telegram>();
+
+  auto telegram = std::move(received_.front());
+  received_.pop_front();
+  return Optional<Telegram>(std::move(telegram));
+}
+
+TcpConnection::Peer& TcpConnection::connect(const Endpoint& endpoint) {
+  auto it = peers_.find(endpoint);
+  if (it != peers_.end()) return it->second;
+
+  DLOG << "Connecting to " << endpoint << '\n';
+  auto fd = ::socket(family_, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) throw std::runtime_error("Socket creation failed.");
+
+  int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  sockaddr_storage sa;
+  const auto length = endpoint.toSockaddr(sa, family_);
+  if (-1 == ::connect(fd, reinterpret_cast<sockaddr*>(&sa), length) && errno != EINPROGRESS) {
+    ::close(fd);
+    throw std::runtime_error("Connecting to " + endpoint.toString() + " failed.");
+  }
+
+  // Writability signals the end of the connection establishment
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLOUT;
+  event.data.fd = fd;
+  if (-1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event)) {
+    ::close(fd);
+    throw std::runtime_error("Registering TCP connection failed.");
+  }
+
+  auto& peer = peers_[endpoint];
+  peer.fd_ = fd;
+  peer.writing_ = true;
+  endpoints_[fd] = endpoint;
+
+  // Every connection starts with the capabilities and settings message
+  auto hello = csm();
+  peer.out_.insert(peer.out_.end(), hello.begin(), hello.end());
+  return peer;
+}
+
+void TcpConnection::accept() {
+  for (;;) {
+    sockaddr_storage sa;
+    socklen_t length = sizeof(sa);
+    auto fd = ::accept4(listener_, reinterpret_cast<sockaddr*>(&sa), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) WLOG << "Accepting TCP connection failed\n";
+      return;
+    }
+
+    const auto endpoint = Endpoint::fromSockaddr(reinterpret_cast<sockaddr*>(&sa));
+    DLOG << "Accepted connection from " << endpoint << '\n';
+    if (peers_.count(endpoint)) disconnect(endpoint);
+
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (-1 == epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event)) {
+      ::close(fd);
+      continue;
+    }
+
+    auto& peer = peers_[endpoint];
+    peer.fd_ = fd;
+    peer.connected_ = true;
+    endpoints_[fd] = endpoint;
+
+    if (not write(peer, csm())) disconnect(endpoint);
+  }
+}
+
+void TcpConnection::onWritable(const Endpoint& endpoint, Peer& peer) {
+  if (not peer.connected_) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (-1 == ::getsockopt(peer.fd_, SOL_SOCKET, SO_ERROR, &error, &length) || error != 0) {
+      WLOG << "Connecting to " << endpoint << " failed, " << peer.unacknowledged_.size()
+           << " confirmable messages are not acknowledged\n";
+      disconnect(endpoint);
+      return;
+    }
+    peer.connected_ = true;
+
+    for (auto messageId : peer.unacknowledged_) acknowledge(endpoint, messageId);
+    peer.unacknowledged_.clear();
+  }
+
+  if (not flush(peer)) disconnect(endpoint);
+}
+
+void TcpConnection::onReadable(const Endpoint& endpoint, Peer& peer) {
+  uint8_t buffer[65536];
+  for (;;) {
+    auto bytes = ::recv(peer.fd_, buffer, sizeof(buffer), 0);
+    if (bytes <= 0) {
+      if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) disconnect(endpoint);
+      return;
+    }
+
+    // Frames are handled as they arrive, such that at most one incomplete frame is buffered
+    peer.in_.insert(peer.in_.end(), buffer, buffer + bytes);
+    if (not readFrames(endpoint, peer)) {
+      disconnect(endpoint);
+      return;
+    }
+  }
+}
+
+bool TcpConnection::readFrames(const Endpoint& endpoint, Peer& peer) {
+  size_t offset = 0;
+  while (auto size = frameSize(peer.in_.data() + offset, peer.in_.size() - offset)) {
+    if (not onFrame(endpoint, peer, peer.in_.data() + offset, size)) return false;
+    offset += size;
+  }
+  peer.in_.erase(peer.in_.begin(), peer.in_.begin() + offset);
+
+  // The frame header is at most 14 bytes besides the announced message size
+  FrameHeader header;
+  if (parseHeader(peer.in_.data(), peer.in_.size(), header)
+      && header.headerSize + header.bodySize > MAX_MESSAGE_SIZE + 14) {
+    WLOG << "Message from " << endpoint << " exceeds the maximum message size\n";
+    write(peer, frame(ABORT, nullptr, 0, nullptr, 0));
+    return false;
+  }
+  return true;
+}
+
+bool TcpConnection::onFrame(const Endpoint& endpoint, Peer& peer, const uint8_t* data, size_t size) {
+  FrameHeader header;
+  parseHeader(data, size, header);
+  const auto code = data[header.headerSize - header.tokenLength - 1];
+  const auto token = data + header.headerSize - header.tokenLength;
+  const auto body = data + header.headerSize;
+
+  switch (code) {
+    case CSM: {
+      const auto maxMessageSize = maxMessageSizeFromCsm(body, header.bodySize);
+      if (maxMessageSize) peer.maxMessageSize_ = maxMessageSize;
+      peer.csmReceived_ = true;
+
+      // Messages exceeding the default size had to wait for the limit of the peer
+      for (auto& held : peer.held_) {
+        if (held.size() <= peer.maxMessageSize_) peer.out_.insert(peer.out_.end(), held.begin(), held.end());
+        else ELOG << "Dropping message exceeding the maximum message size of " << endpoint << '\n';
+      }
+      peer.held_.clear();
+      return flush(peer);
+    }
+
+    case PING:
+      return write(peer, frame(PONG, token, header.tokenLength, nullptr, 0));
+
+    case PONG: {
+      if (peer.pings_.empty()) return true;
+      const auto messageId = peer.pings_.front().first;
+      const auto& pingToken = peer.pings_.front().second;
+
+      // Ping responses are resets in the datagram format
+      std::vector<uint8_t> datagram{static_cast<uint8_t>(0x40 | (static_cast<int>(Type::Reset) << 4) | pingToken.size()),
+                                    0x00, static_cast<uint8_t>(messageId >> 8), static_cast<uint8_t>(messageId & 0xff)};
+      datagram.insert(datagram.end(), pingToken.begin(), pingToken.end());
+      received_.emplace_back(endpoint, std::move(datagram));
+      peer.pings_.pop_front();
+      return true;
+    }
+
+    case RELEASE:
+    case ABORT:
+      DLOG << "Connection to " << endpoint << " released by peer\n";
+      return false;
+
+    default:
+      if (code >= 0xe0) {
+        DLOG << "Ignoring signaling message with code " << static_cast<int>(code) << '\n';
+        return true;
+      }
+      received_.emplace_back(endpoint, toDatagram(data, size));
+      return true;
+  }
+}
+
+bool TcpConnection::write(Peer& peer, const std::vector<uint8_t>& frame) {
+  // Until the peer announced its limit only messages of the default size may be sent,
+  // the order of the messages is kept
+  if (not peer.held_.empty() || (not peer.csmReceived_ && frame.size() > DEFAULT_MAX_MESSAGE_SIZE)) {
+    peer.held_.push_back(frame);
+    return true;
+  }
+
+  peer.out_.insert(peer.out_.end(), frame.begin(), frame.end());
+  return not peer.connected_ || flush(peer);
+}
+
+void TcpConnection::acknowledge(const Endpoint& endpoint, uint16_t messageId) {
+  received_.emplace_back(endpoint, std::vector<uint8_t>{0x60, 0x00, static_cast<uint8_t>(messageId >> 8),
+                                                        static_cast<uint8_t>(messageId & 0xff)});
+}
+
+bool TcpConnection::flush(Peer& peer) {
+  while (peer.outOffset_ < peer.out_.size()) {
+    auto bytes = ::send(peer.fd_, peer.out_.data() + peer.outOffset_, peer.out_.size() - peer.outOffset_, MSG_NOSIGNAL);
+    if (bytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+
+      // Continue when the socket becomes writable again
+      if (not peer.writing_) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.fd = peer.fd_;
+        epoll_ctl(epoll_, EPOLL_CTL_MOD, peer.fd_, &event);
+        peer.writing_ = true;
+      }
+      return true;
+    }
+    peer.outOffset_ += bytes;
+  }
+
+  peer.out_.clear();
+  peer.outOffset_ = 0;
+  if (peer.writing_) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = peer.fd_;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, peer.fd_, &event);
+    peer.writing_ = false;
+  }
+  return true;
+}
+
+void TcpConnection::disconnect(const Endpoint& endpoint) {
+  auto it = peers_.find(endpoint);
+  if (it == peers_.end()) return;
+
+  DLOG << "Closing connection to " << endpoint << '\n';
+  epoll_ctl(epoll_, EPOLL_CTL_DEL, it->second.fd_, nullptr);
+  ::close(it->second.fd_);
+  endpoints_.erase(it->second.fd_);
+  peers_.erase(it);
+}
+
+}  // namespace CoAP
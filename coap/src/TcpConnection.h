@@ -0,0 +1,140 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __TcpConnection_h
+#define __TcpConnection_h
+
+#include "IConnection.h"
+#include "Message.h"
+#include "Telegram.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace CoAP {
+
+/**
+ * Reliable transport of CoAP messages over TCP according to RFC 8323.
+ *
+ * The connection listens for incoming TCP connections and establishes outgoing
+ * ones on demand, one per endpoint. All of them are served by one epoll instance,
+ * such that many persistent connections share the thread calling get().
+ *
+ * Towards Messaging the connection behaves like the UDP connection: Messages are
+ * converted between the datagram format and the length prefixed stream format.
+ * As TCP is reliable, confirmable messages are acknowledged by the connection
+ * itself as soon as they are handed over to an established connection, empty
+ * acknowledgements and resets are not transmitted and received messages are
+ * delivered as nonconfirmable ones. Confirmable messages to peers that cannot be
+ * connected are not acknowledged, thus they are retransmitted by the messaging
+ * until the exchange fails like with lost datagrams.
+ * Pings are mapped to the signaling messages Ping and Pong.
+ */
+class TcpConnection : public IConnection {
+ public:
+  // Message size that may be sent before the peer announced its limit in its CSM
+  static constexpr size_t DEFAULT_MAX_MESSAGE_SIZE{1152};
+
+  // Message size announced to the peers
+  static constexpr size_t MAX_MESSAGE_SIZE{8 * 1024 * 1024};
+
+  TcpConnection() = default;
+
+  virtual ~TcpConnection();
+
+  TcpConnection(const TcpConnection&) = delete;
+  TcpConnection& operator=(const TcpConnection&) = delete;
+
+  /**
+   * Listens for incoming connections on the given port.
+   *
+   * @param port  Number of the port to listen on, 0 for an ephemeral port of a client
+   *
+   * @throws  std::logic_error    when open was already called before
+   * @throws  std::runtime_error  when the connection could not be opened
+   */
+  void open(uint16_t port);
+
+  /**
+   * Closes all connections and resets the internal state of this object.
+   */
+  void close();
+
+  void send(Telegram&& telegram) override;
+
+  Optional<Telegram> get(std::chrono::milliseconds timeout) override;
+
+  /// Returns the number of established or pending TCP connections
+  size_t connections() const;
+
+  /**
+   * Converts a message in datagram format into the stream format of RFC 8323.
+   */
+  static std::vector<uint8_t> toFrame(const std::vector<uint8_t>& datagram);
+
+  /**
+   * Returns the size of the first frame in the buffer or 0 if it is not complete yet.
+   */
+  static size_t frameSize(const uint8_t* data, size_t size);
+
+  /**
+   * Converts a frame in the stream format into a nonconfirmable message in datagram format.
+   */
+  static std::vector<uint8_t> toDatagram(const uint8_t* frame, size_t size);
+
+ private:
+  struct Peer {
+    int fd_{-1};
+    bool connected_{false};
+    std::vector<uint8_t> in_;
+    std::vector<uint8_t> out_;
+    size_t outOffset_{0};
+    // EPOLLOUT is registered while output is pending
+    bool writing_{false};
+    bool csmReceived_{false};
+    size_t maxMessageSize_{DEFAULT_MAX_MESSAGE_SIZE};
+    // frames exceeding the default message size, waiting for the CSM of the peer
+    std::vector<std::vector<uint8_t>> held_;
+    // message ID and token of the pings waiting for their pong
+    std::deque<std::pair<uint16_t, std::vector<uint8_t>>> pings_;
+    // message IDs of confirmable messages, acknowledged once the connection is established
+    std::vector<uint16_t> unacknowledged_;
+  };
+
+  Peer& connect(const Endpoint& endpoint);
+  void accept();
+  void onReadable(const Endpoint& endpoint, Peer& peer);
+  void onWritable(const Endpoint& endpoint, Peer& peer);
+  // Handles the complete frames of the input, returns false if the connection is to be closed
+  bool readFrames(const Endpoint& endpoint, Peer& peer);
+  // Returns false if the connection is to be closed
+  bool onFrame(const Endpoint& endpoint, Peer& peer, const uint8_t* frame, size_t size);
+  // Returns false if the connection failed
+  bool write(Peer& peer, const std::vector<uint8_t>& frame);
+  // Hands the acknowledgement of the confirmable message over to the messaging
+  void acknowledge(const Endpoint& endpoint, uint16_t messageId);
+  // Returns false if the connection failed
+  bool flush(Peer& peer);
+  void disconnect(const Endpoint& endpoint);
+
+  int family_{AF_INET6};
+  int listener_{-1};
+  int epoll_{-1};
+
+  // Protection of the peers and received telegrams, as send() and get() may be called by different threads
+  mutable std::mutex mutex_;
+
+  std::unordered_map<Endpoint, Peer> peers_;
+  std::unordered_map<int, Endpoint> endpoints_;
+
+  std::deque<Telegram> received_;
+};
+
+}  // namespace CoAP
+
+#endif  // __TcpConnection_h
@@ -7,7 +7,8 @@
 #ifndef __Telegram_h
 #define __Telegram_h
 
-#include <netinet/in.h>
+#include "Endpoint.h"
+
 #include <vector>
 
 namespace CoAP {
@@ -16,30 +17,54 @@ namespace CoAP {
  * Representation of UDP telegram with address (ip and port) and payload
  */
 class Telegram {
-  in_addr_t ip_ = 0;
-  uint16_t port_ = 0;
+  Endpoint endpoint_;
   std::vector<uint8_t> message_;
+  bool multicast_ = false;
+  int64_t timestamp_ = 0;
 
  public:
   Telegram() = default;
 
+  Telegram(const Endpoint& endpoint, std::vector<uint8_t> message, bool multicast = false)
+    : endpoint_(endpoint)
+    , message_(std::forward<std::vector<uint8_t>>(message))
+    , multicast_(multicast) { }
+
   Telegram(in_addr_t ip, uint16_t port, std::vector<uint8_t> message)
-    : ip_(ip)
-    , port_(port)
-    , message_(std::forward<std::vector<uint8_t>>(message)) { }
+    : Telegram(Endpoint(ip, port), std::forward<std::vector<uint8_t>>(message)) { }
 
 
+  const Endpoint& getEndpoint() const {
+    return endpoint_;
+  }
+
   in_addr_t getIP() const {
-    return ip_;
+    return endpoint_.ipv4();
   }
 
   uint16_t getPort() const {
-    return port_;
+    return endpoint_.port();
   }
 
-  std::vector<uint8_t> getMessage() const {
+  const std::vector<uint8_t>& getMessage() const {
     return message_;
   }
+
+  /// Returns true if the telegram was received via a multicast group
+  bool isMulticast() const {
+    return multicast_;
+  }
+
+  /// Sets the time in nanoseconds of the realtime clock at which the kernel received the telegram
+  Telegram& withTimestamp(int64_t timestamp) {
+    timestamp_ = timestamp;
+    return *this;
+  }
+
+  /// Returns the receive time set with withTimestamp(), 0 if unknown
+  int64_t timestamp() const {
+    return timestamp_;
+  }
 };
 
 }  // namespace CoAP
@@ -0,0 +1,106 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Tracing.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace CoAP {
+
+namespace {
+
+uint32_t threadId() {
+  thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  return tid;
+}
+
+}  // namespace
+
+// The sequence number tells readers whether a span is complete: odd while it is written,
+// otherwise twice the index of the span plus two. Fields are atomics, as a writer that
+// wrapped around the ring may overwrite a span while it is exported.
+struct Tracer::Span {
+  std::atomic<uint64_t> sequence{0};
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> id{0};
+  std::atomic<int64_t> begin{0};
+  std::atomic<int64_t> end{0};
+  std::atomic<uint32_t> thread{0};
+};
+
+Tracer::Tracer(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+  mask_ = size - 1;
+  spans_.reset(new Span[size]);
+}
+
+Tracer::~Tracer() = default;
+
+Tracer& Tracer::global() {
+  static Tracer tracer;
+  return tracer;
+}
+
+int64_t Tracer::now() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Tracer::record(const char* name, uint64_t id, int64_t begin, int64_t end) {
+  const auto index = next_.fetch_add(1, std::memory_order_relaxed);
+  auto& span = spans_[index & mask_];
+
+  span.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  span.name.store(name, std::memory_order_relaxed);
+  span.id.store(id, std::memory_order_relaxed);
+  span.begin.store(begin, std::memory_order_relaxed);
+  span.end.store(end, std::memory_order_relaxed);
+  span.thread.store(threadId(), std::memory_order_relaxed);
+  span.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void Tracer::exportChromeTrace(std::ostream& os) const {
+  const auto pid = getpid();
+  const auto last = next_.load(std::memory_order_acquire);
+  const auto first = last > mask_ ? last - mask_ - 1 : 0;
+
+  os << "{\"traceEvents\":[";
+  bool separator = false;
+  for (auto index = first; index < last; ++index) {
+    const auto& span = spans_[index & mask_];
+    if (span.sequence.load(std::memory_order_acquire) != 2 * index + 2) continue;
+    const auto name = span.name.load(std::memory_order_relaxed);
+    const auto id = span.id.load(std::memory_order_relaxed);
+    const auto begin = span.begin.load(std::memory_order_relaxed);
+    const auto end = std::max(begin, span.end.load(std::memory_order_relaxed));
+    const auto thread = span.thread.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Overwritten while reading
+    if (span.sequence.load(std::memory_order_relaxed) != 2 * index + 2) continue;
+
+    if (separator) os << ',';
+    separator = true;
+    // Timestamps and durations are given in microseconds
+    os << "\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << thread
+       << ",\"ts\":" << begin / 1000 << '.' << std::setw(3) << std::setfill('0') << begin % 1000
+       << ",\"dur\":" << (end - begin) / 1000 << '.' << std::setw(3) << std::setfill('0') << (end - begin) % 1000
+       << ",\"args\":{\"msgID\":" << id << "}}";
+  }
+  os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Tracer::clear() {
+  // Spans with an index below the new start are no longer exported
+  next_.fetch_add(mask_ + 1, std::memory_order_acq_rel);
+}
+
+}  // namespace CoAP
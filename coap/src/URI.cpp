@@ -8,7 +8,6 @@
 
 Optional<URI> URI::fromString(const std::string& uri) {
   const auto firstColon = uri.find_first_of(':');
-  const auto secondColon = uri.find_first_of(':', firstColon + 1);
 
   const auto firstSlash = uri.find_first_of('/');
   const auto secondSlash = uri.find_first_of('/', firstSlash + 1);
@@ -27,13 +26,27 @@ Optional<URI> URI::fromString(const std::string& uri) {
 
   URI uriObject;
   uriObject.protocol_ = uri.substr(0, firstColon);
-  uriObject.server_ = uri.substr(secondSlash + 1, std::min(secondColon, thirdSlash) - secondSlash - 1);
-  if (secondColon < thirdSlash) {
-    const auto portString = uri.substr(secondColon + 1, thirdSlash - secondColon - 1);
+
+  // IPv6 addresses are enclosed in brackets, as they contain colons themselves
+  auto authority = uri.substr(secondSlash + 1, thirdSlash - secondSlash - 1);
+  auto portColon = authority.find_first_of(':');
+  if (not authority.empty() && authority[0] == '[') {
+    const auto closingBracket = authority.find_first_of(']');
+    if (closingBracket == std::string::npos) return Optional<URI>();
+    uriObject.server_ = authority.substr(1, closingBracket - 1);
+    portColon = authority.find_first_of(':', closingBracket);
+    if (portColon != std::string::npos && portColon != closingBracket + 1) return Optional<URI>();
+  } else {
+    uriObject.server_ = authority.substr(0, portColon);
+  }
+
+  if (portColon != std::string::npos) {
+    const auto portString = authority.substr(portColon + 1);
     uriObject.port_ = std::stoul(portString);
   } else {
     if (uriObject.protocol_ == "coap") uriObject.port_ = 5683;
     if (uriObject.protocol_ == "coaps") uriObject.port_ = 20220;
+    if (uriObject.protocol_ == "coap+tcp") uriObject.port_ = 5683;
   }
   uriObject.path_ = uri.substr(thirdSlash);
 
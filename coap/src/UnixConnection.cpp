@@ -0,0 +1,272 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "UnixConnection.h"
+
+#include "Logging.h"
+
+#include <cstddef>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SETLOGLEVEL(LLWARNING)
+
+namespace CoAP {
+
+constexpr int UnixConnection::batchSize_;
+constexpr int UnixConnection::bufferSize_;
+
+namespace {
+
+// fd75:6e69:7800::/48, the ASCII characters "unix" in the unique local address range
+const uint8_t PREFIX[] = {0xfd, 0x75, 0x6e, 0x69, 0x78, 0x00};
+
+uint64_t fnv1a(const std::string& data, uint64_t hash) {
+  for (auto c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+socklen_t toSockaddr(const std::string& path, sockaddr_un& address) {
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  // Abstract names are not terminated, paths in the file system are
+  const bool abstract = not path.empty() && path[0] == '@';
+  if (path.empty() || path.size() + (abstract ? 0 : 1) > sizeof(address.sun_path)) {
+    throw std::runtime_error("Invalid socket path \"" + path + "\".");
+  }
+
+  memcpy(address.sun_path, path.data(), path.size());
+  if (abstract) address.sun_path[0] = '\0';
+  return offsetof(sockaddr_un, sun_path) + path.size() + (abstract ? 0 : 1);
+}
+
+std::string fromSockaddr(const sockaddr_un& address, socklen_t length) {
+  const auto offset = offsetof(sockaddr_un, sun_path);
+  if (length <= offset) return "";  // unbound socket
+
+  const auto size = length - offset;
+  if (address.sun_path[0] == '\0') return "@" + std::string(address.sun_path + 1, size - 1);
+  return std::string(address.sun_path, strnlen(address.sun_path, size));
+}
+
+}  // namespace
+
+UnixConnection::~UnixConnection() {
+  close();
+}
+
+Endpoint UnixConnection::endpointFor(const std::string& path) {
+  in6_addr address;
+  memcpy(address.s6_addr, PREFIX, sizeof(PREFIX));
+
+  // Two hashes with different offset bases fill the remaining 80 bits
+  const auto high = fnv1a(path, 0xcbf29ce484222325);
+  const auto low = fnv1a(path, 0x84222325cbf29ce4);
+  memcpy(address.s6_addr + sizeof(PREFIX), &high, 8);
+  memcpy(address.s6_addr + sizeof(PREFIX) + 8, &low, 2);
+
+  return Endpoint(address, 0);
+}
+
+void UnixConnection::open(const std::string& path) {
+  if (socket_ != 0) throw std::logic_error("Cannot open already open connection.");
+
+  socket_ = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socket_ <= 0) {
+    socket_ = 0;
+    throw std::runtime_error("Socket creation failed.");
+  }
+
+  sockaddr_un address;
+  socklen_t length = sizeof(sa_family_t);
+  if (path.empty()) {
+    // Binding only the address family lets the kernel choose an abstract name
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+  } else {
+    try {
+      length = CoAP::toSockaddr(path, address);
+    } catch (std::runtime_error&) {
+      close();
+      throw;
+    }
+
+    struct stat status;
+    if (path[0] != '@' && 0 == lstat(path.c_str(), &status) && S_ISSOCK(status.st_mode)) {
+      ::unlink(path.c_str());
+    }
+  }
+
+  if (-1 == ::bind(socket_, reinterpret_cast<sockaddr*>(&address), length)) {
+    close();
+    throw std::runtime_error("bind failed.");
+  }
+  unlink_ = not path.empty() && path[0] != '@';
+
+  length = sizeof(address);
+  if (-1 == getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length)) {
+    close();
+    throw std::runtime_error("Querying socket name failed.");
+  }
+  path_ = fromSockaddr(address, length);
+  buffer_.resize(batchSize_ * bufferSize_);
+}
+
+void UnixConnection::close() {
+  if (socket_ != 0) ::close(socket_);
+  if (unlink_) ::unlink(path_.c_str());
+
+  socket_ = 0;
+  path_.clear();
+  unlink_ = false;
+  received_.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  paths_.clear();
+}
+
+Endpoint UnixConnection::endpoint(const std::string& path) {
+  const auto endpoint = endpointFor(path);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  paths_[endpoint] = path;
+  return endpoint;
+}
+
+Optional<Endpoint> UnixConnection::endpointOf(const std::string& server) {
+  if (server.empty() || (server[0] != '/' && server[0] != '@')) return Optional<Endpoint>();
+  return Optional<Endpoint>(endpoint(server));
+}
+
+Optional<std::string> UnixConnection::path(const Endpoint& endpoint) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = paths_.find(endpoint);
+  if (it == paths_.end()) return Optional<std::string>();
+  return Optional<std::string>(it->second);
+}
+
+socklen_t UnixConnection::toSockaddr(const Endpoint& endpoint, sockaddr_un& address) const {
+  auto path = this->path(endpoint);
+  if (not path) throw std::runtime_error(endpoint.toString() + " is not reachable via Unix domain socket.");
+  return CoAP::toSockaddr(path.value(), address);
+}
+
+void UnixConnection::send(Telegram&& telegram) {
+  if (socket_ == 0) throw std::logic_error("Cannot send if connection was not opened before.");
+
+  sockaddr_un address;
+  const auto length = toSockaddr(telegram.getEndpoint(), address);
+
+  const auto& msg = telegram.getMessage();
+  auto bytes_sent = sendto(socket_, msg.data(), msg.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&address), length);
+  if (bytes_sent < 0 && not dropped(telegram.getEndpoint())) throw std::runtime_error("Sending telegram failed.");
+}
+
+void UnixConnection::sendBatch(std::vector<Telegram>&& telegrams) {
+  if (socket_ == 0) throw std::logic_error("Cannot send if connection was not opened before.");
+
+  std::vector<sockaddr_un> addresses(telegrams.size());
+  std::vector<iovec> iovecs(telegrams.size());
+  std::vector<mmsghdr> headers(telegrams.size());
+
+  for (size_t i = 0; i < telegrams.size(); ++i) {
+    const auto length = toSockaddr(telegrams[i].getEndpoint(), addresses[i]);
+
+    const auto& msg = telegrams[i].getMessage();
+    iovecs[i].iov_base = const_cast<uint8_t*>(msg.data());
+    iovecs[i].iov_len = msg.size();
+
+    auto& hdr = headers[i].msg_hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_name = &addresses[i];
+    hdr.msg_namelen = length;
+    hdr.msg_iov = &iovecs[i];
+    hdr.msg_iovlen = 1;
+  }
+
+  // sendmmsg may send fewer telegrams than requested, thus continue with the remaining ones
+  size_t sent = 0;
+  while (sent < headers.size()) {
+    auto count = sendmmsg(socket_, &headers[sent], headers.size() - sent, MSG_DONTWAIT);
+    if (count < 0) {
+      if (not dropped(telegrams[sent].getEndpoint())) throw std::runtime_error("Sending telegrams failed.");
+      count = 1;
+    }
+    sent += count;
+  }
+}
+
+bool UnixConnection::dropped(const Endpoint& endpoint) {
+  // Like with UDP, telegrams to a full or vanished socket are lost instead of blocking the sender
+  const auto error = errno;
+  if (error != EAGAIN && error != ECONNREFUSED && error != ENOENT) return false;
+
+  ++dropped_;
+  DLOG << "Dropping telegram, " << path(endpoint).value() << " is " << (error == EAGAIN ? "full" : "gone") << '\n';
+  return true;
+}
+
+Optional<Telegram> UnixConnection::get(std::chrono::milliseconds timeout) {
+  if (socket_ == 0) throw std::logic_error("Cannot receive if connection was not opened before.");
+
+  if (received_.empty()) {
+    pollfd fd;
+    fd.fd = socket_;
+    fd.events = POLLIN;
+    const auto result = poll(&fd, 1, timeout.count());
+    if (result < 0 && errno != EINTR) throw std::runtime_error("Waiting for telegrams failed.");
+    if (result > 0) receive();
+  }
+
+  if (received_.empty()) return Optional<Telegram>();
+
+  Telegram telegram(std::move(received_.front()));
+  received_.pop_front();
+  return Optional<Telegram>(std::move(telegram));
+}
+
+void UnixConnection::receive() {
+  sockaddr_un addresses[batchSize_];
+  iovec iovecs[batchSize_];
+  mmsghdr headers[batchSize_];
+
+  for (int i = 0; i < batchSize_; ++i) {
+    iovecs[i].iov_base = buffer_.data() + i * bufferSize_;
+    iovecs[i].iov_len = bufferSize_;
+
+    auto& hdr = headers[i].msg_hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_name = &addresses[i];
+    hdr.msg_namelen = sizeof(addresses[i]);
+    hdr.msg_iov = &iovecs[i];
+    hdr.msg_iovlen = 1;
+  }
+
+  auto count = recvmmsg(socket_, headers, batchSize_, MSG_DONTWAIT, nullptr);
+  if (count < 0) {
+    if (errno == EAGAIN || errno == EINTR) return;
+    throw std::runtime_error("Receiving telegrams failed.");
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const auto path = fromSockaddr(addresses[i], headers[i].msg_hdr.msg_namelen);
+    if (path.empty()) {
+      DLOG << "Dropping telegram from unbound socket\n";
+      continue;
+    }
+
+    auto data = static_cast<uint8_t*>(iovecs[i].iov_base);
+    received_.emplace_back(endpoint(path), std::vector<uint8_t>(data, data + headers[i].msg_len));
+  }
+}
+
+}  // namespace CoAP
@@ -0,0 +1,141 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __UnixConnection_h
+#define __UnixConnection_h
+
+#include "IConnection.h"
+#include "Telegram.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct sockaddr_un;
+
+namespace CoAP {
+
+/**
+ * Transport between processes on the same host through Unix domain datagram sockets.
+ *
+ * Compared to UDP over the loopback interface the telegrams bypass the IP stack and
+ * access is controlled with the file system permissions of the socket. A leading '@'
+ * denotes a path in the abstract namespace of Linux, which is not visible in the
+ * file system and vanishes with the socket.
+ *
+ * Socket paths are mapped to endpoints in the unique local IPv6 range fd75:6e69:7800::/48
+ * ("unix") with port 0, such that Messaging and its clients work unchanged. Telegrams
+ * can only be sent to endpoints whose path is known, either registered with endpoint()
+ * or learned from a received telegram. Like UDP, telegrams are dropped instead of blocking
+ * the sender if the socket of the peer is full or no longer exists.
+ */
+class UnixConnection : public IConnection {
+ public:
+  UnixConnection() = default;
+
+  virtual ~UnixConnection();
+
+  UnixConnection(const UnixConnection&) = delete;
+  UnixConnection& operator=(const UnixConnection&) = delete;
+
+  /**
+   * Returns the endpoint the path is mapped to.
+   */
+  static Endpoint endpointFor(const std::string& path);
+
+  /**
+   * Opens a socket bound to the given path.
+   *
+   * A stale socket left behind at the path by a terminated process is replaced,
+   * other files are not touched.
+   *
+   * @param path  File system path or abstract name starting with '@',
+   *              an empty path binds to a unique abstract name chosen by the kernel
+   *
+   * @throws  std::logic_error    when open was already called before
+   * @throws  std::runtime_error  when the socket could not be opened
+   */
+  void open(const std::string& path = "");
+
+  /**
+   * Closes the socket, removes its file and resets the internal state of this object.
+   */
+  void close();
+
+  /// Returns the path the socket is bound to
+  const std::string& path() const { return path_; }
+
+  /**
+   * Registers the path of a peer.
+   *
+   * @returns  The endpoint for sending telegrams to the peer
+   */
+  Endpoint endpoint(const std::string& path);
+
+  /**
+   * Registers absolute paths and abstract names as peers, see endpoint().
+   */
+  Optional<Endpoint> endpointOf(const std::string& server) override;
+
+  /**
+   * Returns the path of a registered or learned endpoint.
+   */
+  Optional<std::string> path(const Endpoint& endpoint) const;
+
+  /// Returns the number of telegrams dropped because the socket of the peer was full or gone
+  size_t dropped() const { return dropped_; }
+
+  /**
+   * @throws  std::runtime_error  when the path of the endpoint is unknown
+   */
+  void send(Telegram&& telegram) override;
+
+  /**
+   * Sends the telegrams with a single system call.
+   *
+   * @throws  std::runtime_error  when the path of an endpoint is unknown
+   */
+  void sendBatch(std::vector<Telegram>&& telegrams) override;
+
+  /**
+   * Receives the next telegram, all telegrams waiting at the socket are read at once
+   * and returned by the following calls.
+   */
+  Optional<Telegram> get(std::chrono::milliseconds timeout) override;
+
+ private:
+  // Fills the socket address for the path of the endpoint
+  socklen_t toSockaddr(const Endpoint& endpoint, sockaddr_un& address) const;
+
+  // Counts the telegram as dropped if sending failed for a transient reason given in errno
+  bool dropped(const Endpoint& endpoint);
+
+  // Reads the waiting telegrams into the queue of received telegrams
+  void receive();
+
+  int socket_{0};
+  std::string path_;
+  // Whether the path has to be removed from the file system on close
+  bool unlink_{false};
+
+  static constexpr int batchSize_{16};
+  static constexpr int bufferSize_{2048};
+  std::vector<uint8_t> buffer_;
+  std::deque<Telegram> received_;
+
+  // Protection of the paths, as send() and get() may be called by different threads
+  mutable std::mutex mutex_;
+  std::unordered_map<Endpoint, std::string> paths_;
+
+  std::atomic<size_t> dropped_{0};
+};
+
+}  // namespace CoAP
+
+#endif  // __UnixConnection_h
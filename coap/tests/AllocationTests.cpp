@@ -0,0 +1,120 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "Allocations.h"
+#include "LoopbackConnection.h"
+
+#include "Messaging.h"
+#include "RequestHandlers.h"
+#include "ServerImpl.h"
+
+#include <arpa/inet.h>
+
+// Upper bounds for the heap allocations of the steady-state request path.
+// Lower them whenever an optimization reduces the allocations, such that
+// the gain cannot get lost unnoticed.
+
+namespace {
+
+const auto serverEndpoint = CoAP::Endpoint(inet_addr("127.0.0.1"), 5683);
+
+// Path and payload exceed the small string optimization like most real ones
+const auto path = std::string("sensors/temperature");
+const auto payload = std::string("21.5 degrees celsius");
+
+void addTemperatureHandler(CoAP::Messaging& messaging) {
+  messaging.requestHandler().onUri(path).onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload(payload);
+  });
+}
+
+}  // namespace
+
+TEST(Allocations, MessagingOnMessageOfGet) {
+  // GIVEN a server that already handled a request
+  auto connection = std::make_shared<LoopbackConnection>();
+  CoAP::Messaging messaging(connection);
+  addTemperatureHandler(messaging);
+  const auto request = CoAP::Message(CoAP::Type::NonConfirmable, 1, CoAP::Code::GET, 0x42, path);
+  messaging.onMessage(request, serverEndpoint);
+  connection->clear();
+
+  // WHEN a GET request is received and answered
+  const auto perCall = allocationsPerCall([&]() {
+    messaging.onMessage(request, serverEndpoint);
+    connection->clear();
+  });
+
+  // THEN the allocations stay within the bound
+  EXPECT_LE(perCall, 8);
+}
+
+TEST(Allocations, ServerImplReply) {
+  // GIVEN a server that already handled a request
+  auto connection = std::make_shared<LoopbackConnection>();
+  CoAP::Messaging messaging(connection);
+  addTemperatureHandler(messaging);
+  auto& server = messaging.getServer();
+  const auto request = CoAP::Message(CoAP::Type::NonConfirmable, 1, CoAP::Code::GET, 0x42, path);
+  server.onMessage(request, serverEndpoint);
+  connection->clear();
+
+  // WHEN the reply is sent, i.e. the request is handled without the handler being called
+  const auto handling = allocationsPerCall([&]() {
+    server.onMessage(request, serverEndpoint);
+    connection->clear();
+  });
+  const auto perCall = handling - allocationsPerCall([&]() { server.onRequest(request, serverEndpoint); });
+
+  // THEN the allocations stay within the bound
+  EXPECT_LE(perCall, 4);
+}
+
+TEST(Allocations, ClientImplOnMessage) {
+  // GIVEN a client with a request in flight
+  auto connection = std::make_shared<LoopbackConnection>();
+  CoAP::Messaging messaging(connection);
+  auto client = messaging.getClientFor("127.0.0.1");
+
+  size_t total = 0;
+  const unsigned calls = 100;
+  for (unsigned i = 0; i < calls; ++i) {
+    auto response = client.GET(path);
+    auto telegram = connection->get(std::chrono::milliseconds(0));
+    ASSERT_TRUE(telegram);
+    const auto request = CoAP::Message::fromBuffer(telegram.value().getMessage());
+    const auto reply = CoAP::Message(CoAP::Type::NonConfirmable, request.messageId(), CoAP::Code::Content,
+                                     request.token(), "", payload);
+
+    // WHEN the response is received
+    total += allocationsOf([&]() { messaging.onMessage(reply, telegram.value().getEndpoint()); });
+    ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  }
+
+  // THEN the allocations stay within the bound
+  const auto perCall = static_cast<double>(total) / calls;
+  EXPECT_LE(perCall, 2);
+}
+
+TEST(Allocations, GetRoundTrip) {
+  // GIVEN a messaging that is client and server and already handled a request
+  CoAP::Messaging messaging(std::make_shared<LoopbackConnection>());
+  addTemperatureHandler(messaging);
+  auto client = messaging.getClientFor("127.0.0.1");
+
+  auto roundTrip = [&]() {
+    auto response = client.GET(path);
+    while (response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) messaging.loopOnce();
+    return response.get();
+  };
+  ASSERT_EQ(payload, roundTrip().payload());
+
+  // WHEN a GET request is sent, received, answered and the response is received
+  const auto perCall = allocationsPerCall(roundTrip);
+
+  // THEN the allocations stay within the bound
+  EXPECT_LE(perCall, 40);
+}
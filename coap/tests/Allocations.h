@@ -0,0 +1,30 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __Allocations_h
+#define __Allocations_h
+
+#include <cstddef>
+
+// Number of heap allocations of the testsuite so far, counted by the replaced global operator new
+// of coap/allocations
+size_t allocations();
+
+// Returns the number of heap allocations of one call of the function
+template <typename F>
+size_t allocationsOf(F function) {
+  const auto before = allocations();
+  function();
+  return allocations() - before;
+}
+
+// Returns the average number of heap allocations of one call of the function
+template <typename F>
+double allocationsPerCall(F function, unsigned calls = 100) {
+  const auto before = allocations();
+  for (unsigned i = 0; i < calls; ++i) function();
+  return static_cast<double>(allocations() - before) / calls;
+}
+
+#endif  // __Allocations_h
@@ -0,0 +1,86 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ConnectionMock.h"
+#include "Messaging.h"
+
+#include "gtest/gtest.h"
+
+class BatchClientTest: public testing::Test {
+ public:
+  BatchClientTest()
+      : conn(new ConnectionMock()),
+        time_(std::chrono::steady_clock::now()),
+        messaging(conn, [this]() { return this->time_; }) {
+  }
+
+ protected:
+  void loopUntil(std::function<bool()> pre) {
+    while (!pre())
+      messaging.loopOnce();
+  }
+
+  std::shared_ptr<ConnectionMock> conn;
+  std::chrono::time_point<std::chrono::steady_clock> time_;
+  CoAP::Messaging messaging;
+
+  const std::vector<CoAP::BatchClient::Target> targets{
+      {htonl(0x0a000001), 5683}, {htonl(0x0a000002), 5683}, {htonl(0x0a000003), 5684}};
+};
+
+TEST_F(BatchClientTest, SameRequestSentToAllTargets) {
+  // GIVEN a batch client
+  auto client = messaging.getBatchClient();
+
+  // WHEN a request is sent to three targets
+  auto results = client.PUT(targets, "/xyz?a=b", "abc");
+
+  // THEN every target receives the request with its own message ID and token
+  ASSERT_EQ(3U, conn->sentMessages_.size());
+  for (auto& msg : conn->sentMessages_) {
+    EXPECT_EQ(CoAP::Type::NonConfirmable, msg.type());
+    EXPECT_EQ(CoAP::Code::PUT, msg.code());
+    EXPECT_EQ("/xyz", msg.path());
+    ASSERT_EQ(1U, msg.queries().size());
+    EXPECT_EQ("a=b", msg.queries()[0]);
+    EXPECT_EQ("abc", msg.payload());
+  }
+  EXPECT_NE(conn->sentMessages_[0].messageId(), conn->sentMessages_[1].messageId());
+  EXPECT_NE(conn->sentMessages_[1].messageId(), conn->sentMessages_[2].messageId());
+  EXPECT_NE(conn->sentMessages_[0].token(), conn->sentMessages_[1].token());
+  EXPECT_NE(conn->sentMessages_[1].token(), conn->sentMessages_[2].token());
+}
+
+TEST_F(BatchClientTest, ResultsAndTimeoutsReportedPerTarget) {
+  // GIVEN a batch request sent to three targets
+  auto client = messaging.getBatchClient();
+  auto results = client.GET(targets, "/xyz", std::chrono::seconds(5));
+  std::vector<CoAP::RestResponse> responses;
+  bool closed = false;
+  results->subscribe([&responses](const CoAP::RestResponse& response){ responses.push_back(response); },
+                     [&closed](){ closed = true; });
+  ASSERT_EQ(3U, conn->sentMessages_.size());
+
+  // WHEN two targets respond (one of them twice)
+  for (auto i : {0, 2, 2}) {
+    auto& sent = conn->sentMessages_[i];
+    conn->addMessageToReceive(CoAP::Message(CoAP::Type::NonConfirmable, sent.messageId(), CoAP::Code::Content, sent.token(), "", "abc"));
+  }
+  loopUntil([&responses](){ return responses.size() >= 2; });
+  messaging.loopOnce();
+
+  // THEN their responses are reported once
+  ASSERT_EQ(2U, responses.size());
+  EXPECT_EQ(CoAP::Code::Content, responses[0].code());
+  EXPECT_EQ("abc", responses[0].payload());
+  EXPECT_FALSE(closed);
+
+  // AND the third target is reported when its timeout passed
+  time_ += std::chrono::seconds(5);
+  messaging.loopOnce();
+  ASSERT_EQ(3U, responses.size());
+  EXPECT_EQ(CoAP::Code::GatewayTimeout, responses[2].code());
+  EXPECT_EQ(targets[1], responses[2].from());
+  EXPECT_TRUE(closed);
+}
@@ -0,0 +1,208 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "cbor.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace CoAP;
+
+namespace {
+
+// Returns the bytes of the hexadecimal string
+std::string bytes(const std::string& hex) {
+  std::string result;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) result += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+  return result;
+}
+
+template <typename T>
+T decoded(const std::string& hex) {
+  T value{};
+  from_cbor(bytes(hex), value);
+  return value;
+}
+
+class Object {
+  int a_{0};
+  std::list<int> b_;
+ public:
+  Object() = default;
+  Object(int a, std::list<int> b) : a_(a), b_(b) { }
+
+  bool operator==(const Object& rhs) const {
+    return a_ == rhs.a_
+        && b_ == rhs.b_;
+  }
+
+  void to_cbor(std::string& out) const {
+    append_cbor(out, "a", a_);
+    append_cbor(out, "b", b_);
+  }
+
+  void from_cbor(StringView map) {
+    ::from_cbor(map, "a", a_);
+    ::from_cbor(map, "b", b_);
+  }
+};
+
+}  // namespace
+
+// The examples are taken from appendix A of RFC 8949
+
+TEST(to_cbor, fromInt) {
+  EXPECT_EQ(bytes("00"), to_cbor(0));
+  EXPECT_EQ(bytes("17"), to_cbor(23));
+  EXPECT_EQ(bytes("1818"), to_cbor(24));
+  EXPECT_EQ(bytes("1903e8"), to_cbor(1000));
+  EXPECT_EQ(bytes("1a000f4240"), to_cbor(1000000));
+  EXPECT_EQ(bytes("20"), to_cbor(-1));
+  EXPECT_EQ(bytes("3863"), to_cbor(-100));
+  EXPECT_EQ(bytes("3903e7"), to_cbor(-1000));
+  EXPECT_EQ(bytes("3a7fffffff"), to_cbor(std::numeric_limits<int>::min()));
+  EXPECT_EQ(bytes("1affffffff"), to_cbor(std::numeric_limits<unsigned int>::max()));
+}
+
+TEST(from_cbor, toInt) {
+  EXPECT_EQ(0, decoded<int>("00"));
+  EXPECT_EQ(24, decoded<int>("1818"));
+  EXPECT_EQ(1000000, decoded<int>("1a000f4240"));
+  EXPECT_EQ(-1000, decoded<int>("3903e7"));
+  EXPECT_EQ(std::numeric_limits<int>::min(), decoded<int>("3a7fffffff"));
+  EXPECT_EQ(1000000U, decoded<unsigned int>("1a000f4240"));
+  // Tags are ignored, here the one of an epoch based date
+  EXPECT_EQ(1363896240, decoded<int>("c11a514b67b0"));
+}
+
+TEST(from_cbor, toIntOutOfRangeThrows) {
+  EXPECT_THROW(decoded<int>("1a80000000"), std::runtime_error);
+  EXPECT_THROW(decoded<int>("3a80000000"), std::runtime_error);
+  EXPECT_THROW(decoded<unsigned int>("20"), std::runtime_error);
+  EXPECT_THROW(decoded<unsigned int>("1b0000000100000000"), std::runtime_error);
+}
+
+TEST(to_cbor, fromDouble) {
+  // Values without loss of precision in single precision take five bytes
+  EXPECT_EQ(bytes("fa3fc00000"), to_cbor(1.5));
+  EXPECT_EQ(bytes("fa47c35000"), to_cbor(100000.0));
+  EXPECT_EQ(bytes("fa7f7fffff"), to_cbor(3.4028234663852886e+38));
+  EXPECT_EQ(bytes("fa7f800000"), to_cbor(std::numeric_limits<double>::infinity()));
+  EXPECT_EQ(bytes("f97e00"), to_cbor(std::numeric_limits<double>::quiet_NaN()));
+  EXPECT_EQ(bytes("fb3ff199999999999a"), to_cbor(1.1));
+  EXPECT_EQ(bytes("fb7e37e43c8800759c"), to_cbor(1.0e+300));
+  EXPECT_EQ(bytes("fbc010666666666666"), to_cbor(-4.1));
+}
+
+TEST(from_cbor, toDouble) {
+  EXPECT_EQ(1.0, decoded<double>("f93c00"));
+  EXPECT_EQ(65504.0, decoded<double>("f97bff"));
+  EXPECT_EQ(5.960464477539063e-8, decoded<double>("f90001"));
+  EXPECT_EQ(-4.0, decoded<double>("f9c400"));
+  EXPECT_EQ(-INFINITY, decoded<double>("f9fc00"));
+  EXPECT_TRUE(std::isnan(decoded<double>("f97e00")));
+  EXPECT_EQ(100000.0, decoded<double>("fa47c35000"));
+  EXPECT_EQ(-4.1, decoded<double>("fbc010666666666666"));
+  EXPECT_EQ(-100.0, decoded<double>("3863"));
+}
+
+TEST(cbor, simpleValues) {
+  EXPECT_EQ(bytes("f4"), to_cbor(false));
+  EXPECT_EQ(bytes("f5"), to_cbor(true));
+  EXPECT_TRUE(decoded<bool>("f5"));
+
+  // null leaves the value unchanged
+  int value = 7;
+  from_cbor(bytes("f6"), value);
+  EXPECT_EQ(7, value);
+}
+
+TEST(cbor, strings) {
+  EXPECT_EQ(bytes("60"), to_cbor(""));
+  EXPECT_EQ(bytes("6449455446"), to_cbor("IETF"));
+  EXPECT_EQ(bytes("62c3bc"), to_cbor(std::string("\xc3\xbc")));
+  EXPECT_EQ("\"\\", decoded<std::string>("62225c"));
+  EXPECT_EQ("streaming", decoded<std::string>("7f657374726561646d696e67ff"));
+}
+
+TEST(cbor, lists) {
+  EXPECT_EQ(bytes("80"), to_cbor(std::list<int>()));
+  EXPECT_EQ(bytes("83010203"), to_cbor(std::list<int>{1, 2, 3}));
+
+  std::list<int> twentyFive;
+  for (int i = 1; i <= 25; ++i) twentyFive.push_back(i);
+  EXPECT_EQ(bytes("98190102030405060708090a0b0c0d0e0f101112131415161718181819"), to_cbor(twentyFive));
+  EXPECT_EQ(twentyFive, decoded<std::list<int>>("98190102030405060708090a0b0c0d0e0f101112131415161718181819"));
+
+  // Indefinite length
+  EXPECT_EQ(std::list<int>({1, 2}), decoded<std::list<int>>("9f0102ff"));
+  EXPECT_EQ(std::list<std::list<int>>({{1}, {2, 3}}), decoded<std::list<std::list<int>>>("9f81019f0203ffff"));
+}
+
+TEST(cbor, maps) {
+  const auto m = std::map<std::string, std::string>{{"a", "A"}, {"b", "B"}};
+  EXPECT_EQ(bytes("a26161614161626142"), to_cbor(m));
+  EXPECT_EQ(m, (decoded<std::map<std::string, std::string>>("a26161614161626142")));
+  EXPECT_EQ(m, (decoded<std::map<std::string, std::string>>("bf6161614161626142ff")));
+}
+
+TEST(cbor, objects) {
+  // GIVEN an object
+  const auto object = Object(1, {2, 3});
+
+  // WHEN it is encoded
+  // THEN it is a map of indefinite length
+  const auto cbor = to_cbor(object);
+  EXPECT_EQ(bytes("bf6161016162820203ff"), cbor);
+
+  // AND it is decoded from maps of definite and indefinite length, in any order
+  Object result;
+  from_cbor(cbor, result);
+  EXPECT_EQ(object, result);
+  EXPECT_EQ(object, decoded<Object>("a26161016162820203"));
+  EXPECT_EQ(object, decoded<Object>("a26162820203616101"));
+  EXPECT_EQ(object, decoded<Object>("bf61629f0203ff616101ff"));
+
+  // AND unknown members are skipped
+  EXPECT_EQ(object, decoded<Object>("a3617aa16178806161016162820203"));
+}
+
+TEST(cbor, listOfObjects) {
+  const auto objects = std::list<Object>{Object(1, {}), Object(-1, {5})};
+  std::list<Object> result;
+  from_cbor(to_cbor(objects), result);
+  EXPECT_EQ(objects, result);
+}
+
+TEST(cbor, appendReusesTheOutput) {
+  std::string out;
+  out.reserve(32);
+  const auto data = out.data();
+
+  append_cbor(out, std::list<int>{1, 2, 3});
+  out.clear();
+  append_cbor(out, 1000);
+
+  EXPECT_EQ(bytes("1903e8"), out);
+  EXPECT_EQ(data, out.data());
+}
+
+TEST(from_cbor, malformedThrows) {
+  int value;
+  EXPECT_THROW(decoded<int>(""), std::runtime_error);
+  EXPECT_THROW(decoded<int>("19"), std::runtime_error);
+  EXPECT_THROW(decoded<int>("1c"), std::runtime_error);
+  EXPECT_THROW(decoded<int>("1f"), std::runtime_error);
+  EXPECT_THROW(decoded<int>("0101"), std::runtime_error);
+  EXPECT_THROW(from_cbor(bytes("61"), value), std::runtime_error);
+  EXPECT_THROW(decoded<std::string>("6461"), std::runtime_error);
+  EXPECT_THROW(decoded<std::string>("7f6161"), std::runtime_error);
+  EXPECT_THROW(decoded<std::list<int>>("830102"), std::runtime_error);
+  EXPECT_THROW(decoded<std::list<int>>("9f01"), std::runtime_error);
+  EXPECT_THROW(decoded<Object>("a161"), std::runtime_error);
+  EXPECT_THROW(decoded<Object>("83010203"), std::runtime_error);
+  EXPECT_THROW(decoded<Object>(std::string(600, '8') + "0"), std::runtime_error);
+}
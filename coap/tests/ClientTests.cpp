@@ -2,6 +2,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include "ClientImpl.h"
 #include "ConnectionMock.h"
 #include "Messaging.h"
 #include "Parameters.h"
@@ -71,7 +72,7 @@ TEST_F(ClientTest, EachRequestIncreasesMessageId) {
     CoAP::Message(CoAP::Type::NonConfirmable, 4, CoAP::Code::Content, 0, ""));
 
   // WHEN the client sends requests
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto r1 = client.GET("/xyz");
   auto r2 = client.PUT("/xyz", "abc");
   auto r3 = client.POST("/xyz", "abc");
@@ -95,7 +96,7 @@ TEST_F(ClientTest, ConfirmableResponseCausesAcknowledge) {
   conn->addMessageToReceive(CoAP::Message(CoAP::Type::Confirmable, 23, CoAP::Code::Content, 0, ""));
 
   ASSERT_EQ(0U, conn->sentMessages_.size());
-  CoAP::Client client = messaging.getClientFor("localhost", 4711);
+  CoAP::Client client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   ASSERT_EQ(1U, conn->sentMessages_.size());
   loopUntil(response);
@@ -113,7 +114,7 @@ TEST_F(ClientTest, ConfirmableResponseCausesAcknowledge) {
 
 TEST_F(ClientTest, ConfirmableRequestResentOnlyMaxRetransmits) {
   // GIVEN a confirmable message sent by the client Client
-  CoAP::Client client = messaging.getClientFor("localhost", 4711);
+  CoAP::Client client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -133,7 +134,7 @@ TEST_F(ClientTest, ConfirmableRequestResentOnlyMaxRetransmits) {
 
 TEST_F(ClientTest, TimeframeForFirstRetransmit) {
   // GIVEN a confirmable message sent by the client Client
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -152,7 +153,7 @@ TEST_F(ClientTest, TimeframeForFirstRetransmit) {
 
 TEST_F(ClientTest, TimeframeForSecondRetransmit) {
   // GIVEN a confirmable message sent by the client Client
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -171,7 +172,7 @@ TEST_F(ClientTest, TimeframeForSecondRetransmit) {
 
 TEST_F(ClientTest, TimeframeForThirdRetransmit) {
   // GIVEN a confirmable message sent by the client Client
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -194,7 +195,7 @@ TEST_F(ClientTest, TimeframeForThirdRetransmit) {
 
 TEST_F(ClientTest, TimeframeForFourthRetransmit) {
   // GIVEN a confirmable message sent by the client Client
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -219,7 +220,7 @@ TEST_F(ClientTest, TimeframeForFourthRetransmit) {
 
 TEST_F(ClientTest, TimeoutExpires) {
   // GIVEN a confirmable message sent by the client Client
-  CoAP::Client client = messaging.getClientFor("localhost", 4711);
+  CoAP::Client client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -254,7 +255,7 @@ TEST_F(ClientTest, ConfirmableRequestResentUntilAcknowledge) {
   // GIVEN a Client
 
   // WHEN the client sends a confirmable request but receives no acknowledge
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
 
@@ -274,7 +275,7 @@ TEST_F(ClientTest, ConfirmableRequestResentUntilAcknowledge) {
 
 TEST_F(ClientTest, ConfirmableRequestAnsweredWithRST) {
   // GIVEN a Client that sends a request
-  auto client = messaging.getClientFor("localhost", 4711);
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
   auto response = client.GET("/xyz", true);
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -289,4 +290,160 @@ TEST_F(ClientTest, ConfirmableRequestAnsweredWithRST) {
   advance(std::chrono::milliseconds(2000));
   messaging.loopOnce();
   ASSERT_EQ(1U, conn->sentMessages_.size());
-}
\ No newline at end of file
+}
+
+TEST_F(ClientTest, ConfirmableRequestsQueuedBeyondNSTART) {
+  // GIVEN a client with NSTART outstanding confirmable requests to a server
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
+  std::vector<std::future<CoAP::RestResponse>> responses;
+  for (auto i = 0U; i < CoAP::NSTART; ++i) responses.emplace_back(client.GET("/xyz", true));
+  ASSERT_EQ(CoAP::NSTART, conn->sentMessages_.size());
+
+  // WHEN the client sends another confirmable request
+  responses.emplace_back(client.GET("/xyz", true));
+
+  // THEN it is not sent before an outstanding request is acknowledged
+  ASSERT_EQ(CoAP::NSTART, conn->sentMessages_.size());
+  conn->addMessageToReceive(CoAP::Message(CoAP::Type::Acknowledgement, 0, CoAP::Code::Empty, 0, ""));
+  messaging.loopOnce();
+  ASSERT_EQ(CoAP::NSTART + 1, conn->sentMessages_.size());
+  EXPECT_EQ(CoAP::NSTART, conn->sentMessages_.back().messageId());
+}
+
+TEST_F(ClientTest, RetransmissionTimeoutAdaptsToRoundTripTime) {
+  // GIVEN a server that acknowledged a confirmable request after 100ms
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
+  auto r1 = client.GET("/xyz", true);
+  advance(std::chrono::milliseconds(100));
+  conn->addMessageToReceive(CoAP::Message(CoAP::Type::Acknowledgement, 0, CoAP::Code::Empty, 0, ""));
+  messaging.loopOnce();
+  ASSERT_EQ(1U, conn->sentMessages_.size());
+
+  // WHEN the client sends the next confirmable request and receives no acknowledge
+  auto r2 = client.GET("/xyz", true);
+  ASSERT_EQ(2U, conn->sentMessages_.size());
+
+  // THEN it resends the request before ACK_TIMEOUT
+  advance(CoAP::ACK_TIMEOUT - std::chrono::milliseconds(10));
+  messaging.loopOnce();
+  ASSERT_EQ(3U, conn->sentMessages_.size());
+  EXPECT_EQ(1, conn->sentMessages_.back().messageId());
+}
+
+TEST_F(ClientTest, RequestsBeyondWindowAreQueued) {
+  // GIVEN a client with a window of two requests
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
+  client.setWindow(2);
+
+  // WHEN the client sends three requests
+  auto r1 = client.GET("/xyz");
+  auto r2 = client.GET("/xyz");
+  auto r3 = client.GET("/xyz");
+
+  // THEN only the first two are sent
+  ASSERT_EQ(2U, conn->sentMessages_.size());
+  EXPECT_EQ(1U, client.statistics().queued);
+
+  // AND the third is sent when the response for the first arrives
+  advance(std::chrono::milliseconds(20));
+  conn->addMessageToReceive(CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::Content, conn->sentMessages_[0].token(), ""));
+  loopUntil(r1);
+  ASSERT_EQ(3U, conn->sentMessages_.size());
+
+  auto statistics = client.statistics();
+  EXPECT_EQ(3U, statistics.requests);
+  EXPECT_EQ(1U, statistics.responses);
+  EXPECT_EQ(2U, statistics.inFlight);
+  EXPECT_EQ(0U, statistics.queued);
+  EXPECT_EQ(1U, statistics.maxQueued);
+  EXPECT_EQ(std::chrono::milliseconds(20), statistics.meanLatency());
+}
+
+TEST_F(ClientTest, UnansweredRequestsFreeTheWindowAfterMaxTransmitWait) {
+  // GIVEN a client with a window of one request that received no response
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
+  client.setWindow(1);
+  auto r1 = client.GET("/xyz");
+  auto r2 = client.GET("/xyz");
+  ASSERT_EQ(1U, conn->sentMessages_.size());
+
+  // WHEN MAX_TRANSMIT_WAIT passes
+  advance(CoAP::MAX_TRANSMIT_WAIT);
+  messaging.loopOnce();
+
+  // THEN the queued request is sent
+  ASSERT_EQ(2U, conn->sentMessages_.size());
+  EXPECT_EQ(1U, client.statistics().expired);
+}
+
+TEST_F(ClientTest, ExpiredConfirmableRequestsAreNoResponses) {
+  // GIVEN a client that sent a confirmable request
+  auto client = messaging.getClientFor("127.0.0.1", 4711);
+  auto response = client.GET("/xyz", true);
+
+  // WHEN the request is never acknowledged
+  loopUntil([this, &response]() {
+    advance(CoAP::ACK_TIMEOUT * 2);
+    return response.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready;
+  });
+
+  // THEN it is answered with Service Unavailable, but counted as expired
+  EXPECT_EQ(CoAP::Code::ServiceUnavailable, response.get().code());
+  const auto statistics = client.statistics();
+  EXPECT_EQ(0U, statistics.responses);
+  EXPECT_EQ(1U, statistics.expired);
+  EXPECT_EQ(0U, statistics.inFlight);
+}
+
+TEST_F(ClientTest, RequestsWaitForTheAddressWithoutBlocking) {
+  // GIVEN a client of a server whose address is still being resolved
+  CoAP::ClientImpl impl(messaging);
+  std::promise<CoAP::Endpoint> address;
+  CoAP::Client client(impl, address.get_future().share(), 4711);
+
+  // WHEN requests are sent and an observation is started
+  auto response = client.GET("/xyz");
+  auto notifications = client.OBSERVE("/abc");
+  client.setWindow(1);
+
+  // THEN the calls return without sending anything
+  EXPECT_EQ(0U, conn->sentMessages_.size());
+  EXPECT_EQ(0U, client.statistics().requests);
+
+  // WHEN the address is resolved
+  address.set_value(CoAP::Endpoint(htonl(INADDR_LOOPBACK), 0));
+  impl.processResolved();
+
+  // THEN the requests are sent in the order of the calls
+  ASSERT_EQ(2U, conn->sentMessages_.size());
+  EXPECT_EQ(1U, client.statistics().inFlight);
+
+  // AND the responses are relayed to the callers
+  std::string payload;
+  notifications->subscribe([&payload](const CoAP::RestResponse& r) { payload = r.payload(); });
+  impl.onMessage(CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::Content, conn->sentMessages_[0].token(),
+                               "", "first"), CoAP::Endpoint(htonl(INADDR_LOOPBACK), 4711));
+  impl.onMessage(CoAP::Message(CoAP::Type::NonConfirmable, 1, CoAP::Code::Content, conn->sentMessages_[1].token(),
+                               "", "second"), CoAP::Endpoint(htonl(INADDR_LOOPBACK), 4711));
+  ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  EXPECT_EQ("first", response.get().payload());
+  EXPECT_EQ("second", payload);
+  notifications.reset();
+}
+
+TEST_F(ClientTest, RequestsToUnresolvableServersAreUnavailable) {
+  // GIVEN a client of a server whose name cannot be resolved
+  CoAP::ClientImpl impl(messaging);
+  std::promise<CoAP::Endpoint> address;
+  CoAP::Client client(impl, address.get_future().share(), 4711);
+  auto response = client.GET("/xyz");
+
+  // WHEN the resolution fails
+  address.set_exception(std::make_exception_ptr(std::runtime_error("Server name could not be resolved.")));
+  impl.processResolved();
+
+  // THEN the request is answered without being sent
+  ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  EXPECT_EQ(CoAP::Code::ServiceUnavailable, response.get().code());
+  EXPECT_EQ(0U, conn->sentMessages_.size());
+}
@@ -13,3 +13,13 @@ TEST(Code, TransformsIntoCorrectString) {
   ss << CoAP::Code::Content;
   EXPECT_EQ("205-Content", ss.str());
 }
+
+TEST(Code, MapsToHttpStatus) {
+  EXPECT_EQ(0U, CoAP::httpStatus(CoAP::Code::GET));
+  EXPECT_EQ(201U, CoAP::httpStatus(CoAP::Code::Created));
+  EXPECT_EQ(200U, CoAP::httpStatus(CoAP::Code::Content));
+  EXPECT_EQ(403U, CoAP::httpStatus(CoAP::Code::Unauthorized));
+  EXPECT_EQ(404U, CoAP::httpStatus(CoAP::Code::NotFound));
+  EXPECT_EQ(502U, CoAP::httpStatus(CoAP::Code::ProxyingNotSupported));
+  EXPECT_EQ(504U, CoAP::httpStatus(CoAP::Code::GatewayTimeout));
+}
@@ -29,16 +29,21 @@ class ConnectionMock : public CoAP::IConnection {
   virtual Optional<CoAP::Telegram> get(std::chrono::milliseconds) override {
     std::unique_lock<std::mutex> lock(mutex_);
     if (cv_.wait_for(lock, std::chrono::microseconds(1), [&] { return messagesReceived_ < messagesToReceive_.size(); })) {
-      ILOG << "get(): Message(" << CoAP::Message::fromBuffer(messagesToReceive_[messagesReceived_]) << ")\n";
-      return Optional<CoAP::Telegram>(0, 0, static_cast<std::vector<uint8_t>>(messagesToReceive_[messagesReceived_++]));
+      auto& received = messagesToReceive_[messagesReceived_++];
+      ILOG << "get(): Message(" << CoAP::Message::fromBuffer(received.getMessage()) << ")\n";
+      return Optional<CoAP::Telegram>(received);
     } else {
       return Optional<CoAP::Telegram>();
     }
   }
 
-  void addMessageToReceive(const CoAP::Message& message) {
+  void addMessageToReceive(const CoAP::Message& message, bool multicast = false) {
+    addMessageToReceive(message, CoAP::Endpoint(), multicast);
+  }
+
+  void addMessageToReceive(const CoAP::Message& message, const CoAP::Endpoint& from, bool multicast = false) {
     std::lock_guard<std::mutex> lock(mutex_);
-    messagesToReceive_.push_back(message.asBuffer());
+    messagesToReceive_.emplace_back(from, message.asBuffer(), multicast);
     cv_.notify_all();
   }
 
@@ -47,7 +52,7 @@ class ConnectionMock : public CoAP::IConnection {
  private:
   std::condition_variable cv_;
   std::mutex mutex_;
-  std::vector<CoAP::Message::Buffer> messagesToReceive_;
+  std::vector<CoAP::Telegram> messagesToReceive_;
   size_t messagesReceived_{0};
 };
 
@@ -6,6 +6,8 @@
 
 #include "Connection.h"
 
+#include <arpa/inet.h>
+
 namespace {
 
 class ModifiedConnection : public CoAP::Connection {
@@ -46,3 +48,81 @@ TEST(Connection_Get, FailWhenConnectionIsNotOpen) {
   // THEN we shall get an exception
   EXPECT_THROW(conn.get(std::chrono::milliseconds(100)), std::logic_error);
 }
+
+TEST(Connection_SendBatch, FailWhenConnectionIsNotOpen) {
+  // GIVEN a connection that was not opened
+  auto conn = ModifiedConnection();
+
+  // WHEN we call the function sendBatch
+
+  // THEN we shall get an exception
+  std::vector<CoAP::Telegram> telegrams;
+  telegrams.emplace_back(0, 0, std::vector<uint8_t>());
+  EXPECT_THROW(conn.sendBatch(std::move(telegrams)), std::logic_error);
+}
+
+TEST(Connection_DualStack, ReceivesFromIPv4AndIPv6) {
+  // GIVEN an open connection
+  CoAP::Connection server;
+  CoAP::Connection client;
+  server.open(56831);
+  client.open(56832);
+
+  // WHEN telegrams are sent to it over IPv4 and IPv6 loopback
+  const auto ipv4 = CoAP::Endpoint(htonl(INADDR_LOOPBACK), 56831);
+  const auto ipv6 = CoAP::Endpoint(in6addr_loopback, 56831);
+  client.send(CoAP::Telegram(ipv4, std::vector<uint8_t>{4}));
+  client.send(CoAP::Telegram(ipv6, std::vector<uint8_t>{6}));
+
+  // THEN both are received with the respective sender address
+  auto first = server.get(std::chrono::milliseconds(1000));
+  auto second = server.get(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(std::vector<uint8_t>{4}, first.value().getMessage());
+  EXPECT_EQ(CoAP::Endpoint(htonl(INADDR_LOOPBACK), 56832), first.value().getEndpoint());
+  EXPECT_EQ(std::vector<uint8_t>{6}, second.value().getMessage());
+  EXPECT_EQ(CoAP::Endpoint(in6addr_loopback, 56832), second.value().getEndpoint());
+}
+
+TEST(Connection_Open, PortOfAnotherConnectionCannotBeBound) {
+  // GIVEN an open connection without multicast groups
+  CoAP::Connection first;
+  first.open(56835);
+
+  // THEN another connection cannot open the same port
+  CoAP::Connection second;
+  EXPECT_THROW(second.open(56835), std::runtime_error);
+}
+
+TEST(Connection_Multicast, ReceivesTelegramsToJoinedGroup) {
+  // GIVEN a connection that joined a multicast group
+  CoAP::Connection server;
+  CoAP::Connection client;
+  server.open(56833);
+  client.open(56834);
+  const auto group = CoAP::Endpoint(inet_addr("224.0.1.187"), 56833);
+  try {
+    server.joinGroup(group, 0);
+  } catch (std::runtime_error&) {
+    // Hosts without multicast capable interface cannot run this test
+    return;
+  }
+
+  // WHEN telegrams are sent to the group and to the unicast address
+  client.send(CoAP::Telegram(group, std::vector<uint8_t>{1}));
+  client.send(CoAP::Telegram(CoAP::Endpoint(htonl(INADDR_LOOPBACK), 56833), std::vector<uint8_t>{2}));
+
+  // THEN both are received once with the multicast one being marked as such
+  std::vector<CoAP::Telegram> received;
+  for (int i = 0; i < 10 && received.size() < 3; ++i) {
+    auto telegram = server.get(std::chrono::milliseconds(100));
+    if (telegram) received.push_back(telegram.value());
+  }
+  if (received.empty()) return;  // no route for multicast telegrams on this host
+
+  ASSERT_EQ(2U, received.size());
+  for (auto& telegram : received) {
+    EXPECT_EQ(telegram.getMessage()[0] == 1, telegram.isMulticast());
+  }
+}
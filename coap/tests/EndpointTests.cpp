@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "Endpoint.h"
+
+#include <arpa/inet.h>
+#include <unordered_set>
+
+TEST(Endpoint, IPv4) {
+  auto endpoint = CoAP::Endpoint(inet_addr("192.168.0.1"), 5683);
+
+  EXPECT_TRUE(endpoint.isIPv4());
+  EXPECT_FALSE(endpoint.isMulticast());
+  EXPECT_EQ(inet_addr("192.168.0.1"), endpoint.ipv4());
+  EXPECT_EQ("192.168.0.1:5683", endpoint.toString());
+}
+
+TEST(Endpoint, IPv4MappedAddressesAreIPv4) {
+  // GIVEN an IPv4 address as received on a dual-stack socket
+  auto endpoint = CoAP::Endpoint::fromString("::ffff:127.0.0.1", 5683);
+
+  // THEN it equals the IPv4 address
+  ASSERT_TRUE(endpoint);
+  EXPECT_TRUE(endpoint.value().isIPv4());
+  EXPECT_EQ(CoAP::Endpoint(htonl(INADDR_LOOPBACK), 5683), endpoint.value());
+}
+
+TEST(Endpoint, IPv6WithScope) {
+  auto endpoint = CoAP::Endpoint::fromString("ff02::fd%3", 5683);
+
+  ASSERT_TRUE(endpoint);
+  EXPECT_TRUE(endpoint.value().isIPv6());
+  EXPECT_TRUE(endpoint.value().isMulticast());
+  EXPECT_EQ(3U, endpoint.value().scopeId());
+  EXPECT_EQ("[ff02::fd%3]:5683", endpoint.value().toString());
+}
+
+TEST(Endpoint, InvalidAddress) {
+  EXPECT_FALSE(CoAP::Endpoint::fromString("localhost", 5683));
+  EXPECT_FALSE(CoAP::Endpoint::fromString("fe80::1%", 5683));
+}
+
+TEST(Endpoint, SockaddrRoundTrip) {
+  // GIVEN an IPv4 endpoint
+  auto endpoint = CoAP::Endpoint(inet_addr("10.0.0.1"), 1234);
+
+  // WHEN it is converted to a socket address of a dual-stack socket and back
+  sockaddr_storage sa;
+  EXPECT_EQ(sizeof(sockaddr_in6), endpoint.toSockaddr(sa, AF_INET6));
+  EXPECT_TRUE(IN6_IS_ADDR_V4MAPPED(&reinterpret_cast<sockaddr_in6&>(sa).sin6_addr));
+
+  // THEN the result equals the original endpoint
+  EXPECT_EQ(endpoint, CoAP::Endpoint::fromSockaddr(reinterpret_cast<sockaddr*>(&sa)));
+}
+
+TEST(Endpoint, IPv6CannotBeConvertedForIPv4Sockets) {
+  sockaddr_storage sa;
+
+  // GIVEN an IPv6 endpoint
+  auto endpoint = CoAP::Endpoint::fromString("2001:db8::1", 1234).value();
+
+  // THEN it cannot be converted to a socket address of an IPv4 socket
+  EXPECT_THROW(endpoint.toSockaddr(sa, AF_INET), std::invalid_argument);
+
+  // AND an IPv4-mapped address can
+  auto mapped = CoAP::Endpoint::fromString("::ffff:10.0.0.1", 1234).value();
+  EXPECT_EQ(sizeof(sockaddr_in), mapped.toSockaddr(sa, AF_INET));
+  EXPECT_EQ(inet_addr("10.0.0.1"), reinterpret_cast<sockaddr_in&>(sa).sin_addr.s_addr);
+}
+
+TEST(Endpoint, Hashable) {
+  std::unordered_set<CoAP::Endpoint> endpoints;
+  endpoints.insert(CoAP::Endpoint(inet_addr("10.0.0.1"), 1234));
+  endpoints.insert(CoAP::Endpoint(inet_addr("10.0.0.1"), 1235));
+  endpoints.insert(CoAP::Endpoint::fromString("::1", 1234).value());
+  endpoints.insert(CoAP::Endpoint(inet_addr("10.0.0.1"), 1234));
+
+  EXPECT_EQ(3U, endpoints.size());
+  EXPECT_EQ(1U, endpoints.count(CoAP::Endpoint(inet_addr("10.0.0.1"), 1235)));
+}
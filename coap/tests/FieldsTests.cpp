@@ -0,0 +1,185 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Fields.h"
+#include "cbor.h"
+#include "json.h"
+
+#include "gtest/gtest.h"
+
+#include <set>
+
+using namespace CoAP;
+
+namespace {
+
+class Position {
+ public:
+  int x_{0};
+  int y_{0};
+
+  bool operator==(const Position& rhs) const {
+    return x_ == rhs.x_
+        && y_ == rhs.y_;
+  }
+
+  static constexpr auto fields() {
+    return CoAP::fields(field("x", &Position::x_),
+                        field("y", &Position::y_));
+  }
+};
+
+class Sensor {
+ public:
+  std::string name_;
+  double value_{0.0};
+  unsigned int time_{0};
+  bool valid_{false};
+  Position position_;
+  std::list<Position> track_;
+
+  bool operator==(const Sensor& rhs) const {
+    return name_ == rhs.name_
+        && value_ == rhs.value_
+        && time_ == rhs.time_
+        && valid_ == rhs.valid_
+        && position_ == rhs.position_
+        && track_ == rhs.track_;
+  }
+
+  static constexpr auto fields() {
+    return CoAP::fields(field("name", &Sensor::name_),
+                        field("value", &Sensor::value_),
+                        field("time", &Sensor::time_),
+                        field("valid", &Sensor::valid_),
+                        field("position", &Sensor::position_),
+                        field("track", &Sensor::track_));
+  }
+};
+
+Sensor sensor() {
+  Sensor s;
+  s.name_ = "temp\"1\"";
+  s.value_ = 21.5;
+  s.time_ = 1700000000;
+  s.valid_ = true;
+  s.position_ = Position{1, -2};
+  s.track_ = {Position{3, 4}, Position{5, 6}};
+  return s;
+}
+
+// The key table is computed at compile time
+constexpr auto sensorKeys = __internal__::keyTable<Sensor>;
+static_assert(sensorKeys.slotCount == 16, "Six keys take 16 slots");
+
+}  // namespace
+
+TEST(Fields, keyTableIsPerfect) {
+  // GIVEN the key table of an object with six fields
+  const auto& table = __internal__::keyTable<Sensor>;
+
+  // THEN every key has a slot of its own
+  std::set<size_t> slots;
+  for (auto key : {"name", "value", "time", "valid", "position", "track"}) {
+    slots.insert(table.slot(key, strlen(key)));
+  }
+  EXPECT_EQ(6U, slots.size());
+
+  // AND the keys are found, other keys are not
+  EXPECT_EQ(0U, table.find("name"));
+  EXPECT_EQ(5U, table.find("track"));
+  EXPECT_EQ(6U, table.find("nam"));
+  EXPECT_EQ(6U, table.find("names"));
+  EXPECT_EQ(6U, table.find(""));
+}
+
+TEST(Fields, toJsonInTheOrderOfTheList) {
+  EXPECT_EQ("{\"x\":1,\"y\":-2}", to_json(Position{1, -2}));
+  EXPECT_EQ("{\"name\":\"temp\\\"1\\\"\",\"value\":21.5,\"time\":1700000000,\"valid\":true,"
+            "\"position\":{\"x\":1,\"y\":-2},\"track\":[{\"x\":3,\"y\":4},{\"x\":5,\"y\":6}]}",
+            to_json(sensor()));
+}
+
+TEST(Fields, fromJson) {
+  // GIVEN the JSON of an object
+  const auto json = to_json(sensor());
+
+  // WHEN it is read
+  Sensor result;
+  from_json(json, result);
+
+  // THEN all members are set
+  EXPECT_EQ(sensor(), result);
+}
+
+TEST(Fields, fromJsonInAnyOrder) {
+  // GIVEN members in another order, with spaces, escaped keys, unknown members and null
+  const auto json = R"( { "unknown" : {"x": [1, {"y": 2}]}, "valid": true, "track": [],)"
+                    R"( "position": {"y": 7}, "name": null, "ti\u006de": 5 } )";
+
+  // WHEN it is read
+  Sensor result;
+  result.name_ = "kept";
+  from_json(json, result);
+
+  // THEN the known members are set and the others are unchanged
+  EXPECT_TRUE(result.valid_);
+  EXPECT_EQ(5U, result.time_);
+  EXPECT_EQ("kept", result.name_);
+  EXPECT_EQ(0.0, result.value_);
+  EXPECT_EQ((Position{0, 7}), result.position_);
+  EXPECT_TRUE(result.track_.empty());
+}
+
+TEST(Fields, fromJsonMalformedThrows) {
+  Sensor result;
+  EXPECT_THROW(from_json("[]", result), std::runtime_error);
+  EXPECT_THROW(from_json("{\"name\":1}", result), std::runtime_error);
+  EXPECT_THROW(from_json("{\"name\":\"a\"", result), std::runtime_error);
+  EXPECT_THROW(from_json("{\"name\" \"a\"}", result), std::runtime_error);
+  EXPECT_THROW(from_json("{\"unknown\":}", result), std::runtime_error);
+}
+
+TEST(Fields, cborIsAMapOfDefiniteLength) {
+  // { "x": 1, "y": -2 }
+  EXPECT_EQ(std::string("\xa2\x61x\x01\x61y\x21"), to_cbor(Position{1, -2}));
+}
+
+TEST(Fields, fromCbor) {
+  // GIVEN the CBOR of an object
+  const auto cbor = to_cbor(sensor());
+
+  // WHEN it is read
+  Sensor result;
+  from_cbor(cbor, result);
+
+  // THEN all members are set
+  EXPECT_EQ(sensor(), result);
+}
+
+TEST(Fields, fromCborInAnyOrder) {
+  // GIVEN a map of indefinite length in another order with an unknown member
+  // {_ "y": 3, "z": [1], "x": 2 }
+  const auto cbor = std::string("\xbf\x61y\x03\x61z\x81\x01\x61x\x02\xff");
+
+  // WHEN it is read
+  Position result;
+  from_cbor(cbor, result);
+
+  // THEN the known members are set
+  EXPECT_EQ((Position{2, 3}), result);
+  EXPECT_THROW(from_cbor(std::string("\x81\x01"), result), std::runtime_error);
+}
+
+TEST(Fields, listsOfObjects) {
+  const auto sensors = std::list<Sensor>{sensor(), Sensor()};
+
+  std::list<Sensor> fromJson;
+  from_json(to_json(sensors), fromJson);
+  EXPECT_EQ(sensors, fromJson);
+
+  std::list<Sensor> fromCbor;
+  from_cbor(to_cbor(sensors), fromCbor);
+  EXPECT_EQ(sensors, fromCbor);
+}
@@ -0,0 +1,226 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HttpProxy.h"
+#include "IConnection.h"
+#include "Messaging.h"
+#include "RequestHandlers.h"
+
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <list>
+#include <mutex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace CoAP;
+
+namespace {
+
+// Delivers every sent telegram back to the messaging, sent by the thread of the HTTP front end as well
+class SharedLoopbackConnection : public IConnection {
+  std::mutex mutex_;
+  std::list<Telegram> telegrams_;
+
+ public:
+  void send(Telegram&& telegram) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    telegrams_.emplace_back(telegram);
+  }
+
+  Optional<Telegram> get(std::chrono::milliseconds) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (not telegrams_.empty()) {
+        auto telegram = std::move(telegrams_.front());
+        telegrams_.pop_front();
+        return telegram;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return Optional<Telegram>();
+  }
+};
+
+// Drops every sent telegram, thus forwarded requests are never answered
+class SilentConnection : public IConnection {
+ public:
+  void send(Telegram&&) override {}
+
+  Optional<Telegram> get(std::chrono::milliseconds) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return Optional<Telegram>();
+  }
+};
+
+// Sends the requests on a new connection and reads until the front end closes it
+std::string exchange(uint16_t port, const std::string& requests) {
+  auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  timeval timeout{5, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = inet_addr("127.0.0.1");
+  std::string responses;
+  if (0 == ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+      && static_cast<ssize_t>(requests.size()) == ::send(fd, requests.data(), requests.size(), MSG_NOSIGNAL)) {
+    char buffer[4096];
+    ssize_t bytes;
+    while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) responses.append(buffer, bytes);
+  }
+  ::close(fd);
+  return responses;
+}
+
+}  // namespace
+
+TEST(HttpProxy, ParsesPipelinedRequests) {
+  // GIVEN a buffer with a POST request with body followed by the beginning of a GET request
+  const std::string buffer =
+      "POST /hc/coap://10.0.0.2/led HTTP/1.1\r\n"
+      "Host: proxy\r\n"
+      "content-type: application/json\r\n"
+      "Accept: application/cbor, */*\r\n"
+      "Content-Length: 4\r\n"
+      "\r\n"
+      "true"
+      "GET /temp HTTP/1.0\r\n";
+
+  // WHEN the first request is parsed
+  HttpProxy::Request request;
+  const auto size = HttpProxy::parse(buffer.data(), buffer.size(), request);
+
+  // THEN its size, method, target, headers and body are returned
+  EXPECT_EQ(buffer.find("GET"), size);
+  EXPECT_EQ("POST", request.method_);
+  EXPECT_EQ("/hc/coap://10.0.0.2/led", request.target_);
+  EXPECT_EQ("application/json", request.contentType_);
+  EXPECT_EQ("application/cbor, */*", request.accept_);
+  EXPECT_EQ("true", request.body_);
+  EXPECT_TRUE(request.keepAlive_);
+
+  // AND the incomplete request is not parsed yet
+  HttpProxy::Request incomplete;
+  EXPECT_EQ(0U, HttpProxy::parse(buffer.data() + size, buffer.size() - size, incomplete));
+  const std::string complete = buffer.substr(size) + "\r\n";
+  EXPECT_EQ(complete.size(), HttpProxy::parse(complete.data(), complete.size(), incomplete));
+  EXPECT_FALSE(incomplete.keepAlive_);
+
+  // AND a body which was not received completely is waited for
+  const auto headers = buffer.substr(0, buffer.find("true"));
+  EXPECT_EQ(0U, HttpProxy::parse(headers.data(), headers.size(), incomplete));
+}
+
+TEST(HttpProxy, RejectsMalformedRequests) {
+  HttpProxy::Request request;
+  for (std::string malformed : {"GET /temp\r\n\r\n", "GET temp HTTP/1.1\r\n\r\n", "GET /temp HTTP/2\r\n\r\n",
+                                "GET /temp HTTP/1.1\r\nHost\r\n\r\n",
+                                "GET /temp HTTP/1.1\r\nContent-Length: x\r\n\r\n"}) {
+    EXPECT_THROW(HttpProxy::parse(malformed.data(), malformed.size(), request), std::runtime_error) << malformed;
+  }
+
+  // GIVEN a chunked request
+  const std::string chunked = "POST /temp HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4\r\ntrue\r\n0\r\n\r\n";
+  // THEN only its header is parsed, the request is answered with 501
+  EXPECT_EQ(chunked.find("4\r\n"), HttpProxy::parse(chunked.data(), chunked.size(), request));
+  EXPECT_TRUE(request.chunked_);
+}
+
+TEST(HttpProxy, FormatsResponses) {
+  // GIVEN a response with content format and Max-Age
+  const auto response = RestResponse().withCode(Code::Content).withContentFormat(ContentFormat::Json)
+                                      .withMaxAge(30).withPayload("21.5");
+
+  // THEN it is formatted with the mapped status code and headers
+  EXPECT_EQ("HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/json\r\n"
+            "Cache-Control: max-age=30\r\n"
+            "Content-Length: 4\r\n"
+            "\r\n"
+            "21.5", HttpProxy::format(response, false, false));
+
+  // AND the response to HEAD requests has no body
+  EXPECT_EQ("HTTP/1.1 504 Gateway Timeout\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n"
+            "\r\n", HttpProxy::format(RestResponse().withCode(Code::GatewayTimeout), true, true));
+}
+
+TEST(HttpProxy, FailWhenEnabledTwice) {
+  // GIVEN a messaging with an HTTP front end
+  Messaging messaging(std::make_shared<SharedLoopbackConnection>());
+  HttpProxyOptions options;
+  options.port = 0;
+  messaging.enableHttpProxy(options);
+
+  // WHEN the front end is enabled again
+  // THEN we shall get an exception
+  EXPECT_THROW(messaging.enableHttpProxy(options), std::logic_error);
+}
+
+TEST(HttpProxy, ForwardsPipelinedRequests) {
+  // GIVEN a server with a resource and an HTTP front end whose target is the server itself
+  Messaging messaging(std::make_shared<SharedLoopbackConnection>());
+  messaging.requestHandler().onUri("/api/temp").onGet([](const Path&) {
+    return RestResponse().withCode(Code::Content).withContentFormat(ContentFormat::TextPlain).withPayload("21.5");
+  });
+  HttpProxyOptions options;
+  options.port = 0;
+  options.target = "coap://127.0.0.1/api";
+  const auto port = messaging.enableHttpProxy(options);
+  messaging.loopStart();
+
+  // WHEN pipelined requests for the resource, an unknown resource, another scheme and without method mapping
+  // are sent on one connection
+  const auto responses = exchange(port,
+                                  "GET /temp HTTP/1.1\r\n\r\n"
+                                  "GET /hc/coap://127.0.0.1/api/unknown HTTP/1.1\r\n\r\n"
+                                  "GET /hc/http://127.0.0.1/api/temp HTTP/1.1\r\n\r\n"
+                                  "PATCH /temp HTTP/1.1\r\nContent-Length: 0\r\n\r\n"
+                                  "HEAD /hc/coap://127.0.0.1/api/temp HTTP/1.1\r\nConnection: close\r\n\r\n");
+  messaging.loopStop();
+
+  // THEN they are answered in order and the connection is closed after the last one
+  const std::vector<std::string> statusLines = {"HTTP/1.1 200 OK", "HTTP/1.1 404 Not Found",
+                                                "HTTP/1.1 502 Bad Gateway", "HTTP/1.1 501 Not Implemented",
+                                                "HTTP/1.1 200 OK"};
+  size_t position = 0;
+  for (auto& statusLine : statusLines) {
+    position = responses.find(statusLine, position);
+    ASSERT_NE(std::string::npos, position) << responses;
+    position += statusLine.size();
+  }
+  EXPECT_EQ(0U, responses.find("HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\n"
+                               "Content-Length: 4\r\n\r\n21.5"));
+  EXPECT_EQ(responses.size() - 2, responses.rfind("Connection: close\r\n\r\n") + 19) << responses;
+}
+
+TEST(HttpProxy, LimitsTheRequestsBeyondThePipeline) {
+  // GIVEN an HTTP front end that forwards one request at a time and buffers up to 64 bytes of further requests
+  Messaging messaging(std::make_shared<SilentConnection>());
+  HttpProxyOptions options;
+  options.port = 0;
+  options.timeout = std::chrono::milliseconds(100);
+  options.pipelineDepth = 1;
+  options.maxRequestSize = 64;
+  const auto port = messaging.enableHttpProxy(options);
+  messaging.loopStart();
+
+  // WHEN more requests than fit into the buffer are sent while the first one is forwarded
+  std::string requests;
+  for (int i = 0; i < 4; ++i) requests += "GET /hc/coap://127.0.0.1/temp HTTP/1.1\r\n\r\n";
+  const auto responses = exchange(port, requests.c_str());
+  messaging.loopStop();
+
+  // THEN the forwarded requests time out, the others are rejected and the connection is closed
+  EXPECT_EQ(0U, responses.find("HTTP/1.1 504 Gateway Timeout")) << responses;
+  const auto rejected = responses.find("HTTP/1.1 413 Payload Too Large");
+  ASSERT_NE(std::string::npos, rejected) << responses;
+  EXPECT_EQ(std::string::npos, responses.find("HTTP/1.1", rejected + 1)) << responses;
+  EXPECT_EQ(responses.size() - 2, responses.rfind("Connection: close\r\n\r\n") + 19) << responses;
+}
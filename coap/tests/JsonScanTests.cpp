@@ -0,0 +1,187 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "JsonScan.h"
+#include "json.h"
+
+#include <random>
+#include <vector>
+
+using namespace CoAP;
+
+namespace {
+
+const JsonScanLevel vectorLevels[] = {JsonScanLevel::SSE2, JsonScanLevel::AVX2};
+
+// Selects the scan level for the lifetime of the object
+class ScanLevel {
+ public:
+  explicit ScanLevel(JsonScanLevel level) : previous_(jsonScanLevel()) { setJsonScanLevel(level); }
+  ~ScanLevel() { setJsonScanLevel(previous_); }
+
+ private:
+  JsonScanLevel previous_;
+};
+
+// Random text that consists mostly of the characters the scanners look for
+std::string randomText(std::mt19937& random, size_t size) {
+  static const char alphabet[] = "\"\\{}[]:, a0|;[{ZzAa\x7b\x5b\x3b\x1b\xfb\xdb";
+  std::uniform_int_distribution<size_t> character(0, sizeof(alphabet) - 2);
+  std::uniform_int_distribution<int> sparse(0, 7);
+  std::string text(size, 'x');
+  for (auto& c : text) {
+    if (sparse(random) == 0) c = alphabet[character(random)];
+  }
+  return text;
+}
+
+// A JSON document with strings that contain escapes and structural characters
+std::string randomDocument(std::mt19937& random, int depth) {
+  std::uniform_int_distribution<int> kind(0, depth > 0 ? 4 : 2);
+  std::uniform_int_distribution<size_t> count(0, 5);
+  switch (kind(random)) {
+    case 0: return std::to_string(random() % 1000);
+    case 1: case 2: {
+      std::string str;
+      append_json(str, randomText(random, random() % 80));
+      return str;
+    }
+    case 3: {
+      std::string json = "[";
+      for (auto n = count(random); n > 0; --n) json += randomDocument(random, depth - 1) + (n > 1 ? "," : "");
+      return json + "]";
+    }
+    default: {
+      std::string json = "{";
+      for (auto n = count(random); n > 0; --n) {
+        std::string key;
+        append_json(key, randomText(random, random() % 20));
+        json += key + ":" + randomDocument(random, depth - 1) + (n > 1 ? "," : "");
+      }
+      return json + "}";
+    }
+  }
+}
+
+// Reads the document as one value, like the members skipped by from_json()
+std::string readValue(StringView json) {
+  JsonCursor cursor(json);
+  const auto value = cursor.value();
+  cursor.finish();
+  return std::string(value);
+}
+
+}  // namespace
+
+TEST(JsonScan, ScalarIsAlwaysSupported) {
+  EXPECT_TRUE(isJsonScanLevelSupported(JsonScanLevel::Scalar));
+  EXPECT_TRUE(isJsonScanLevelSupported(jsonScanLevel()));
+}
+
+TEST(JsonScan, FindsTheFirstMatch) {
+  // GIVEN a text with the characters behind the first vector block
+  const std::string text = std::string(40, 'a') + "b[\\\"" + std::string(40, 'c');
+
+  for (auto level : {JsonScanLevel::Scalar, JsonScanLevel::SSE2, JsonScanLevel::AVX2}) {
+    if (not isJsonScanLevelSupported(level)) continue;
+    ScanLevel scanLevel(level);
+
+    // THEN the first of them is found, or the size if there is none
+    EXPECT_EQ(42U, findStringSpecial(text.data(), 0, text.size()));
+    EXPECT_EQ(41U, findStructural(text.data(), 0, text.size()));
+    EXPECT_EQ(43U, findStructural(text.data(), 42, text.size()));
+    EXPECT_EQ(text.size(), findStringSpecial(text.data(), 44, text.size()));
+    EXPECT_EQ(40U, findStringSpecial(text.data(), 0, 40));
+  }
+}
+
+TEST(JsonScan, VectorScansMatchScalarScans) {
+  // GIVEN random texts of all sizes around the vector widths
+  std::mt19937 random(4711);
+  for (auto level : vectorLevels) {
+    if (not isJsonScanLevelSupported(level)) continue;
+
+    for (int run = 0; run < 2000; ++run) {
+      const auto text = randomText(random, random() % 100);
+
+      // WHEN they are scanned from every position
+      for (size_t pos = 0; pos <= text.size(); ++pos) {
+        size_t stringSpecial, structural;
+        {
+          ScanLevel scalar(JsonScanLevel::Scalar);
+          stringSpecial = findStringSpecial(text.data(), pos, text.size());
+          structural = findStructural(text.data(), pos, text.size());
+        }
+
+        // THEN the vector scans find the same characters as the scalar scans
+        ScanLevel vector(level);
+        ASSERT_EQ(stringSpecial, findStringSpecial(text.data(), pos, text.size())) << text << " from " << pos;
+        ASSERT_EQ(structural, findStructural(text.data(), pos, text.size())) << text << " from " << pos;
+      }
+    }
+  }
+}
+
+TEST(JsonScan, VectorParsingMatchesScalarParsing) {
+  // GIVEN random documents, some of them truncated or with a changed character
+  std::mt19937 random(815);
+  for (int run = 0; run < 1000; ++run) {
+    auto json = randomDocument(random, 3);
+    if (run % 3 == 1 && not json.empty()) json.resize(random() % json.size());
+    if (run % 3 == 2 && not json.empty()) json[random() % json.size()] = "\"\\{}[],:"[random() % 8];
+
+    // WHEN they are read as one value with the scalar scans
+    std::string expected;
+    std::string expectedError;
+    {
+      ScanLevel scalar(JsonScanLevel::Scalar);
+      try {
+        expected = readValue(json);
+      } catch (std::runtime_error& e) {
+        expectedError = e.what();
+      }
+    }
+
+    // THEN the vector scans give the same value and errors
+    for (auto level : vectorLevels) {
+      if (not isJsonScanLevelSupported(level)) continue;
+      ScanLevel vector(level);
+      std::string value;
+      std::string error;
+      try {
+        value = readValue(json);
+      } catch (std::runtime_error& e) {
+        error = e.what();
+      }
+      ASSERT_EQ(expected, value) << json;
+      ASSERT_EQ(expectedError, error) << json;
+    }
+  }
+}
+
+TEST(JsonScan, VectorSkippingMatchesScalarSkipping) {
+  // GIVEN objects whose first members must be skipped to find the last one
+  std::mt19937 random(42);
+  for (int run = 0; run < 500; ++run) {
+    std::map<std::string, std::list<std::string>> object;
+    for (int i = 0; i < 4; ++i) {
+      object["key" + std::to_string(i)] = {randomText(random, random() % 70), randomText(random, random() % 70)};
+    }
+    const auto json = to_json(object);
+    const auto members = json.substr(1, json.size() - 2);
+
+    // WHEN the last member is read
+    for (auto level : {JsonScanLevel::Scalar, JsonScanLevel::SSE2, JsonScanLevel::AVX2}) {
+      if (not isJsonScanLevelSupported(level)) continue;
+      ScanLevel scanLevel(level);
+      std::list<std::string> value;
+      from_json(members, "key3", value);
+
+      // THEN it is found behind the skipped members
+      ASSERT_EQ(object["key3"], value) << json;
+    }
+  }
+}
@@ -0,0 +1,116 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "Logging.h"
+#include "Metrics.h"
+
+#include <iostream>
+#include <thread>
+
+SETLOGLEVEL(LLDEBUG)
+
+namespace {
+
+// Redirects the log into a string for the lifetime of the object
+class CapturedLog {
+ public:
+  CapturedLog() { CoAP::setLogStream(log_); }
+
+  ~CapturedLog() { CoAP::setLogStream(std::cout); }
+
+  std::string str() {
+    CoAP::flushLog();
+    return log_.str();
+  }
+
+ private:
+  std::ostringstream log_;
+};
+
+struct Formatted {
+  int value;
+};
+
+std::ostream& operator<<(std::ostream& os, const Formatted& formatted) {
+  return os << '<' << formatted.value << '>';
+}
+
+}  // namespace
+
+TEST(Logging, RecordsAreFormattedLikeStreams) {
+  if (LLDEBUG < COAP_MIN_LOGLEVEL) GTEST_SKIP();
+
+  // GIVEN a captured log
+  CapturedLog log;
+
+  // WHEN a message with arguments of different types is logged
+  const auto line = __LINE__ + 1;
+  DLOG << "msgID=" << 42 << ' ' << -7L << ' ' << 3000000000u << ' ' << uint8_t('x') << ' ' << true << ' ' << 0.5
+       << ' ' << std::string("token") << ' ' << Formatted{3} << '\n';
+
+  // THEN it is written with its location as before
+  EXPECT_EQ(std::string(__FILE__) + ':' + std::to_string(line) + " (DEBUG) msgID=42 -7 3000000000 x 1 0.5 token <3>\n",
+            log.str());
+}
+
+TEST(Logging, MessagesBelowTheFileLevelAreNotEvaluated) {
+  // GIVEN a captured log
+  CapturedLog log;
+
+  // WHEN a message below the level of the file is logged
+  int evaluated = 0;
+  TLOG << ++evaluated << '\n';
+
+  // THEN its arguments are not evaluated and nothing is written
+  EXPECT_EQ(0, evaluated);
+  EXPECT_EQ("", log.str());
+}
+
+TEST(Logging, LongMessagesAreTruncated) {
+  if (LLWARNING < COAP_MIN_LOGLEVEL) GTEST_SKIP();
+
+  // GIVEN a captured log
+  CapturedLog log;
+
+  // WHEN a message is logged that exceeds the size of a record
+  WLOG << std::string(2 * CoAP::LogRecord::capacity, 'a') << "end\n";
+
+  // THEN its beginning is written
+  const auto text = log.str();
+  EXPECT_NE(std::string::npos, text.find("(WARNING) aaaa"));
+  EXPECT_EQ(std::string::npos, text.find("end"));
+  EXPECT_GT(CoAP::LogRecord::capacity, std::count(text.begin(), text.end(), 'a'));
+}
+
+TEST(Logging, RecordsOfAllThreadsAreWritten) {
+  if (LLERROR < COAP_MIN_LOGLEVEL) GTEST_SKIP();
+
+  // GIVEN a captured log
+  CapturedLog log;
+  auto& dropped = CoAP::Metrics::global().counter("coap_log_records_dropped_total");
+  const auto droppedBefore = dropped.value();
+
+  // WHEN several threads log concurrently
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 100; ++i) ELOG << "thread " << t << " message " << i << '\n';
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // THEN every message is written or counted as dropped, and the messages of a thread are in order
+  const auto text = log.str();
+  size_t lines = std::count(text.begin(), text.end(), '\n');
+  EXPECT_EQ(400, lines + dropped.value() - droppedBefore);
+  for (int t = 0; t < 4; ++t) {
+    const auto first = text.find("thread " + std::to_string(t) + " message 0\n");
+    const auto last = text.find("thread " + std::to_string(t) + " message 99\n");
+    if (first != std::string::npos && last != std::string::npos) {
+      EXPECT_LT(first, last);
+    }
+  }
+}
@@ -0,0 +1,32 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __LoopbackConnection_h
+#define __LoopbackConnection_h
+
+#include "IConnection.h"
+
+#include <list>
+
+// Delivers every sent telegram back to the same messaging, which thus is client and server
+class LoopbackConnection : public CoAP::IConnection {
+  std::list<CoAP::Telegram> telegrams_;
+
+ public:
+  void send(CoAP::Telegram &&telegram) override {
+    telegrams_.emplace_back(telegram);
+  }
+
+  Optional<CoAP::Telegram> get(std::chrono::milliseconds) override {
+    if (telegrams_.empty()) return Optional<CoAP::Telegram>();
+
+    auto telegram = std::move(telegrams_.front());
+    telegrams_.pop_front();
+    return telegram;
+  }
+
+  void clear() { telegrams_.clear(); }
+};
+
+#endif  // __LoopbackConnection_h
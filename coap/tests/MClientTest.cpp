@@ -33,6 +33,13 @@ class MClientTest: public testing::Test {
     time_ += offset;
   }
 
+  void respond(uint32_t server, const std::string& payload) {
+    auto& request = conn->sentMessages_.front();
+    conn->addMessageToReceive(CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::Content, request.token(), "", payload),
+                              CoAP::Endpoint(htonl(0x0a000000 + server), 5683));
+    messaging.loopOnce();
+  }
+
   std::shared_ptr<ConnectionMock> conn;
   std::chrono::time_point<std::chrono::steady_clock> time_;
   CoAP::Messaging messaging;
@@ -89,3 +96,126 @@ TEST_F(MClientTest, MultipleResponseAssignedToSameRequest) {
   EXPECT_EQ(CoAP::Code::Content, response.code());
   EXPECT_EQ("def", response.payload());
 }
+
+TEST_F(MClientTest, ResponsesAreDeduplicatedBySender) {
+  // GIVEN an aggregated multicast request
+  auto client = messaging.getMulticastClient(4711);
+  std::vector<CoAP::Aggregation::Payload> payloads;
+  CoAP::Aggregation::Options options;
+  options.onResponse = [&payloads](const CoAP::Aggregation::Response& response) {
+    payloads.push_back(response.payload);
+  };
+  auto aggregation = client.GET("/name", options);
+  ASSERT_EQ(1U, conn->sentMessages_.size());
+  EXPECT_EQ(CoAP::Type::NonConfirmable, conn->sentMessages_[0].type());
+
+  // WHEN one server responds twice and another one once
+  respond(1, "a");
+  respond(1, "a");
+  respond(2, "b");
+
+  // THEN both are counted once
+  EXPECT_EQ(2U, aggregation->count());
+  EXPECT_EQ(2U, payloads.size());
+  EXPECT_FALSE(aggregation->done());
+
+  // AND the results are available when the timeout passed
+  advance(options.timeout);
+  messaging.loopOnce();
+  ASSERT_TRUE(aggregation->done());
+  auto results = aggregation->results().get();
+  ASSERT_EQ(2U, results.size());
+  EXPECT_EQ(std::vector<uint8_t>{'a'}, *results[0].payload);
+  EXPECT_EQ(CoAP::Endpoint(htonl(0x0a000002), 5683), results[1].from);
+
+  // AND they share the payloads with the callback
+  EXPECT_EQ(payloads[0], results[0].payload);
+  EXPECT_EQ(payloads[1], results[1].payload);
+}
+
+TEST_F(MClientTest, AggregationCompletesAfterFirstResponses) {
+  // GIVEN a multicast request for the first two responses
+  auto client = messaging.getMulticastClient(4711);
+  CoAP::Aggregation::Options options;
+  options.maxResponses = 2;
+  auto aggregation = client.GET("/name", options);
+
+  // WHEN three servers respond
+  respond(1, "a");
+  EXPECT_FALSE(aggregation->done());
+  respond(2, "b");
+  respond(3, "c");
+
+  // THEN only the first two are taken into account
+  ASSERT_TRUE(aggregation->done());
+  EXPECT_EQ(2U, aggregation->results().get().size());
+  EXPECT_EQ(2U, aggregation->count());
+}
+
+TEST_F(MClientTest, ResponsesAreNotKeptOnRequest) {
+  // GIVEN a multicast request that only counts the servers
+  auto client = messaging.getMulticastClient(4711);
+  CoAP::Aggregation::Options options;
+  options.keepResponses = false;
+  auto aggregation = client.GET("/name", options);
+
+  // WHEN servers respond and the aggregation gets cancelled
+  respond(1, "a");
+  respond(2, "b");
+  aggregation->cancel();
+
+  // THEN they are counted but not kept
+  EXPECT_EQ(2U, aggregation->count());
+  EXPECT_TRUE(aggregation->results().get().empty());
+}
+
+TEST(Aggregation, CancellationReleasesTheToken) {
+  // GIVEN an aggregation that releases its token on cancellation
+  unsigned released = 0;
+  CoAP::Aggregation aggregation(CoAP::Aggregation::Options(), [&released]() { ++released; });
+
+  // WHEN it completes
+  aggregation.complete();
+
+  // THEN the token is left to the client
+  EXPECT_EQ(0U, released);
+
+  // WHEN it gets cancelled
+  aggregation.cancel();
+
+  // THEN the token is released
+  EXPECT_EQ(1U, released);
+}
+
+TEST_F(MClientTest, AggregationsCanBeCancelledByTheCallback) {
+  // GIVEN a multicast request that gets cancelled on the first response
+  auto client = messaging.getMulticastClient(4711);
+  std::shared_ptr<CoAP::Aggregation> aggregation;
+  CoAP::Aggregation::Options options;
+  options.onResponse = [&aggregation](const CoAP::Aggregation::Response&) { aggregation->cancel(); };
+  aggregation = client.GET("/name", options);
+
+  // WHEN servers respond
+  respond(1, "a");
+  respond(2, "b");
+
+  // THEN only the first response is taken into account
+  ASSERT_TRUE(aggregation->done());
+  EXPECT_EQ(1U, aggregation->results().get().size());
+}
+
+TEST(MClient, AggregationsMayOutliveTheMessaging) {
+  // GIVEN an aggregation of a multicast request
+  std::shared_ptr<CoAP::Aggregation> aggregation;
+  {
+    CoAP::Messaging messaging(std::make_shared<ConnectionMock>());
+    aggregation = messaging.getMulticastClient(4711).GET("/name", CoAP::Aggregation::Options());
+  }
+
+  // WHEN it is cancelled after the messaging was destroyed
+  aggregation->cancel();
+
+  // THEN it is completed without responses
+  ASSERT_TRUE(aggregation->done());
+  EXPECT_TRUE(aggregation->results().get().empty());
+}
@@ -266,6 +266,84 @@ TEST(Message, convertAndBackWithContentFormat2Byte) {
   EXPECT_EQ(333, msg2.optionalContentFormat().value());
 }
 
+TEST(Message, convertAndBackWithAcceptAndQuery) {
+  // GIVEN a request with query and Accept option, which follows the Uri-Query option
+  auto msg = Message(Type::NonConfirmable, 0, Code::GET, 0, "/a?b=c");
+  msg.withAccept(60);
+
+  // WHEN it is serialized and deserialized
+  auto msg2 = Message::fromBuffer(msg.asBuffer());
+
+  // THEN the Accept option is preserved
+  ASSERT_TRUE(msg2.optionalAccept());
+  EXPECT_EQ(60, msg2.optionalAccept().value());
+  EXPECT_EQ("/a", msg2.path());
+  EXPECT_EQ(std::vector<std::string>{"b=c"}, msg2.queries());
+}
+
+TEST(Message, convertAndBackWithProxyOptions) {
+  // GIVEN a proxy request with options before and after the path, some of them with extended deltas and lengths
+  auto msg = Message(Type::Confirmable, 1, Code::GET, 2, "/a?b=c");
+  msg.withUriHost("example.org")
+     .withUriPort(61616)
+     .withObserveValue(0)
+     .withProxyUri("coap://[2001:db8::1]:5683/sensors/temperature?unit=celsius")
+     .withProxyScheme("coap");
+  auto response = Message(Type::Acknowledgement, 1, Code::Content, 2, "", "abc");
+  response.withContentFormat(50).withMaxAge(86400);
+
+  // WHEN they are serialized and deserialized
+  auto msg2 = Message::fromBuffer(msg.asBuffer());
+  auto response2 = Message::fromBuffer(response.asBuffer());
+
+  // THEN all options are preserved
+  EXPECT_TRUE(msg2.isProxyRequest());
+  EXPECT_EQ("example.org", msg2.optionalUriHost().value());
+  EXPECT_EQ(61616, msg2.optionalUriPort().value());
+  EXPECT_EQ(0U, msg2.optionalObserveValue().value());
+  EXPECT_EQ("coap://[2001:db8::1]:5683/sensors/temperature?unit=celsius", msg2.optionalProxyUri().value());
+  EXPECT_EQ("coap", msg2.optionalProxyScheme().value());
+  EXPECT_EQ("/a", msg2.path());
+  EXPECT_EQ(std::vector<std::string>{"b=c"}, msg2.queries());
+
+  EXPECT_FALSE(response2.isProxyRequest());
+  EXPECT_EQ(50, response2.optionalContentFormat().value());
+  EXPECT_EQ(86400U, response2.optionalMaxAge().value());
+  EXPECT_EQ("abc", response2.payload());
+}
+
+TEST(Message, convertAndBackWithLocationPath) {
+  // GIVEN a response to a POST request with the location of the created resource
+  auto response = Message(Type::Acknowledgement, 1, Code::Created, 2, "");
+  response.withLocationPath("/rd/4521").withObserveValue(1).withContentFormat(40);
+
+  // WHEN it is serialized and deserialized
+  auto response2 = Message::fromBuffer(response.asBuffer());
+
+  // THEN the location is preserved besides the options around it
+  EXPECT_EQ("/rd/4521", response2.optionalLocationPath().value());
+  EXPECT_EQ(1U, response2.optionalObserveValue().value());
+  EXPECT_EQ(40, response2.optionalContentFormat().value());
+  EXPECT_FALSE(Message::fromBuffer(Message(Type::Acknowledgement, 1, Code::Created, 2, "").asBuffer())
+                   .optionalLocationPath());
+}
+
+TEST(Message, unrecognizedOptionIsSkipped) {
+  // GIVEN a message with an unrecognized option (13) between path and Accept
+  auto buffer = Message(Type::NonConfirmable, 0, Code::Content, 0, "/a").asBuffer();
+  const std::vector<uint8_t> unrecognized = {0x22, 0x12, 0x34};
+  buffer.insert(buffer.end(), unrecognized.begin(), unrecognized.end());
+  buffer.push_back(0x40);
+
+  // WHEN it is deserialized
+  auto msg = Message::fromBuffer(buffer);
+
+  // THEN the value of the unrecognized option is not taken for further options
+  EXPECT_EQ("/a", msg.path());
+  ASSERT_TRUE(msg.optionalAccept());
+  EXPECT_EQ(0, msg.optionalAccept().value());
+}
+
 TEST(Message_option, baseAndOffset) {
   uint8_t buffer[] = {0, 0, 0};
 
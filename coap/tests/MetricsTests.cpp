@@ -0,0 +1,152 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "LoopbackConnection.h"
+
+#include "Messaging.h"
+#include "Metrics.h"
+#include "RequestHandlers.h"
+
+#include <thread>
+
+TEST(Metrics, CounterSumsUpIncrementsOfAllThreads) {
+  // GIVEN a counter
+  CoAP::Counter counter;
+
+  // WHEN several threads increment it concurrently
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < 10000; ++i) counter.increment();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  counter.increment(5);
+
+  // THEN no increment is lost
+  EXPECT_EQ(80005, counter.value());
+}
+
+TEST(Metrics, GaugeGoesUpAndDown) {
+  // GIVEN a gauge
+  CoAP::Gauge gauge;
+
+  // WHEN it is incremented and decremented by different threads
+  std::thread up([&gauge]() { for (int i = 0; i < 1000; ++i) gauge.increment(); });
+  std::thread down([&gauge]() { for (int i = 0; i < 1003; ++i) gauge.decrement(); });
+  up.join();
+  down.join();
+
+  // THEN the value can become negative
+  EXPECT_EQ(-3, gauge.value());
+}
+
+TEST(Metrics, HistogramCountsValuesPerBucket) {
+  // GIVEN a histogram with the bounds 10 and 100
+  CoAP::Histogram histogram({10, 100});
+
+  // WHEN values are recorded
+  for (auto value : {0, 10, 11, 100, 101, 1000}) histogram.record(value);
+
+  // THEN the bounds are inclusive and larger values go to the last bucket
+  const auto snapshot = histogram.snapshot();
+  EXPECT_EQ(std::vector<uint64_t>({2, 2, 2}), snapshot.counts);
+  EXPECT_EQ(6, snapshot.count);
+  EXPECT_EQ(1222, snapshot.sum);
+}
+
+TEST(Metrics, HistogramNeedsAscendingBounds) {
+  EXPECT_THROW(CoAP::Histogram({100, 10}), std::logic_error);
+}
+
+TEST(Metrics, RegistryReturnsTheSameMetricForAName) {
+  // GIVEN a registry with a counter
+  CoAP::Metrics metrics;
+  auto& counter = metrics.counter("requests");
+
+  // WHEN the name is looked up again
+  // THEN the same counter is returned, but not as another kind of metric
+  EXPECT_EQ(&counter, &metrics.counter("requests"));
+  EXPECT_THROW(metrics.gauge("requests"), std::logic_error);
+  EXPECT_THROW(metrics.histogram("requests", {1}), std::logic_error);
+}
+
+TEST(Metrics, TextFormat) {
+  // GIVEN a registry with a counter, a gauge and a histogram
+  CoAP::Metrics metrics;
+  metrics.counter("requests_total").increment(3);
+  metrics.gauge("active").decrement();
+  auto& histogram = metrics.histogram("latency", {10, 100, 1000});
+  histogram.record(5);
+  histogram.record(500);
+
+  // WHEN it is formatted as text
+  // THEN every value is on its own line and empty buckets are left out
+  EXPECT_EQ("requests_total 3\n"
+            "active -1\n"
+            "latency_bucket{le=\"10\"} 1\n"
+            "latency_bucket{le=\"1000\"} 2\n"
+            "latency_bucket{le=\"+Inf\"} 2\n"
+            "latency_sum 505\n"
+            "latency_count 2\n",
+            metrics.toText());
+}
+
+TEST(Metrics, MessagingIsInstrumented) {
+  // GIVEN a messaging with a request handler
+  CoAP::Messaging messaging(std::make_shared<LoopbackConnection>());
+  messaging.requestHandler().onUri("hello").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("world");
+  });
+
+  auto& metrics = CoAP::Metrics::global();
+  const auto serverRequests = metrics.counter("coap_server_requests_total").value();
+  const auto clientResponses = metrics.counter("coap_client_responses_total").value();
+  const auto latencies = metrics.histogram("coap_client_latency_us", {}).snapshot().count;
+
+  // WHEN a request is answered
+  auto client = messaging.getClientFor("127.0.0.1");
+  auto response = client.GET("hello");
+  while (response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) messaging.loopOnce();
+
+  // THEN the request, the response and its latency are recorded
+  EXPECT_EQ(serverRequests + 1, metrics.counter("coap_server_requests_total").value());
+  EXPECT_EQ(clientResponses + 1, metrics.counter("coap_client_responses_total").value());
+  EXPECT_EQ(latencies + 1, metrics.histogram("coap_client_latency_us", {}).snapshot().count);
+}
+
+TEST(Metrics, MalformedMessagesAreCountedAndDropped) {
+  // GIVEN a messaging
+  auto connection = std::make_shared<LoopbackConnection>();
+  CoAP::Messaging messaging(connection);
+  auto& failures = CoAP::Metrics::global().counter("coap_parse_failures_total");
+  const auto before = failures.value();
+
+  // WHEN a telegram is received that is no CoAP message
+  connection->send(CoAP::Telegram(CoAP::Endpoint(), {0xff}));
+
+  // THEN it is dropped and counted
+  EXPECT_NO_THROW(messaging.loopOnce(std::chrono::milliseconds(0)));
+  EXPECT_EQ(before + 1, failures.value());
+}
+
+TEST(Metrics, ExposedAtWellKnownResource) {
+  // GIVEN a messaging that exposes its metrics
+  CoAP::Messaging messaging(std::make_shared<LoopbackConnection>());
+  messaging.exposeMetrics();
+
+  // WHEN the metrics are requested
+  auto client = messaging.getClientFor("127.0.0.1");
+  auto response = client.GET("/.well-known/metrics");
+  while (response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) messaging.loopOnce();
+
+  // THEN the library metrics are returned as text
+  auto r = response.get();
+  EXPECT_EQ(CoAP::Code::Content, r.code());
+  EXPECT_EQ(0, r.contentFormat());
+  EXPECT_NE(std::string::npos, r.payload().find("coap_server_requests_total "));
+  EXPECT_NE(std::string::npos, r.payload().find("coap_datagrams_sent_total "));
+}
@@ -13,8 +13,8 @@ namespace {
 class NetUtilsMock: public CoAP::NetUtils {
 
  protected:
-  hostent* gethostbyname(const std::string&) const override {
-    return nullptr;  // host could not be resolved
+  int getaddrinfo(const std::string&, const addrinfo*, addrinfo**) const override {
+    return EAI_NONAME;  // host could not be resolved
   }
 };
 
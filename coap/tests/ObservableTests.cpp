@@ -21,4 +21,15 @@ TEST(Observable, onNext_callsObserver) {
   o.onNext(23);
 
   ASSERT_EQ(23, value);
-}
\ No newline at end of file
+}
+
+TEST(Observable, onClose_callsCloseObserver) {
+  Observable<int> o;
+
+  bool closed = false;
+
+  o.subscribe([](const int&){}, [&closed](){ closed = true; });
+  o.onClose();
+
+  ASSERT_TRUE(closed);
+}
@@ -54,3 +54,11 @@ TEST(Path, WithLargeNumberOfParts) {
   EXPECT_EQ("z", p.getPart(25));
 }
 
+
+TEST(Path, WithQueries) {
+  auto p = Path("/rd-lookup/res/", {"rt=temperature", "page=2"});
+  EXPECT_EQ(2U, p.size());
+  EXPECT_EQ("res", p.getPart(1));
+  EXPECT_EQ((std::vector<std::string>{"rt=temperature", "page=2"}), p.queries());
+  EXPECT_TRUE(Path("/rd").queries().empty());
+}
@@ -0,0 +1,116 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "PeerState.h"
+
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+namespace {
+const auto t0 = CoAP::PeerState::Time();
+}
+
+TEST(PeerState, InitialRtoIsAckTimeout) {
+  CoAP::PeerState peer;
+
+  EXPECT_EQ(CoAP::ACK_TIMEOUT, peer.rto(t0));
+}
+
+TEST(PeerState, StrongRttSampleAdaptsRto) {
+  // GIVEN a peer without RTT samples
+  CoAP::PeerState peer;
+
+  // WHEN an exchange is acknowledged after 100ms without retransmission
+  peer.onStrongRtt(milliseconds(100), t0);
+
+  // THEN the RTO is the mean of the strong estimate (100ms + 4 * 50ms) and the previous RTO
+  EXPECT_EQ(milliseconds(650), peer.rto(t0));
+}
+
+TEST(PeerState, WeakRttSampleHasLessInfluence) {
+  // GIVEN a peer without RTT samples
+  CoAP::PeerState peer;
+
+  // WHEN an exchange is acknowledged 2s after the initial transmission
+  peer.onWeakRtt(seconds(2), t0);
+
+  // THEN the weak estimate (2s + 1s) is weighted with one quarter
+  EXPECT_EQ(milliseconds(1500), peer.rto(t0));
+}
+
+TEST(PeerState, SmallRtoIsDoubledWhenNotUpdated) {
+  // GIVEN a peer with a small RTO
+  CoAP::PeerState peer(milliseconds(100));
+  peer.onStrongRtt(milliseconds(20), t0);
+  const auto rto = peer.rto(t0);
+  ASSERT_GT(milliseconds(1000), rto);
+
+  // WHEN the peer was not heard of for more than 16 RTOs
+  // THEN the RTO is doubled
+  EXPECT_EQ(rto, peer.rto(t0 + 16 * rto));
+  EXPECT_EQ(2 * rto, peer.rto(t0 + 16 * rto + milliseconds(1)));
+}
+
+TEST(PeerState, LargeRtoDecaysWhenNotUpdated) {
+  // GIVEN a peer with a large RTO
+  CoAP::PeerState peer(seconds(8));
+  peer.onStrongRtt(seconds(4), t0);
+  const auto rto = peer.rto(t0);
+  ASSERT_EQ(seconds(10), rto);
+
+  // WHEN the peer was not heard of for more than 4 RTOs
+  // THEN the RTO is moved towards the default
+  EXPECT_EQ(seconds(6), peer.rto(t0 + 4 * rto + milliseconds(1)));
+}
+
+TEST(PeerState, IdleOnceTheRtoIsStale) {
+  // GIVEN a peer with a measured RTO
+  CoAP::PeerState peer;
+  peer.onStrongRtt(seconds(2), t0);
+  const auto rto = peer.rto(t0);
+
+  // WHEN it was not confirmed for 16 RTOs
+  // THEN the state may be forgotten
+  EXPECT_FALSE(peer.idle(t0 + 16 * rto));
+  EXPECT_TRUE(peer.idle(t0 + 16 * rto + milliseconds(1)));
+}
+
+TEST(PeerState, NotIdleWithOutstandingOrPendingExchanges) {
+  // GIVEN a peer without RTT samples
+  CoAP::PeerState peer;
+  EXPECT_TRUE(peer.idle(t0));
+
+  // WHEN an exchange is outstanding
+  peer.startExchange();
+
+  // THEN the state must be kept
+  EXPECT_FALSE(peer.idle(t0));
+
+  // AND also while further exchanges are pending
+  peer.finishExchange();
+  peer.pending().emplace_back(CoAP::Message(CoAP::Type::Confirmable, 1, CoAP::Code::GET, 1, "x"));
+  EXPECT_FALSE(peer.idle(t0));
+}
+
+TEST(PeerState, VariableBackoffFactor) {
+  EXPECT_EQ(3, CoAP::PeerState::backoffFactor(milliseconds(500)));
+  EXPECT_EQ(2, CoAP::PeerState::backoffFactor(milliseconds(1000)));
+  EXPECT_EQ(2, CoAP::PeerState::backoffFactor(milliseconds(3000)));
+  EXPECT_EQ(1.5, CoAP::PeerState::backoffFactor(milliseconds(3001)));
+}
+
+TEST(PeerState, LimitsOutstandingExchangesToNSTART) {
+  CoAP::PeerState peer;
+
+  for (auto i = 0U; i < CoAP::NSTART; ++i) {
+    ASSERT_TRUE(peer.mayStartExchange());
+    peer.startExchange();
+  }
+  EXPECT_FALSE(peer.mayStartExchange());
+
+  peer.finishExchange();
+  EXPECT_TRUE(peer.mayStartExchange());
+}
@@ -4,30 +4,11 @@
 
 #include "gtest/gtest.h"
 
+#include "LoopbackConnection.h"
+
 #include <Messaging.h>
-#include <IConnection.h>
-#include <list>
 #include <RequestHandlers.h>
 
-using CoAP::Telegram;
-
-class LoopbackConnection : public CoAP::IConnection {
-  std::list<Telegram> telegrams_;
-
- public:
-  void send(Telegram &&telegram) override {
-    telegrams_.emplace_back(telegram);
-  }
-
-  Optional<Telegram> get(std::chrono::milliseconds) override {
-    if (telegrams_.empty()) return Optional<Telegram>();
-
-    auto telegram = std::move(telegrams_.front());
-    telegrams_.pop_front();
-    return telegram;
-  }
-};
-
 TEST(Performance, Test) {
   CoAP::Messaging messaging(std::make_shared<LoopbackConnection>());
 
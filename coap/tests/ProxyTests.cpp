@@ -0,0 +1,266 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ConnectionMock.h"
+#include "Messaging.h"
+#include "RequestHandlers.h"
+
+#include "gtest/gtest.h"
+
+using namespace CoAP;
+
+class ProxyTest: public testing::Test {
+ public:
+  ProxyTest()
+      : conn(new ConnectionMock()),
+        time_(std::chrono::steady_clock::now()),
+        messaging(conn, [this]() { return this->time_; }) {
+  }
+
+ protected:
+  // Receives the request from the downstream client and returns the messages sent thereupon
+  std::vector<Message> receive(const Message& request, const Endpoint& from) {
+    const auto sent = conn->sentMessages_.size();
+    conn->addMessageToReceive(request, from);
+    messaging.loopOnce();
+    return std::vector<Message>(conn->sentMessages_.begin() + sent, conn->sentMessages_.end());
+  }
+
+  Message proxyRequest(MessageId messageId, uint64_t token, const std::string& proxyUri,
+                       Type type = Type::NonConfirmable) {
+    auto request = Message(type, messageId, Code::GET, token, "");
+    request.withProxyUri(proxyUri);
+    return request;
+  }
+
+  std::shared_ptr<ConnectionMock> conn;
+  std::chrono::time_point<std::chrono::steady_clock> time_;
+  Messaging messaging;
+
+  const Endpoint device{htonl(0x0a000009), 40000};
+  const Endpoint backend{htonl(0x0a000002), 5684};
+};
+
+TEST_F(ProxyTest, ForwardsProxyUriAndRelaysResponse) {
+  // GIVEN a forward proxy
+  ProxyOptions options;
+  options.forwardProxy = true;
+  messaging.enableProxy(options);
+
+  // WHEN a device sends a confirmable request with Proxy-Uri
+  auto upstream = receive(proxyRequest(100, 7, "coap://10.0.0.2:5684/temp?unit=c", Type::Confirmable), device);
+
+  // THEN it is forwarded to the server of the URI with a token of the proxy and without proxy options
+  ASSERT_EQ(1U, upstream.size());
+  EXPECT_EQ(Type::Confirmable, upstream[0].type());
+  EXPECT_EQ(Code::GET, upstream[0].code());
+  EXPECT_EQ("/temp", upstream[0].path());
+  EXPECT_EQ(std::vector<std::string>{"unit=c"}, upstream[0].queries());
+  EXPECT_FALSE(upstream[0].isProxyRequest());
+
+  // WHEN the server responds
+  auto response = Message(Type::Acknowledgement, upstream[0].messageId(), Code::Content, upstream[0].token(),
+                          "", "21.5");
+  response.withContentFormat(ContentFormat::TextPlain).withMaxAge(30);
+  auto downstream = receive(response, backend);
+
+  // THEN the response is relayed to the device with its message ID and token
+  ASSERT_EQ(1U, downstream.size());
+  EXPECT_EQ(100, downstream[0].messageId());
+  EXPECT_EQ(7U, downstream[0].token());
+  EXPECT_EQ(Code::Content, downstream[0].code());
+  EXPECT_EQ("21.5", downstream[0].payload());
+  EXPECT_EQ(ContentFormat::TextPlain, downstream[0].optionalContentFormat().value());
+  EXPECT_EQ(30U, downstream[0].optionalMaxAge().value());
+}
+
+TEST_F(ProxyTest, ForwardsProxySchemeToUriHost) {
+  // GIVEN a forward proxy
+  ProxyOptions options;
+  options.forwardProxy = true;
+  messaging.enableProxy(options);
+
+  // WHEN a device sends a request with Proxy-Scheme, Uri-Host and Uri-Port
+  auto request = Message(Type::NonConfirmable, 100, Code::PUT, 7, "/led?on", "1");
+  request.withProxyScheme("coap").withUriHost("10.0.0.2").withUriPort(5684);
+  auto upstream = receive(request, device);
+
+  // THEN it is forwarded with path, queries and payload
+  ASSERT_EQ(1U, upstream.size());
+  EXPECT_EQ(Type::NonConfirmable, upstream[0].type());
+  EXPECT_EQ(Code::PUT, upstream[0].code());
+  EXPECT_EQ("/led", upstream[0].path());
+  EXPECT_EQ(std::vector<std::string>{"on"}, upstream[0].queries());
+  EXPECT_EQ("1", upstream[0].payload());
+  EXPECT_FALSE(upstream[0].optionalUriHost());
+}
+
+TEST_F(ProxyTest, ReverseProxyForwardsRoutes) {
+  // GIVEN a reverse proxy for the prefix /sensors
+  ProxyOptions options;
+  options.routes["/sensors"] = "coap://10.0.0.2:5684/api/";
+  messaging.enableProxy(options);
+
+  // WHEN a device requests a resource below the prefix
+  auto upstream = receive(Message(Type::NonConfirmable, 100, Code::GET, 7, "/sensors/temp?x=1"), device);
+
+  // THEN it is forwarded to the base path of the route
+  ASSERT_EQ(1U, upstream.size());
+  EXPECT_EQ("/api/temp", upstream[0].path());
+  EXPECT_EQ(std::vector<std::string>{"x=1"}, upstream[0].queries());
+
+  // AND other paths are handled by the server itself
+  auto local = receive(Message(Type::NonConfirmable, 101, Code::GET, 8, "/sensorsx"), device);
+  ASSERT_EQ(1U, local.size());
+  EXPECT_EQ(Code::NotFound, local[0].code());
+
+  // AND invalid routes are rejected
+  options.routes["/actors"] = "http://10.0.0.2/api";
+  EXPECT_THROW(messaging.enableProxy(options), std::logic_error);
+}
+
+TEST_F(ProxyTest, UnsupportedRequestsAreRejected) {
+  // GIVEN a server without proxy
+  // WHEN it receives a proxy request
+  auto reply = receive(proxyRequest(100, 7, "coap://10.0.0.2/temp"), device);
+
+  // THEN it is answered with 5.05
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::ProxyingNotSupported, reply[0].code());
+
+  // GIVEN a forward proxy
+  ProxyOptions options;
+  options.forwardProxy = true;
+  messaging.enableProxy(options);
+
+  // THEN other schemes and malformed URIs are rejected
+  reply = receive(proxyRequest(101, 8, "http://10.0.0.2/temp"), device);
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::ProxyingNotSupported, reply[0].code());
+
+  reply = receive(proxyRequest(102, 9, "coap://10.0.0.2:port/temp"), device);
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::BadOption, reply[0].code());
+
+  auto request = Message(Type::NonConfirmable, 103, Code::GET, 10, "/temp");
+  request.withProxyScheme("coap");
+  reply = receive(request, device);
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::BadRequest, reply[0].code());
+}
+
+TEST_F(ProxyTest, ObservationsAreRejected) {
+  // GIVEN a forward proxy
+  ProxyOptions options;
+  options.forwardProxy = true;
+  messaging.enableProxy(options);
+
+  // WHEN it receives a request registering an observation
+  auto request = proxyRequest(100, 7, "coap://10.0.0.2/temp");
+  request.withObserveValue(0);
+  auto reply = receive(request, device);
+
+  // THEN it is answered with 5.05 instead of being forwarded as a single request
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::ProxyingNotSupported, reply[0].code());
+}
+
+TEST_F(ProxyTest, ForwardingIsDisabledByDefault) {
+  // GIVEN a proxy with the default options
+  messaging.enableProxy();
+
+  // WHEN it receives a proxy request
+  auto reply = receive(proxyRequest(100, 7, "coap://10.0.0.2/temp"), device);
+
+  // THEN it is answered with 5.05 instead of being forwarded
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Code::ProxyingNotSupported, reply[0].code());
+
+  // AND forwarded requests would be answered before their clients give up
+  EXPECT_LE(ProxyOptions().timeout, MAX_TRANSMIT_WAIT - MAX_TRANSMIT_SPAN);
+}
+
+TEST_F(ProxyTest, RetransmittedRequestsAreAcknowledged) {
+  // GIVEN a forward proxy with a forwarded confirmable request
+  ProxyOptions options;
+  options.forwardProxy = true;
+  messaging.enableProxy(options);
+  ASSERT_EQ(1U, receive(proxyRequest(100, 7, "coap://10.0.0.2/temp", Type::Confirmable), device).size());
+
+  // WHEN the device retransmits the request
+  auto reply = receive(proxyRequest(100, 7, "coap://10.0.0.2/temp", Type::Confirmable), device);
+
+  // THEN it is acknowledged, but not forwarded again
+  ASSERT_EQ(1U, reply.size());
+  EXPECT_EQ(Type::Acknowledgement, reply[0].type());
+  EXPECT_EQ(Code::Empty, reply[0].code());
+  EXPECT_EQ(100, reply[0].messageId());
+}
+
+TEST_F(ProxyTest, TimeoutIsAnsweredWithGatewayTimeout) {
+  // GIVEN a forward proxy with a timeout of 5s and a forwarded request
+  ProxyOptions options;
+  options.forwardProxy = true;
+  options.timeout = std::chrono::seconds(5);
+  messaging.enableProxy(options);
+  auto upstream = receive(proxyRequest(100, 7, "coap://10.0.0.2/temp"), device);
+  ASSERT_EQ(1U, upstream.size());
+
+  // WHEN the device retransmits the request
+  // THEN it is not forwarded again
+  EXPECT_TRUE(receive(proxyRequest(100, 7, "coap://10.0.0.2/temp"), device).empty());
+
+  // WHEN the server does not respond within the timeout
+  time_ += std::chrono::seconds(5);
+  const auto sent = conn->sentMessages_.size();
+  messaging.loopOnce();
+
+  // THEN the device receives 5.04 (besides the retransmissions of the upstream request)
+  std::vector<Message> downstream;
+  for (auto i = sent; i < conn->sentMessages_.size(); ++i) {
+    if (conn->sentMessages_[i].token() == 7U) downstream.push_back(conn->sentMessages_[i]);
+  }
+  ASSERT_EQ(1U, downstream.size());
+  EXPECT_EQ(Code::GatewayTimeout, downstream[0].code());
+  EXPECT_EQ(100, downstream[0].messageId());
+}
+
+TEST_F(ProxyTest, CachedResponsesAreServedUntilTheyExpire) {
+  // GIVEN a caching proxy and a response with Max-Age 30s
+  ProxyOptions options;
+  options.forwardProxy = true;
+  options.cacheSize = 10;
+  messaging.enableProxy(options);
+  auto upstream = receive(proxyRequest(100, 7, "coap://10.0.0.2/temp"), device);
+  ASSERT_EQ(1U, upstream.size());
+  auto response = Message(Type::Acknowledgement, upstream[0].messageId(), Code::Content, upstream[0].token(),
+                          "", "21.5");
+  response.withMaxAge(30);
+  receive(response, backend);
+
+  // WHEN the resource is requested again within the Max-Age
+  time_ += std::chrono::seconds(10);
+  auto cached = receive(proxyRequest(101, 8, "coap://10.0.0.2/temp"), device);
+
+  // THEN the response is served from the cache with the remaining Max-Age
+  ASSERT_EQ(1U, cached.size());
+  EXPECT_EQ(8U, cached[0].token());
+  EXPECT_EQ("21.5", cached[0].payload());
+  EXPECT_EQ(20U, cached[0].optionalMaxAge().value());
+
+  // AND other content formats are requested from the server
+  auto cbor = proxyRequest(102, 9, "coap://10.0.0.2/temp");
+  cbor.withAccept(ContentFormat::Cbor);
+  upstream = receive(cbor, device);
+  ASSERT_EQ(1U, upstream.size());
+  EXPECT_EQ(ContentFormat::Cbor, upstream[0].optionalAccept().value());
+
+  // WHEN the Max-Age passed
+  time_ += std::chrono::seconds(20);
+  upstream = receive(proxyRequest(103, 10, "coap://10.0.0.2/temp"), device);
+
+  // THEN the request is forwarded again
+  ASSERT_EQ(1U, upstream.size());
+  EXPECT_EQ("/temp", upstream[0].path());
+}
@@ -0,0 +1,105 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "Resolver.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+
+class ResolverTest: public testing::Test {
+ public:
+  ResolverTest()
+      : time_(std::chrono::steady_clock::now()),
+        resolver_([this](const std::string& hostname) { return this->lookup(hostname); },
+                  std::chrono::seconds(10),
+                  std::chrono::seconds(2),
+                  [this]() { return this->time_.load(); }) {
+  }
+
+ protected:
+  CoAP::Endpoint lookup(const std::string& hostname) {
+    ++lookups_;
+    if (hostname == "unavailable.local") throw std::runtime_error("Server name could not be resolved.");
+    return CoAP::Endpoint(htonl(0x0a000001), 0);
+  }
+
+  std::atomic<std::chrono::time_point<std::chrono::steady_clock>> time_;
+  std::atomic<unsigned> lookups_{0};
+  CoAP::Resolver resolver_;
+};
+
+TEST_F(ResolverTest, NumericAddressNeedsNoLookup) {
+  auto address = resolver_.resolve("192.168.1.2");
+
+  ASSERT_EQ(std::future_status::ready, address.wait_for(std::chrono::seconds(0)));
+  EXPECT_EQ(inet_addr("192.168.1.2"), address.get().ipv4());
+  EXPECT_EQ(0U, lookups_);
+}
+
+TEST_F(ResolverTest, NumericIPv6AddressNeedsNoLookup) {
+  auto address = resolver_.resolve("fe80::1%1");
+
+  ASSERT_EQ(std::future_status::ready, address.wait_for(std::chrono::seconds(0)));
+  EXPECT_TRUE(address.get().isIPv6());
+  EXPECT_EQ(1U, address.get().scopeId());
+  EXPECT_EQ(0U, lookups_);
+}
+
+TEST_F(ResolverTest, RepeatedLookupsAreCached) {
+  // GIVEN a resolved host name
+  EXPECT_EQ(htonl(0x0a000001), resolver_.resolve("device.local").get().ipv4());
+
+  // WHEN it is resolved again within the TTL
+  time_ = time_.load() + std::chrono::seconds(9);
+  EXPECT_EQ(htonl(0x0a000001), resolver_.resolve("device.local").get().ipv4());
+
+  // THEN no further lookup is done
+  EXPECT_EQ(1U, lookups_);
+
+  // BUT after the TTL it is looked up again
+  time_ = time_.load() + std::chrono::seconds(2);
+  EXPECT_EQ(htonl(0x0a000001), resolver_.resolve("device.local").get().ipv4());
+  EXPECT_EQ(2U, lookups_);
+}
+
+TEST_F(ResolverTest, FailedLookupsAreCached) {
+  // GIVEN a host name that could not be resolved
+  EXPECT_THROW(resolver_.resolve("unavailable.local").get(), std::runtime_error);
+
+  // WHEN it is resolved again within the negative TTL
+  // THEN it fails without a further lookup
+  time_ = time_.load() + std::chrono::seconds(1);
+  EXPECT_THROW(resolver_.resolve("unavailable.local").get(), std::runtime_error);
+  EXPECT_EQ(1U, lookups_);
+
+  // BUT after the negative TTL it is looked up again
+  time_ = time_.load() + std::chrono::seconds(2);
+  EXPECT_THROW(resolver_.resolve("unavailable.local").get(), std::runtime_error);
+  EXPECT_EQ(2U, lookups_);
+}
+
+TEST(Resolver, SlowLookupsDoNotDelayOtherNames) {
+  // GIVEN a resolver whose lookup of one name hangs
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  CoAP::Resolver resolver([released](const std::string& hostname) {
+    if (hostname == "slow.local") released.wait();
+    return CoAP::Endpoint(htonl(0x0a000002), 0);
+  });
+  auto slow = resolver.resolve("slow.local");
+
+  // WHEN another name is resolved
+  auto fast = resolver.resolve("fast.local");
+
+  // THEN it is resolved while the slow lookup is pending
+  ASSERT_EQ(std::future_status::ready, fast.wait_for(std::chrono::seconds(5)));
+  EXPECT_EQ(std::future_status::timeout, slow.wait_for(std::chrono::seconds(0)));
+
+  release.set_value();
+  EXPECT_EQ(htonl(0x0a000002), slow.get().ipv4());
+}
@@ -0,0 +1,210 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ConnectionMock.h"
+#include "Messaging.h"
+#include "ResourceDirectory.h"
+#include "ServerImpl.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using namespace CoAP;
+
+class ResourceDirectoryTest: public testing::Test {
+ public:
+  ResourceDirectoryTest()
+      : conn(new ConnectionMock()),
+        time_(std::chrono::steady_clock::now()),
+        messaging(conn, [this]() { return this->time_; }) {
+  }
+
+ protected:
+  RestResponse request(Code code, const std::string& uri, const std::string& payload = "") {
+    return messaging.getServer().onRequest(Message(Type::NonConfirmable, 100, code, 7, uri, payload), device);
+  }
+
+  std::shared_ptr<ConnectionMock> conn;
+  std::chrono::time_point<std::chrono::steady_clock> time_;
+  Messaging messaging;
+
+  const Endpoint device{htonl(0x0a000003), 5683};
+  const std::string links = "</sensors/temp>;rt=\"temperature-c\";if=sensor,</led>;rt=\"light switch\";ct=0";
+};
+
+TEST_F(ResourceDirectoryTest, RegistersAndLooksUpEndpoints) {
+  // GIVEN a resource directory
+  messaging.enableResourceDirectory();
+
+  // WHEN an endpoint registers its links
+  auto registration = Message(Type::NonConfirmable, 100, Code::POST, 7, "/rd?ep=node1&base=coap://10.0.0.3&lt=600",
+                              links);
+  registration.withContentFormat(ContentFormat::LinkFormat);
+  conn->addMessageToReceive(registration, device);
+  messaging.loopOnce();
+
+  // THEN it is created at the location of the registration
+  ASSERT_EQ(1U, conn->sentMessages_.size());
+  EXPECT_EQ(Code::Created, conn->sentMessages_[0].code());
+  EXPECT_EQ("/rd/1", conn->sentMessages_[0].optionalLocationPath().value());
+
+  // AND its resources are found by resource type with absolute URIs
+  auto response = request(Code::GET, "/rd-lookup/res?rt=temperature-c");
+  EXPECT_EQ(Code::Content, response.code());
+  EXPECT_EQ(ContentFormat::LinkFormat, response.contentFormat());
+  EXPECT_EQ("<coap://10.0.0.3/sensors/temp>;rt=\"temperature-c\";if=sensor;anchor=\"coap://10.0.0.3\"",
+            response.payload());
+
+  // AND each of several resource types and wildcards match
+  EXPECT_EQ("<coap://10.0.0.3/led>;rt=\"light switch\";ct=0;anchor=\"coap://10.0.0.3\"",
+            request(Code::GET, "/rd-lookup/res?rt=switch").payload());
+  EXPECT_EQ(links.size() + 2 * strlen(";anchor=\"coap://10.0.0.3\"") + 2 * strlen("coap://10.0.0.3"),
+            request(Code::GET, "/rd-lookup/res?ep=node*").payload().size());
+
+  // AND the endpoint is found by the interface of its resources
+  EXPECT_EQ("</rd/1>;ep=\"node1\";base=\"coap://10.0.0.3\";rt=core.rd-ep",
+            request(Code::GET, "/rd-lookup/ep?if=sensor").payload());
+  EXPECT_EQ("", request(Code::GET, "/rd-lookup/ep?if=actuator").payload());
+
+  // AND the registration returns the links as registered
+  EXPECT_EQ(links, request(Code::GET, "/rd/1").payload());
+}
+
+TEST_F(ResourceDirectoryTest, RegistrationsAreReplacedUpdatedAndRemoved) {
+  // GIVEN a registered endpoint
+  messaging.enableResourceDirectory();
+  ASSERT_EQ("/rd/1", request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3", links).locationPath());
+
+  // WHEN it registers again with other links
+  auto response = request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3/", "</humidity>;rt=humidity");
+
+  // THEN the registration is replaced at the same location
+  EXPECT_EQ(Code::Created, response.code());
+  EXPECT_EQ("/rd/1", response.locationPath());
+  EXPECT_EQ("", request(Code::GET, "/rd-lookup/res?rt=temperature-c").payload());
+  EXPECT_EQ("<coap://10.0.0.3/humidity>;rt=humidity;anchor=\"coap://10.0.0.3\"",
+            request(Code::GET, "/rd-lookup/res?rt=humidity").payload());
+
+  // AND endpoints of other sectors are registered separately
+  EXPECT_EQ("/rd/2", request(Code::POST, "/rd?ep=node1&d=lab&base=coap://10.0.0.4", links).locationPath());
+  EXPECT_EQ("</rd/2>;ep=\"node1\";d=\"lab\";base=\"coap://10.0.0.4\";rt=core.rd-ep",
+            request(Code::GET, "/rd-lookup/ep?d=lab").payload());
+
+  // WHEN the registration is updated
+  // THEN its base changes
+  EXPECT_EQ(Code::Changed, request(Code::POST, "/rd/1?base=coap://10.0.0.5").code());
+  EXPECT_EQ("<coap://10.0.0.5/humidity>;rt=humidity;anchor=\"coap://10.0.0.5\"",
+            request(Code::GET, "/rd-lookup/res?rt=humidity").payload());
+
+  // WHEN the registration is removed
+  EXPECT_EQ(Code::Deleted, request(Code::DELETE, "/rd/1").code());
+
+  // THEN it is neither found nor updated anymore
+  EXPECT_EQ("", request(Code::GET, "/rd-lookup/res?rt=humidity").payload());
+  EXPECT_EQ(Code::NotFound, request(Code::GET, "/rd/1").code());
+  EXPECT_EQ(Code::NotFound, request(Code::POST, "/rd/1").code());
+  EXPECT_EQ(Code::NotFound, request(Code::DELETE, "/rd/1").code());
+}
+
+TEST_F(ResourceDirectoryTest, RegistrationsExpireAfterTheirLifetime) {
+  // GIVEN a registration with a lifetime of 60s
+  messaging.enableResourceDirectory();
+  request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3&lt=60", links);
+
+  // WHEN it is updated with a lifetime of 120s after 50s
+  time_ += std::chrono::seconds(50);
+  EXPECT_EQ(Code::Changed, request(Code::POST, "/rd/1?lt=120").code());
+
+  // THEN it does not expire after the first lifetime
+  time_ += std::chrono::seconds(60);
+  messaging.loopOnce();
+  EXPECT_EQ(Code::Content, request(Code::GET, "/rd/1").code());
+
+  // BUT after the lifetime of the update
+  time_ += std::chrono::seconds(60);
+  messaging.loopOnce();
+  EXPECT_EQ(Code::NotFound, request(Code::GET, "/rd/1").code());
+  EXPECT_EQ("", request(Code::GET, "/rd-lookup/ep?ep=node1").payload());
+}
+
+TEST_F(ResourceDirectoryTest, LookupsArePaginated) {
+  // GIVEN 5 registered endpoints
+  messaging.enableResourceDirectory();
+  for (int i = 1; i <= 5; ++i) {
+    request(Code::POST, "/rd?ep=node" + std::to_string(i) + "&base=coap://10.0.0." + std::to_string(i), links);
+  }
+
+  // WHEN the second page of 2 endpoints is looked up
+  auto response = request(Code::GET, "/rd-lookup/ep?page=1&count=2");
+
+  // THEN the third and fourth endpoint are returned
+  EXPECT_EQ("</rd/3>;ep=\"node3\";base=\"coap://10.0.0.3\";rt=core.rd-ep,"
+            "</rd/4>;ep=\"node4\";base=\"coap://10.0.0.4\";rt=core.rd-ep", response.payload());
+
+  // AND pages count the links of resource lookups
+  EXPECT_EQ("<coap://10.0.0.2/sensors/temp>;rt=\"temperature-c\";if=sensor;anchor=\"coap://10.0.0.2\"",
+            request(Code::GET, "/rd-lookup/res?page=2&count=1").payload());
+  EXPECT_EQ("", request(Code::GET, "/rd-lookup/ep?page=5&count=1").payload());
+  EXPECT_EQ(Code::BadRequest, request(Code::GET, "/rd-lookup/ep?count=0").code());
+}
+
+TEST_F(ResourceDirectoryTest, InvalidRegistrationsAreRejected) {
+  // GIVEN a resource directory for one endpoint
+  ResourceDirectoryOptions options;
+  options.maxRegistrations = 1;
+  messaging.enableResourceDirectory(options);
+  EXPECT_THROW(messaging.enableResourceDirectory(options), std::logic_error);
+
+  // THEN registrations without endpoint name or base, malformed links and lifetimes are rejected
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?base=coap://10.0.0.3", links).code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1", links).code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3", "/temp;rt=x").code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3", "</temp>;rt=\"x").code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3&lt=1h", links).code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1&base=/", links).code());
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd?ep=node1&base=///", links).code());
+
+  // AND further endpoints are rejected when the directory is full
+  EXPECT_EQ(Code::Created, request(Code::POST, "/rd?ep=node1&base=coap://10.0.0.3", links).code());
+  EXPECT_EQ(Code::ServiceUnavailable, request(Code::POST, "/rd?ep=node2&base=coap://10.0.0.4", links).code());
+
+  // AND updates with an empty base are rejected without changing the registration
+  EXPECT_EQ(Code::BadRequest, request(Code::POST, "/rd/1?lt=60&base=/").code());
+  EXPECT_EQ("</rd/1>;ep=\"node1\";base=\"coap://10.0.0.3\";rt=core.rd-ep",
+            request(Code::GET, "/rd-lookup/ep").payload());
+}
+
+TEST_F(ResourceDirectoryTest, WellKnownCoreListsTheEntryPoints) {
+  // GIVEN a resource directory
+  messaging.enableResourceDirectory();
+
+  // THEN its entry points are discovered, filtered by resource type
+  EXPECT_EQ("</rd>;rt=core.rd;ct=40,</rd-lookup/ep>;rt=core.rd-lookup-ep;ct=40,"
+            "</rd-lookup/res>;rt=core.rd-lookup-res;ct=40", request(Code::GET, "/.well-known/core").payload());
+  EXPECT_EQ("</rd-lookup/ep>;rt=core.rd-lookup-ep;ct=40,</rd-lookup/res>;rt=core.rd-lookup-res;ct=40",
+            request(Code::GET, "/.well-known/core?rt=core.rd-lookup*").payload());
+}
+
+TEST_F(ResourceDirectoryTest, LookupsUseTheIndexesWith100kEndpoints) {
+  // GIVEN 100k registered endpoints, of which every 1000th has a rare resource type
+  messaging.enableResourceDirectory();
+  for (int i = 0; i < 100000; ++i) {
+    const auto resourceType = (i % 1000 == 0) ? "rare" : "common";
+    request(Code::POST, "/rd?ep=node" + std::to_string(i) + "&base=coap://10.0.0.1:" + std::to_string(i),
+            std::string("</temp>;rt=") + resourceType);
+  }
+
+  // WHEN endpoints are looked up by name and resource type
+  const auto start = std::chrono::steady_clock::now();
+  const auto byName = request(Code::GET, "/rd-lookup/ep?ep=node99999");
+  const auto byResourceType = request(Code::GET, "/rd-lookup/res?rt=rare&count=1000");
+  const auto duration = std::chrono::steady_clock::now() - start;
+
+  // THEN the endpoints are found without visiting all registrations
+  EXPECT_EQ("</rd/100000>;ep=\"node99999\";base=\"coap://10.0.0.1:99999\";rt=core.rd-ep", byName.payload());
+  const auto links = byResourceType.payload();
+  EXPECT_EQ(100, std::count(links.begin(), links.end(), '<'));
+  EXPECT_LT(duration, std::chrono::milliseconds(100));
+}
@@ -6,6 +6,7 @@
 #include "Messaging.h"
 #include "ServerImpl.h"
 #include "Path.h"
+#include "Representations.h"
 
 #include "gtest/gtest.h"
 
@@ -27,7 +28,7 @@ TEST(ServerImpl_onMessage, NoAcknowledgeForNonConfirmableMessage) {
   auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::GET, 0, "/");
 
   // WHEN the NonConfirmable message is sent to the server
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN we only get the answer back, but no acknowledge for reception of the message
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -59,7 +60,7 @@ TEST(ServerImpl_onMessage, AcknowledgeForConfirmableMessage) {
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::GET, 0, "/");
 
   // WHEN
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN
   ASSERT_EQ(2U, conn->sentMessages_.size());
@@ -80,7 +81,7 @@ TEST(ServerImpl_onMessage, NoAcknowledgeForConfirmableMessageOnInvalidRessource)
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::GET, 0, "/xyz");
 
   // WHEN
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -101,7 +102,7 @@ TEST(ServerImpl_onRequest, PiggybackedResponseForGET) {
 
   // WHEN it receives a confirmable message with a GET request
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::GET, 0, "/");
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN it sends an ACK message with a piggybacked response
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -122,7 +123,7 @@ TEST(ServerImpl_onRequest, PiggybackedResponseForPUT) {
 
   // WHEN it receives a confirmable message with a GET request
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::PUT, 0, "/");
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN it sends an ACK message with a piggybacked response
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -142,7 +143,7 @@ TEST(ServerImpl_onRequest, PiggybackedResponseForPOST) {
 
   // WHEN it receives a confirmable message with a GET request
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::POST, 0, "/");
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN it sends an ACK message with a piggybacked response
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -162,7 +163,7 @@ TEST(ServerImpl_onRequest, PiggybackedResponseForDELETE) {
 
   // WHEN it receives a confirmable message with a GET request
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::DELETE, 0, "/");
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN it sends an ACK message with a piggybacked response
   ASSERT_EQ(1U, conn->sentMessages_.size());
@@ -184,7 +185,7 @@ TEST(ServerImpl_onRequest, DelegatesGetRequestAndReceivesResponse) {
   auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::GET, 0, "/some/where");
 
   // WHEN NonConfirmable message with GET request is sent to the Server
-  auto reply = srv.getServer().onRequest(msg, 0, 0);
+  auto reply = srv.getServer().onRequest(msg, CoAP::Endpoint());
 
   // THEN RequestHandler GET is called with the message and an reply is sent
   EXPECT_EQ(1, getCalled);
@@ -206,7 +207,7 @@ TEST(ServerImpl_onRequest, DelegatesPutRequestAndReceivesResponse) {
   auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::PUT, 0, "/some/where");
 
   // WHEN NonConfirmable message with PUT request is sent to the Server
-  auto reply = srv.getServer().onRequest(msg, 0, 0);
+  auto reply = srv.getServer().onRequest(msg, CoAP::Endpoint());
 
   // THEN RequestHandler PUT is called with the message and an reply is sent
   EXPECT_EQ(1, putCalled);
@@ -228,7 +229,7 @@ TEST(ServerImpl_onRequest, DelegatesPostRequestAndReceivesResponse) {
   auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::POST, 0, "/some/where");
 
   // WHEN NonConfirmable message with POST request is sent to the Server
-  auto reply = srv.getServer().onRequest(msg, 0, 0);
+  auto reply = srv.getServer().onRequest(msg, CoAP::Endpoint());
 
   // THEN RequestHandler POST is called with the message and an reply is sent
   EXPECT_EQ(1, postCalled);
@@ -250,7 +251,7 @@ TEST(ServerImpl_onRequest, DelegatesDeleteRequestAndReceivesResponse) {
   auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::DELETE, 0, "/some/where");
 
   // WHEN NonConfirmable message with DELETE request is sent to the Server
-  auto reply = srv.getServer().onRequest(msg, 0, 0);
+  auto reply = srv.getServer().onRequest(msg, CoAP::Endpoint());
 
   // THEN RequestHandler DELETE is called with the message and an reply is sent
   EXPECT_EQ(1, deleteCalled);
@@ -278,7 +279,7 @@ TEST(ServerImpl_onRequest, DelegatesObserveRequestAndReceivesNotification) {
       .withObserveValue(0);
 
   // WHEN NonConfirmable message with GET request is sent with OBSERVE=0 to the Server
-  auto reply = srv.getServer().onRequest(msg, 0, 0);
+  auto reply = srv.getServer().onRequest(msg, CoAP::Endpoint());
 
   // THEN RequestHandler OBSERVE is called with the message and an reply is sent
   EXPECT_EQ(1, observeCalled);
@@ -316,9 +317,9 @@ TEST(ServerImpl_onRequest, DelegatesObserveRequestAndCancelsNotifications) {
           .withObserveValue(1);
 
   // WHEN NonConfirmable message with GET request is sent with OBSERVE=1 to the Server
-  auto observeReply = srv.getServer().onRequest(observeMsg, 0, 0);
+  auto observeReply = srv.getServer().onRequest(observeMsg, CoAP::Endpoint());
   notifications.lock()->onNext(CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("Notification"));
-  auto unobserveReply = srv.getServer().onRequest(unobserveMsg, 0, 0);
+  auto unobserveReply = srv.getServer().onRequest(unobserveMsg, CoAP::Endpoint());
 
   // THEN the notification observer is canceled
   EXPECT_EQ(true, notifications.expired());
@@ -346,9 +347,9 @@ TEST(ServerImpl_onRequest, RejectedNotificationCancelsObservation) {
 
   // WHEN NonConfirmable message with GET request is sent to the Server and the first
   //      notification is answered with Reset
-  auto observeReply = srv.getServer().onRequest(observeMsg, 0, 0);
+  auto observeReply = srv.getServer().onRequest(observeMsg, CoAP::Endpoint());
   notifications.lock()->onNext(CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("Notification"));
-  srv.getServer().onMessage(CoAP::Message(CoAP::Type::Reset, 0, CoAP::Code::GET, 0, "/some/where"), 0, 0);
+  srv.getServer().onMessage(CoAP::Message(CoAP::Type::Reset, 0, CoAP::Code::GET, 0, "/some/where"), CoAP::Endpoint());
 
   // THEN the notification observer is canceled
   EXPECT_EQ(true, notifications.expired());
@@ -361,10 +362,113 @@ TEST(ServerImpl_onMessage, EmptyRequestCausesPingResponse) {
 
   // WHEN
   auto msg = CoAP::Message(CoAP::Type::Confirmable, 0, CoAP::Code::Empty, 0, "");
-  srv.onMessage(msg, 0, 0);
+  srv.onMessage(msg, CoAP::Endpoint());
 
   // THEN
   ASSERT_EQ(1U, conn->sentMessages_.size());
   EXPECT_EQ(CoAP::Type::Reset, conn->sentMessages_[0].type());
   EXPECT_EQ(CoAP::Code::Empty, conn->sentMessages_[0].code());
-}
\ No newline at end of file
+}
+
+TEST(ServerImpl_onMulticastMessage, ResponseIsDeferredWithinLeisure) {
+  // GIVEN a server with a leisure of one second
+  auto conn = std::make_shared<ConnectionMock>();
+  auto time = std::chrono::steady_clock::now();
+  CoAP::Messaging srv(conn, [&time]() { return time; });
+  srv.setMulticastLeisure(std::chrono::seconds(1));
+  srv.requestHandler()
+      .onUri("/")
+          .onGet([](const Path&){
+            return CoAP::RestResponse().withCode(CoAP::Code::Content);
+          });
+
+  // WHEN requests are received via multicast
+  for (CoAP::MessageId id = 0; id < 20; ++id) {
+    conn->addMessageToReceive(CoAP::Message(CoAP::Type::NonConfirmable, id, CoAP::Code::GET, id, "/"), true);
+  }
+  for (auto i = 0; i < 20; ++i) srv.loopOnce();
+
+  // THEN the responses are spread over the leisure period
+  EXPECT_GT(20U, conn->sentMessages_.size());
+
+  time += std::chrono::seconds(1);
+  srv.loopOnce();
+  ASSERT_EQ(20U, conn->sentMessages_.size());
+  EXPECT_EQ(CoAP::Type::NonConfirmable, conn->sentMessages_[0].type());
+  EXPECT_EQ(CoAP::Code::Content, conn->sentMessages_[0].code());
+}
+
+TEST(ServerImpl_onMulticastMessage, ErrorResponsesAreSuppressed) {
+  // GIVEN a server without handler for the requested resource
+  auto conn = std::make_shared<ConnectionMock>();
+  auto time = std::chrono::steady_clock::now();
+  CoAP::Messaging srv(conn, [&time]() { return time; });
+
+  // WHEN a request is received via multicast
+  conn->addMessageToReceive(CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::GET, 0, "/unknown"), true);
+  srv.loopOnce();
+
+  // THEN no response is sent at all
+  time += std::chrono::seconds(10);
+  srv.loopOnce();
+  EXPECT_EQ(0U, conn->sentMessages_.size());
+}
+
+TEST(ServerImpl_onRequest, NegotiatesTheContentFormatWithAccept) {
+  // GIVEN a resource offered as JSON and CBOR
+  auto conn = std::make_shared<ConnectionMock>();
+  CoAP::Messaging srv(conn);
+  srv.requestHandler()
+      .onUri("/values")
+          .onGet([](const Path&){
+            return CoAP::withValue(CoAP::RestResponse().withCode(CoAP::Code::Content), std::list<int>{1, 2, 3});
+          });
+  auto request = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::GET, 0, "/values");
+
+  // WHEN it is requested without Accept option
+  // THEN it is returned in the first content format
+  auto reply = srv.getServer().onRequest(request, CoAP::Endpoint());
+  EXPECT_EQ(CoAP::Code::Content, reply.code());
+  EXPECT_EQ(CoAP::ContentFormat::Json, reply.contentFormat());
+  EXPECT_EQ("[1,2,3]", reply.payload());
+
+  // WHEN it is requested as CBOR
+  // THEN it is returned as CBOR
+  reply = srv.getServer().onRequest(request.withAccept(CoAP::ContentFormat::Cbor), CoAP::Endpoint());
+  EXPECT_EQ(CoAP::Code::Content, reply.code());
+  EXPECT_EQ(CoAP::ContentFormat::Cbor, reply.contentFormat());
+  EXPECT_EQ(std::string("\x83\x01\x02\x03"), reply.payload());
+
+  // WHEN it is requested in a content format that is not offered
+  // THEN it is not acceptable
+  reply = srv.getServer().onRequest(request.withAccept(CoAP::ContentFormat::TextPlain), CoAP::Endpoint());
+  EXPECT_EQ(CoAP::Code::NotAcceptable, reply.code());
+  EXPECT_FALSE(reply.hasContentFormat());
+  EXPECT_EQ("", reply.payload());
+}
+
+TEST(ServerImpl_onRequest, NotificationsUseTheContentFormatOfTheObservation) {
+  // GIVEN an observation that accepts CBOR
+  auto conn = std::make_shared<ConnectionMock>();
+  CoAP::Messaging srv(conn);
+  std::weak_ptr<CoAP::Notifications> notifications;
+  srv.requestHandler()
+      .onUri("/value")
+        .onObserve([&notifications](const Path&, std::weak_ptr<CoAP::Notifications> observer){
+          notifications = observer;
+          return CoAP::withValue(CoAP::RestResponse().withCode(CoAP::Code::Content), 1);
+        });
+  auto observeMsg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::GET, 0, "/value")
+      .withObserveValue(0)
+      .withAccept(CoAP::ContentFormat::Cbor);
+  srv.getServer().onRequest(observeMsg, CoAP::Endpoint());
+
+  // WHEN a notification is sent
+  notifications.lock()->onNext(CoAP::withValue(CoAP::RestResponse().withCode(CoAP::Code::Content), 24));
+
+  // THEN it is encoded as CBOR
+  ASSERT_EQ(1U, conn->sentMessages_.size());
+  ASSERT_TRUE(conn->sentMessages_[0].optionalContentFormat());
+  EXPECT_EQ(CoAP::ContentFormat::Cbor, conn->sentMessages_[0].optionalContentFormat().value());
+  EXPECT_EQ(std::string("\x18\x18"), conn->sentMessages_[0].payload());
+}
@@ -0,0 +1,197 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "CoAP.h"
+#include "RequestHandlers.h"
+#include "ShmConnection.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const auto clientEndpoint = CoAP::Endpoint(inet_addr("127.0.0.1"), 40000);
+const auto serverEndpoint = CoAP::Endpoint(inet_addr("127.0.0.1"), 5683);
+
+std::vector<uint8_t> message(size_t size, uint8_t fill) {
+  return std::vector<uint8_t>(size, fill);
+}
+
+}  // namespace
+
+TEST(ShmConnection, FailWhenConnectionIsNotOpen) {
+  // GIVEN a connection that was neither created nor attached
+  CoAP::ShmConnection conn;
+
+  // WHEN we call the functions send or get
+  // THEN we shall get an exception
+  EXPECT_THROW(conn.send(CoAP::Telegram(serverEndpoint, message(1, 0))), std::logic_error);
+  EXPECT_THROW(conn.get(std::chrono::milliseconds(0)), std::logic_error);
+}
+
+TEST(ShmConnection, ExchangeInBothDirections) {
+  // GIVEN a connection and its peer attached to the same shared memory
+  CoAP::ShmConnection client;
+  CoAP::ShmConnection server;
+  client.create(clientEndpoint, serverEndpoint);
+  server.attach(client.fd());
+  EXPECT_EQ(serverEndpoint, server.self());
+  EXPECT_EQ(clientEndpoint, server.peer());
+
+  // WHEN telegrams are sent in both directions
+  client.send(CoAP::Telegram(serverEndpoint, message(10, 1)));
+  server.send(CoAP::Telegram(clientEndpoint, message(20, 2)));
+
+  // THEN they are received from the peer endpoint
+  auto request = server.get(std::chrono::milliseconds(0));
+  ASSERT_TRUE(request);
+  EXPECT_EQ(clientEndpoint, request.value().getEndpoint());
+  EXPECT_EQ(message(10, 1), request.value().getMessage());
+
+  auto response = client.get(std::chrono::milliseconds(0));
+  ASSERT_TRUE(response);
+  EXPECT_EQ(serverEndpoint, response.value().getEndpoint());
+  EXPECT_EQ(message(20, 2), response.value().getMessage());
+
+  EXPECT_FALSE(client.get(std::chrono::milliseconds(0)));
+}
+
+TEST(ShmConnection, OnlyThePeerIsReachable) {
+  // GIVEN a created connection
+  CoAP::ShmConnection client;
+  client.create(clientEndpoint, serverEndpoint);
+
+  // WHEN a telegram is sent to another endpoint
+  // THEN we shall get an exception
+  EXPECT_THROW(client.send(CoAP::Telegram(serverEndpoint.withPort(5684), message(1, 0))), std::runtime_error);
+}
+
+TEST(ShmConnection, TelegramsWrapAroundTheRing) {
+  // GIVEN a connection with a small ring
+  CoAP::ShmConnection client;
+  CoAP::ShmConnection server;
+  client.create(clientEndpoint, serverEndpoint, 1024);
+  server.attach(client.fd());
+
+  // WHEN many telegrams of varying sizes pass through it
+  for (unsigned i = 0; i < 1000; ++i) {
+    client.send(CoAP::Telegram(serverEndpoint, message(i % 300, static_cast<uint8_t>(i))));
+    if (i % 2) client.send(CoAP::Telegram(serverEndpoint, message(7, static_cast<uint8_t>(i))));
+
+    // THEN every telegram is received unchanged and in order
+    auto telegram = server.get(std::chrono::milliseconds(0));
+    ASSERT_TRUE(telegram);
+    EXPECT_EQ(message(i % 300, static_cast<uint8_t>(i)), telegram.value().getMessage());
+    if (i % 2) {
+      telegram = server.get(std::chrono::milliseconds(0));
+      ASSERT_TRUE(telegram);
+      EXPECT_EQ(message(7, static_cast<uint8_t>(i)), telegram.value().getMessage());
+    }
+  }
+  EXPECT_EQ(0, client.dropped());
+}
+
+TEST(ShmConnection, TelegramsAreDroppedWhenTheRingIsFull) {
+  // GIVEN a connection with a small ring
+  CoAP::ShmConnection client;
+  CoAP::ShmConnection server;
+  client.create(clientEndpoint, serverEndpoint, 1024);
+  server.attach(client.fd());
+
+  // WHEN more telegrams are sent than fit into the ring
+  for (int i = 0; i < 10; ++i) client.send(CoAP::Telegram(serverEndpoint, message(200, static_cast<uint8_t>(i))));
+
+  // THEN the surplus is dropped and the rest is received
+  EXPECT_EQ(6, client.dropped());
+  for (int i = 0; i < 4; ++i) {
+    auto telegram = server.get(std::chrono::milliseconds(0));
+    ASSERT_TRUE(telegram);
+    EXPECT_EQ(message(200, static_cast<uint8_t>(i)), telegram.value().getMessage());
+  }
+  EXPECT_FALSE(server.get(std::chrono::milliseconds(0)));
+}
+
+TEST(ShmConnection, WaitingReceiverIsWokenUp) {
+  // GIVEN a receiver waiting for a telegram
+  CoAP::ShmConnection client;
+  CoAP::ShmConnection server;
+  client.create(clientEndpoint, serverEndpoint);
+  server.attach(client.fd());
+
+  std::thread sender([&client]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    client.send(CoAP::Telegram(serverEndpoint, message(4, 4)));
+  });
+
+  // WHEN the telegram is sent while it waits
+  const auto start = std::chrono::steady_clock::now();
+  auto telegram = server.get(std::chrono::milliseconds(5000));
+  sender.join();
+
+  // THEN it is received long before the timeout
+  ASSERT_TRUE(telegram);
+  EXPECT_GT(std::chrono::seconds(2), std::chrono::steady_clock::now() - start);
+}
+
+TEST(ShmConnection, ExchangeBetweenProcesses) {
+  // GIVEN a child process attached to the shared memory
+  CoAP::ShmConnection client;
+  client.create(clientEndpoint, serverEndpoint);
+
+  auto pid = fork();
+  ASSERT_LE(0, pid);
+  if (pid == 0) {
+    // The child echoes one telegram reversed
+    CoAP::ShmConnection server;
+    server.attach(client.fd());
+    auto telegram = server.get(std::chrono::milliseconds(5000));
+    if (telegram) {
+      auto data = telegram.value().getMessage();
+      std::reverse(data.begin(), data.end());
+      server.send(CoAP::Telegram(clientEndpoint, data));
+    }
+    _exit(telegram ? 0 : 1);
+  }
+
+  // WHEN a telegram is sent to it
+  client.send(CoAP::Telegram(serverEndpoint, {1, 2, 3}));
+
+  // THEN the child answers through the shared memory
+  auto reply = client.get(std::chrono::milliseconds(5000));
+  int status = 0;
+  waitpid(pid, &status, 0);
+  ASSERT_TRUE(reply);
+  EXPECT_EQ(std::vector<uint8_t>({3, 2, 1}), reply.value().getMessage());
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+TEST(ShmConnection, Messaging) {
+  // GIVEN a client and a server messaging through shared memory
+  int fd = -1;
+  auto client = CoAP::newShmMessaging(clientEndpoint, serverEndpoint, fd);
+  auto server = CoAP::newShmMessaging(fd);
+
+  server->requestHandler().onUri("sidecar").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("local");
+  });
+
+  // WHEN the client sends a confirmable request to the server endpoint
+  auto shmClient = client->getClientFor("127.0.0.1", 5683);
+  auto response = shmClient.GET("sidecar", true);
+  for (int i = 0; i < 10 && response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready; ++i) {
+    server->loopOnce();
+    client->loopOnce();
+  }
+
+  // THEN the response is received
+  ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  auto r = response.get();
+  EXPECT_EQ(CoAP::Code::Content, r.code());
+  EXPECT_EQ("local", r.payload());
+}
@@ -0,0 +1,216 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "Messaging.h"
+#include "RequestHandlers.h"
+#include "TcpConnection.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const auto localhost = inet_addr("127.0.0.1");
+
+std::vector<uint8_t> datagram(size_t payloadSize) {
+  auto msg = CoAP::Message(CoAP::Type::NonConfirmable, 0, CoAP::Code::Content, 0x4711, "", std::string(payloadSize, 'x'));
+  return msg.asBuffer();
+}
+
+Optional<CoAP::Telegram> receive(CoAP::TcpConnection& conn, CoAP::TcpConnection& other) {
+  for (int i = 0; i < 50; ++i) {
+    auto telegram = conn.get(std::chrono::milliseconds(10));
+    if (telegram) return telegram;
+    other.get(std::chrono::milliseconds(0));
+  }
+  return Optional<CoAP::Telegram>();
+}
+
+}  // namespace
+
+TEST(TcpConnection_Frame, RoundTripWithExtendedLengths) {
+  for (auto payloadSize : {0, 5, 100, 1000, 70000}) {
+    // GIVEN a nonconfirmable message in datagram format
+    auto message = datagram(payloadSize);
+
+    // WHEN it is converted into a frame and back
+    auto frame = CoAP::TcpConnection::toFrame(message);
+
+    // THEN the frame is complete and converts back into the same message
+    EXPECT_EQ(frame.size(), CoAP::TcpConnection::frameSize(frame.data(), frame.size()));
+    EXPECT_EQ(message, CoAP::TcpConnection::toDatagram(frame.data(), frame.size()));
+  }
+}
+
+TEST(TcpConnection_Frame, IncompleteFrameHasNoSize) {
+  // GIVEN a frame with extended length
+  auto frame = CoAP::TcpConnection::toFrame(datagram(300));
+
+  // WHEN only parts of it have been received
+  // THEN it is not complete
+  EXPECT_EQ(0, CoAP::TcpConnection::frameSize(frame.data(), 0));
+  EXPECT_EQ(0, CoAP::TcpConnection::frameSize(frame.data(), 2));
+  EXPECT_EQ(0, CoAP::TcpConnection::frameSize(frame.data(), frame.size() - 1));
+}
+
+TEST(TcpConnection_Send, FailWhenConnectionIsNotOpen) {
+  // GIVEN a connection that was not opened
+  CoAP::TcpConnection conn;
+
+  // WHEN we call the function send
+  // THEN we shall get an exception
+  EXPECT_THROW(conn.send(CoAP::Telegram(localhost, 56840, datagram(0))), std::logic_error);
+}
+
+TEST(TcpConnection_Send, ConfirmableMessagesAreAcknowledgedAndDelivered) {
+  // GIVEN a server and a client connection
+  CoAP::TcpConnection server;
+  CoAP::TcpConnection client;
+  server.open(56840);
+  client.open(0);
+
+  // WHEN the client sends a confirmable message with a payload larger than the default message size
+  auto msg = CoAP::Message(CoAP::Type::Confirmable, 0x1234, CoAP::Code::PUT, 0x4711, "large", std::string(100000, 'x'));
+  client.send(CoAP::Telegram(localhost, 56840, msg.asBuffer()));
+
+  // THEN the client gets the acknowledgement from the transport
+  auto ack = client.get(std::chrono::milliseconds(0));
+  ASSERT_TRUE(ack);
+  EXPECT_EQ(CoAP::Type::Acknowledgement, CoAP::Message::fromBuffer(ack.value().getMessage()).type());
+  EXPECT_EQ(0x1234, CoAP::Message::fromBuffer(ack.value().getMessage()).messageId());
+
+  // AND the server receives the message in one piece
+  auto telegram = receive(server, client);
+  ASSERT_TRUE(telegram);
+  auto received = CoAP::Message::fromBuffer(telegram.value().getMessage());
+  EXPECT_EQ(CoAP::Code::PUT, received.code());
+  EXPECT_EQ(0x4711, received.token());
+  EXPECT_EQ(100000, received.payload().size());
+  EXPECT_EQ(1, server.connections());
+
+  // WHEN the server replies
+  server.send(CoAP::Telegram(telegram.value().getEndpoint(), datagram(10)));
+
+  // THEN the reply is received through the same connection
+  auto reply = receive(client, server);
+  ASSERT_TRUE(reply);
+  EXPECT_EQ(0x4711, CoAP::Message::fromBuffer(reply.value().getMessage()).token());
+  EXPECT_EQ(1, client.connections());
+}
+
+TEST(TcpConnection_Send, RetransmissionsWhileConnectingAreSentOnce) {
+  // GIVEN a server and a client connection
+  CoAP::TcpConnection server;
+  CoAP::TcpConnection client;
+  server.open(56845);
+  client.open(0);
+
+  // WHEN the client retransmits a confirmable message before the connection is established
+  auto msg = CoAP::Message(CoAP::Type::Confirmable, 0x1234, CoAP::Code::POST, 0x4711, "counter");
+  client.send(CoAP::Telegram(localhost, 56845, msg.asBuffer()));
+  client.send(CoAP::Telegram(localhost, 56845, msg.asBuffer()));
+
+  // THEN the server receives the message only once
+  auto telegram = receive(server, client);
+  ASSERT_TRUE(telegram);
+  EXPECT_EQ(CoAP::Code::POST, CoAP::Message::fromBuffer(telegram.value().getMessage()).code());
+  EXPECT_FALSE(receive(server, client));
+}
+
+TEST(TcpConnection_Send, PingIsAnsweredWithReset) {
+  // GIVEN a server and a client connection
+  CoAP::TcpConnection server;
+  CoAP::TcpConnection client;
+  server.open(56841);
+  client.open(0);
+
+  // WHEN the client sends an empty confirmable message
+  auto ping = CoAP::Message(CoAP::Type::Confirmable, 0x0815, CoAP::Code::Empty, 0, "", "");
+  client.send(CoAP::Telegram(localhost, 56841, ping.asBuffer()));
+
+  // THEN it receives the pong as reset with the same message ID
+  auto pong = receive(client, server);
+  ASSERT_TRUE(pong);
+  auto msg = CoAP::Message::fromBuffer(pong.value().getMessage());
+  EXPECT_EQ(CoAP::Type::Reset, msg.type());
+  EXPECT_EQ(0x0815, msg.messageId());
+}
+
+TEST(TcpConnection_Send, ConfirmableMessagesToUnreachablePeersAreNotAcknowledged) {
+  // GIVEN a client connection and a port without server
+  CoAP::TcpConnection client;
+  client.open(0);
+
+  // WHEN the client sends a confirmable message to the port
+  auto msg = CoAP::Message(CoAP::Type::Confirmable, 0x1234, CoAP::Code::GET, 0x4711, "temp");
+  client.send(CoAP::Telegram(localhost, 56843, msg.asBuffer()));
+
+  // THEN the connection fails without acknowledging the message, such that the messaging retransmits it
+  Optional<CoAP::Telegram> ack;
+  for (int i = 0; i < 10 && not ack; ++i) ack = client.get(std::chrono::milliseconds(10));
+  EXPECT_FALSE(ack);
+  EXPECT_EQ(0, client.connections());
+}
+
+TEST(TcpConnection_Receive, OversizedMessagesAbortTheConnection) {
+  // GIVEN a server connection and a client connected to it
+  CoAP::TcpConnection server;
+  server.open(56844);
+  auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  timeval timeout{5, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(56844);
+  address.sin_addr.s_addr = localhost;
+  ASSERT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  for (int i = 0; i < 10 && server.connections() == 0; ++i) server.get(std::chrono::milliseconds(10));
+  ASSERT_EQ(1, server.connections());
+
+  // WHEN the client announces a message larger than the maximum message size
+  const uint8_t header[] = {0xf0, 0xff, 0xff, 0xff, 0xff, 0x45};
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(header)), ::send(fd, header, sizeof(header), MSG_NOSIGNAL));
+  for (int i = 0; i < 10 && server.connections() > 0; ++i) server.get(std::chrono::milliseconds(10));
+
+  // THEN the server aborts the connection without waiting for the message
+  EXPECT_EQ(0, server.connections());
+  std::vector<uint8_t> received;
+  uint8_t buffer[256];
+  ssize_t bytes;
+  while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) received.insert(received.end(), buffer, buffer + bytes);
+  ::close(fd);
+  ASSERT_LE(2U, received.size());
+  EXPECT_EQ((std::vector<uint8_t>{0x00, 0xe5}), std::vector<uint8_t>(received.end() - 2, received.end()));
+}
+
+TEST(TcpConnection_Messaging, RequestAndResponse) {
+  // GIVEN a server and a client messaging over TCP
+  auto serverConnection = std::make_shared<CoAP::TcpConnection>();
+  auto clientConnection = std::make_shared<CoAP::TcpConnection>();
+  serverConnection->open(56842);
+  clientConnection->open(0);
+  CoAP::Messaging server(serverConnection);
+  CoAP::Messaging client(clientConnection);
+
+  server.requestHandler().onUri("large").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload(std::string(10000, 'x'));
+  });
+
+  // WHEN the client requests a large resource with a confirmable request
+  auto tcpClient = client.getClientFor("127.0.0.1", 56842);
+  auto response = tcpClient.GET("large", true);
+  for (int i = 0; i < 50 && response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready; ++i) {
+    server.loopOnce();
+    client.loopOnce();
+  }
+
+  // THEN the complete resource is received without block-wise transfer
+  ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  auto r = response.get();
+  EXPECT_EQ(CoAP::Code::Content, r.code());
+  EXPECT_EQ(10000, r.payload().size());
+}
@@ -0,0 +1,130 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "LoopbackConnection.h"
+
+#include "Connection.h"
+#include "Messaging.h"
+#include "RequestHandlers.h"
+#include "Tracing.h"
+
+#include <arpa/inet.h>
+#include <sstream>
+
+namespace {
+
+std::string chromeTrace(const CoAP::Tracer& tracer) {
+  std::ostringstream os;
+  tracer.exportChromeTrace(os);
+  return os.str();
+}
+
+size_t occurrences(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) ++count;
+  return count;
+}
+
+// Enables the global tracer for the lifetime of the object
+class GlobalTracing {
+ public:
+  GlobalTracing() {
+    CoAP::Tracer::global().clear();
+    CoAP::Tracer::global().enable();
+  }
+
+  ~GlobalTracing() {
+    CoAP::Tracer::global().enable(false);
+    CoAP::Tracer::global().clear();
+  }
+};
+
+}  // namespace
+
+TEST(Tracing, SpansAreExportedInChromeTraceFormat) {
+  // GIVEN a tracer with a span
+  CoAP::Tracer tracer;
+  tracer.record("handler", 4711, 1000001234, 1000003000);
+
+  // WHEN the spans are exported
+  // THEN it is a complete event with microsecond timestamps
+  const auto trace = chromeTrace(tracer);
+  EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"handler\",\"ph\":\"X\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ts\":1000001.234,\"dur\":1.766,\"args\":{\"msgID\":4711}}"));
+}
+
+TEST(Tracing, RingKeepsTheNewestSpans) {
+  // GIVEN a tracer for four spans
+  CoAP::Tracer tracer(4);
+
+  // WHEN six spans are recorded
+  for (uint64_t id = 0; id < 6; ++id) tracer.record("parse", id, 1000, 2000);
+
+  // THEN the last four are exported
+  const auto trace = chromeTrace(tracer);
+  EXPECT_EQ(4, occurrences(trace, "\"ph\":\"X\""));
+  EXPECT_EQ(std::string::npos, trace.find("\"msgID\":1}"));
+  EXPECT_NE(std::string::npos, trace.find("\"msgID\":2}"));
+  EXPECT_NE(std::string::npos, trace.find("\"msgID\":5}"));
+
+  // AND none after clearing
+  tracer.clear();
+  EXPECT_EQ(0, occurrences(chromeTrace(tracer), "\"ph\":\"X\""));
+}
+
+TEST(Tracing, DisabledTracerRecordsNoSpans) {
+  // GIVEN the disabled global tracer
+  CoAP::Tracer::global().clear();
+  ASSERT_FALSE(CoAP::Tracer::global().enabled());
+
+  // WHEN a span ends
+  { CoAP::TraceSpan span("handler", 1); }
+
+  // THEN nothing is recorded
+  EXPECT_EQ(0, occurrences(chromeTrace(CoAP::Tracer::global()), "\"ph\":\"X\""));
+}
+
+TEST(Tracing, KernelTimestampsOfReceivedTelegrams) {
+  // GIVEN tracing and two connections
+  GlobalTracing tracing;
+  CoAP::Connection server;
+  CoAP::Connection client;
+  server.open(56860);
+  client.open(56861);
+  server.get(std::chrono::milliseconds(0));
+
+  // WHEN a telegram is received
+  const auto sent = CoAP::Tracer::now();
+  client.send(CoAP::Telegram(CoAP::Endpoint(htonl(INADDR_LOOPBACK), 56860), std::vector<uint8_t>{1}));
+  auto telegram = server.get(std::chrono::milliseconds(1000));
+
+  // THEN it carries the time the kernel received it
+  ASSERT_TRUE(telegram);
+  EXPECT_LE(sent, telegram.value().timestamp());
+  EXPECT_GE(CoAP::Tracer::now(), telegram.value().timestamp());
+}
+
+TEST(Tracing, SpansOfAnExchange) {
+  // GIVEN tracing and a messaging with a request handler
+  GlobalTracing tracing;
+  CoAP::Messaging messaging(std::make_shared<LoopbackConnection>());
+  messaging.requestHandler().onUri("hello").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("world");
+  });
+
+  // WHEN a nonconfirmable request is answered
+  auto client = messaging.getClientFor("127.0.0.1");
+  auto response = client.GET("hello", false);
+  while (response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) messaging.loopOnce();
+
+  // THEN request and response are encoded, sent and parsed, and the request is handled
+  const auto trace = chromeTrace(CoAP::Tracer::global());
+  EXPECT_EQ(2, occurrences(trace, "\"name\":\"encode\""));
+  EXPECT_EQ(2, occurrences(trace, "\"name\":\"send\""));
+  EXPECT_EQ(2, occurrences(trace, "\"name\":\"parse\""));
+  EXPECT_EQ(1, occurrences(trace, "\"name\":\"handler\""));
+}
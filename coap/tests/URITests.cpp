@@ -57,3 +57,24 @@ TEST(URI, ParseCoapsURIWithoutPort) {
   EXPECT_EQ(20220, uri.getPort());
   EXPECT_EQ("/.well-known/core", uri.getPath());
 }
+
+TEST(URI, ParseIPv6URI) {
+  auto optionalUri = URI::fromString("coap://[fe80::1%eth0]:4711/home");
+  EXPECT_TRUE(optionalUri);
+  auto& uri = optionalUri.value();
+  EXPECT_EQ("fe80::1%eth0", uri.getServer());
+  EXPECT_EQ(4711, uri.getPort());
+  EXPECT_EQ("/home", uri.getPath());
+}
+
+TEST(URI, ParseIPv6URIWithoutPort) {
+  auto optionalUri = URI::fromString("coap://[::1]/home");
+  EXPECT_TRUE(optionalUri);
+  auto& uri = optionalUri.value();
+  EXPECT_EQ("::1", uri.getServer());
+  EXPECT_EQ(5683, uri.getPort());
+}
+
+TEST(URI, ParseIPv6URIWithoutClosingBracket) {
+  EXPECT_FALSE(URI::fromString("coap://[::1/home"));
+}
@@ -0,0 +1,192 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "CoAP.h"
+#include "RequestHandlers.h"
+#include "UnixConnection.h"
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string socketPath(const char* name) {
+  return "/tmp/coap-test-" + std::to_string(getpid()) + "-" + name;
+}
+
+std::string ipOf(const CoAP::Endpoint& endpoint) {
+  char ip[INET6_ADDRSTRLEN];
+  const auto address = endpoint.ipv6();
+  inet_ntop(AF_INET6, &address, ip, sizeof(ip));
+  return ip;
+}
+
+}  // namespace
+
+TEST(UnixConnection, FailWhenConnectionIsNotOpen) {
+  // GIVEN a connection that was not opened
+  CoAP::UnixConnection conn;
+  const auto endpoint = conn.endpoint("@peer");
+
+  // WHEN we call the functions send or get
+  // THEN we shall get an exception
+  EXPECT_THROW(conn.send(CoAP::Telegram(endpoint, {1})), std::logic_error);
+  EXPECT_THROW(conn.get(std::chrono::milliseconds(0)), std::logic_error);
+}
+
+TEST(UnixConnection, FailWhenOpenedTwice) {
+  // GIVEN an open connection
+  CoAP::UnixConnection conn;
+  conn.open();
+
+  // WHEN it is opened again
+  // THEN we shall get an exception
+  EXPECT_THROW(conn.open(), std::logic_error);
+}
+
+TEST(UnixConnection, PathsAreMappedToUniqueLocalEndpoints) {
+  // GIVEN two paths
+  // WHEN they are mapped to endpoints
+  const auto a = CoAP::UnixConnection::endpointFor("/run/coap/a.sock");
+  const auto b = CoAP::UnixConnection::endpointFor("/run/coap/b.sock");
+
+  // THEN the endpoints are distinct, stable and within fd75:6e69:7800::/48
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a, CoAP::UnixConnection::endpointFor("/run/coap/a.sock"));
+  EXPECT_EQ(0, ipOf(a).find("fd75:6e69:7800:"));
+  EXPECT_EQ(0, a.port());
+}
+
+TEST(UnixConnection, ExchangeThroughTheFileSystem) {
+  // GIVEN a server bound to a path and a client bound to an abstract name chosen by the kernel
+  CoAP::UnixConnection server;
+  CoAP::UnixConnection client;
+  server.open(socketPath("server"));
+  client.open();
+  EXPECT_EQ('@', client.path()[0]);
+
+  struct stat status;
+  ASSERT_EQ(0, stat(server.path().c_str(), &status));
+  EXPECT_TRUE(S_ISSOCK(status.st_mode));
+
+  // WHEN the client sends a telegram to the path of the server
+  client.send(CoAP::Telegram(client.endpoint(server.path()), {1, 2, 3}));
+
+  // THEN the server receives it from the endpoint of the client and can reply to it
+  auto request = server.get(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(request);
+  EXPECT_EQ(std::vector<uint8_t>({1, 2, 3}), request.value().getMessage());
+  EXPECT_EQ(CoAP::UnixConnection::endpointFor(client.path()), request.value().getEndpoint());
+  EXPECT_EQ(client.path(), server.path(request.value().getEndpoint()).value());
+
+  server.send(CoAP::Telegram(request.value().getEndpoint(), {4}));
+  auto response = client.get(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(response);
+  EXPECT_EQ(std::vector<uint8_t>({4}), response.value().getMessage());
+
+  // AND the socket file is removed on close
+  const auto path = server.path();
+  server.close();
+  EXPECT_NE(0, stat(path.c_str(), &status));
+}
+
+TEST(UnixConnection, StaleSocketIsReplaced) {
+  // GIVEN a socket file left behind by another connection
+  const auto path = socketPath("stale");
+  {
+    CoAP::UnixConnection previous;
+    previous.open(path);
+    ASSERT_EQ(0, link(path.c_str(), (path + ".keep").c_str()));
+  }
+  ASSERT_EQ(0, rename((path + ".keep").c_str(), path.c_str()));
+
+  // WHEN a connection is opened at the same path
+  CoAP::UnixConnection conn;
+
+  // THEN it succeeds
+  EXPECT_NO_THROW(conn.open(path));
+}
+
+TEST(UnixConnection, UnknownEndpointIsNotReachable) {
+  // GIVEN an open connection
+  CoAP::UnixConnection conn;
+  conn.open();
+
+  // WHEN a telegram is sent to an endpoint without registered path
+  // THEN we shall get an exception
+  EXPECT_THROW(conn.send(CoAP::Telegram(CoAP::UnixConnection::endpointFor("@nobody"), {1})), std::runtime_error);
+}
+
+TEST(UnixConnection, BatchIsSentAndReceivedInOrder) {
+  // GIVEN two connected sockets in the abstract namespace
+  CoAP::UnixConnection server;
+  CoAP::UnixConnection client;
+  server.open("@coap-test-batch-" + std::to_string(getpid()));
+  client.open();
+
+  // WHEN several batches of telegrams are sent
+  const auto endpoint = client.endpoint(server.path());
+  for (uint8_t batch = 0; batch < 4; ++batch) {
+    std::vector<CoAP::Telegram> telegrams;
+    for (uint8_t i = 0; i < 8; ++i) telegrams.emplace_back(endpoint, std::vector<uint8_t>(i + 1, batch));
+    client.sendBatch(std::move(telegrams));
+
+    // THEN the telegrams are received in order
+    for (uint8_t i = 0; i < 8; ++i) {
+      auto telegram = server.get(std::chrono::milliseconds(1000));
+      ASSERT_TRUE(telegram);
+      EXPECT_EQ(std::vector<uint8_t>(i + 1, batch), telegram.value().getMessage());
+    }
+  }
+  EXPECT_FALSE(server.get(std::chrono::milliseconds(0)));
+  EXPECT_EQ(0, client.dropped());
+}
+
+TEST(UnixConnection, TelegramsAreDroppedWhenTheSocketIsFull) {
+  // GIVEN a server that does not read its socket
+  CoAP::UnixConnection server;
+  CoAP::UnixConnection client;
+  server.open("@coap-test-full-" + std::to_string(getpid()));
+  client.open();
+
+  // WHEN more telegrams are sent than the socket queues
+  const auto endpoint = client.endpoint(server.path());
+  std::vector<CoAP::Telegram> telegrams;
+  for (int i = 0; i < 1000; ++i) telegrams.emplace_back(endpoint, std::vector<uint8_t>(100, 1));
+  client.sendBatch(std::move(telegrams));
+
+  // THEN the sender is not blocked and the surplus is dropped
+  EXPECT_LT(0, client.dropped());
+  size_t received = 0;
+  while (server.get(std::chrono::milliseconds(0))) ++received;
+  EXPECT_EQ(1000, received + client.dropped());
+}
+
+TEST(UnixConnection, Messaging) {
+  // GIVEN a client and a server messaging through Unix domain sockets
+  const auto serverPath = socketPath("messaging");
+  auto server = CoAP::newUnixMessaging(serverPath);
+  auto client = CoAP::newUnixMessaging();
+
+  server->requestHandler().onUri("local").onGet([](const Path&) {
+    return CoAP::RestResponse().withCode(CoAP::Code::Content).withPayload("unix");
+  });
+
+  // WHEN the client sends a confirmable request to the server path
+  auto unixClient = client->getClientFor(serverPath.c_str());
+  auto response = unixClient.GET("local", true);
+  for (int i = 0; i < 10 && response.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready; ++i) {
+    client->loopOnce();
+    server->loopOnce();
+  }
+
+  // THEN the response is received
+  ASSERT_EQ(std::future_status::ready, response.wait_for(std::chrono::milliseconds(0)));
+  auto r = response.get();
+  EXPECT_EQ(CoAP::Code::Content, r.code());
+  EXPECT_EQ("unix", r.payload());
+}
@@ -6,63 +6,9 @@
 
 #include "gtest/gtest.h"
 
-using namespace CoAP;
-
-TEST(without, non_empty) {
-  EXPECT_EQ("abc", __internal__::without('<', '>', "<abc>"));
-}
-
-TEST(without, empty) {
-  EXPECT_EQ("", __internal__::without('<', '>', "<>"));
-}
-
-TEST(without, exception_without_opening_bracket) {
-  EXPECT_THROW(__internal__::without('<', '>', "abc>"), std::runtime_error);
-}
-
-TEST(without, exception_without_closing_bracket) {
-  EXPECT_THROW(__internal__::without('<', '>', "<abc"), std::runtime_error);
-}
-
-TEST(withoutCurly, non_empty) {
-  EXPECT_EQ("abc", __internal__::withoutCurly("{abc}"));
-}
-
-TEST(withoutRect, non_empty) {
-  EXPECT_EQ("abc", __internal__::withoutRect("[abc]"));
-}
-
-TEST(withoutQuot, non_empty) {
-  EXPECT_EQ("abc", __internal__::withoutQuot("\"abc\""));
-}
-
-TEST(find_element_delimiter, simple) {
-  EXPECT_EQ(1U, __internal__::findListDelimiter("a,b"));
-}
-
-TEST(find_element_delimiter, nested) {
-  EXPECT_EQ(5U, __internal__::findListDelimiter("{a,b},c"));
-}
-
-TEST(trimmed, without_spaces) {
-  EXPECT_EQ("hello", __internal__::trimmed("hello"));
-}
-
-TEST(trimmed, leading_spaces) {
-  EXPECT_EQ("hello", __internal__::trimmed("   hello"));
-}
-
-TEST(trimmed, trailing_spaces) {
-  EXPECT_EQ("hello", __internal__::trimmed("hello   "));
-}
+#include <limits>
 
-TEST(trimmed, one_space) {
-  EXPECT_EQ("", __internal__::trimmed(" "));
-}
-
-TEST(trimmed, two_spaces) {
-  EXPECT_EQ("", __internal__::trimmed(" "));
-}
+using namespace CoAP;
 
 TEST(to_json, fromString) {
   EXPECT_EQ("\"text\"", to_json("text"));
@@ -126,6 +72,22 @@ TEST(to_json, fromNaturalDouble) {
   EXPECT_EQ("3", to_json(3));
 }
 
+TEST(to_json, fromDoubleWithoutFraction) {
+  EXPECT_EQ("3", to_json(3.0));
+  EXPECT_EQ("0", to_json(0.0));
+  EXPECT_EQ("10", to_json(10.0));
+}
+
+TEST(to_json, fromNonFiniteDouble) {
+  EXPECT_EQ("null", to_json(std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("null", to_json(std::numeric_limits<double>::quiet_NaN()));
+}
+
+TEST(to_json, fromIntLimits) {
+  EXPECT_EQ("-2147483648", to_json(std::numeric_limits<int>::min()));
+  EXPECT_EQ("4294967295", to_json(std::numeric_limits<unsigned int>::max()));
+}
+
 TEST(to_json, fromNegativeDouble) {
   EXPECT_EQ("-3.141", to_json(-3.141));
 }
@@ -339,4 +301,174 @@ TEST(from_json, toListWithObjects) {
   std::list<Object> result;
   from_json("[ { \"a\" : 1, \"b\" : 2 }, { \"a\" : 3, \"b\" : 4 } ]", result);
   EXPECT_EQ(std::list<Object>({Object(1,2), Object(3,4)}), result);
-}
\ No newline at end of file
+}
+
+TEST(from_json, toListOfStringsWithDelimiters) {
+  // GIVEN strings with list and object delimiters
+  std::list<std::string> result;
+
+  // WHEN the list is read
+  from_json("[\"a,b\", \"]\", \"{\\\"c\\\":1}\"]", result);
+
+  // THEN the delimiters are part of the strings
+  EXPECT_EQ(std::list<std::string>({"a,b", "]", "{\"c\":1}"}), result);
+}
+
+TEST(from_json, toStringWithEscapes) {
+  std::string result;
+  from_json("\"tab\\t \\\"quote\\\" \\\\ \\u00e4 \\ud83d\\ude00\"", result);
+  EXPECT_EQ("tab\t \"quote\" \\ \xc3\xa4 \xf0\x9f\x98\x80", result);
+}
+
+TEST(from_json, toObjectWithKeyInString) {
+  // GIVEN an object with a string containing the key of another member
+  std::map<std::string, std::string> result;
+
+  // WHEN it is read
+  from_json("{\"x\": \"\\\"a\\\":2\", \"a\": \"1\"}", result);
+
+  // THEN both members are found
+  ASSERT_EQ(2U, result.size());
+  EXPECT_EQ("\"a\":2", result["x"]);
+  EXPECT_EQ("1", result["a"]);
+}
+
+TEST(from_json, nullLeavesValueUnchanged) {
+  int value = 7;
+  from_json("null", value);
+  EXPECT_EQ(7, value);
+
+  Object object(1, 2);
+  from_json("{\"a\":null,\"b\":3}", object);
+  EXPECT_EQ(Object(1, 3), object);
+}
+
+TEST(from_json, toIntWithExponentThrows) {
+  int value;
+  EXPECT_THROW(from_json("1e3", value), std::runtime_error);
+
+  double result;
+  from_json("-1.5e3", result);
+  EXPECT_EQ(-1500.0, result);
+}
+
+TEST(from_json, outOfRangeThrows) {
+  int value;
+  EXPECT_THROW(from_json("2147483648", value), std::runtime_error);
+  from_json("-2147483648", value);
+  EXPECT_EQ(-2147483647 - 1, value);
+
+  unsigned int unsignedValue;
+  EXPECT_THROW(from_json("-1", unsignedValue), std::runtime_error);
+  EXPECT_THROW(from_json("4294967296", unsignedValue), std::runtime_error);
+}
+
+TEST(from_json, malformedThrows) {
+  std::list<int> list;
+  EXPECT_THROW(from_json("[1,2", list), std::runtime_error);
+  EXPECT_THROW(from_json("[1,,2]", list), std::runtime_error);
+  EXPECT_THROW(from_json("[1,2] 3", list), std::runtime_error);
+
+  std::string str;
+  EXPECT_THROW(from_json("\"open", str), std::runtime_error);
+  EXPECT_THROW(from_json("\"\\x\"", str), std::runtime_error);
+
+  std::map<std::string, int> map;
+  EXPECT_THROW(from_json("{\"a\" 1}", map), std::runtime_error);
+  EXPECT_THROW(from_json("{a:1}", map), std::runtime_error);
+
+  Object object;
+  EXPECT_THROW(from_json("{\"a\":{\"b\":1}", object), std::runtime_error);
+}
+
+TEST(from_json, largeListInLinearTime) {
+  // GIVEN a list with 100000 elements
+  std::string json = "[0";
+  for (int i = 1; i < 100000; ++i) json += "," + std::to_string(i);
+  json += "]";
+
+  // WHEN it is read
+  std::list<int> result;
+  from_json(json, result);
+
+  // THEN all elements are read without copying the remainder of the list for each of them
+  ASSERT_EQ(100000U, result.size());
+  EXPECT_EQ(99999, result.back());
+}
+
+TEST(to_json, fromStringWithEscapes) {
+  // GIVEN a string with characters that must be escaped
+  const std::string text = "\"quote\" \\ tab\t line\n \x01";
+
+  // WHEN it is converted to JSON
+  const auto json = to_json(text);
+
+  // THEN they are escaped and the string is read back unchanged
+  EXPECT_EQ("\"\\\"quote\\\" \\\\ tab\\t line\\n \\u0001\"", json);
+  std::string result;
+  from_json(json, result);
+  EXPECT_EQ(text, result);
+}
+
+TEST(append_json, reusesTheOutput) {
+  // GIVEN an output with capacity for the value
+  std::string out;
+  out.reserve(64);
+  const auto data = out.data();
+
+  // WHEN values are appended
+  append_json(out, std::list<int>({1, 2}));
+  out += ',';
+  append_json(out, "key", 1.5);
+
+  // THEN they are written into the output without reallocating it
+  EXPECT_EQ("[1,2],\"key\":1.5", out);
+  EXPECT_EQ(data, out.data());
+
+  // AND after clearing the next value is written into the same storage
+  out.clear();
+  append_json(out, std::map<std::string, bool>{{"a", true}});
+  EXPECT_EQ("{\"a\":true}", out);
+  EXPECT_EQ(data, out.data());
+}
+
+namespace {
+// Appends its members to the output instead of returning them
+class AppendingObject {
+  int a_{0};
+  std::list<std::string> b_;
+ public:
+  AppendingObject() = default;
+  AppendingObject(int a, std::list<std::string> b) : a_(a), b_(b) { }
+
+  bool operator==(const AppendingObject& rhs) const {
+    return a_ == rhs.a_
+        && b_ == rhs.b_;
+  }
+
+  void to_json(std::string& out) const {
+    ::append_json(out, "a", a_);
+    out += ',';
+    ::append_json(out, "b", b_);
+  }
+
+  void from_json(const std::string& j) {
+    ::from_json(j, "a", a_);
+    ::from_json(j, "b", b_);
+  }
+};
+}
+
+TEST(to_json, fromAppendingObject) {
+  // GIVEN a list of objects that append their members
+  auto l = std::list<AppendingObject>({AppendingObject(1, {"x"}), AppendingObject(2, {})});
+
+  // WHEN it is converted to JSON
+  const auto json = to_json(l);
+
+  // THEN the members are written in place and can be read back
+  EXPECT_EQ("[{\"a\":1,\"b\":[\"x\"]},{\"a\":2,\"b\":[]}]", json);
+  std::list<AppendingObject> result;
+  from_json(json, result);
+  EXPECT_EQ(l, result);
+}
@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Arguments.h"
+
+#include <StringHelpers.h>
+
+#include <cstdlib>
+
+namespace {
+
+bool toUnsigned(const char* from, unsigned& to) {
+  char* end;
+  const auto value = strtoul(from, &end, 10);
+  if (*from == '\0' || *end != '\0' || value > UINT32_MAX) return false;
+  to = static_cast<unsigned>(value);
+  return true;
+}
+
+// Parses weights like "get=8,put=1,observe=1", omitted request types get weight 0
+bool toMix(const std::string& from, Arguments::Mix& to) {
+  to = Arguments::Mix();
+  to.get = 0;
+
+  for (const auto& entry : splitAll(from, ',')) {
+    const auto parts = splitFirst(entry, '=');
+    unsigned weight;
+    if (not toUnsigned(parts.second.c_str(), weight)) return false;
+
+    if (parts.first == "get") to.get = weight;
+    else if (parts.first == "put") to.put = weight;
+    else if (parts.first == "post") to.post = weight;
+    else if (parts.first == "observe") to.observe = weight;
+    else return false;
+  }
+
+  return to.get + to.put + to.post + to.observe > 0;
+}
+
+bool positive(const char* from, unsigned& to) {
+  return toUnsigned(from, to) && to > 0;
+}
+
+}  // namespace
+
+Optional<Arguments> Arguments::fromArgv(int argc, const char** argv) {
+  Arguments arguments;
+
+  auto arg = 1;
+  for (; arg < argc - 1; ++arg) {
+    const std::string option = argv[arg];
+    if (option == "-n") {
+      arguments.confirmable_ = false;
+      continue;
+    }
+
+    // All other options have a value
+    if (arg + 1 >= argc - 1) return Optional<Arguments>();
+    const auto value = argv[++arg];
+    unsigned number;
+
+    if (option == "-r" && positive(value, number)) arguments.rate_ = number;
+    else if (option == "-c" && positive(value, number)) arguments.concurrency_ = number;
+    else if (option == "-d" && positive(value, number)) arguments.duration_ = std::chrono::seconds(number);
+    else if (option == "-t" && positive(value, number)) arguments.timeout_ = std::chrono::milliseconds(number);
+    else if (option == "-m" && toMix(value, arguments.mix_)) continue;
+    else if (option == "-p") arguments.payload_ = value;
+    else if (option == "-o") arguments.traceFile_ = value;
+    else return Optional<Arguments>();
+  }
+
+  if (arg != argc - 1) return Optional<Arguments>();
+
+  auto uri = URI::fromString(argv[arg]);
+  if (not uri) return Optional<Arguments>();
+  arguments.uri_ = std::move(uri.value());
+
+  return Optional<Arguments>(arguments);
+}
@@ -0,0 +1,62 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Arguments_h
+#define __Arguments_h
+
+#include <Optional.h>
+#include <URI.h>
+
+#include <chrono>
+#include <string>
+
+class Arguments {
+ public:
+  // Relative weights of the request types
+  struct Mix {
+    unsigned get{1};
+    unsigned put{0};
+    unsigned post{0};
+    unsigned observe{0};
+  };
+
+  static Optional<Arguments> fromArgv(int argc, const char** argv);
+
+  const URI& getUri() const { return uri_; }
+
+  /// Requests per second for the open loop, 0 for the closed loop
+  unsigned getRate() const { return rate_; }
+
+  /// Requests in flight for the closed loop
+  unsigned getConcurrency() const { return concurrency_; }
+
+  std::chrono::seconds getDuration() const { return duration_; }
+
+  /// Time after which a request without response counts as lost
+  std::chrono::milliseconds getTimeout() const { return timeout_; }
+
+  const Mix& getMix() const { return mix_; }
+
+  const std::string& getPayload() const { return payload_; }
+
+  bool isConfirmable() const { return confirmable_; }
+
+  /// File the trace of the exchanges is written to, empty if not tracing
+  const std::string& getTraceFile() const { return traceFile_; }
+
+ private:
+  URI uri_;
+  unsigned rate_{0};
+  unsigned concurrency_{1};
+  std::chrono::seconds duration_{10};
+  std::chrono::milliseconds timeout_{5000};
+  Mix mix_;
+  std::string payload_;
+  bool confirmable_{true};
+  std::string traceFile_;
+};
+
+#endif  // __Arguments_h
@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr unsigned SUB_BUCKET_BITS = 7;
+constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+}  // namespace
+
+Histogram::Histogram() : counts_((64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS) {
+}
+
+// Values below SUB_BUCKETS are kept exactly, above that the bucket is given by the
+// position of the highest bit and the sub-bucket by the SUB_BUCKET_BITS bits below it.
+unsigned Histogram::bucket(uint64_t value) {
+  if (value < SUB_BUCKETS) return value;
+
+  const unsigned magnitude = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS + 1;
+  return magnitude * SUB_BUCKETS + ((value >> (magnitude - 1)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Histogram::highest(unsigned bucket) {
+  const unsigned magnitude = bucket / SUB_BUCKETS;
+  if (magnitude == 0) return bucket;
+
+  const uint64_t lowest = (SUB_BUCKETS | (bucket % SUB_BUCKETS)) << (magnitude - 1);
+  return lowest + (uint64_t(1) << (magnitude - 1)) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+  ++counts_[bucket(value)];
+  ++count_;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+uint64_t Histogram::percentile(double percentile) const {
+  if (count_ == 0) return 0;
+
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count_)));
+  uint64_t seen = 0;
+  for (unsigned i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(highest(i), max_);
+  }
+  return max_;
+}
@@ -0,0 +1,54 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#ifndef __Histogram_h
+#define __Histogram_h
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Histogram of latencies with logarithmic buckets in the style of HdrHistogram.
+ *
+ * Every power of two range is split into 128 linear sub-buckets, thus recorded
+ * values are kept with a relative error below 1% over the full range of uint64_t
+ * at a fixed memory footprint and constant recording cost.
+ */
+class Histogram {
+ public:
+  Histogram();
+
+  void record(uint64_t value);
+
+  uint64_t count() const { return count_; }
+
+  uint64_t min() const { return count_ ? min_ : 0; }
+
+  uint64_t max() const { return max_; }
+
+  double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+  /**
+   * Returns the value below or at which the given percentage of the recorded values lie.
+   *
+   * @param percentile  Percentage between 0 and 100
+   */
+  uint64_t percentile(double percentile) const;
+
+ private:
+  static unsigned bucket(uint64_t value);
+
+  // Highest value that is mapped to the bucket
+  static uint64_t highest(unsigned bucket);
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_{0};
+  uint64_t min_{UINT64_MAX};
+  uint64_t max_{0};
+  uint64_t sum_{0};
+};
+
+#endif  // __Histogram_h
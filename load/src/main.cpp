@@ -0,0 +1,190 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Arguments.h"
+#include "CoAP.h"
+#include "Histogram.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <random>
+
+// Sample arguments:
+//
+// -r 5000 -d 30 -n coap://localhost:5683/name
+// -c 16 -m get=8,put=1,observe=1 -p load coap://localhost:5683/observable
+//
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum RequestType { GET, PUT, POST, OBSERVE };
+
+const char* names[] = {"GET", "PUT", "POST", "OBSERVE"};
+
+struct Request {
+  RequestType type;
+  // Time at which the request should have been sent, the latency is measured from
+  // there such that a stalled server cannot hide its queueing delay (coordinated omission)
+  Clock::time_point intended;
+  std::future<CoAP::RestResponse> response;
+  // Kept until the first notification arrived, then the observation is cancelled
+  std::shared_ptr<CoAP::Notifications> observation;
+};
+
+void usage() {
+  std::cout << "Usage: coap_load [-r <rate> | -c <concurrency>] [-d <seconds>] [-t <ms>]\n";
+  std::cout << "                 [-m <mix>] [-p <payload>] [-n] [-o <trace>] <uri>\n";
+  std::cout << "       -r      : open loop, requests per second independent of the responses\n";
+  std::cout << "       -c      : closed loop, number of requests in flight (default 1)\n";
+  std::cout << "       -d      : duration of the test in seconds (default 10)\n";
+  std::cout << "       -t      : time in milliseconds after which a request counts as lost (default 5000)\n";
+  std::cout << "       -m      : weights of the request types, e.g. get=8,put=1,post=1,observe=0 (default get=1)\n";
+  std::cout << "       -p      : payload of PUT and POST requests\n";
+  std::cout << "       -n      : nonconfirmable messages\n";
+  std::cout << "       -o      : file the spans of the last exchanges are written to in the Chrome trace format\n";
+  std::cout << "       uri     : coap://localhost:5683/name\n";
+  exit(1);
+}
+
+Request send(CoAP::Client& client, RequestType type, Clock::time_point intended, const Arguments& arguments) {
+  const auto& path = arguments.getUri().getPath();
+  const auto confirmable = arguments.isConfirmable();
+
+  Request request{type, intended, std::future<CoAP::RestResponse>(), nullptr};
+  switch (type) {
+    case GET:
+      request.response = client.GET(path, confirmable);
+      break;
+    case PUT:
+      request.response = client.PUT(path, arguments.getPayload(), confirmable);
+      break;
+    case POST:
+      request.response = client.POST(path, arguments.getPayload(), confirmable);
+      break;
+    case OBSERVE: {
+      auto first = std::make_shared<std::promise<CoAP::RestResponse>>();
+      auto received = std::make_shared<bool>(false);
+      request.response = first->get_future();
+      request.observation = client.OBSERVE(path, confirmable);
+      request.observation->subscribe([first, received](const CoAP::RestResponse& response) {
+        if (*received) return;
+        *received = true;
+        first->set_value(response);
+      });
+      break;
+    }
+  }
+  return request;
+}
+
+void printLatency(const char* name, uint64_t microseconds) {
+  printf("  %-8s %10.3f ms\n", name, microseconds / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  const auto parsed = Arguments::fromArgv(argc, argv);
+  if (not parsed) usage();
+  const auto& arguments = parsed.value();
+  const auto& uri = arguments.getUri();
+
+  // The requests are sent from the thread running the message processing loop
+  auto messaging = CoAP::newMessaging(0);
+  auto client = messaging->getClientFor(uri.getServer().c_str(), uri.getPort());
+  const auto openLoop = arguments.getRate() > 0;
+  client.setWindow(openLoop ? UINT16_MAX : arguments.getConcurrency());
+
+  const auto& mix = arguments.getMix();
+  std::mt19937 random(std::random_device{}());
+  std::discrete_distribution<int> types({double(mix.get), double(mix.put), double(mix.post), double(mix.observe)});
+  const auto interval = openLoop ? Clock::duration(std::chrono::seconds(1)) / arguments.getRate() : Clock::duration(0);
+
+  std::list<Request> inFlight;
+  Histogram latencies;
+  uint64_t sent[4] = {0, 0, 0, 0};
+  uint64_t lost = 0;
+  uint64_t errors = 0;
+
+  if (not arguments.getTraceFile().empty()) CoAP::Tracer::global().enable();
+
+  const auto start = Clock::now();
+  const auto end = start + arguments.getDuration();
+  auto next = start;
+  auto now = start;
+
+  while (now < end || not inFlight.empty()) {
+    if (now < end) {
+      if (openLoop) {
+        // Requests that are overdue are sent at once and keep their intended time
+        for (; next <= now && next < end; next += interval) {
+          const auto type = static_cast<RequestType>(types(random));
+          inFlight.emplace_back(send(client, type, next, arguments));
+          ++sent[type];
+        }
+      } else {
+        while (inFlight.size() < arguments.getConcurrency()) {
+          const auto type = static_cast<RequestType>(types(random));
+          inFlight.emplace_back(send(client, type, now, arguments));
+          ++sent[type];
+        }
+      }
+    }
+
+    // Waiting for the next request to be due, busy when it is due within a millisecond
+    auto wait = std::chrono::milliseconds(1);
+    if (openLoop && now < end) wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(next - now));
+    messaging->loopOnce(wait);
+
+    now = Clock::now();
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+      if (it->response.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        const auto code = static_cast<int>(it->response.get().code());
+        if ((code >> 5) != 2) ++errors;
+        latencies.record(std::chrono::duration_cast<std::chrono::microseconds>(now - it->intended).count());
+        it = inFlight.erase(it);
+      } else if (now - it->intended > arguments.getTimeout()) {
+        ++lost;
+        it = inFlight.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (not arguments.getTraceFile().empty()) {
+    std::ofstream trace(arguments.getTraceFile());
+    CoAP::Tracer::global().exportChromeTrace(trace);
+  }
+
+  const auto total = sent[GET] + sent[PUT] + sent[POST] + sent[OBSERVE];
+  const auto seconds = std::chrono::duration<double>(arguments.getDuration()).count();
+
+  printf("Target:      %s:%u%s (%s loop, %s)\n", uri.getServer().c_str(), uri.getPort(), uri.getPath().c_str(),
+         openLoop ? "open" : "closed", arguments.isConfirmable() ? "confirmable" : "nonconfirmable");
+  printf("Requests:    %llu sent", static_cast<unsigned long long>(total));
+  for (int type = GET; type <= OBSERVE; ++type) {
+    if (sent[type]) printf(", %llu %s", static_cast<unsigned long long>(sent[type]), names[type]);
+  }
+  printf("\n");
+  printf("Responses:   %llu received, %llu errors\n", static_cast<unsigned long long>(latencies.count()),
+         static_cast<unsigned long long>(errors));
+  printf("Loss:        %llu (%.3f %%)\n", static_cast<unsigned long long>(lost), total ? 100.0 * lost / total : 0.0);
+  printf("Throughput:  %.1f requests/s, %.1f responses/s\n", total / seconds, latencies.count() / seconds);
+  printf("Latency:\n");
+  printLatency("min", latencies.min());
+  printLatency("p50", latencies.percentile(50));
+  printLatency("p90", latencies.percentile(90));
+  printLatency("p99", latencies.percentile(99));
+  printLatency("p99.9", latencies.percentile(99.9));
+  printLatency("p99.99", latencies.percentile(99.99));
+  printLatency("max", latencies.max());
+  printf("  %-8s %10.3f ms\n", "mean", latencies.mean() / 1000.0);
+
+  return lost == total ? 1 : 0;
+}
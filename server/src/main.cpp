@@ -4,13 +4,26 @@
 
 #include "CoAP.h"
 
+#include <Logging.h>
 #include <list>
 #include <map>
 #include <string>
 
+SETLOGLEVEL(LLWARNING)
+
 int main() {
   auto messaging = CoAP::newMessaging();
 
+  // Answer requests to the "All CoAP Nodes" multicast group as well, if the host has a multicast route
+  try {
+    messaging->joinMulticastGroup(CoAP::MClient::allNodesIPv4());
+  } catch (std::exception& e) {
+    WLOG << "Serving unicast requests only, joining the multicast group failed: " << e.what() << '\n';
+  }
+
+  // Serve the traffic statistics at /.well-known/metrics
+  messaging->exposeMetrics();
+
   auto name = std::string("coap_server");
   auto dynamic = std::map<int, std::string>();
   auto dynamic_index = 0;